@@ -0,0 +1,82 @@
+//
+//  aead_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Compares AES 256 GCM and ChaCha20-Poly1305 of the C core, the same choice `EHREncryption.aeadBenchmark`
+//  makes on device. On CPUs without AES instructions (OPENSSL_ia32cap="~0x200000200000000") ChaCha20 wins.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/rand.h>
+#include "aes256.h"
+#include "alloc_count.h"
+#include "chacha20_poly1305.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, size_t size, long iterations, double elapsed_ns, unsigned long allocations) {
+  double ns_per_op = elapsed_ns / (double)iterations;
+  printf("%-18s %8zu B %10.0f ns/op %9.1f MB/s %6.2f allocs/op\n",
+         name, size, ns_per_op, (double)size / ns_per_op * 1e3, (double)allocations / (double)iterations);
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 100000;
+  const size_t sizes[] = { 64, 2048, 65536 };
+
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  RAND_bytes(key, sizeof(key));
+  RAND_bytes(iv, sizeof(iv));
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    long n = size > 4096 ? iterations / 16 + 1 : iterations;
+    size_t capacity = size + AES256_TAG_LENGTH;
+    unsigned char *plain = malloc(size);
+    unsigned char *buffer = malloc(capacity);
+    size_t length = 0;
+    int ok = 1;
+    RAND_bytes(plain, (int)size);
+
+    // Warm up the per thread contexts, round trips run in place like in aes256_bench
+    memcpy(buffer, plain, size);
+    ok &= aes256_encrypt(Aes256_block_mode_gcm, key, iv, buffer, size, buffer, capacity, &length, NULL);
+    ok &= aes256_decrypt(Aes256_block_mode_gcm, key, iv, buffer, length, buffer, capacity, &length, NULL);
+    ok &= chacha20_poly1305_encrypt(key, iv, buffer, size, buffer, capacity, &length, NULL);
+    ok &= chacha20_poly1305_decrypt(key, iv, buffer, length, buffer, capacity, &length, NULL);
+
+    unsigned long allocations = alloc_count();
+    double start = now_ns();
+    for (long i = 0; i < n && ok; i++) {
+      ok &= aes256_encrypt(Aes256_block_mode_gcm, key, iv, buffer, size, buffer, capacity, &length, NULL);
+      ok &= aes256_decrypt(Aes256_block_mode_gcm, key, iv, buffer, length, buffer, capacity, &length, NULL);
+    }
+    report("aes-256-gcm", size, n, now_ns() - start, alloc_count() - allocations);
+
+    allocations = alloc_count();
+    start = now_ns();
+    for (long i = 0; i < n && ok; i++) {
+      ok &= chacha20_poly1305_encrypt(key, iv, buffer, size, buffer, capacity, &length, NULL);
+      ok &= chacha20_poly1305_decrypt(key, iv, buffer, length, buffer, capacity, &length, NULL);
+    }
+    report("chacha20-poly1305", size, n, now_ns() - start, alloc_count() - allocations);
+
+    if (!ok || length != size || memcmp(buffer, plain, size) != 0) {
+      fprintf(stderr, "round trip failed for %zu\n", size);
+      return 1;
+    }
+    free(plain);
+    free(buffer);
+  }
+  return 0;
+}
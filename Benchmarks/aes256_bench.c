@@ -0,0 +1,134 @@
+//
+//  aes256_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Compares the buffer API of aes256.c with a C model of the copy pattern of the Data based AES256 API.
+//  The "copy model" row counts the allocations of that model, not ones measured in `AES256.encrypt`.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include "aes256.h"
+#include "alloc_count.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+ Hand written model of the copies `AES256.encrypt(data:key:iv:blockMode:)` makes per record: copies key, IV and
+ data, creates a cipher, encrypts into a new buffer and copies the result once more. Its allocations are the
+ model's own, the Swift API allocates through its runtime and CryptoSwift and is not measured here.
+ */
+static size_t copying_encrypt(enum Aes256_block_mode mode, const unsigned char *key, const unsigned char *iv, const unsigned char *in, size_t length, unsigned char **result) {
+  unsigned char *key_copy = malloc(AES256_KEY_LENGTH);
+  unsigned char *iv_copy = malloc(AES256_IV_LENGTH);
+  unsigned char *in_copy = malloc(length);
+  memcpy(key_copy, key, AES256_KEY_LENGTH);
+  memcpy(iv_copy, iv, AES256_IV_LENGTH);
+  memcpy(in_copy, in, length);
+
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(ctx, mode == Aes256_block_mode_gcm ? EVP_aes_256_gcm() : EVP_aes_256_cbc(), NULL, NULL, NULL);
+  if (mode == Aes256_block_mode_gcm) {
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, AES256_IV_LENGTH, NULL);
+  }
+  EVP_EncryptInit_ex(ctx, NULL, NULL, key_copy, iv_copy);
+  unsigned char *digest = malloc(length + 2 * AES256_BLOCK_LENGTH);
+  int updatel = 0;
+  int finall = 0;
+  EVP_EncryptUpdate(ctx, digest, &updatel, in_copy, (int)length);
+  EVP_EncryptFinal_ex(ctx, digest + updatel, &finall);
+  size_t total = (size_t)updatel + (size_t)finall;
+  if (mode == Aes256_block_mode_gcm) {
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AES256_TAG_LENGTH, digest + total);
+    total += AES256_TAG_LENGTH;
+  }
+  EVP_CIPHER_CTX_free(ctx);
+
+  *result = malloc(total);
+  memcpy(*result, digest, total);
+  free(digest);
+  free(in_copy);
+  free(iv_copy);
+  free(key_copy);
+  return total;
+}
+
+static void report(const char *name, const char *mode, size_t size, long iterations, double elapsed_ns, unsigned long allocations) {
+  double ns_per_op = elapsed_ns / (double)iterations;
+  printf("%-16s %-4s %8zu B %10.0f ns/op %9.1f MB/s %6.2f allocs/op\n",
+         name, mode, size, ns_per_op, (double)size / ns_per_op * 1e3, (double)allocations / (double)iterations);
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 100000;
+  const size_t sizes[] = { 64, 2048, 65536 };
+  const enum Aes256_block_mode modes[] = { Aes256_block_mode_gcm, Aes256_block_mode_cbc };
+
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  RAND_bytes(key, sizeof(key));
+  RAND_bytes(iv, sizeof(iv));
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    long n = size > 4096 ? iterations / 16 + 1 : iterations;
+    unsigned char *plain = malloc(size);
+    unsigned char *buffer = malloc(size + 2 * AES256_BLOCK_LENGTH);
+    RAND_bytes(plain, (int)size);
+
+    for (size_t m = 0; m < 2; m++) {
+      enum Aes256_block_mode mode = modes[m];
+      const char *mode_name = mode == Aes256_block_mode_gcm ? "gcm" : "cbc";
+      size_t capacity = size + 2 * AES256_BLOCK_LENGTH;
+      size_t length = 0;
+
+      // Warm up the per thread contexts
+      aes256_encrypt(mode, key, iv, plain, size, buffer, capacity, &length, NULL);
+      aes256_decrypt(mode, key, iv, buffer, length, buffer, capacity, &length, NULL);
+
+      unsigned long allocations = alloc_count();
+      double start = now_ns();
+      for (long i = 0; i < n; i++) {
+        unsigned char *result = NULL;
+        copying_encrypt(mode, key, iv, plain, size, &result);
+        free(result);
+      }
+      report("copy model", mode_name, size, n, now_ns() - start, alloc_count() - allocations);
+
+      allocations = alloc_count();
+      start = now_ns();
+      for (long i = 0; i < n; i++) {
+        aes256_encrypt(mode, key, iv, plain, size, buffer, capacity, &length, NULL);
+      }
+      report("buffer", mode_name, size, n, now_ns() - start, alloc_count() - allocations);
+
+      memcpy(buffer, plain, size);
+      allocations = alloc_count();
+      start = now_ns();
+      int ok = 1;
+      for (long i = 0; i < n && ok; i++) {
+        // In place round trip, the buffer holds the plaintext again after every iteration
+        ok &= aes256_encrypt(mode, key, iv, buffer, size, buffer, capacity, &length, NULL);
+        ok &= aes256_decrypt(mode, key, iv, buffer, length, buffer, capacity, &length, NULL);
+      }
+      report("in-place loop", mode_name, size, n, now_ns() - start, alloc_count() - allocations);
+      if (!ok || length != size || memcmp(buffer, plain, size) != 0) {
+        fprintf(stderr, "in place round trip failed for %s %zu\n", mode_name, size);
+        return 1;
+      }
+    }
+    free(plain);
+    free(buffer);
+  }
+  return 0;
+}
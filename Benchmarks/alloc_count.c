@@ -0,0 +1,49 @@
+//
+//  alloc_count.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "alloc_count.h"
+
+#ifdef __GLIBC__
+
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long allocations;
+
+/*
+ The benchmark binary interposes the allocator entry points, so allocations made by OpenSSL
+ and by the Krypt C core are counted as well.
+ */
+void *malloc(size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+unsigned long alloc_count(void) {
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+#else
+
+unsigned long alloc_count(void) {
+  return 0;
+}
+
+#endif
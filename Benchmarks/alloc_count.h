@@ -0,0 +1,19 @@
+//
+//  alloc_count.h
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef alloc_count_h
+#define alloc_count_h
+
+#include <stdio.h>
+
+/**
+ Number of heap allocations (malloc, calloc, realloc) made by the process so far.
+ Counting works with glibc, elsewhere it always returns 0.
+ */
+unsigned long alloc_count(void);
+
+#endif /* alloc_count_h */
@@ -0,0 +1,129 @@
+//
+//  ca_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  S/MIME certificates per second issued by a local CA with an RSA 2048 and a P-256 key,
+//  per thread count and output format. The first certificate of every run is verified against the CA.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include "alloc_count.h"
+#include "ca.h"
+#include "key_pool.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, int threads, long iterations, double elapsed_ns, unsigned long allocations) {
+  printf("%-14s %2d threads %10.0f ns/op %8.0f certs/s %8.2f allocs/op\n",
+         name, threads, elapsed_ns / (double)iterations, (double)iterations / (elapsed_ns / 1e9),
+         (double)allocations / (double)iterations);
+}
+
+static char *write_pem(EVP_PKEY *pkey, int private) {
+  BIO *bio = BIO_new(BIO_s_mem());
+  int ok = bio && (private ? PEM_write_bio_PrivateKey(bio, pkey, NULL, NULL, 0, NULL, NULL) : PEM_write_bio_PUBKEY(bio, pkey));
+  char *pem = NULL;
+  if (ok == 1) {
+    BUF_MEM *mem = NULL;
+    BIO_get_mem_ptr(bio, &mem);
+    pem = strndup(mem->data, mem->length);
+  }
+  BIO_free(bio);
+  return pem;
+}
+
+static int verify(const struct Ca *ca, const struct Ca_output *output, enum Ca_format format) {
+  char *ca_pem = ca_certificate_pem(ca);
+  BIO *bio = ca_pem ? BIO_new_mem_buf(ca_pem, -1) : NULL;
+  X509 *issuer = bio ? PEM_read_bio_X509(bio, NULL, NULL, NULL) : NULL;
+  BIO_free(bio);
+  X509 *x = NULL;
+  if (format == Ca_format_pem) {
+    bio = BIO_new_mem_buf(output->data, (int)output->length);
+    x = bio ? PEM_read_bio_X509(bio, NULL, NULL, NULL) : NULL;
+    BIO_free(bio);
+  } else {
+    const unsigned char *p = output->data;
+    x = d2i_X509(NULL, &p, (long)output->length);
+  }
+  int ok = issuer && x && X509_verify(x, X509_get0_pubkey(issuer)) == 1;
+  X509_free(x);
+  X509_free(issuer);
+  free(ca_pem);
+  return ok;
+}
+
+static int run(const char *name, enum Key_pool_type type, const char *subject_pem, long iterations, long processors) {
+  EVP_PKEY *pkey = key_pool_generate(type, NULL);
+  char *key_pem = pkey ? write_pem(pkey, 1) : NULL;
+  struct Ca *ca = key_pem ? ca_new_self_signed(key_pem, "Krypt Benchmark CA", 86400, NULL) : NULL;
+  struct Ca_request *requests = calloc((size_t)iterations, sizeof(struct Ca_request));
+  struct Ca_output *outputs = calloc((size_t)iterations, sizeof(struct Ca_output));
+  char (*emails)[32] = calloc((size_t)iterations, sizeof(*emails));
+  if (!ca || !requests || !outputs || !emails) {
+    fprintf(stderr, "setup failed\n");
+    return 0;
+  }
+  for (long i = 0; i < iterations; i++) {
+    snprintf(emails[i], sizeof(emails[i]), "user%ld@vivy.com", i);
+    requests[i] = (struct Ca_request){ NULL, subject_pem, "Load Test", emails[i] };
+  }
+  struct Ca_profile profile = { 86400, 300, 1 };
+
+  int ok = 1;
+  for (long threads = 1; ok && threads <= (processors < 2 ? 2 : processors); threads *= 2) {
+    for (int format = Ca_format_der; ok && format <= Ca_format_pem; format++) {
+      unsigned long allocations = alloc_count();
+      double start = now_ns();
+      ok = ca_issue_batch(ca, &profile, requests, (size_t)iterations, format, (int)threads, outputs, NULL) &&
+           verify(ca, &outputs[0], format);
+      if (ok) {
+        char label[32];
+        snprintf(label, sizeof(label), "%s %s", name, format == Ca_format_der ? "der" : "pem");
+        report(label, (int)threads, iterations, now_ns() - start, alloc_count() - allocations);
+      }
+      ca_output_free(outputs, (size_t)iterations);
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "%s issuing failed\n", name);
+  }
+
+  free(emails);
+  free(outputs);
+  free(requests);
+  ca_free(ca);
+  free(key_pem);
+  EVP_PKEY_free(pkey);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  // the certified key does not influence the cost, one subject key for all certificates
+  EVP_PKEY *subject = key_pool_generate(Key_pool_type_ec_p256, NULL);
+  char *subject_pem = subject ? write_pem(subject, 0) : NULL;
+  if (!subject_pem) {
+    fprintf(stderr, "setup failed\n");
+    return 1;
+  }
+  int ok = run("ca rsa2048", Key_pool_type_rsa_2048, subject_pem, iterations, processors) &&
+           run("ca p256", Key_pool_type_ec_p256, subject_pem, iterations, processors);
+  free(subject_pem);
+  EVP_PKEY_free(subject);
+  return ok ? 0 : 1;
+}
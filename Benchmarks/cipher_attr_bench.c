@@ -0,0 +1,55 @@
+//
+//  cipher_attr_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Per record cost of the CipherAttr JSON fast path in cipher_attr.c.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aes256.h"
+#include "alloc_count.h"
+#include "cipher_attr.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  const char *layouts[][2] = {
+    { "contract", "{\"base64EncodedKey\":\"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=\",\"base64EncodedIV\":\"DGgfmKl7kNGzMlW5Li\\/Ilw==\"}" },
+    { "reordered", "{\n  \"base64EncodedIV\" : \"DGgfmKl7kNGzMlW5Li/Ilw==\",\n  \"base64EncodedKey\" : \"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=\"\n}" },
+    { "fallback", "{\"base64EncodedKey\":\"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=\",\"base64EncodedIV\":\"DGgfmKl7kNGzMlW5Li\\/Ilw==\",\"v\":1}" },
+  };
+
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+    const unsigned char *json = (const unsigned char *)layouts[l][1];
+    size_t length = strlen(layouts[l][1]);
+    int expected = cipher_attr_parse(json, length, key, iv);
+
+    unsigned long allocations = alloc_count();
+    double start = now_ns();
+    int ok = 1;
+    for (long i = 0; i < iterations; i++) {
+      ok &= cipher_attr_parse(json, length, key, iv) == expected;
+    }
+    double ns_per_op = (now_ns() - start) / (double)iterations;
+    printf("%-10s %4zu B %8.1f ns/op %6.2f allocs/op %s\n",
+           layouts[l][0], length, ns_per_op, (double)(alloc_count() - allocations) / (double)iterations,
+           expected ? "parsed" : "needs fallback");
+    if (!ok) {
+      fprintf(stderr, "unstable result for %s\n", layouts[l][0]);
+      return 1;
+    }
+  }
+  return 0;
+}
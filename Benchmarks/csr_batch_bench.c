@@ -0,0 +1,117 @@
+//
+//  csr_batch_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  CSRs per second with RSA 2048: `createCSR` per request compared with `csr_batch_create`
+//  and with the bare signature, the lower bound of a CSR.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include "alloc_count.h"
+#include "csr.h"
+#include "csr_batch.h"
+#include "key_pool.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, int threads, long iterations, double elapsed_ns, unsigned long allocations) {
+  printf("%-10s %2d threads %10.0f ns/op %8.0f CSR/s %8.2f allocs/op\n",
+         name, threads, elapsed_ns / (double)iterations, (double)iterations / (elapsed_ns / 1e9),
+         (double)allocations / (double)iterations);
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 200;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  EVP_PKEY *pkey = key_pool_generate(Key_pool_type_rsa_2048, NULL);
+  BIO *bio = BIO_new(BIO_s_mem());
+  char *pem = NULL;
+  if (pkey && bio && PEM_write_bio_PrivateKey(bio, pkey, NULL, NULL, 0, NULL, NULL) == 1) {
+    BUF_MEM *mem = NULL;
+    BIO_get_mem_ptr(bio, &mem);
+    pem = strndup(mem->data, mem->length);
+  }
+  BIO_free(bio);
+  struct Csr_key *key = pem ? csr_key_new_pem(pem, NULL) : NULL;
+  struct Csr_template_entry entries[] = {
+    { "C", "DE" }, { "ST", "Berlin" }, { "L", "Berlin" }, { "O", "Vivy GmbH" }, { "OU", "IT" },
+    { "emailAddress", NULL }, { "UID", NULL }, { "GN", NULL }, { "SN", NULL }
+  };
+  struct Csr_template *subject = csr_template_new(entries, sizeof(entries) / sizeof(entries[0]), NULL);
+  struct Csr_batch_request *requests = calloc((size_t)iterations, sizeof(struct Csr_batch_request));
+  struct Csr_batch_output *outputs = calloc((size_t)iterations, sizeof(struct Csr_batch_output));
+  if (!key || !subject || !requests || !outputs) {
+    fprintf(stderr, "setup failed\n");
+    return 1;
+  }
+  const char *values[] = { "device@vivy.com", "device-0001", "Device", "Fleet" };
+  for (long i = 0; i < iterations; i++) {
+    requests[i] = (struct Csr_batch_request){ key, values };
+  }
+
+  unsigned long allocations = alloc_count();
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    char *csr = createCSR(pem, "DE", "Berlin", "Berlin", "Vivy GmbH", "IT", values[0], values[1], values[2], values[3]);
+    if (!csr) {
+      fprintf(stderr, "createCSR failed\n");
+      return 1;
+    }
+    free(csr);
+  }
+  report("createCSR", 1, iterations, now_ns() - start, alloc_count() - allocations);
+
+  size_t tbs_length = 0;
+  for (long threads = 1; threads <= (processors < 2 ? 2 : processors); threads *= 2) {
+    for (int format = Csr_batch_format_der; format <= Csr_batch_format_pem; format++) {
+      allocations = alloc_count();
+      start = now_ns();
+      if (!csr_batch_create(subject, requests, (size_t)iterations, format, (int)threads, outputs, NULL)) {
+        fprintf(stderr, "batch failed\n");
+        return 1;
+      }
+      report(format == Csr_batch_format_der ? "batch der" : "batch pem", (int)threads, iterations, now_ns() - start, alloc_count() - allocations);
+      // the TBS is roughly the CSR without the signature
+      tbs_length = outputs[0].length;
+      csr_batch_output_free(outputs, (size_t)iterations);
+    }
+  }
+
+  unsigned char tbs[2048] = { 0 };
+  unsigned char signature[512];
+  tbs_length = tbs_length < sizeof(tbs) ? tbs_length : sizeof(tbs);
+  EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+  allocations = alloc_count();
+  start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    size_t signature_length = sizeof(signature);
+    EVP_MD_CTX_reset(md_ctx);
+    if (EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, pkey) != 1 ||
+        EVP_DigestSign(md_ctx, signature, &signature_length, tbs, tbs_length) != 1) {
+      fprintf(stderr, "signature failed\n");
+      return 1;
+    }
+  }
+  report("signature", 1, iterations, now_ns() - start, alloc_count() - allocations);
+
+  EVP_MD_CTX_free(md_ctx);
+  free(outputs);
+  free(requests);
+  csr_template_free(subject);
+  csr_key_free(key);
+  free(pem);
+  EVP_PKEY_free(pkey);
+  return 0;
+}
@@ -0,0 +1,125 @@
+//
+//  ecdsa_csr_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  CSRs per second on one thread: `createCSR` with RSA 4096 and P-256 PEM keys, and `csr_batch_create`
+//  with a P-256 key loaded once from its X9.63 form. Every CSR of the first iteration is verified.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include "alloc_count.h"
+#include "csr.h"
+#include "csr_batch.h"
+#include "key_pool.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, long iterations, double elapsed_ns, unsigned long allocations, double baseline_ns) {
+  double per_op = elapsed_ns / (double)iterations;
+  printf("%-16s %12.0f ns/op %8.0f CSR/s %8.2f allocs/op %7.1fx\n",
+         name, per_op, 1e9 / per_op, (double)allocations / (double)iterations, baseline_ns > 0 ? baseline_ns / per_op : 1.0);
+}
+
+static char *private_key_pem(EVP_PKEY *pkey) {
+  BIO *bio = BIO_new(BIO_s_mem());
+  char *pem = NULL;
+  if (bio && PEM_write_bio_PrivateKey_traditional(bio, pkey, NULL, NULL, 0, NULL, NULL) == 1) {
+    BUF_MEM *mem = NULL;
+    BIO_get_mem_ptr(bio, &mem);
+    pem = strndup(mem->data, mem->length);
+  }
+  BIO_free(bio);
+  return pem;
+}
+
+static int verify_pem(const char *csr, EVP_PKEY *pkey) {
+  BIO *bio = BIO_new_mem_buf(csr, -1);
+  X509_REQ *req = bio ? PEM_read_bio_X509_REQ(bio, NULL, NULL, NULL) : NULL;
+  int ok = req && X509_REQ_verify(req, pkey) == 1;
+  X509_REQ_free(req);
+  BIO_free(bio);
+  return ok;
+}
+
+static double bench_create_csr(const char *name, const char *pem, EVP_PKEY *pkey, long iterations, double baseline_ns) {
+  unsigned long allocations = alloc_count();
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    char *csr = createCSR(pem, "DE", "Berlin", "Berlin", "Vivy GmbH", "IT", "device@vivy.com", "device-0001", "Device", "Fleet");
+    if (!csr || (i == 0 && !verify_pem(csr, pkey))) {
+      fprintf(stderr, "%s failed\n", name);
+      exit(1);
+    }
+    free(csr);
+  }
+  double elapsed = now_ns() - start;
+  report(name, iterations, elapsed, alloc_count() - allocations, baseline_ns);
+  return elapsed / (double)iterations;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 200;
+  EVP_PKEY *rsa = key_pool_generate(Key_pool_type_rsa_4096, NULL);
+  EVP_PKEY *ec = key_pool_generate(Key_pool_type_ec_p256, NULL);
+  char *rsa_pem = rsa ? private_key_pem(rsa) : NULL;
+  char *ec_pem = ec ? private_key_pem(ec) : NULL;
+
+  // X9.63 form as exported by SecKeyCopyExternalRepresentation
+  unsigned char raw[CSR_EC_P256_RAW_LENGTH];
+  const EC_KEY *ec_key = ec ? EVP_PKEY_get0_EC_KEY(ec) : NULL;
+  int raw_ok = ec_key &&
+               EC_POINT_point2oct(EC_KEY_get0_group(ec_key), EC_KEY_get0_public_key(ec_key), POINT_CONVERSION_UNCOMPRESSED, raw, 65, NULL) == 65 &&
+               BN_bn2binpad(EC_KEY_get0_private_key(ec_key), raw + 65, 32) == 32;
+  struct Csr_key *key = raw_ok ? csr_key_new_ec_p256(raw, sizeof(raw), NULL) : NULL;
+  struct Csr_template_entry entries[] = {
+    { "C", "DE" }, { "ST", "Berlin" }, { "L", "Berlin" }, { "O", "Vivy GmbH" }, { "OU", "IT" },
+    { "emailAddress", NULL }, { "UID", NULL }, { "GN", NULL }, { "SN", NULL }
+  };
+  struct Csr_template *subject = csr_template_new(entries, sizeof(entries) / sizeof(entries[0]), NULL);
+  struct Csr_batch_request *requests = calloc((size_t)iterations, sizeof(struct Csr_batch_request));
+  struct Csr_batch_output *outputs = calloc((size_t)iterations, sizeof(struct Csr_batch_output));
+  if (!rsa_pem || !ec_pem || !key || !subject || !requests || !outputs) {
+    fprintf(stderr, "setup failed\n");
+    return 1;
+  }
+  const char *values[] = { "device@vivy.com", "device-0001", "Device", "Fleet" };
+  for (long i = 0; i < iterations; i++) {
+    requests[i] = (struct Csr_batch_request){ key, values };
+  }
+
+  double baseline_ns = bench_create_csr("createCSR rsa4096", rsa_pem, rsa, iterations, 0);
+  bench_create_csr("createCSR p256", ec_pem, ec, iterations, baseline_ns);
+
+  unsigned long allocations = alloc_count();
+  double start = now_ns();
+  if (!csr_batch_create(subject, requests, (size_t)iterations, Csr_batch_format_pem, 1, outputs, NULL) ||
+      !verify_pem((const char *)outputs[0].data, ec)) {
+    fprintf(stderr, "batch failed\n");
+    return 1;
+  }
+  report("batch p256 x9.63", iterations, now_ns() - start, alloc_count() - allocations, baseline_ns);
+
+  csr_batch_output_free(outputs, (size_t)iterations);
+  free(outputs);
+  free(requests);
+  csr_template_free(subject);
+  csr_key_free(key);
+  free(ec_pem);
+  free(rsa_pem);
+  EVP_PKEY_free(ec);
+  EVP_PKEY_free(rsa);
+  return 0;
+}
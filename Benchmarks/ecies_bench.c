@@ -0,0 +1,156 @@
+//
+//  ecies_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Head to head of the gcmOAEP envelope (RSA 4096 OAEP SHA256 wrap of the JSON cipher attributes + AES 256 GCM)
+//  and the gcmECIES envelope (ECDH P-256 + HKDF SHA256 + AES 256 GCM) per record.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include "aes256.h"
+#include "alloc_count.h"
+#include "ecies.h"
+
+/// Length of `{"base64EncodedKey":"…","base64EncodedIV":"…"}` as wrapped by gcmOAEP
+#define CIPHER_ATTR_JSON_LENGTH 100
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, const char *operation, size_t size, long iterations, double elapsed_ns, unsigned long allocations) {
+  double ns_per_op = elapsed_ns / (double)iterations;
+  printf("%-10s %-8s %6zu B %12.0f ns/op %10.1f ops/s %8.2f allocs/op\n",
+         name, operation, size, ns_per_op, 1e9 / ns_per_op, (double)allocations / (double)iterations);
+}
+
+static EVP_PKEY_CTX *oaep_ctx(EVP_PKEY *pkey, int encrypt) {
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+  int ok = ctx &&
+           (encrypt ? EVP_PKEY_encrypt_init(ctx) : EVP_PKEY_decrypt_init(ctx)) == 1 &&
+           EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) == 1 &&
+           EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) == 1 &&
+           EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) == 1;
+  if (!ok) {
+    EVP_PKEY_CTX_free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+/*
+ gcmOAEP sender: random key and IV, AES GCM, RSA wrap of the cipher attributes.
+ The padding setup is repeated per record like `SecKeyCreateEncryptedData` does.
+ */
+static int oaep_encrypt(EVP_PKEY *pkey, const unsigned char *in, size_t length,
+                        unsigned char *wrapped, size_t *wrapped_length, unsigned char *out, size_t *out_length) {
+  unsigned char attr[CIPHER_ATTR_JSON_LENGTH];
+  RAND_bytes(attr, sizeof(attr));
+  int ok = aes256_encrypt(Aes256_block_mode_gcm, attr, attr + AES256_KEY_LENGTH, in, length, out, length + AES256_TAG_LENGTH, out_length, NULL);
+  EVP_PKEY_CTX *ctx = oaep_ctx(pkey, 1);
+  ok = ok && ctx && EVP_PKEY_encrypt(ctx, wrapped, wrapped_length, attr, sizeof(attr)) == 1;
+  EVP_PKEY_CTX_free(ctx);
+  return ok;
+}
+
+static int oaep_decrypt(EVP_PKEY *pkey, const unsigned char *wrapped, size_t wrapped_length,
+                        const unsigned char *in, size_t length, unsigned char *out, size_t *out_length) {
+  unsigned char attr[512];
+  size_t attr_length = sizeof(attr);
+  EVP_PKEY_CTX *ctx = oaep_ctx(pkey, 0);
+  int ok = ctx && EVP_PKEY_decrypt(ctx, attr, &attr_length, wrapped, wrapped_length) == 1;
+  EVP_PKEY_CTX_free(ctx);
+  return ok && aes256_decrypt(Aes256_block_mode_gcm, attr, attr + AES256_KEY_LENGTH, in, length, out, length, out_length, NULL);
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 200;
+  const size_t sizes[] = { 64, 1024, 16384 };
+
+  EVP_PKEY *rsa = NULL;
+  EVP_PKEY_CTX *keygen = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+  if (!keygen || EVP_PKEY_keygen_init(keygen) != 1 || EVP_PKEY_CTX_set_rsa_keygen_bits(keygen, 4096) != 1 || EVP_PKEY_keygen(keygen, &rsa) != 1) {
+    fprintf(stderr, "RSA key generation failed\n");
+    return 1;
+  }
+  EVP_PKEY_CTX_free(keygen);
+
+  EC_KEY *ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+  unsigned char ec_private[ECIES_P256_PRIVATE_KEY_LENGTH];
+  if (!ec || EC_KEY_generate_key(ec) != 1 ||
+      EC_POINT_point2oct(EC_KEY_get0_group(ec), EC_KEY_get0_public_key(ec), POINT_CONVERSION_UNCOMPRESSED,
+                         ec_private, ECIES_P256_PUBLIC_KEY_LENGTH, NULL) != ECIES_P256_PUBLIC_KEY_LENGTH ||
+      BN_bn2binpad(EC_KEY_get0_private_key(ec), ec_private + ECIES_P256_PUBLIC_KEY_LENGTH, ECIES_P256_SCALAR_LENGTH) != ECIES_P256_SCALAR_LENGTH) {
+    fprintf(stderr, "P-256 key generation failed\n");
+    return 1;
+  }
+  EC_KEY_free(ec);
+  const unsigned char *ec_public = ec_private;
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    unsigned char *plain = malloc(size);
+    unsigned char *cipher = malloc(size + AES256_TAG_LENGTH);
+    unsigned char *decrypted = malloc(size);
+    unsigned char wrapped[512];
+    unsigned char ephemeral[ECIES_P256_PUBLIC_KEY_LENGTH];
+    size_t wrapped_length = sizeof(wrapped);
+    size_t length = 0;
+    int ok = 1;
+    RAND_bytes(plain, (int)size);
+
+    unsigned long allocations = alloc_count();
+    double start = now_ns();
+    for (long i = 0; i < iterations && ok; i++) {
+      wrapped_length = sizeof(wrapped);
+      ok &= oaep_encrypt(rsa, plain, size, wrapped, &wrapped_length, cipher, &length);
+    }
+    report("gcmOAEP", "encrypt", size, iterations, now_ns() - start, alloc_count() - allocations);
+
+    allocations = alloc_count();
+    start = now_ns();
+    for (long i = 0; i < iterations && ok; i++) {
+      ok &= oaep_decrypt(rsa, wrapped, wrapped_length, cipher, size + AES256_TAG_LENGTH, decrypted, &length);
+    }
+    report("gcmOAEP", "decrypt", size, iterations, now_ns() - start, alloc_count() - allocations);
+    ok &= length == size && memcmp(plain, decrypted, size) == 0;
+
+    allocations = alloc_count();
+    start = now_ns();
+    for (long i = 0; i < iterations && ok; i++) {
+      ok &= ecies_p256_encrypt(ec_public, ECIES_P256_PUBLIC_KEY_LENGTH, plain, size, ephemeral, cipher, size + AES256_TAG_LENGTH, &length, NULL);
+    }
+    report("gcmECIES", "encrypt", size, iterations, now_ns() - start, alloc_count() - allocations);
+
+    allocations = alloc_count();
+    start = now_ns();
+    for (long i = 0; i < iterations && ok; i++) {
+      ok &= ecies_p256_decrypt(ec_private, sizeof(ec_private), ephemeral, sizeof(ephemeral), cipher, size + AES256_TAG_LENGTH, decrypted, size, &length, NULL);
+    }
+    report("gcmECIES", "decrypt", size, iterations, now_ns() - start, alloc_count() - allocations);
+    ok &= length == size && memcmp(plain, decrypted, size) == 0;
+
+    free(plain);
+    free(cipher);
+    free(decrypted);
+    if (!ok) {
+      fprintf(stderr, "round trip failed for %zu\n", size);
+      return 1;
+    }
+  }
+  EVP_PKEY_free(rsa);
+  return 0;
+}
@@ -0,0 +1,273 @@
+//
+//  file_crypt_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  File encryption paths of file_crypt.c on one input file: the reader/cipher/writer pipeline with io_uring and
+//  with pread/pwrite, the memory mapped path and a serial read-encrypt-write loop on one thread as baseline.
+//  Reading alone and the cipher alone are measured too. With more than one processor the pipeline should reach
+//  the slower of both while the serial loop pays their sum, on one processor the stages only take turns.
+//  Every output is compared with the serial one and decrypted back, any mismatch, failure or a run that does not
+//  finish within the watchdog fails the benchmark.
+//
+//  Usage: file_crypt_bench [megabytes, default 64] [rounds, default 3] [directory, default /tmp]
+//
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include "file_crypt.h"
+
+#define CHUNK_SIZE (256 * 1024)
+#define WATCHDOG_SECONDS 60
+
+enum Path {
+  Path_serial = 0,
+  Path_pipeline_io_uring,
+  Path_pipeline_pread,
+  Path_mapped,
+  Path_count
+};
+
+static const char *path_names[Path_count] = { "serial", "pipeline io_uring", "pipeline pread", "mapped" };
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void watchdog(int signal) {
+  (void)signal;
+  static const char message[] = "file_crypt_bench: a run did not finish, pipeline stalled\n";
+  write(STDERR_FILENO, message, sizeof(message) - 1);
+  _exit(1);
+}
+
+static int write_random_file(const char *path, size_t length) {
+  FILE *file = fopen(path, "wb");
+  unsigned char *chunk = malloc(CHUNK_SIZE);
+  int ok = file && chunk;
+  for (size_t done = 0; ok && done < length; done += CHUNK_SIZE) {
+    size_t n = length - done < CHUNK_SIZE ? length - done : CHUNK_SIZE;
+    ok = RAND_bytes(chunk, (int)n) == 1 && fwrite(chunk, 1, n, file) == n;
+  }
+  free(chunk);
+  if (file && fclose(file) != 0) {
+    ok = 0;
+  }
+  return ok;
+}
+
+/// SHA256 of the file, 0 if it cannot be read
+static int file_digest(const char *path, unsigned char digest[32]) {
+  FILE *file = fopen(path, "rb");
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  unsigned char *chunk = malloc(CHUNK_SIZE);
+  int ok = file && ctx && chunk && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) == 1;
+  size_t n;
+  while (ok && (n = fread(chunk, 1, CHUNK_SIZE, file)) > 0) {
+    ok = EVP_DigestUpdate(ctx, chunk, n) == 1;
+  }
+  ok = ok && !ferror(file) && EVP_DigestFinal_ex(ctx, digest, NULL) == 1;
+  free(chunk);
+  EVP_MD_CTX_free(ctx);
+  if (file) {
+    fclose(file);
+  }
+  return ok;
+}
+
+/// Reads the file in chunks without ciphering, the I/O cost of every path
+static int read_only(const char *path) {
+  int fd = open(path, O_RDONLY);
+  unsigned char *chunk = malloc(CHUNK_SIZE);
+  int ok = fd >= 0 && chunk;
+  ssize_t n;
+  while (ok && (n = read(fd, chunk, CHUNK_SIZE)) != 0) {
+    ok = n > 0;
+  }
+  free(chunk);
+  if (fd >= 0) {
+    close(fd);
+  }
+  return ok;
+}
+
+/// Ciphers `length` bytes from memory, the cipher cost of every path
+static int cipher_only(enum Aes256_block_mode mode, const unsigned char *key, const unsigned char *iv, size_t length) {
+  EVP_CIPHER_CTX *ctx = aes256_cipher_ctx_new(mode, 1, key, iv);
+  unsigned char *in = calloc(1, CHUNK_SIZE);
+  unsigned char *out = malloc(CHUNK_SIZE + 2 * AES256_BLOCK_LENGTH);
+  int ok = ctx && in && out;
+  for (size_t done = 0; ok && done < length; done += CHUNK_SIZE) {
+    int n = (int)(length - done < CHUNK_SIZE ? length - done : CHUNK_SIZE);
+    int outl = 0;
+    ok = EVP_CipherUpdate(ctx, out, &outl, in, n) == 1;
+  }
+  free(out);
+  free(in);
+  EVP_CIPHER_CTX_free(ctx);
+  return ok;
+}
+
+/// Read, encrypt and write one chunk after the other on the calling thread, same output as file_encrypt
+static int serial_encrypt(const char *in_path, const char *out_path, enum Aes256_block_mode mode, const unsigned char *key, const unsigned char *iv) {
+  int in_fd = open(in_path, O_RDONLY);
+  int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  EVP_CIPHER_CTX *ctx = aes256_cipher_ctx_new(mode, 1, key, iv);
+  unsigned char *in = malloc(CHUNK_SIZE);
+  unsigned char *out = malloc(CHUNK_SIZE + 2 * AES256_BLOCK_LENGTH + AES256_TAG_LENGTH);
+  int ok = in_fd >= 0 && out_fd >= 0 && ctx && in && out;
+  ssize_t n;
+  int outl = 0;
+  while (ok && (n = read(in_fd, in, CHUNK_SIZE)) != 0) {
+    ok = n > 0 && EVP_CipherUpdate(ctx, out, &outl, in, (int)n) == 1 && write(out_fd, out, (size_t)outl) == outl;
+  }
+  if (ok) {
+    int finall = 0;
+    ok = EVP_CipherFinal_ex(ctx, out, &finall) == 1;
+    if (ok && mode == Aes256_block_mode_gcm) {
+      ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AES256_TAG_LENGTH, out + finall) == 1;
+      finall += AES256_TAG_LENGTH;
+    }
+    ok = ok && write(out_fd, out, (size_t)finall) == finall;
+  }
+  free(out);
+  free(in);
+  EVP_CIPHER_CTX_free(ctx);
+  if (in_fd >= 0) {
+    close(in_fd);
+  }
+  if (out_fd >= 0 && close(out_fd) != 0) {
+    ok = 0;
+  }
+  return ok;
+}
+
+static int encrypt_with(enum Path path, const char *in_path, const char *out_path, enum Aes256_block_mode mode,
+                        const unsigned char *key, const unsigned char *iv) {
+  struct File_crypt_options options = { CHUNK_SIZE, 0, path == Path_pipeline_pread };
+  enum File_crypt_error err = File_crypt_error_none;
+  switch (path) {
+    case Path_serial:
+      return serial_encrypt(in_path, out_path, mode, key, iv);
+    case Path_pipeline_io_uring:
+    case Path_pipeline_pread:
+      return file_encrypt(in_path, out_path, mode, key, iv, &options, &err);
+    case Path_mapped:
+      return file_encrypt_mapped(in_path, out_path, mode, key, iv, &err);
+    default:
+      return 0;
+  }
+}
+
+static int decrypt_with(enum Path path, const char *in_path, const char *out_path, enum Aes256_block_mode mode,
+                        const unsigned char *key, const unsigned char *iv) {
+  struct File_crypt_options options = { CHUNK_SIZE, 0, path == Path_pipeline_pread };
+  enum File_crypt_error err = File_crypt_error_none;
+  return path == Path_mapped ? file_decrypt_mapped(in_path, out_path, mode, key, iv, &err)
+                             : file_decrypt(in_path, out_path, mode, key, iv, &options, &err);
+}
+
+static void report(const char *mode, const char *name, size_t length, double best_ns) {
+  printf("%-4s %-18s %10.1f ms %9.1f MB/s\n", mode, name, best_ns / 1e6, (double)length / best_ns * 1e3);
+}
+
+int main(int argc, char **argv) {
+  size_t megabytes = argc > 1 ? (size_t)atol(argv[1]) : 64;
+  int rounds = argc > 2 ? atoi(argv[2]) : 3;
+  const char *directory = argc > 3 ? argv[3] : "/tmp";
+  if (megabytes == 0 || rounds <= 0) {
+    fprintf(stderr, "usage: file_crypt_bench [megabytes] [rounds] [directory]\n");
+    return 2;
+  }
+  size_t length = megabytes << 20;
+  // not a multiple of the chunk size, so the last chunk is a short one
+  length += 4093;
+
+  char in_path[4096], out_path[4096], expected_path[4096], back_path[4096];
+  snprintf(in_path, sizeof(in_path), "%s/file_crypt_bench.%d.in", directory, (int)getpid());
+  snprintf(out_path, sizeof(out_path), "%s/file_crypt_bench.%d.out", directory, (int)getpid());
+  snprintf(expected_path, sizeof(expected_path), "%s/file_crypt_bench.%d.expected", directory, (int)getpid());
+  snprintf(back_path, sizeof(back_path), "%s/file_crypt_bench.%d.back", directory, (int)getpid());
+
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  unsigned char plain_digest[32];
+  RAND_bytes(key, sizeof(key));
+  RAND_bytes(iv, sizeof(iv));
+  if (!write_random_file(in_path, length) || !file_digest(in_path, plain_digest)) {
+    fprintf(stderr, "cannot write %s\n", in_path);
+    unlink(in_path);
+    return 1;
+  }
+  signal(SIGALRM, watchdog);
+  alarm(WATCHDOG_SECONDS);
+
+  const enum Aes256_block_mode modes[] = { Aes256_block_mode_gcm, Aes256_block_mode_cbc };
+  const char *mode_names[] = { "gcm", "cbc" };
+  int failures = 0;
+  printf("%.1f MB input in the page cache, %d rounds, best round reported\n", (double)length / (1 << 20), rounds);
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    enum Aes256_block_mode mode = modes[m];
+    double read_ns = 0, cipher_ns = 0;
+    for (int round = 0; round < rounds; round++) {
+      double start = now_ns();
+      failures += !read_only(in_path);
+      double elapsed = now_ns() - start;
+      read_ns = round == 0 || elapsed < read_ns ? elapsed : read_ns;
+      start = now_ns();
+      failures += !cipher_only(mode, key, iv, length);
+      elapsed = now_ns() - start;
+      cipher_ns = round == 0 || elapsed < cipher_ns ? elapsed : cipher_ns;
+    }
+    report(mode_names[m], "read only", length, read_ns);
+    report(mode_names[m], "cipher only", length, cipher_ns);
+
+    unsigned char expected[32];
+    if (!serial_encrypt(in_path, expected_path, mode, key, iv) || !file_digest(expected_path, expected)) {
+      fprintf(stderr, "%s serial encryption failed\n", mode_names[m]);
+      failures++;
+      continue;
+    }
+    for (int path = 0; path < Path_count; path++) {
+      double best = 0;
+      for (int round = 0; round < rounds; round++) {
+        double start = now_ns();
+        int ok = encrypt_with((enum Path)path, in_path, out_path, mode, key, iv);
+        double elapsed = now_ns() - start;
+        best = round == 0 || elapsed < best ? elapsed : best;
+
+        unsigned char digest[32];
+        if (!ok || !file_digest(out_path, digest) || memcmp(digest, expected, sizeof(digest)) != 0) {
+          fprintf(stderr, "%s %s: output differs from the serial encryption\n", mode_names[m], path_names[path]);
+          failures++;
+          continue;
+        }
+        if (path != Path_serial &&
+            (!decrypt_with((enum Path)path, out_path, back_path, mode, key, iv) || !file_digest(back_path, digest) ||
+             memcmp(digest, plain_digest, sizeof(digest)) != 0)) {
+          fprintf(stderr, "%s %s: decryption does not match the input\n", mode_names[m], path_names[path]);
+          failures++;
+        }
+      }
+      report(mode_names[m], path_names[path], length, best);
+    }
+  }
+
+  alarm(0);
+  unlink(in_path);
+  unlink(out_path);
+  unlink(expected_path);
+  unlink(back_path);
+  printf("%d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+//
+//  key_cache_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Cost of key_cache_get hits and key_cache_put evictions for growing capacities, both should stay flat.
+//  Random puts and gets are checked against a plain least recently used list first, the time to live separately.
+//
+//  Usage: key_cache_bench [operations per capacity, default 1000000]
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/rand.h>
+#include "key_cache.h"
+
+#define MODEL_CAPACITY 64
+#define MODEL_IDS 160
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/// Key and IV stored for id number n, every third IV has the 12 bytes of a GCM nonce
+static size_t make_entry(size_t n, unsigned char *key, unsigned char *iv) {
+  memset(key, (int)(n & 0xff), AES256_KEY_LENGTH);
+  memset(iv, (int)((n >> 8) & 0xff), AES256_IV_LENGTH);
+  key[0] = (unsigned char)(n >> 16);
+  return n % 3 == 0 ? 12 : AES256_IV_LENGTH;
+}
+
+/// Random puts and gets on a small cache, compared with a list ordered from least to most recently used
+static int model_check(void) {
+  static unsigned char ids[MODEL_IDS][KEY_CACHE_ID_LENGTH];
+  RAND_bytes(&ids[0][0], sizeof(ids));
+  // two ids with the same leading bytes share their home slot
+  memcpy(ids[1], ids[0], 8);
+  struct Key_cache *cache = key_cache_new(MODEL_CAPACITY, 0);
+  size_t order[MODEL_CAPACITY];
+  size_t count = 0;
+  uint64_t state = 1;
+  int ok = cache != NULL;
+  for (long step = 0; ok && step < 200000; step++) {
+    size_t n = (size_t)(splitmix64(&state) % MODEL_IDS);
+    size_t position = count;
+    for (size_t i = 0; i < count; i++) {
+      position = order[i] == n ? i : position;
+    }
+    unsigned char key[AES256_KEY_LENGTH], iv[AES256_IV_LENGTH];
+    unsigned char expected_key[AES256_KEY_LENGTH], expected_iv[AES256_IV_LENGTH];
+    size_t iv_length = 0;
+    size_t expected_iv_length = make_entry(n, expected_key, expected_iv);
+    if (splitmix64(&state) % 2) {
+      int hit = key_cache_get(cache, ids[n], key, iv, &iv_length);
+      ok = hit == (position < count) &&
+           (!hit || (memcmp(key, expected_key, sizeof(key)) == 0 && iv_length == expected_iv_length &&
+                     memcmp(iv, expected_iv, iv_length) == 0));
+      if (!hit) {
+        continue;
+      }
+    } else {
+      key_cache_put(cache, ids[n], expected_key, expected_iv, expected_iv_length);
+      if (position == count && count == MODEL_CAPACITY) {
+        // the least recently used entry is evicted
+        memmove(order, order + 1, (count - 1) * sizeof(size_t));
+        position = --count;
+      }
+      count += position == count;
+    }
+    // most recently used at the end
+    memmove(order + position, order + position + 1, (count - 1 - position) * sizeof(size_t));
+    order[count - 1] = n;
+  }
+  struct Key_cache_stats stats;
+  key_cache_get_stats(cache, &stats);
+  ok = ok && stats.count == count;
+  key_cache_remove_all(cache);
+  unsigned char key[AES256_KEY_LENGTH], iv[AES256_IV_LENGTH];
+  size_t iv_length = 0;
+  for (size_t n = 0; ok && n < MODEL_IDS; n++) {
+    ok = !key_cache_get(cache, ids[n], key, iv, &iv_length);
+  }
+  key_cache_free(cache);
+  return ok;
+}
+
+/// Entries expire after the time to live, also the ones that are never looked up again
+static int ttl_check(void) {
+  unsigned char ids[3][KEY_CACHE_ID_LENGTH];
+  unsigned char key[AES256_KEY_LENGTH] = { 1 }, iv[AES256_IV_LENGTH] = { 2 };
+  size_t iv_length = 0;
+  RAND_bytes(&ids[0][0], sizeof(ids));
+  struct Key_cache *cache = key_cache_new(4, 0.05);
+  int ok = cache != NULL;
+  if (ok) {
+    key_cache_put(cache, ids[0], key, iv, sizeof(iv));
+    key_cache_put(cache, ids[1], key, iv, sizeof(iv));
+    ok = key_cache_get(cache, ids[0], key, iv, &iv_length);
+    usleep(100000);
+    key_cache_put(cache, ids[2], key, iv, sizeof(iv));
+    struct Key_cache_stats stats;
+    key_cache_get_stats(cache, &stats);
+    ok = ok && stats.expirations == 2 && stats.count == 1 && !key_cache_get(cache, ids[0], key, iv, &iv_length) &&
+         key_cache_get(cache, ids[2], key, iv, &iv_length);
+  }
+  key_cache_free(cache);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  long operations = argc > 1 ? atol(argv[1]) : 1000000;
+  if (operations <= 0) {
+    fprintf(stderr, "usage: key_cache_bench [operations]\n");
+    return 2;
+  }
+  if (!model_check() || !ttl_check()) {
+    fprintf(stderr, "key cache differs from the reference\n");
+    return 1;
+  }
+
+  const size_t capacities[] = { 16, 1024, 65536 };
+  for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+    size_t capacity = capacities[c];
+    // twice the capacity, so half of the puts evict
+    size_t id_count = 2 * capacity;
+    unsigned char (*ids)[KEY_CACHE_ID_LENGTH] = malloc(id_count * KEY_CACHE_ID_LENGTH);
+    struct Key_cache *cache = key_cache_new(capacity, 3600);
+    if (!ids || !cache) {
+      fprintf(stderr, "setup failed\n");
+      return 1;
+    }
+    RAND_bytes(&ids[0][0], (int)(id_count * KEY_CACHE_ID_LENGTH));
+    unsigned char key[AES256_KEY_LENGTH] = { 0 }, iv[AES256_IV_LENGTH] = { 0 };
+    size_t iv_length = 0;
+    for (size_t i = 0; i < capacity; i++) {
+      key_cache_put(cache, ids[i], key, iv, sizeof(iv));
+    }
+
+    uint64_t state = capacity;
+    long hits = 0;
+    double start = now_ns();
+    for (long i = 0; i < operations; i++) {
+      hits += key_cache_get(cache, ids[splitmix64(&state) % capacity], key, iv, &iv_length);
+    }
+    double get_ns = (now_ns() - start) / (double)operations;
+
+    start = now_ns();
+    for (long i = 0; i < operations; i++) {
+      key_cache_put(cache, ids[splitmix64(&state) % id_count], key, iv, sizeof(iv));
+    }
+    double put_ns = (now_ns() - start) / (double)operations;
+
+    struct Key_cache_stats stats;
+    key_cache_get_stats(cache, &stats);
+    printf("capacity %6zu get hit %7.1f ns put %7.1f ns evictions %lu locked %d\n", capacity, get_ns, put_ns,
+           stats.evictions, stats.locked);
+    key_cache_free(cache);
+    free(ids);
+    if (hits != operations || stats.count != capacity) {
+      fprintf(stderr, "capacity %zu: %ld of %ld lookups hit, %zu entries\n", capacity, hits, operations, stats.count);
+      return 1;
+    }
+  }
+  return 0;
+}
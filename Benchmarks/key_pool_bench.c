@@ -0,0 +1,67 @@
+//
+//  key_pool_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Time to get a private key: generated on the calling thread compared with taken from a filled `Key_pool`.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "key_pool.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 4;
+  const enum Key_pool_type types[] = { Key_pool_type_ec_p256, Key_pool_type_rsa_2048, Key_pool_type_rsa_4096 };
+  const char *names[] = { "p256", "rsa2048", "rsa4096" };
+
+  for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+    // RSA 4096 generation is slow, fewer iterations keep the smoke run short
+    long count = types[t] == Key_pool_type_rsa_4096 ? iterations / 4 + 1 : iterations;
+    double min_ns = 0;
+    double max_ns = 0;
+    double start = now_ns();
+    for (long i = 0; i < count; i++) {
+      double key_start = now_ns();
+      EVP_PKEY *pkey = key_pool_generate(types[t], NULL);
+      double key_ns = now_ns() - key_start;
+      if (!pkey) {
+        fprintf(stderr, "%s generation failed\n", names[t]);
+        return 1;
+      }
+      EVP_PKEY_free(pkey);
+      min_ns = i == 0 || key_ns < min_ns ? key_ns : min_ns;
+      max_ns = key_ns > max_ns ? key_ns : max_ns;
+    }
+    printf("%-8s generate %12.0f ns/op  min %12.0f ns  max %12.0f ns\n", names[t], (now_ns() - start) / (double)count, min_ns, max_ns);
+
+    struct Key_pool *pool = key_pool_new(types[t], (size_t)count, 2);
+    struct Key_pool_stats stats = { 0 };
+    while (pool && stats.depth < (size_t)count) {
+      usleep(1000);
+      key_pool_get_stats(pool, &stats);
+    }
+    start = now_ns();
+    for (long i = 0; i < count && pool; i++) {
+      EVP_PKEY *pkey = key_pool_take(pool, NULL);
+      if (!pkey) {
+        fprintf(stderr, "%s take failed\n", names[t]);
+        return 1;
+      }
+      EVP_PKEY_free(pkey);
+    }
+    key_pool_get_stats(pool, &stats);
+    printf("%-8s take     %12.0f ns/op  misses %lu\n", names[t], (now_ns() - start) / (double)count, stats.misses);
+    key_pool_free(pool);
+  }
+  return 0;
+}
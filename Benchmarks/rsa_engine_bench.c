@@ -0,0 +1,168 @@
+//
+//  rsa_engine_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Per operation cost of wrapping and unwrapping small payloads with prepared `Rsa_engine_key`s
+//  compared with setting up the key and the `EVP_PKEY_CTX` for every operation.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include "alloc_count.h"
+#include "rsa_engine.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, const char *operation, int bits, size_t size, long iterations, double elapsed_ns, unsigned long allocations) {
+  double ns_per_op = elapsed_ns / (double)iterations;
+  printf("%-8s %-8s %4d bit %4zu B %10.0f ns/op %8.2f allocs/op\n",
+         name, operation, bits, size, ns_per_op, (double)allocations / (double)iterations);
+}
+
+/*
+ What a straightforward port of `RSA.encrypt`/`RSA.decrypt` does per call: parse the key,
+ create and configure the context, run the operation, free everything.
+ */
+static int fresh_crypt(const unsigned char *der, size_t der_length, int decrypt,
+                       const unsigned char *in, size_t in_length, unsigned char *out, size_t *out_length) {
+  const unsigned char *p = der;
+  RSA *rsa = decrypt ? d2i_RSAPrivateKey(NULL, &p, (long)der_length) : d2i_RSAPublicKey(NULL, &p, (long)der_length);
+  EVP_PKEY *pkey = EVP_PKEY_new();
+  if (!rsa || !pkey || EVP_PKEY_assign_RSA(pkey, rsa) != 1) {
+    RSA_free(rsa);
+    EVP_PKEY_free(pkey);
+    return 0;
+  }
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+  int ok = ctx &&
+           (decrypt ? EVP_PKEY_decrypt_init(ctx) : EVP_PKEY_encrypt_init(ctx)) == 1 &&
+           EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) == 1 &&
+           EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) == 1 &&
+           EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) == 1;
+  if (ok) {
+    ok = decrypt ? EVP_PKEY_decrypt(ctx, out, out_length, in, in_length) == 1
+                 : EVP_PKEY_encrypt(ctx, out, out_length, in, in_length) == 1;
+  }
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(pkey);
+  return ok;
+}
+
+static int generate(int bits, unsigned char **private_der, int *private_length, unsigned char **public_der, int *public_length) {
+  EVP_PKEY *pkey = NULL;
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+  int ok = ctx && EVP_PKEY_keygen_init(ctx) == 1 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) == 1 && EVP_PKEY_keygen(ctx, &pkey) == 1;
+  EVP_PKEY_CTX_free(ctx);
+  if (ok) {
+    const RSA *rsa = EVP_PKEY_get0_RSA(pkey);
+    *private_der = NULL;
+    *public_der = NULL;
+    *private_length = i2d_RSAPrivateKey(rsa, private_der);
+    *public_length = i2d_RSAPublicKey(rsa, public_der);
+    ok = *private_length > 0 && *public_length > 0;
+  }
+  EVP_PKEY_free(pkey);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 200;
+  const int key_sizes[] = { 2048, 4096 };
+  // compact cipher attributes, JSON cipher attributes
+  const size_t payload_sizes[] = { 48, 100 };
+
+  for (size_t k = 0; k < sizeof(key_sizes) / sizeof(key_sizes[0]); k++) {
+    int bits = key_sizes[k];
+    unsigned char *private_der = NULL;
+    unsigned char *public_der = NULL;
+    int private_length = 0;
+    int public_length = 0;
+    if (!generate(bits, &private_der, &private_length, &public_der, &public_length)) {
+      fprintf(stderr, "RSA %d key generation failed\n", bits);
+      return 1;
+    }
+    struct Rsa_engine_key *private_key = rsa_engine_key_new_der(private_der, (size_t)private_length, 1, NULL);
+    struct Rsa_engine_key *public_key = rsa_engine_key_new_der(public_der, (size_t)public_length, 0, NULL);
+    if (!private_key || !public_key) {
+      fprintf(stderr, "RSA %d key loading failed\n", bits);
+      return 1;
+    }
+
+    for (size_t s = 0; s < sizeof(payload_sizes) / sizeof(payload_sizes[0]); s++) {
+      size_t size = payload_sizes[s];
+      unsigned char plain[128];
+      unsigned char cipher[512];
+      unsigned char decrypted[512];
+      size_t cipher_length = 0;
+      size_t length = 0;
+      int ok = 1;
+      RAND_bytes(plain, (int)size);
+      // Prepares the contexts of this thread
+      ok &= rsa_engine_encrypt(public_key, Rsa_engine_padding_oaep_sha256, plain, size, cipher, sizeof(cipher), &cipher_length, NULL);
+      ok &= rsa_engine_decrypt(private_key, Rsa_engine_padding_oaep_sha256, cipher, cipher_length, decrypted, sizeof(decrypted), &length, NULL);
+
+      unsigned long allocations = alloc_count();
+      double start = now_ns();
+      for (long i = 0; i < iterations && ok; i++) {
+        cipher_length = sizeof(cipher);
+        ok &= fresh_crypt(public_der, (size_t)public_length, 0, plain, size, cipher, &cipher_length);
+      }
+      report("fresh", "encrypt", bits, size, iterations, now_ns() - start, alloc_count() - allocations);
+
+      allocations = alloc_count();
+      start = now_ns();
+      for (long i = 0; i < iterations && ok; i++) {
+        ok &= rsa_engine_encrypt(public_key, Rsa_engine_padding_oaep_sha256, plain, size, cipher, sizeof(cipher), &cipher_length, NULL);
+      }
+      report("engine", "encrypt", bits, size, iterations, now_ns() - start, alloc_count() - allocations);
+
+      long private_iterations = iterations / 4 + 1;
+      allocations = alloc_count();
+      start = now_ns();
+      for (long i = 0; i < private_iterations && ok; i++) {
+        length = sizeof(decrypted);
+        ok &= fresh_crypt(private_der, (size_t)private_length, 1, cipher, cipher_length, decrypted, &length);
+      }
+      report("fresh", "decrypt", bits, size, private_iterations, now_ns() - start, alloc_count() - allocations);
+
+      allocations = alloc_count();
+      start = now_ns();
+      for (long i = 0; i < private_iterations && ok; i++) {
+        ok &= rsa_engine_decrypt(private_key, Rsa_engine_padding_oaep_sha256, cipher, cipher_length, decrypted, sizeof(decrypted), &length, NULL);
+      }
+      report("engine", "decrypt", bits, size, private_iterations, now_ns() - start, alloc_count() - allocations);
+
+      if (!ok || length != size || memcmp(plain, decrypted, size) != 0) {
+        fprintf(stderr, "round trip failed for RSA %d with %zu bytes\n", bits, size);
+        return 1;
+      }
+
+      // a failed decryption must not leave errors for later OpenSSL calls of the thread
+      RAND_bytes(cipher, (int)cipher_length);
+      ERR_clear_error();
+      if (rsa_engine_decrypt(private_key, Rsa_engine_padding_oaep_sha256, cipher, cipher_length, decrypted, sizeof(decrypted), &length, NULL) ||
+          ERR_peek_error() != 0) {
+        fprintf(stderr, "failed decryption for RSA %d left errors on the queue\n", bits);
+        return 1;
+      }
+    }
+    rsa_engine_key_free(private_key);
+    rsa_engine_key_free(public_key);
+    OPENSSL_free(private_der);
+    OPENSSL_free(public_der);
+  }
+  return 0;
+}
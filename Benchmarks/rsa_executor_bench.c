@@ -0,0 +1,146 @@
+//
+//  rsa_executor_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Throughput and latency percentiles of RSA 2048 OAEP unwraps submitted in one burst
+//  to `Rsa_executor`s with a growing number of threads.
+//
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include "rsa_engine.h"
+#include "rsa_executor.h"
+
+struct Job {
+  struct Rsa_engine_key *key;
+  const unsigned char *cipher;
+  size_t cipher_length;
+  int ok;
+};
+
+static pthread_mutex_t done_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static long done;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void unwrap(void *context) {
+  struct Job *job = context;
+  unsigned char out[512];
+  size_t length = 0;
+  job->ok = rsa_engine_decrypt(job->key, Rsa_engine_padding_oaep_sha256, job->cipher, job->cipher_length, out, sizeof(out), &length, NULL);
+}
+
+static void completed(void *context, double wait_us, double service_us) {
+  (void)context;
+  (void)wait_us;
+  (void)service_us;
+  pthread_mutex_lock(&done_mutex);
+  done++;
+  pthread_cond_signal(&done_cond);
+  pthread_mutex_unlock(&done_mutex);
+}
+
+static struct Rsa_engine_key *generate(int bits, struct Rsa_engine_key **public_key) {
+  EVP_PKEY *pkey = NULL;
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+  int ok = ctx && EVP_PKEY_keygen_init(ctx) == 1 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) == 1 && EVP_PKEY_keygen(ctx, &pkey) == 1;
+  EVP_PKEY_CTX_free(ctx);
+  struct Rsa_engine_key *private_key = NULL;
+  if (ok) {
+    const RSA *rsa = EVP_PKEY_get0_RSA(pkey);
+    unsigned char *private_der = NULL;
+    unsigned char *public_der = NULL;
+    int private_length = i2d_RSAPrivateKey(rsa, &private_der);
+    int public_length = i2d_RSAPublicKey(rsa, &public_der);
+    if (private_length > 0 && public_length > 0) {
+      private_key = rsa_engine_key_new_der(private_der, (size_t)private_length, 1, NULL);
+      *public_key = rsa_engine_key_new_der(public_der, (size_t)public_length, 0, NULL);
+    }
+    OPENSSL_free(private_der);
+    OPENSSL_free(public_der);
+  }
+  EVP_PKEY_free(pkey);
+  return private_key;
+}
+
+int main(int argc, char **argv) {
+  long requests = argc > 1 ? atol(argv[1]) : 400;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  struct Rsa_engine_key *public_key = NULL;
+  struct Rsa_engine_key *private_key = generate(2048, &public_key);
+  if (!private_key || !public_key) {
+    fprintf(stderr, "RSA 2048 key generation failed\n");
+    return 1;
+  }
+  unsigned char plain[48];
+  unsigned char cipher[256];
+  size_t cipher_length = 0;
+  RAND_bytes(plain, sizeof(plain));
+  if (!rsa_engine_encrypt(public_key, Rsa_engine_padding_oaep_sha256, plain, sizeof(plain), cipher, sizeof(cipher), &cipher_length, NULL)) {
+    fprintf(stderr, "RSA 2048 encryption failed\n");
+    return 1;
+  }
+
+  struct Job *jobs = calloc((size_t)requests, sizeof(struct Job));
+  for (long threads = 1; jobs && threads <= (cpus < 1 ? 1 : cpus); threads *= 2) {
+    struct Rsa_executor *executor = rsa_executor_new((int)threads, (size_t)requests);
+    if (!executor) {
+      fprintf(stderr, "executor creation failed\n");
+      return 1;
+    }
+    done = 0;
+    double start = now_ns();
+    for (long i = 0; i < requests; i++) {
+      jobs[i] = (struct Job){ private_key, cipher, cipher_length, 0 };
+      if (!rsa_executor_submit(executor, unwrap, completed, &jobs[i], -1, NULL)) {
+        fprintf(stderr, "submission failed\n");
+        return 1;
+      }
+    }
+    pthread_mutex_lock(&done_mutex);
+    while (done < requests) {
+      pthread_cond_wait(&done_cond, &done_mutex);
+    }
+    pthread_mutex_unlock(&done_mutex);
+    double elapsed_ns = now_ns() - start;
+
+    struct Rsa_executor_stats stats;
+    rsa_executor_get_stats(executor, &stats);
+    printf("%2ld threads %8.0f ops/s  wait p50 %8.0f us p99 %8.0f us  service p50 %6.0f us p99 %6.0f us  max depth %zu\n",
+           threads, (double)requests / (elapsed_ns / 1e9),
+           rsa_executor_histogram_percentile(&stats.wait, 50), rsa_executor_histogram_percentile(&stats.wait, 99),
+           rsa_executor_histogram_percentile(&stats.service, 50), rsa_executor_histogram_percentile(&stats.service, 99),
+           stats.max_queue_depth);
+    rsa_executor_free(executor);
+    // every completion has run, so the statistics must count every request
+    if (stats.completed != (unsigned long)requests || stats.service.count != (unsigned long)requests) {
+      fprintf(stderr, "statistics count %lu of %ld requests\n", stats.completed, requests);
+      return 1;
+    }
+
+    for (long i = 0; i < requests; i++) {
+      if (!jobs[i].ok) {
+        fprintf(stderr, "unwrap %ld failed\n", i);
+        return 1;
+      }
+    }
+  }
+  free(jobs);
+  rsa_engine_key_free(private_key);
+  rsa_engine_key_free(public_key);
+  return 0;
+}
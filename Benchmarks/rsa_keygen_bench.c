@@ -0,0 +1,91 @@
+//
+//  rsa_keygen_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Latency distribution of RSA key generation: `RSA_generate_key_ex` compared with
+//  `rsa_keygen_parallel` on 1, 2, ... processors.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/bn.h>
+#include <openssl/rsa.h>
+#include "rsa_keygen.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void report(const char *name, int threads, int bits, double *samples_ns, long count) {
+  double total = 0;
+  for (long i = 0; i < count; i++) {
+    total += samples_ns[i];
+  }
+  qsort(samples_ns, (size_t)count, sizeof(double), compare);
+  printf("%-9s %2d threads %4d bit  mean %8.1f ms  p50 %8.1f ms  p90 %8.1f ms  max %8.1f ms\n",
+         name, threads, bits, total / (double)count / 1e6, samples_ns[count / 2] / 1e6,
+         samples_ns[(count * 9) / 10] / 1e6, samples_ns[count - 1] / 1e6);
+}
+
+static int generate_single(int bits) {
+  RSA *rsa = RSA_new();
+  BIGNUM *e = BN_new();
+  int ok = rsa && e && BN_set_word(e, RSA_F4) == 1 && RSA_generate_key_ex(rsa, bits, e, NULL) == 1;
+  BN_free(e);
+  RSA_free(rsa);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 16;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  const int key_sizes[] = { 2048, 4096 };
+  double *samples_ns = calloc((size_t)(iterations > 0 ? iterations : 1), sizeof(double));
+  if (!samples_ns) {
+    return 1;
+  }
+
+  for (size_t k = 0; k < sizeof(key_sizes) / sizeof(key_sizes[0]); k++) {
+    int bits = key_sizes[k];
+    // RSA 4096 generation is slow, fewer iterations keep the run short
+    long count = bits == 4096 ? iterations / 4 + 1 : iterations;
+    for (long i = 0; i < count; i++) {
+      double start = now_ns();
+      if (!generate_single(bits)) {
+        fprintf(stderr, "RSA %d generation failed\n", bits);
+        return 1;
+      }
+      samples_ns[i] = now_ns() - start;
+    }
+    report("single", 1, bits, samples_ns, count);
+
+    for (long threads = 1; threads <= (processors < 2 ? 2 : processors); threads *= 2) {
+      for (long i = 0; i < count; i++) {
+        double start = now_ns();
+        EVP_PKEY *pkey = rsa_keygen_parallel(bits, (int)threads, NULL);
+        samples_ns[i] = now_ns() - start;
+        const RSA *rsa = pkey ? EVP_PKEY_get0_RSA(pkey) : NULL;
+        if (!rsa || RSA_bits(rsa) != bits || RSA_check_key(rsa) != 1) {
+          fprintf(stderr, "parallel RSA %d generation failed\n", bits);
+          return 1;
+        }
+        EVP_PKEY_free(pkey);
+      }
+      report("parallel", (int)threads, bits, samples_ns, count);
+    }
+  }
+  free(samples_ns);
+  return 0;
+}
@@ -0,0 +1,252 @@
+//
+//  smime_bench.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Replays a corpus of smime_corpus: per message kind and payload size the time of the MIME parsing
+//  (SMIME_read_PKCS7 as in smime_decrypt and smime_verify), of smime_decrypt and of smime_verify. Every result
+//  and the SHA256 of the content is checked against the manifest, any mismatch fails the run.
+//
+//  Usage: smime_bench DIR [max megabytes per message, default 256]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pkcs7.h>
+#include "alloc_count.h"
+#include "smime.h"
+
+#define MAX_GROUPS 64
+#define MAX_TRUSTED 16
+
+enum Field {
+  Field_file = 0,
+  Field_kind,
+  Field_size,
+  Field_payload_bytes,
+  Field_parts,
+  Field_recipients,
+  Field_chain_depth,
+  Field_sender,
+  Field_decrypt_key,
+  Field_trusted_certs,
+  Field_expect_decrypt,
+  Field_expect_verify,
+  Field_content_sha256,
+  Field_count
+};
+
+struct Group {
+  char kind[32];
+  char size[16];
+  long messages;
+  unsigned long long payload_bytes;
+  double parse_ns;
+  double decrypt_ns;
+  double verify_ns;
+  unsigned long allocations;
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const struct Group *group) {
+  double n = (double)group->messages;
+  double seconds = (group->decrypt_ns + group->verify_ns) / 1e9;
+  printf("%-17s %6s %4ld msgs parse %10.3f ms decrypt %10.3f ms verify %10.3f ms %8.1f MB/s %10.0f allocs/msg\n",
+         group->kind, group->size, group->messages, group->parse_ns / n / 1e6, group->decrypt_ns / n / 1e6,
+         group->verify_ns / n / 1e6, seconds > 0 ? (double)group->payload_bytes / 1e6 / seconds : 0.0,
+         (double)group->allocations / n);
+}
+
+/// Contents of `directory`/`name` with a terminating NUL, NULL if it cannot be read or is larger than `max_length`
+static char *read_file(const char *directory, const char *name, size_t max_length, size_t *length) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return NULL;
+  }
+  char *data = NULL;
+  long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  if (size >= 0 && (size_t)size <= max_length && fseek(file, 0, SEEK_SET) == 0 && (data = malloc((size_t)size + 1))) {
+    if (fread(data, 1, (size_t)size, file) == (size_t)size) {
+      data[size] = '\0';
+      *length = (size_t)size;
+    } else {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(file);
+  return data;
+}
+
+static int split_fields(char *line, char *fields[Field_count]) {
+  line[strcspn(line, "\r\n")] = '\0';
+  int count = 0;
+  for (char *field = strtok(line, "\t"); field && count < Field_count; field = strtok(NULL, "\t")) {
+    fields[count++] = field;
+  }
+  return count == Field_count;
+}
+
+static struct Group *group_for(struct Group *groups, int *group_count, const char *kind, const char *size) {
+  for (int i = 0; i < *group_count; i++) {
+    if (strcmp(groups[i].kind, kind) == 0 && strcmp(groups[i].size, size) == 0) {
+      return &groups[i];
+    }
+  }
+  if (*group_count == MAX_GROUPS) {
+    return NULL;
+  }
+  struct Group *group = &groups[(*group_count)++];
+  memset(group, 0, sizeof(*group));
+  snprintf(group->kind, sizeof(group->kind), "%s", kind);
+  snprintf(group->size, sizeof(group->size), "%s", size);
+  return group;
+}
+
+static int matches_sha256(const char *content, const char *expected) {
+  unsigned char digest[32];
+  char hex[65];
+  if (EVP_Digest(content, strlen(content), digest, NULL, EVP_sha256(), NULL) != 1) {
+    return 0;
+  }
+  for (int i = 0; i < 32; i++) {
+    snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+  }
+  return strcmp(hex, expected) == 0;
+}
+
+static int check(const char *file, const char *step, const char *expected, int succeeded) {
+  if (strcmp(expected, succeeded ? "ok" : "fail") == 0) {
+    return 1;
+  }
+  fprintf(stderr, "%s: %s expected %s\n", file, step, expected);
+  return 0;
+}
+
+/// Runs one manifest line, adds its times to `group`
+static int replay(const char *directory, char *fields[Field_count], const char *message, size_t length, struct Group *group) {
+  const char *file = fields[Field_file];
+  unsigned long allocations = alloc_count();
+
+  double start = now_ns();
+  BIO *bio = BIO_new_mem_buf(message, (int)length);
+  BIO *bcont = NULL;
+  PKCS7 *pkcs7 = bio ? SMIME_read_PKCS7(bio, &bcont) : NULL;
+  int parsed = pkcs7 != NULL;
+  PKCS7_free(pkcs7);
+  BIO_free(bcont);
+  BIO_free(bio);
+  group->parse_ns += now_ns() - start;
+  if (!parsed) {
+    fprintf(stderr, "%s: MIME parsing failed\n", file);
+    return 0;
+  }
+
+  int ok = 1;
+  char *decrypted = NULL;
+  if (strcmp(fields[Field_expect_decrypt], "-") != 0) {
+    size_t key_length = 0;
+    char *key = read_file(directory, fields[Field_decrypt_key], 1 << 20, &key_length);
+    start = now_ns();
+    decrypted = key ? smime_decrypt(message, key) : NULL;
+    group->decrypt_ns += now_ns() - start;
+    ok = check(file, "decrypt", fields[Field_expect_decrypt], decrypted != NULL);
+    free(key);
+  }
+
+  char *content = NULL;
+  if (ok && strcmp(fields[Field_expect_verify], "-") != 0) {
+    const char *certs[MAX_TRUSTED];
+    int cert_count = 0;
+    for (char *name = strtok(fields[Field_trusted_certs], ","); name && cert_count < MAX_TRUSTED; name = strtok(NULL, ",")) {
+      size_t cert_length = 0;
+      char *cert = read_file(directory, name, 1 << 20, &cert_length);
+      if (cert) {
+        certs[cert_count++] = cert;
+      }
+    }
+    enum Smime_error err = 0;
+    start = now_ns();
+    int verified = smime_verify(decrypted ? decrypted : message, fields[Field_sender], certs, cert_count, &content, &err);
+    group->verify_ns += now_ns() - start;
+    ok = check(file, "verify", fields[Field_expect_verify], verified);
+    for (int i = 0; i < cert_count; i++) {
+      free((char *)certs[i]);
+    }
+  }
+
+  const char *result = content ? content : decrypted;
+  if (ok && strcmp(fields[Field_content_sha256], "-") != 0 && !(result && matches_sha256(result, fields[Field_content_sha256]))) {
+    fprintf(stderr, "%s: content does not match\n", file);
+    ok = 0;
+  }
+  free(content);
+  free(decrypted);
+  ERR_clear_error();
+
+  group->messages++;
+  group->payload_bytes += strtoull(fields[Field_payload_bytes], NULL, 10);
+  group->allocations += alloc_count() - allocations;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: smime_bench DIR [max megabytes per message]\n");
+    return 2;
+  }
+  const char *directory = argv[1];
+  size_t max_length = (size_t)(argc > 2 ? atol(argv[2]) : 256) << 20;
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/manifest.tsv", directory);
+  FILE *manifest = fopen(path, "r");
+  if (!manifest) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+
+  struct Group groups[MAX_GROUPS];
+  int group_count = 0;
+  long messages = 0, mismatches = 0, skipped = 0;
+  char *line = NULL;
+  size_t capacity = 0;
+  while (getline(&line, &capacity, manifest) > 0) {
+    char *fields[Field_count];
+    if (line[0] == '#' || !split_fields(line, fields)) {
+      continue;
+    }
+    size_t length = 0;
+    char *message = read_file(directory, fields[Field_file], max_length, &length);
+    struct Group *group = message ? group_for(groups, &group_count, fields[Field_kind], fields[Field_size]) : NULL;
+    if (!group) {
+      skipped++;
+      free(message);
+      continue;
+    }
+    messages++;
+    mismatches += !replay(directory, fields, message, length, group);
+    free(message);
+  }
+  free(line);
+  fclose(manifest);
+
+  for (int i = 0; i < group_count; i++) {
+    report(&groups[i]);
+  }
+  printf("%ld messages, %ld mismatches, %ld skipped\n", messages, mismatches, skipped);
+  return mismatches == 0 && messages > 0 ? 0 : 1;
+}
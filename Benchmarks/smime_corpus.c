@@ -0,0 +1,682 @@
+//
+//  smime_corpus.c
+//  Krypt Benchmarks
+//
+//  Created by agent on 18.10.26.
+//
+//  Generates a corpus of encrypted, clear signed, opaque signed and signed then encrypted S/MIME messages and a
+//  manifest of the expected results of smime_decrypt and smime_verify, replayed by smime_bench. The certificates
+//  are issued by a local CA chain, payloads are multipart/mixed MIME entities with text and attachment parts.
+//  Payloads and the choice of tampered messages are reproducible from the seed, keys and signatures are not.
+//  Messages are streamed from a payload file to the output file, 1 GB payloads do not need 1 GB of memory.
+//
+//  Usage: smime_corpus -o DIR [-n count] [-k kinds] [-s sizes] [-r recipients] [-d depth] [-p parts]
+//                      [-a types] [-b bits] [-t percent] [-S seed]
+//
+//    -n  messages per kind and size, default 1
+//    -k  kinds: encrypted,clear-signed,opaque-signed,signed-encrypted (default all)
+//    -s  payload sizes from 1K to 1G with K, M or G suffix, default 1K,64K,1M
+//    -r  recipients per encrypted message, default 1
+//    -d  CA certificates above the signer, 1 = the root issues the signer, default 1
+//    -p  MIME parts per payload, the first is text, default 2
+//    -a  attachment types: txt,json,png,pdf,bin (default txt,png,pdf)
+//    -b  RSA key size, 2048 or 4096, default 2048
+//    -t  percent of messages that must fail: flipped content, untrusted root or a key of no recipient
+//    -S  seed of the payloads, default 1
+//
+//  Layout of DIR: keys/*.pem, certs/*.pem, messages/*.eml and manifest.tsv with one tab separated line per message:
+//  file kind size payload_bytes parts recipients chain_depth sender decrypt_key trusted_certs expect_decrypt
+//  expect_verify content_sha256. Paths are relative to DIR, "-" marks a step that does not apply.
+//
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/pkcs7.h>
+#include <openssl/x509.h>
+#include "ca.h"
+#include "key_pool.h"
+
+#define MAX_SIZES 16
+#define MAX_TYPES 8
+#define MARKER "Krypt S/MIME corpus"
+#define SENDER "sender@krypt.test"
+#define VALIDITY_SECONDS (10L * 365 * 24 * 60 * 60)
+
+enum Kind {
+  Kind_encrypted = 0,
+  Kind_clear_signed,
+  Kind_opaque_signed,
+  Kind_signed_encrypted,
+  Kind_count
+};
+
+static const char *kind_names[Kind_count] = { "encrypted", "clear-signed", "opaque-signed", "signed-encrypted" };
+
+struct Attachment_type {
+  const char *name;
+  const char *content_type;
+  /// Leading bytes of binary attachments, NULL for text attachments
+  const char *magic;
+  size_t magic_length;
+};
+
+static const struct Attachment_type attachment_types[] = {
+  { "txt", "text/plain; charset=utf-8", NULL, 0 },
+  { "json", "application/json", NULL, 0 },
+  { "png", "image/png", "\x89PNG\r\n\x1a\n", 8 },
+  { "pdf", "application/pdf", "%PDF-1.4\n", 9 },
+  { "bin", "application/octet-stream", "", 0 },
+};
+
+static const char *words[] = {
+  "patient", "record", "health", "document", "consent", "doctor", "laboratory", "result", "insurance",
+  "appointment", "prescription", "allergy", "vaccination", "report", "referral", "diagnosis",
+};
+
+struct Options {
+  const char *directory;
+  long count;
+  int kinds[Kind_count];
+  unsigned long long sizes[MAX_SIZES];
+  char size_labels[MAX_SIZES][16];
+  int size_count;
+  int recipients;
+  int depth;
+  int parts;
+  int types[MAX_TYPES];
+  int type_count;
+  int bits;
+  int tampered_percent;
+  uint64_t seed;
+};
+
+struct Identity {
+  EVP_PKEY *key;
+  X509 *certificate;
+  char key_path[64];
+};
+
+struct Corpus {
+  struct Ca **cas;
+  struct Ca *untrusted_root;
+  struct Identity signer;
+  struct Identity *recipients;
+  struct Identity outsider;
+  STACK_OF(X509) *chain;
+  STACK_OF(X509) *recipient_certificates;
+  char trusted[1024];
+};
+
+/// Payload file with the SHA256 of everything written
+struct Writer {
+  FILE *file;
+  EVP_MD_CTX *sha;
+  unsigned long long length;
+  int failed;
+};
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: smime_corpus -o DIR [-n count] [-k kinds] [-s sizes] [-r recipients] [-d depth] "
+                  "[-p parts] [-a types] [-b bits] [-t percent] [-S seed]\n");
+}
+
+// MARK: Options
+
+static int parse_size(const char *token, unsigned long long *size) {
+  char *end = NULL;
+  unsigned long long value = strtoull(token, &end, 10);
+  switch (*end) {
+    case 'K': case 'k': value <<= 10; end++; break;
+    case 'M': case 'm': value <<= 20; end++; break;
+    case 'G': case 'g': value <<= 30; end++; break;
+    default: break;
+  }
+  *size = value;
+  return end != token && *end == '\0' && value >= (1ULL << 10) && value <= (1ULL << 30);
+}
+
+static int parse_kinds(char *list, struct Options *options) {
+  memset(options->kinds, 0, sizeof(options->kinds));
+  for (char *token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+    int found = 0;
+    for (int kind = 0; kind < Kind_count; kind++) {
+      if (strcmp(token, kind_names[kind]) == 0) {
+        options->kinds[kind] = found = 1;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "unknown kind %s\n", token);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int parse_sizes(char *list, struct Options *options) {
+  options->size_count = 0;
+  for (char *token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+    if (options->size_count == MAX_SIZES || strlen(token) >= sizeof(options->size_labels[0]) ||
+        !parse_size(token, &options->sizes[options->size_count])) {
+      fprintf(stderr, "invalid size %s, sizes are 1K to 1G\n", token);
+      return 0;
+    }
+    strcpy(options->size_labels[options->size_count++], token);
+  }
+  return options->size_count > 0;
+}
+
+static int parse_types(char *list, struct Options *options) {
+  options->type_count = 0;
+  size_t known = sizeof(attachment_types) / sizeof(attachment_types[0]);
+  for (char *token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+    size_t type = 0;
+    while (type < known && strcmp(token, attachment_types[type].name) != 0) {
+      type++;
+    }
+    if (type == known || options->type_count == MAX_TYPES) {
+      fprintf(stderr, "invalid attachment type %s\n", token);
+      return 0;
+    }
+    options->types[options->type_count++] = (int)type;
+  }
+  return options->type_count > 0;
+}
+
+static int parse_options(int argc, char **argv, struct Options *options) {
+  char default_sizes[] = "1K,64K,1M";
+  char default_types[] = "txt,png,pdf";
+  *options = (struct Options){ .count = 1, .recipients = 1, .depth = 1, .parts = 2, .bits = 2048, .seed = 1 };
+  for (int kind = 0; kind < Kind_count; kind++) {
+    options->kinds[kind] = 1;
+  }
+  if (!parse_sizes(default_sizes, options) || !parse_types(default_types, options)) {
+    return 0;
+  }
+
+  int option;
+  while ((option = getopt(argc, argv, "o:n:k:s:r:d:p:a:b:t:S:")) != -1) {
+    int ok = 1;
+    switch (option) {
+      case 'o': options->directory = optarg; break;
+      case 'n': options->count = atol(optarg); ok = options->count > 0; break;
+      case 'k': ok = parse_kinds(optarg, options); break;
+      case 's': ok = parse_sizes(optarg, options); break;
+      case 'r': options->recipients = atoi(optarg); ok = options->recipients > 0; break;
+      case 'd': options->depth = atoi(optarg); ok = options->depth > 0 && options->depth <= 8; break;
+      case 'p': options->parts = atoi(optarg); ok = options->parts > 0 && options->parts <= 64; break;
+      case 'a': ok = parse_types(optarg, options); break;
+      case 'b': options->bits = atoi(optarg); ok = options->bits == 2048 || options->bits == 4096; break;
+      case 't': options->tampered_percent = atoi(optarg); ok = options->tampered_percent >= 0 && options->tampered_percent <= 100; break;
+      case 'S': options->seed = strtoull(optarg, NULL, 10); break;
+      default: ok = 0; break;
+    }
+    if (!ok) {
+      return 0;
+    }
+  }
+  return options->directory != NULL && optind == argc;
+}
+
+// MARK: Files
+
+static int make_directory(const char *directory, const char *name) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", directory, name ? name : "");
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static FILE *open_file(const char *directory, const char *name, const char *mode) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  return fopen(path, mode);
+}
+
+static BIO *open_bio(const char *directory, const char *name, const char *mode) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  return BIO_new_file(path, mode);
+}
+
+static int write_key(const char *directory, const char *name, EVP_PKEY *key) {
+  BIO *bio = open_bio(directory, name, "w");
+  int ok = bio && PEM_write_bio_PrivateKey(bio, key, NULL, NULL, 0, NULL, NULL) == 1;
+  BIO_free(bio);
+  return ok;
+}
+
+static int write_certificate(const char *directory, const char *name, X509 *certificate) {
+  BIO *bio = open_bio(directory, name, "w");
+  int ok = bio && PEM_write_bio_X509(bio, certificate) == 1;
+  BIO_free(bio);
+  return ok;
+}
+
+static char *pem_string(EVP_PKEY *key, int private) {
+  BIO *bio = BIO_new(BIO_s_mem());
+  int ok = bio && (private ? PEM_write_bio_PrivateKey(bio, key, NULL, NULL, 0, NULL, NULL) : PEM_write_bio_PUBKEY(bio, key));
+  char *pem = NULL;
+  if (ok == 1) {
+    BUF_MEM *mem = NULL;
+    BIO_get_mem_ptr(bio, &mem);
+    pem = strndup(mem->data, mem->length);
+  }
+  BIO_free(bio);
+  return pem;
+}
+
+// MARK: Certificates
+
+static EVP_PKEY *generate_key(const struct Options *options) {
+  return key_pool_generate(options->bits == 4096 ? Key_pool_type_rsa_4096 : Key_pool_type_rsa_2048, NULL);
+}
+
+static struct Ca *new_ca(const struct Options *options, struct Ca *parent, const char *common_name, const char *file) {
+  EVP_PKEY *key = generate_key(options);
+  char *key_pem = key ? pem_string(key, 1) : NULL;
+  struct Ca *ca = NULL;
+  if (key_pem) {
+    ca = parent ? ca_new_intermediate(parent, key_pem, common_name, VALIDITY_SECONDS, NULL)
+                : ca_new_self_signed(key_pem, common_name, VALIDITY_SECONDS, NULL);
+  }
+  char *certificate_pem = ca ? ca_certificate_pem(ca) : NULL;
+  FILE *out = certificate_pem ? open_file(options->directory, file, "w") : NULL;
+  int ok = out && fputs(certificate_pem, out) >= 0;
+  if (out && fclose(out) != 0) {
+    ok = 0;
+  }
+  if (!ok) {
+    ca_free(ca);
+    ca = NULL;
+  }
+  free(certificate_pem);
+  free(key_pem);
+  EVP_PKEY_free(key);
+  return ca;
+}
+
+static X509 *ca_x509(const struct Ca *ca) {
+  char *pem = ca_certificate_pem(ca);
+  BIO *bio = pem ? BIO_new_mem_buf(pem, -1) : NULL;
+  X509 *certificate = bio ? PEM_read_bio_X509(bio, NULL, NULL, NULL) : NULL;
+  BIO_free(bio);
+  free(pem);
+  return certificate;
+}
+
+/// Generates a key and, if `ca` is not NULL, an S/MIME certificate for `email`, both written below `name`
+static int new_identity(const struct Options *options, const struct Ca *ca, const char *name, const char *email, struct Identity *identity) {
+  identity->key = generate_key(options);
+  snprintf(identity->key_path, sizeof(identity->key_path), "keys/%s.pem", name);
+  if (!identity->key || !write_key(options->directory, identity->key_path, identity->key)) {
+    return 0;
+  }
+  if (!ca) {
+    return 1;
+  }
+  char *public_key_pem = pem_string(identity->key, 0);
+  struct Ca_profile profile = { VALIDITY_SECONDS, 300, 1 };
+  struct Ca_request request = { NULL, public_key_pem, name, email };
+  struct Der_buffer *der = public_key_pem ? ca_issue_der(ca, &profile, &request, NULL) : NULL;
+  const unsigned char *p = der ? der->data : NULL;
+  identity->certificate = p ? d2i_X509(NULL, &p, (long)der->length) : NULL;
+  der_buffer_free(der);
+  free(public_key_pem);
+
+  char certificate_path[64];
+  snprintf(certificate_path, sizeof(certificate_path), "certs/%s.pem", name);
+  return identity->certificate && write_certificate(options->directory, certificate_path, identity->certificate);
+}
+
+static void free_identity(struct Identity *identity) {
+  EVP_PKEY_free(identity->key);
+  X509_free(identity->certificate);
+}
+
+static int new_corpus(const struct Options *options, struct Corpus *corpus) {
+  corpus->cas = calloc((size_t)options->depth, sizeof(struct Ca *));
+  corpus->recipients = calloc((size_t)options->recipients, sizeof(struct Identity));
+  corpus->chain = sk_X509_new_null();
+  corpus->recipient_certificates = sk_X509_new_null();
+  if (!corpus->cas || !corpus->recipients || !corpus->chain || !corpus->recipient_certificates) {
+    return 0;
+  }
+
+  size_t trusted_length = 0;
+  for (int i = 0; i < options->depth; i++) {
+    char common_name[64], file[64];
+    if (i == 0) {
+      snprintf(common_name, sizeof(common_name), "Krypt Corpus Root CA");
+      snprintf(file, sizeof(file), "certs/root.pem");
+    } else {
+      snprintf(common_name, sizeof(common_name), "Krypt Corpus Intermediate CA %d", i);
+      snprintf(file, sizeof(file), "certs/intermediate-%d.pem", i);
+    }
+    corpus->cas[i] = new_ca(options, i ? corpus->cas[i - 1] : NULL, common_name, file);
+    if (!corpus->cas[i]) {
+      return 0;
+    }
+    // PKCS7_NOCHAIN of smime_verify: the whole chain above the signer must be trusted
+    trusted_length += (size_t)snprintf(corpus->trusted + trusted_length, sizeof(corpus->trusted) - trusted_length,
+                                       "%s%s", i ? "," : "", file);
+    X509 *intermediate = i ? ca_x509(corpus->cas[i]) : NULL;
+    if (i && (!intermediate || !sk_X509_push(corpus->chain, intermediate))) {
+      X509_free(intermediate);
+      return 0;
+    }
+  }
+
+  struct Ca *issuer = corpus->cas[options->depth - 1];
+  if (!new_identity(options, issuer, "signer", SENDER, &corpus->signer)) {
+    return 0;
+  }
+  for (int i = 0; i < options->recipients; i++) {
+    char name[32], email[64];
+    snprintf(name, sizeof(name), "recipient-%d", i);
+    snprintf(email, sizeof(email), "recipient-%d@krypt.test", i);
+    if (!new_identity(options, issuer, name, email, &corpus->recipients[i]) ||
+        !sk_X509_push(corpus->recipient_certificates, corpus->recipients[i].certificate)) {
+      return 0;
+    }
+  }
+  if (options->tampered_percent > 0) {
+    corpus->untrusted_root = new_ca(options, NULL, "Krypt Corpus Untrusted Root CA", "certs/untrusted-root.pem");
+    if (!corpus->untrusted_root || !new_identity(options, NULL, "outsider", NULL, &corpus->outsider)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void free_corpus(const struct Options *options, struct Corpus *corpus) {
+  sk_X509_free(corpus->recipient_certificates);
+  sk_X509_pop_free(corpus->chain, X509_free);
+  for (int i = 0; corpus->recipients && i < options->recipients; i++) {
+    free_identity(&corpus->recipients[i]);
+  }
+  for (int i = 0; corpus->cas && i < options->depth; i++) {
+    ca_free(corpus->cas[i]);
+  }
+  free_identity(&corpus->signer);
+  free_identity(&corpus->outsider);
+  ca_free(corpus->untrusted_root);
+  free(corpus->recipients);
+  free(corpus->cas);
+}
+
+// MARK: Payload
+
+static void writer_write(struct Writer *writer, const void *data, size_t length) {
+  if (fwrite(data, 1, length, writer->file) != length || EVP_DigestUpdate(writer->sha, data, length) != 1) {
+    writer->failed = 1;
+  }
+  writer->length += length;
+}
+
+static void writer_printf(struct Writer *writer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void writer_printf(struct Writer *writer, const char *format, ...) {
+  char line[512];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(line, sizeof(line), format, arguments);
+  va_end(arguments);
+  writer_write(writer, line, length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1);
+}
+
+/// Lines of words, as plain text or one JSON object per line, until `budget` bytes are written
+static void write_text(struct Writer *writer, uint64_t *state, unsigned long long budget, int json) {
+  size_t word_count = sizeof(words) / sizeof(words[0]);
+  unsigned long long start = writer->length;
+  char line[128];
+  for (unsigned long id = 0; writer->length - start < budget && !writer->failed; id++) {
+    size_t length = json ? (size_t)snprintf(line, sizeof(line), "{\"id\":%lu,\"text\":\"", id) : 0;
+    while (length < 64) {
+      const char *word = words[splitmix64(state) % word_count];
+      length += (size_t)snprintf(line + length, sizeof(line) - length, "%s%s", length && line[length - 1] != '"' ? " " : "", word);
+    }
+    length += (size_t)snprintf(line + length, sizeof(line) - length, "%s\r\n", json ? "\"}" : "");
+    writer_write(writer, line, length);
+  }
+}
+
+/// Base64 lines of 76 characters of random bytes, starting with the magic of the type, until `budget` bytes are written
+static void write_base64(struct Writer *writer, uint64_t *state, const struct Attachment_type *type, unsigned long long budget) {
+  enum { line_bytes = 57, lines = 1024 };
+  unsigned char raw[line_bytes * lines + 8];
+  unsigned char encoded[78 * lines + 1];
+  unsigned long long remaining = budget / 78 * line_bytes + line_bytes;
+  int first = 1;
+  while (remaining > 0 && !writer->failed) {
+    size_t chunk = remaining < sizeof(raw) - 8 ? (size_t)remaining : sizeof(raw) - 8;
+    for (size_t i = 0; i < chunk; i += 8) {
+      uint64_t random = splitmix64(state);
+      memcpy(raw + i, &random, 8);
+    }
+    if (first) {
+      memcpy(raw, type->magic, type->magic_length);
+      first = 0;
+    }
+    size_t length = 0;
+    for (size_t offset = 0; offset < chunk; offset += line_bytes) {
+      size_t n = chunk - offset < line_bytes ? chunk - offset : line_bytes;
+      length += (size_t)EVP_EncodeBlock(encoded + length, raw + offset, (int)n);
+      encoded[length++] = '\r';
+      encoded[length++] = '\n';
+    }
+    writer_write(writer, encoded, length);
+    remaining -= chunk;
+  }
+}
+
+/// Writes the MIME entity of message `index` with about `size` bytes to `name`
+static int write_payload(const struct Options *options, const char *name, long index, uint64_t seed,
+                         unsigned long long size, unsigned char digest[32], unsigned long long *length) {
+  struct Writer writer = { open_file(options->directory, name, "wb"), EVP_MD_CTX_new(), 0, 0 };
+  if (!writer.file || !writer.sha || EVP_DigestInit_ex(writer.sha, EVP_sha256(), NULL) != 1) {
+    writer.failed = 1;
+  }
+  uint64_t state = seed;
+  unsigned long long budget = size / (unsigned long long)options->parts;
+  char boundary[64];
+  snprintf(boundary, sizeof(boundary), "krypt-corpus-%016llx", (unsigned long long)splitmix64(&state));
+
+  if (!writer.failed && options->parts > 1) {
+    writer_printf(&writer, "Content-Type: multipart/mixed; boundary=\"%s\"\r\n\r\n--%s\r\n", boundary, boundary);
+  }
+  if (!writer.failed) {
+    writer_printf(&writer, "Content-Type: text/plain; charset=utf-8\r\nContent-Transfer-Encoding: 7bit\r\n\r\n"
+                           "Message %ld of the " MARKER "\r\n", index);
+    write_text(&writer, &state, budget, 0);
+  }
+  for (int part = 1; part < options->parts && !writer.failed; part++) {
+    const struct Attachment_type *type = &attachment_types[options->types[(part - 1) % options->type_count]];
+    int text = type->magic == NULL;
+    writer_printf(&writer, "\r\n--%s\r\nContent-Type: %s\r\nContent-Transfer-Encoding: %s\r\n"
+                           "Content-Disposition: attachment; filename=\"attachment-%d.%s\"\r\n\r\n",
+                  boundary, type->content_type, text ? "7bit" : "base64", part, type->name);
+    if (text) {
+      write_text(&writer, &state, budget, strcmp(type->name, "json") == 0);
+    } else {
+      write_base64(&writer, &state, type, budget);
+    }
+  }
+  if (!writer.failed && options->parts > 1) {
+    writer_printf(&writer, "\r\n--%s--\r\n", boundary);
+  }
+
+  int ok = !writer.failed && EVP_DigestFinal_ex(writer.sha, digest, NULL) == 1;
+  if (writer.file && fclose(writer.file) != 0) {
+    ok = 0;
+  }
+  EVP_MD_CTX_free(writer.sha);
+  *length = writer.length;
+  return ok;
+}
+
+// MARK: S/MIME
+
+static int sign_file(const struct Options *options, const char *input, const char *output, const struct Corpus *corpus, int detached) {
+  int flags = PKCS7_STREAM | PKCS7_BINARY | (detached ? PKCS7_DETACHED : 0);
+  BIO *in = open_bio(options->directory, input, "rb");
+  BIO *out = open_bio(options->directory, output, "wb");
+  PKCS7 *pkcs7 = in && out ? PKCS7_sign(corpus->signer.certificate, corpus->signer.key, corpus->chain, in, flags) : NULL;
+  int ok = pkcs7 && SMIME_write_PKCS7(out, pkcs7, in, flags) == 1;
+  PKCS7_free(pkcs7);
+  BIO_free(out);
+  BIO_free(in);
+  return ok;
+}
+
+static int encrypt_file(const struct Options *options, const char *input, const char *output, const struct Corpus *corpus) {
+  int flags = PKCS7_STREAM | PKCS7_BINARY;
+  BIO *in = open_bio(options->directory, input, "rb");
+  BIO *out = open_bio(options->directory, output, "wb");
+  PKCS7 *pkcs7 = in && out ? PKCS7_encrypt(corpus->recipient_certificates, in, EVP_aes_256_cbc(), flags) : NULL;
+  int ok = pkcs7 && SMIME_write_PKCS7(out, pkcs7, in, flags) == 1;
+  PKCS7_free(pkcs7);
+  BIO_free(out);
+  BIO_free(in);
+  return ok;
+}
+
+/// Flips the first letter of the marker in the text part of a clear signed message, the signature no longer matches
+static int tamper(const struct Options *options, const char *name) {
+  FILE *file = open_file(options->directory, name, "r+b");
+  char head[16384];
+  size_t length = file ? fread(head, 1, sizeof(head) - 1, file) : 0;
+  head[length] = '\0';
+  char *marker = strstr(head, MARKER);
+  int ok = marker && fseek(file, marker - head, SEEK_SET) == 0 && fputc('k', file) == 'k';
+  if (file && fclose(file) != 0) {
+    ok = 0;
+  }
+  return ok;
+}
+
+static int write_message(const struct Options *options, const struct Corpus *corpus, FILE *manifest,
+                         enum Kind kind, int size_index, long index) {
+  uint64_t seed = options->seed ^ ((uint64_t)kind << 56) ^ ((uint64_t)size_index << 40) ^ (uint64_t)index;
+  uint64_t state = seed;
+  int tampered = (int)(splitmix64(&state) % 100) < options->tampered_percent;
+
+  char file[128];
+  snprintf(file, sizeof(file), "messages/%s-%s-%03ld.eml", kind_names[kind], options->size_labels[size_index], index);
+  unsigned char digest[32];
+  unsigned long long payload_bytes = 0;
+  if (!write_payload(options, "messages/.payload", index, splitmix64(&state), options->sizes[size_index], digest, &payload_bytes)) {
+    return 0;
+  }
+
+  int ok = 0;
+  switch (kind) {
+    case Kind_encrypted:
+      ok = encrypt_file(options, "messages/.payload", file, corpus);
+      break;
+    case Kind_clear_signed:
+      ok = sign_file(options, "messages/.payload", file, corpus, 1) && (!tampered || tamper(options, file));
+      break;
+    case Kind_opaque_signed:
+      ok = sign_file(options, "messages/.payload", file, corpus, 0);
+      break;
+    case Kind_signed_encrypted:
+      ok = sign_file(options, "messages/.payload", "messages/.signed", corpus, 1) &&
+           encrypt_file(options, "messages/.signed", file, corpus);
+      break;
+    default:
+      break;
+  }
+  if (!ok) {
+    return 0;
+  }
+
+  int encrypted = kind == Kind_encrypted || kind == Kind_signed_encrypted;
+  int signed_message = kind != Kind_encrypted;
+  // tampered: encrypted messages are opened with a key of no recipient, signed messages fail verification
+  int decrypt_fails = tampered && kind == Kind_encrypted;
+  int verify_fails = tampered && signed_message;
+  const char *untrusted = kind == Kind_clear_signed ? corpus->trusted : "certs/untrusted-root.pem";
+  char sha[65];
+  for (int i = 0; i < 32; i++) {
+    snprintf(sha + 2 * i, 3, "%02x", digest[i]);
+  }
+  fprintf(manifest, "%s\t%s\t%s\t%llu\t%d\t%d\t%d\t%s\t%s\t%s\t%s\t%s\t%s\n",
+          file, kind_names[kind], options->size_labels[size_index], payload_bytes, options->parts,
+          encrypted ? options->recipients : 0, signed_message ? options->depth : 0,
+          signed_message ? SENDER : "-",
+          encrypted ? (decrypt_fails ? corpus->outsider.key_path : corpus->recipients[index % options->recipients].key_path) : "-",
+          signed_message ? (verify_fails ? untrusted : corpus->trusted) : "-",
+          encrypted ? (decrypt_fails ? "fail" : "ok") : "-",
+          signed_message ? (verify_fails ? "fail" : "ok") : "-",
+          decrypt_fails || verify_fails ? "-" : sha);
+  return ferror(manifest) == 0;
+}
+
+int main(int argc, char **argv) {
+  struct Options options;
+  if (!parse_options(argc, argv, &options)) {
+    usage();
+    return 2;
+  }
+  if (!make_directory(options.directory, NULL) || !make_directory(options.directory, "keys") ||
+      !make_directory(options.directory, "certs") || !make_directory(options.directory, "messages")) {
+    fprintf(stderr, "cannot create %s: %s\n", options.directory, strerror(errno));
+    return 1;
+  }
+
+  double start = now_s();
+  struct Corpus corpus = { 0 };
+  FILE *manifest = NULL;
+  int ok = new_corpus(&options, &corpus) && (manifest = open_file(options.directory, "manifest.tsv", "w")) != NULL;
+  if (ok) {
+    fprintf(manifest, "# file\tkind\tsize\tpayload_bytes\tparts\trecipients\tchain_depth\tsender\tdecrypt_key"
+                      "\ttrusted_certs\texpect_decrypt\texpect_verify\tcontent_sha256\n");
+  }
+  long messages = 0;
+  for (int kind = 0; ok && kind < Kind_count; kind++) {
+    for (int size = 0; ok && options.kinds[kind] && size < options.size_count; size++) {
+      for (long index = 0; ok && index < options.count; index++) {
+        ok = write_message(&options, &corpus, manifest, (enum Kind)kind, size, index);
+        messages += ok;
+      }
+    }
+  }
+  if (manifest && fclose(manifest) != 0) {
+    ok = 0;
+  }
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/messages/.payload", options.directory);
+  remove(path);
+  snprintf(path, sizeof(path), "%s/messages/.signed", options.directory);
+  remove(path);
+  free_corpus(&options, &corpus);
+
+  if (!ok) {
+    fprintf(stderr, "corpus generation failed after %ld messages\n", messages);
+    return 1;
+  }
+  printf("%ld messages in %s, %.1f s\n", messages, options.directory, now_s() - start);
+  return 0;
+}
@@ -70,4 +70,227 @@ final class AES256Tests: XCTestCase {
     // then
     XCTAssertEqual(decryptedString, secret)
   }
+
+  func testGCM_encryptDecryptFile__shouldDoFullLoop() throws {
+    // given
+    let secretData = Data((0 ..< 1_000_003).map { UInt8(truncatingIfNeeded: $0) })
+    let input = temporaryFileURL()
+    let encryptedURL = temporaryFileURL()
+    let decryptedURL = temporaryFileURL()
+    try secretData.write(to: input)
+
+    // when
+    let (key, iv) = try AES256.encrypt(file: input, to: encryptedURL, blockMode: .gcm)
+    try AES256.decrypt(file: encryptedURL, to: decryptedURL, key: key, iv: iv, blockMode: .gcm)
+
+    // then
+    XCTAssertEqual(try Data(contentsOf: decryptedURL), secretData)
+  }
+
+  func testCBC_encryptFileDecryptData__shouldMatchInMemoryFormat() throws {
+    // given
+    let secret = UUID().uuidString
+    let secretData = secret.data(using: .utf8)!
+    let input = temporaryFileURL()
+    let encryptedURL = temporaryFileURL()
+    try secretData.write(to: input)
+
+    // when
+    let (key, iv) = try AES256.encrypt(file: input, to: encryptedURL, blockMode: .cbc)
+    let decrypted = try AES256.decrypt(data: try Data(contentsOf: encryptedURL), key: key, iv: iv, blockMode: .cbc)
+
+    // then
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), secret)
+  }
+
+  func testGCM_decryptTamperedFile__shouldThrowAndRemoveOutput() throws {
+    // given
+    let input = temporaryFileURL()
+    let encryptedURL = temporaryFileURL()
+    let decryptedURL = temporaryFileURL()
+    try UUID().uuidString.data(using: .utf8)!.write(to: input)
+    let (key, iv) = try AES256.encrypt(file: input, to: encryptedURL, blockMode: .gcm)
+    var encrypted = try Data(contentsOf: encryptedURL)
+    encrypted[0] ^= 0xFF
+    try encrypted.write(to: encryptedURL)
+
+    // when
+    XCTAssertThrowsError(try AES256.decrypt(file: encryptedURL, to: decryptedURL, key: key, iv: iv, blockMode: .gcm)) {
+      // then
+      guard case AES256.Error.authenticationFailed = $0 else {
+        return XCTFail("Unexpected error \($0)")
+      }
+    }
+    XCTAssertFalse(FileManager.default.fileExists(atPath: decryptedURL.path))
+  }
+
+  func testGCMAndCBC_memoryMappedFile__shouldMatchPipelinedFile() throws {
+    for blockMode in [AES256.BlockMode.gcm, .cbc] {
+      // given
+      let secretData = Data((0 ..< 9_000_017).map { UInt8(truncatingIfNeeded: $0 &* 31) })
+      let input = temporaryFileURL()
+      let mappedURL = temporaryFileURL()
+      let pipelinedURL = temporaryFileURL()
+      let decryptedURL = temporaryFileURL()
+      try secretData.write(to: input)
+
+      // when
+      let (key, iv) = try AES256.encrypt(file: input, to: mappedURL, blockMode: blockMode, access: .memoryMapped)
+      _ = try AES256.encrypt(file: input, to: pipelinedURL, key: key, iv: iv, blockMode: blockMode)
+      try AES256.decrypt(file: mappedURL, to: decryptedURL, key: key, iv: iv, blockMode: blockMode, access: .memoryMapped)
+
+      // then
+      XCTAssertEqual(try Data(contentsOf: mappedURL), try Data(contentsOf: pipelinedURL))
+      XCTAssertEqual(try Data(contentsOf: decryptedURL), secretData)
+    }
+  }
+
+  func testGCM_encryptBufferDecryptData__shouldDoFullLoop() throws {
+    // given
+    let secret = UUID().uuidString
+    let secretData = secret.data(using: .utf8)!
+    let key = Data((0 ..< 32).map { UInt8($0) })
+    let iv = Data((0 ..< 16).map { UInt8($0) })
+    var encrypted = Data(count: AES256.encryptedCount(for: secretData.count, blockMode: .gcm))
+
+    // when
+    let written = try encrypted.withUnsafeMutableBytes { output in
+      try secretData.withUnsafeBytes { input in
+        try key.withUnsafeBytes { key in
+          try iv.withUnsafeBytes { iv in
+            try AES256.encrypt(input, into: output, key: key, iv: iv, blockMode: .gcm)
+          }
+        }
+      }
+    }
+    let decrypted = try AES256.decrypt(data: encrypted, key: key, iv: iv, blockMode: .gcm)
+
+    // then
+    XCTAssertEqual(written, encrypted.count)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), secret)
+  }
+
+  func testCBC_encryptDecryptBufferInPlace__shouldDoFullLoop() throws {
+    // given
+    let secretData = UUID().uuidString.data(using: .utf8)!
+    let (expected, key, iv) = try AES256.encrypt(data: secretData, blockMode: .cbc)
+    var buffer = secretData + Data(count: AES256.encryptedCount(for: secretData.count, blockMode: .cbc) - secretData.count)
+
+    // when
+    let (encryptedCount, decryptedCount, encrypted) = try buffer.withUnsafeMutableBytes { buffer -> (Int, Int, Data) in
+      try key.withUnsafeBytes { key in
+        try iv.withUnsafeBytes { iv in
+          let encryptedCount = try AES256.encrypt(UnsafeRawBufferPointer(rebasing: buffer[0 ..< secretData.count]), into: buffer, key: key, iv: iv, blockMode: .cbc)
+          let encrypted = Data(buffer[0 ..< encryptedCount])
+          let decryptedCount = try AES256.decrypt(UnsafeRawBufferPointer(rebasing: buffer[0 ..< encryptedCount]), into: buffer, key: key, iv: iv, blockMode: .cbc)
+          return (encryptedCount, decryptedCount, encrypted)
+        }
+      }
+    }
+
+    // then
+    XCTAssertEqual(encryptedCount, expected.count)
+    XCTAssertEqual(encrypted, expected)
+    XCTAssertEqual(buffer.prefix(decryptedCount), secretData)
+  }
+
+  func testGCM_encryptEVP__shouldMatchCryptoSwift() throws {
+    // given
+    let data = Data((0 ..< 1000).map { UInt8($0 % 251) })
+    let key = Data((0 ..< 32).map { UInt8($0) })
+    let iv = Data((0 ..< 16).map { UInt8($0) })
+
+    // when
+    let (expected, _, _) = try AES256.encrypt(data: data, key: key, iv: iv, blockMode: .gcm)
+    let (encrypted, _, _) = try AES256.encryptEVP(data: data, key: key, iv: iv, blockMode: .gcm)
+    let decrypted = try AES256.decryptEVP(data: expected, key: key, iv: iv, blockMode: .gcm)
+
+    // then
+    XCTAssertEqual(encrypted, expected)
+    XCTAssertEqual(decrypted, data)
+  }
+
+  func testGCM_decryptBufferEmptyPlaintext__shouldWriteNothing() throws {
+    // given
+    let key = Data((0 ..< 32).map { UInt8($0) })
+    let iv = Data((0 ..< 16).map { UInt8($0) })
+    let (encrypted, _, _) = try AES256.encrypt(data: Data(), key: key, iv: iv, blockMode: .gcm)
+
+    // when
+    let written = try encrypted.withUnsafeBytes { input in
+      try key.withUnsafeBytes { key in
+        try iv.withUnsafeBytes { iv in
+          try AES256.decrypt(input, into: UnsafeMutableRawBufferPointer(start: nil, count: 0), key: key, iv: iv, blockMode: .gcm)
+        }
+      }
+    }
+
+    // then
+    XCTAssertEqual(written, 0)
+  }
+
+  func testCBC_decryptBufferInvalidLength__shouldThrowInvalidInput() throws {
+    // given
+    let input = Data(count: 15)
+    var output = Data(count: 16)
+    let key = Data(count: 32)
+    let iv = Data(count: 16)
+
+    // when
+    XCTAssertThrowsError(try output.withUnsafeMutableBytes { output in
+      try input.withUnsafeBytes { input in
+        try key.withUnsafeBytes { key in
+          try iv.withUnsafeBytes { iv in
+            try AES256.decrypt(input, into: output, key: key, iv: iv, blockMode: .cbc)
+          }
+        }
+      }
+    }) {
+      // then
+      guard case AES256.Error.invalidInput = $0 else {
+        return XCTFail("Unexpected error \($0)")
+      }
+    }
+  }
+
+  func testGCM_encryptBuffer_performance() throws {
+    let record = Data(count: 2048)
+    let key = Data(count: 32)
+    let iv = Data(count: 16)
+    var output = Data(count: AES256.encryptedCount(for: record.count, blockMode: .gcm))
+
+    measure {
+      output.withUnsafeMutableBytes { output in
+        record.withUnsafeBytes { input in
+          key.withUnsafeBytes { key in
+            iv.withUnsafeBytes { iv in
+              for _ in 0 ..< 10000 {
+                _ = try? AES256.encrypt(input, into: output, key: key, iv: iv, blockMode: .gcm)
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  func testGCM_encryptData_performance() throws {
+    let record = Data(count: 2048)
+    let key = Data(count: 32)
+    let iv = Data(count: 16)
+
+    measure {
+      for _ in 0 ..< 10000 {
+        _ = try? AES256.encrypt(data: record, key: key, iv: iv, blockMode: .gcm)
+      }
+    }
+  }
+
+  private func temporaryFileURL() -> URL {
+    let url = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    addTeardownBlock {
+      try? FileManager.default.removeItem(at: url)
+    }
+    return url
+  }
 }
@@ -64,6 +64,124 @@ final class CSRTests: XCTestCase {
     XCTAssertNotEqual(result, expectedCSR)
   }
 
+  func testCreateDER_withCorrectAttributes__shouldMatchExpectedCSR() throws {
+    // given
+    let privateKey = try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+    let base64 = expectedCSR.components(separatedBy: .newlines).filter { !$0.hasPrefix("-----") }.joined()
+
+    // when
+    let der = try CSR.createDER(with: privateKey, attributes: .withCorrectAttributes)
+
+    // then
+    XCTAssertEqual(der, Data(base64Encoded: base64))
+  }
+
+  func testCreateBatch_withTemplate__shouldMatchExpectedCSRs() throws {
+    // given
+    let key = try CSR.SigningKey(key: try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private))
+    let template = CSR.SubjectTemplate([
+      ("C", .fixed("DE")),
+      ("ST", .placeholder),
+      ("L", .placeholder),
+      ("O", .placeholder),
+      ("OU", .placeholder),
+      ("emailAddress", .placeholder),
+      ("UID", .placeholder),
+      ("GN", .placeholder),
+      ("SN", .placeholder)
+    ])
+    let batch = [
+      CSR.BatchRequest(key: key, values: ["Berlin", "Berlin", "Vivy GmbH", "IT", "tech@vivy.com", "someUID", "someGN", "someSN"]),
+      CSR.BatchRequest(key: key, values: ["Baden-Württemberg", "Nürnberg", "Vüvy", "ÄIT", "test@vivy.com", "someÜID", "Gǖvenname", "Söörnamê"])
+    ]
+
+    // when
+    let result = try CSR.create(batch: batch, template: template, threadCount: 2)
+
+    // then
+    XCTAssertEqual(result.count, 2)
+    XCTAssertEqual(result[0].stringTrimmingWhitespacesAndNewlines, expectedCSR)
+    XCTAssertEqual(result[1].stringTrimmingWhitespacesAndNewlines, expectedCSRWithUmlauts)
+  }
+
+  func testCreateBatch_derFormat__shouldMatchPEMContent() throws {
+    // given
+    let key = try CSR.SigningKey(key: try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private))
+    let template = CSR.SubjectTemplate(attributes: .withCorrectAttributes)
+    let batch = [CSR.BatchRequest(key: key, values: [])]
+
+    // when
+    let der = try CSR.create(batch: batch, template: template, format: .der)
+
+    // then
+    let base64 = expectedCSR.components(separatedBy: .newlines).filter { !$0.hasPrefix("-----") }.joined()
+    XCTAssertEqual(der.first, Data(base64Encoded: base64))
+  }
+
+  func testCreateBatch_missingPlaceholderValue__shouldThrow() throws {
+    // given
+    let key = try CSR.SigningKey(key: try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private))
+    let template = CSR.SubjectTemplate([("C", .fixed("DE")), ("emailAddress", .placeholder)])
+
+    // then
+    XCTAssertThrowsError(try CSR.create(batch: [CSR.BatchRequest(key: key, values: [])], template: template))
+  }
+
+  func testCreate_withP256Key__shouldCreateCSR() throws {
+    // given
+    let privateKey = try ecPrivateKey()
+
+    // when
+    let result = try CSR.create(with: privateKey, attributes: .withCorrectAttributes)
+
+    // then
+    XCTAssertTrue(result.hasPrefix("-----BEGIN CERTIFICATE REQUEST-----"))
+  }
+
+  func testCreateBatch_withP256SigningKey__shouldMatchRequestInfoOfCreate() throws {
+    // given
+    let privateKey = try ecPrivateKey()
+    let key = try CSR.SigningKey(key: privateKey)
+    let template = CSR.SubjectTemplate(attributes: .withCorrectAttributes)
+
+    // when
+    let batch = try CSR.create(batch: [CSR.BatchRequest(key: key, values: [])], template: template, format: .der)
+    let single = try CSR.createDER(with: privateKey, attributes: .withCorrectAttributes)
+
+    // then
+    // ECDSA signatures are randomized, everything before the signature is equal
+    XCTAssertEqual(batch.count, 1)
+    XCTAssertNotNil(certificationRequestInfo(of: single))
+    XCTAssertEqual(batch.first.flatMap(certificationRequestInfo), certificationRequestInfo(of: single))
+  }
+
+  private func ecPrivateKey() throws -> Key {
+    let pem = TestData.openSSLPrivateKeyECPRIME256R1SEC1PEM.string
+    return try Key(pem: pem, type: .ecSECPrimeRandom, access: .private, size: .bit_256)
+  }
+
+  /// First element of the outer CSR SEQUENCE, the signed part
+  private func certificationRequestInfo(of der: Data) -> Data? {
+    let bytes = [UInt8](der)
+    func headerLength(at index: Int) -> (header: Int, length: Int)? {
+      guard index + 1 < bytes.count, bytes[index] == 0x30 else { return nil }
+      let first = Int(bytes[index + 1])
+      guard first & 0x80 != 0 else { return (2, first) }
+      let count = first & 0x7F
+      guard index + 2 + count <= bytes.count else { return nil }
+      let length = bytes[(index + 2) ..< (index + 2 + count)].reduce(0) { $0 << 8 | Int($1) }
+      return (2 + count, length)
+    }
+    guard
+      let outer = headerLength(at: 0),
+      let inner = headerLength(at: outer.header),
+      outer.header + inner.header + inner.length <= bytes.count
+    else {
+      return nil
+    }
+    return Data(bytes[outer.header ..< (outer.header + inner.header + inner.length)])
+  }
+
   private func createCSR(from attributes: CSRAttributes) -> String {
     let privateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
     let result = try! CSR.create(with: privateKey, attributes: attributes)
@@ -0,0 +1,112 @@
+//
+//  CertificateAuthorityTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+import Krypt
+import XCTest
+
+final class CertificateAuthorityTests: XCTestCase {
+  func testIssue_publicKey__shouldCreateCertificateWithEmail() throws {
+    // given
+    let ca = try selfSignedCA()
+    let request = CertificateAuthority.Request.publicKey(publicKeyPEM, commonName: "Test User", email: "test@vivy.com")
+
+    // when
+    let der = try ca.issue(request)
+
+    // then
+    let certificate = try XCTUnwrap(SecCertificateCreateWithData(nil, der as CFData))
+    var emails: CFArray?
+    XCTAssertEqual(SecCertificateCopyEmailAddresses(certificate, &emails), errSecSuccess)
+    XCTAssertEqual(emails as? [String], ["test@vivy.com"])
+    XCTAssertEqual(SecCertificateCopySubjectSummary(certificate) as String?, "Test User")
+  }
+
+  func testIssueBatch__shouldCreateRandomSerialNumbers() throws {
+    // given
+    let ca = try selfSignedCA()
+    let batch = (0 ..< 16).map {
+      CertificateAuthority.Request.publicKey(publicKeyPEM, commonName: "User \($0)", email: "user\($0)@vivy.com")
+    }
+
+    // when
+    let certificates = try ca.issue(batch: batch, threadCount: 4)
+
+    // then
+    let serials = try certificates.map { der -> Data in
+      let certificate = try XCTUnwrap(SecCertificateCreateWithData(nil, der as CFData))
+      return try XCTUnwrap(SecCertificateCopySerialNumberData(certificate, nil) as Data?)
+    }
+    XCTAssertEqual(serials.count, 16)
+    XCTAssertEqual(Set(serials).count, 16)
+    XCTAssertTrue(serials.allSatisfy { $0.count <= 20 && ($0.first ?? 0) < 0x80 })
+  }
+
+  func testIssueBatch_pemFormat__shouldCreatePEMCertificates() throws {
+    // given
+    let ca = try selfSignedCA()
+    let batch = [CertificateAuthority.Request.publicKey(publicKeyPEM, email: "test@vivy.com")]
+
+    // when
+    let certificates = try ca.issue(batch: batch, format: .pem)
+
+    // then
+    let pem = try XCTUnwrap(certificates.first.map { String(decoding: $0, as: UTF8.self) })
+    XCTAssertTrue(pem.hasPrefix("-----BEGIN CERTIFICATE-----\n"))
+  }
+
+  func testIssue_invalidCSR__shouldThrow() throws {
+    // given
+    let ca = try selfSignedCA()
+
+    // then
+    XCTAssertThrowsError(try ca.issue(.csr("-----BEGIN CERTIFICATE REQUEST-----\n", email: "test@vivy.com")))
+  }
+
+  func testInit_certificateOfOtherKey__shouldThrow() throws {
+    // given
+    let certificatePEM = try selfSignedCA().certificatePEM
+    let otherKeyPEM = TestData.openSSLPrivateKeyPEM.string
+
+    // then
+    XCTAssertThrowsError(try CertificateAuthority(keyPEM: otherKeyPEM, certificatePEM: certificatePEM))
+  }
+
+  func testInit_issuer__shouldCreateIntermediateCertificate() throws {
+    // given
+    let root = try selfSignedCA()
+
+    // when
+    let intermediate = try CertificateAuthority(
+      keyPEM: TestData.openSSLPrivateKeyPEM.string,
+      commonName: "Krypt Test Intermediate CA",
+      validity: 24 * 60 * 60,
+      issuer: root
+    )
+
+    // then
+    let der = try XCTUnwrap(Data(base64Encoded: intermediate.certificatePEM
+        .components(separatedBy: "\n")
+        .filter { !$0.hasPrefix("-----") }
+        .joined()))
+    let certificate = try XCTUnwrap(SecCertificateCreateWithData(nil, der as CFData))
+    XCTAssertEqual(SecCertificateCopySubjectSummary(certificate) as String?, "Krypt Test Intermediate CA")
+    XCTAssertNotEqual(intermediate.certificatePEM, root.certificatePEM)
+  }
+
+  private func selfSignedCA() throws -> CertificateAuthority {
+    return try CertificateAuthority(
+      keyPEM: TestData.openSSLPrivateKey2048PEM.string,
+      commonName: "Krypt Test CA",
+      validity: 24 * 60 * 60
+    )
+  }
+
+  private var publicKeyPEM: String {
+    return TestData.openSSLPublicKey2048PEM.string
+  }
+}
@@ -0,0 +1,72 @@
+//
+//  ChaCha20Poly1305Tests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+import Krypt
+import XCTest
+
+final class ChaCha20Poly1305Tests: XCTestCase {
+  // key and nonce of RFC 8439 section 2.8.2, without additional data
+  let key = Data(hex: "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f")
+  let nonce = Data(hex: "070000004041424344454647")
+  let message = "Ladies and Gentlemen of the class of '99"
+
+  func testEncrypt_knownKeyAndNonce__shouldMatchExpectedCiphertext() throws {
+    // when
+    let (encrypted, _, _) = try ChaCha20Poly1305.encrypt(data: message.data(using: .utf8)!, key: key, nonce: nonce)
+
+    // then
+    XCTAssertEqual(
+      encrypted,
+      Data(hex: "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca967122eb838bb957e60b8f30a8bc490057bad")
+    )
+  }
+
+  func testEncryptDecrypt__shouldDoFullLoop() throws {
+    // given
+    let secret = UUID().uuidString
+
+    // when
+    let (encrypted, key, nonce) = try ChaCha20Poly1305.encrypt(data: secret.data(using: .utf8)!)
+    let decrypted = try ChaCha20Poly1305.decrypt(data: encrypted, key: key, nonce: nonce)
+
+    // then
+    XCTAssertEqual(key.count, 32)
+    XCTAssertEqual(nonce.count, 12)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), secret)
+  }
+
+  func testEncryptDecrypt_empty__shouldDoFullLoop() throws {
+    // when
+    let (encrypted, key, nonce) = try ChaCha20Poly1305.encrypt(data: Data())
+    let decrypted = try ChaCha20Poly1305.decrypt(data: encrypted, key: key, nonce: nonce)
+
+    // then
+    XCTAssertEqual(encrypted.count, ChaCha20Poly1305.tagCount)
+    XCTAssertEqual(decrypted, Data())
+  }
+
+  func testDecrypt_tampered__shouldThrowAuthenticationFailed() throws {
+    // given
+    var (encrypted, key, nonce) = try ChaCha20Poly1305.encrypt(data: message.data(using: .utf8)!)
+    encrypted[0] ^= 0x01
+
+    // when
+    XCTAssertThrowsError(try ChaCha20Poly1305.decrypt(data: encrypted, key: key, nonce: nonce)) { error in
+      // then
+      XCTAssertEqual(error as? ChaCha20Poly1305.Error, .authenticationFailed)
+    }
+  }
+
+  func testEncrypt_aesIV__shouldThrowInvalidKeyOrNonce() throws {
+    // when
+    XCTAssertThrowsError(try ChaCha20Poly1305.encrypt(data: Data([1]), key: key, nonce: Data(count: 16))) { error in
+      // then
+      XCTAssertEqual(error as? ChaCha20Poly1305.Error, .invalidKeyOrNonce)
+    }
+  }
+}
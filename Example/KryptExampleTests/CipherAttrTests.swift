@@ -0,0 +1,109 @@
+//
+//  CipherAttrTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class CipherAttrTests: XCTestCase {
+  // Decrypted `ehr-gcm-contract-cipher-key-base64`, JSONEncoder escapes the slash
+  let contractJSON = #"{"base64EncodedKey":"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=","base64EncodedIV":"DGgfmKl7kNGzMlW5Li\/Ilw=="}"#
+  let expectedKey = Data(hex: "86171604848b23a12fd4066c7b8b2aafb238c602429b6a8fab02469eaa83e9c9")
+  let expectedIV = Data(hex: "0c681f98a97b90d1b33255b92e2fc897")
+
+  func testInitJSON_contract__shouldParseKeyAndIV() {
+    // given
+    let json = contractJSON.data(using: .utf8)!
+
+    // when
+    let cipherAttr = CipherAttr(json: json)
+
+    // then
+    XCTAssertEqual(cipherAttr?.key, expectedKey)
+    XCTAssertEqual(cipherAttr?.iv, expectedIV)
+  }
+
+  func testInitJSON_reorderedWithWhitespace__shouldParseKeyAndIV() {
+    // given
+    let json = """
+    {
+      "base64EncodedIV" : "DGgfmKl7kNGzMlW5Li/Ilw==",
+      "base64EncodedKey" : "hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck="
+    }
+    """.data(using: .utf8)!
+
+    // when
+    let cipherAttr = CipherAttr(json: json)
+
+    // then
+    XCTAssertEqual(cipherAttr?.key, expectedKey)
+    XCTAssertEqual(cipherAttr?.iv, expectedIV)
+  }
+
+  func testInitJSON_additionalMember__shouldFallBackToJSONDecoder() {
+    // given
+    let json = #"{"base64EncodedKey":"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=","base64EncodedIV":"DGgfmKl7kNGzMlW5Li\/Ilw==","version":1}"#.data(using: .utf8)!
+
+    // when
+    let cipherAttr = CipherAttr(json: json)
+
+    // then
+    XCTAssertEqual(cipherAttr?.key, expectedKey)
+    XCTAssertEqual(cipherAttr?.iv, expectedIV)
+  }
+
+  func testInitJSON_encodedByJSONEncoder__shouldMatch() throws {
+    // given
+    let key = Data((0 ..< 32).map { _ in UInt8.random(in: 0 ... 255) })
+    let iv = Data((0 ..< 16).map { _ in UInt8.random(in: 0 ... 255) })
+    let json = try JSONEncoder().encode(CipherAttr(key: key, iv: iv))
+
+    // when
+    let cipherAttr = CipherAttr(json: json)
+
+    // then
+    XCTAssertEqual(cipherAttr?.key, key)
+    XCTAssertEqual(cipherAttr?.iv, iv)
+  }
+
+  func testInitJSON_invalid__shouldReturnNil() {
+    // given
+    let invalidJSONs = [
+      "",
+      "{}",
+      #"{"base64EncodedKey":"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck="}"#,
+      #"{"base64EncodedKey":"not base64","base64EncodedIV":"DGgfmKl7kNGzMlW5Li\/Ilw=="}"#,
+      #"{"base64EncodedKey":"hhcWBISLI6Ev1AZse4sqr7I4xgJCm2qPqwJGnqqD6ck=","base64EncodedIV":"DGgfmKl7kNGzMlW5Li\/Ilw=="#,
+    ]
+
+    for json in invalidJSONs {
+      // when
+      let cipherAttr = CipherAttr(json: json.data(using: .utf8)!)
+
+      // then
+      XCTAssertNil(cipherAttr, json)
+    }
+  }
+
+  func testPerformanceInitJSON() {
+    let json = contractJSON.data(using: .utf8)!
+    measure {
+      for _ in 0 ..< 10000 {
+        _ = CipherAttr(json: json)
+      }
+    }
+  }
+
+  func testPerformanceJSONDecoder() {
+    let json = contractJSON.data(using: .utf8)!
+    measure {
+      for _ in 0 ..< 10000 {
+        _ = try? JSONDecoder().decode(CipherAttr.self, from: json)
+      }
+    }
+  }
+}
@@ -0,0 +1,135 @@
+//
+//  ECIESTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class ECIESTests: XCTestCase {
+  let slogan = "A Healthier Life is a Happier Life"
+  let rsaPublicKey = try! Key(pem: TestData.openSSLPublicKeyPEM.data, access: .public)
+  let rsaPrivateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+  lazy var privateKey = ECIESTests.generatePrivateKey()
+  lazy var publicKey = try! Key(key: SecKeyCopyPublicKey(privateKey.secRef)!)
+
+  func testEncryptDecrypt_gcmECIES__shouldDoWholeLoop() throws {
+    // given
+    let message = UUID().uuidString
+
+    // when
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey, version: .gcmECIES)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey)
+
+    // then
+    XCTAssertEqual(encrypted.version, .gcmECIES)
+    XCTAssertEqual(Data(base64Encoded: encrypted.cipherKey)?.count, 65)
+    XCTAssertEqual(Data(base64Encoded: encrypted.cipherKey)?.first, 0x04)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+  }
+
+  func testEncrypt_gcmECIES__shouldUseFreshEphemeralKey() throws {
+    // given
+    let messageData = slogan.data(using: .utf8)!
+
+    // when
+    let first = try EHREncryption.encrypt(data: messageData, with: publicKey, version: .gcmECIES)
+    let second = try EHREncryption.encrypt(data: messageData, with: publicKey, version: .gcmECIES)
+
+    // then
+    XCTAssertNotEqual(first.cipherKey, second.cipherKey)
+    XCTAssertNotEqual(first.data, second.data)
+  }
+
+  func testDecrypt_gcmECIES_serialized__shouldRestoreVersion() throws {
+    // given
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .gcmECIES)
+
+    // when
+    let restored = try EHREncryption.EncryptedData(serializedData: try encrypted.serializedData())
+    let decrypted = try EHREncryption.decrypt(encryptedData: restored, with: privateKey)
+
+    // then
+    XCTAssertEqual(restored.version, .gcmECIES)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), slogan)
+  }
+
+  func testDecrypt_gcmECIES_otherKey__shouldThrowPublicError() throws {
+    // given
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .gcmECIES)
+
+    // when
+    XCTAssertThrowsError(try EHREncryption.decrypt(encryptedData: encrypted, with: ECIESTests.generatePrivateKey())) { error in
+      // then
+      XCTAssertEqual(error as? PublicError, PublicError.decryptionFailed)
+    }
+  }
+
+  func testDecrypt_gcmECIES_tamperedEphemeralKey__shouldThrowPublicError() throws {
+    // given
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .gcmECIES)
+    var ephemeralPublicKey = Data(base64Encoded: encrypted.cipherKey)!
+    ephemeralPublicKey[10] ^= 0x01
+    let tampered = EHREncryption.EncryptedData(cipherKey: ephemeralPublicKey.base64EncodedString(), data: encrypted.data, version: .gcmECIES)
+
+    // when
+    XCTAssertThrowsError(try EHREncryption.decrypt(encryptedData: tampered, with: privateKey)) { error in
+      // then
+      XCTAssertEqual(error as? PublicError, PublicError.decryptionFailed)
+    }
+  }
+
+  func testEncrypt_gcmECIES_rsaKey__shouldThrowPublicError() throws {
+    // when
+    XCTAssertThrowsError(try EHREncryption.encrypt(data: Data([1]), with: rsaPublicKey, version: .gcmECIES)) { error in
+      // then
+      XCTAssertEqual(error as? PublicError, PublicError.encryptionFailed)
+    }
+  }
+
+  func testDecryptBatch_gcmECIES__shouldDecryptAll() throws {
+    // given
+    let messages = (0 ..< 8).map { "\($0) \(slogan)" }
+    let batch = try messages.map { try EHREncryption.encrypt(data: $0.data(using: .utf8)!, with: publicKey, version: .gcmECIES) }
+
+    // when
+    let results = EHREncryption.decrypt(batch: batch, with: privateKey)
+
+    // then
+    XCTAssertEqual(try results.map { String(data: try $0.get(), encoding: .utf8) }, messages)
+  }
+
+  func testPerformanceEncryptDecrypt_gcmECIES() throws {
+    let data = Data(count: 1024)
+    measure {
+      for _ in 0 ..< 20 {
+        let encrypted = try! EHREncryption.encrypt(data: data, with: publicKey, version: .gcmECIES)
+        _ = try? EHREncryption.decrypt(encryptedData: encrypted, with: privateKey)
+      }
+    }
+  }
+
+  func testPerformanceEncryptDecrypt_gcmOAEP() throws {
+    let data = Data(count: 1024)
+    measure {
+      for _ in 0 ..< 20 {
+        let encrypted = try! EHREncryption.encrypt(data: data, with: rsaPublicKey, version: .gcmOAEP)
+        _ = try? EHREncryption.decrypt(encryptedData: encrypted, with: rsaPrivateKey)
+      }
+    }
+  }
+}
+
+private extension ECIESTests {
+  static func generatePrivateKey() -> Key {
+    let attributes: [String: Any] = [
+      kSecAttrKeyType as String: kSecAttrKeyTypeECSECPrimeRandom,
+      kSecAttrKeySizeInBits as String: 256
+    ]
+    let secKey = SecKeyCreateRandomKey(attributes as CFDictionary, nil)!
+    return try! Key(key: secKey)
+  }
+}
@@ -83,6 +83,23 @@ final class EHREncryptionTests: XCTestCase {
     XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, message)
   }
 
+  func testDecrypt_gcmOAEP_12BytesIV__shouldDecrypt() throws {
+    // given
+    let message = UUID().uuidString
+    let messageData = message.data(using: .utf8)!
+    let iv = Data((0..<12).map { _ in UInt8.random(in: 0...255) })
+    let (encrypted, key, _) = try AES256.encrypt(data: messageData, iv: iv, blockMode: .gcm)
+    let cipherKeyData = try JSONEncoder().encode(CipherAttr(key: key, iv: iv))
+    let cipherKeyEncryptedBase64 = try RSA.encrypt(data: cipherKeyData, with: publicKey, padding: .oaep).base64EncodedString()
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: cipherKeyEncryptedBase64, data: encrypted, version: .gcmOAEP)
+
+    // when
+    let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey)
+
+    // then
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, message)
+  }
+
   func testDecrypt_cbcPKCS1__shouldDecrypt() throws {
     // given
     let message = UUID().uuidString
@@ -188,4 +205,442 @@ final class EHREncryptionTests: XCTestCase {
     // then
     XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, slogan)
   }
+
+  func testEncryptDecryptFile__shouldDoWholeLoop() throws {
+    // given
+    let message = UUID().uuidString
+    let input = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    let encryptedURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    let decryptedURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    defer {
+      [input, encryptedURL, decryptedURL].forEach { try? FileManager.default.removeItem(at: $0) }
+    }
+    try message.data(using: .utf8)!.write(to: input)
+
+    // when
+    let encryptedFile = try EHREncryption.encrypt(file: input, to: encryptedURL, with: publicKey)
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: encryptedFile.cipherKey, data: try Data(contentsOf: encryptedURL), version: encryptedFile.version)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey)
+    try EHREncryption.decrypt(encryptedFile: encryptedFile, to: decryptedURL, with: privateKey)
+
+    // then
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+    XCTAssertEqual(String(data: try Data(contentsOf: decryptedURL), encoding: .utf8), message)
+  }
+
+  func testEncryptDecrypt_gcmOAEPCompact__shouldDoWholeLoop() throws {
+    // given
+    let message = UUID().uuidString
+    let messageData = message.data(using: .utf8)!
+
+    // when
+    let encrypted = try EHREncryption.encrypt(data: messageData, with: publicKey, version: .gcmOAEPCompact)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey)
+
+    // then
+    XCTAssertEqual(encrypted.version, EHREncryption.Version.gcmOAEPCompact)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+  }
+
+  func testEncrypt_gcmOAEPCompact__shouldWrapRawKeyAndIV() throws {
+    // given
+    let messageData = UUID().uuidString.data(using: .utf8)!
+
+    // when
+    let encrypted = try EHREncryption.encrypt(data: messageData, with: publicKey, version: .gcmOAEPCompact)
+    let decryptedCipherKey = try RSA.decrypt(data: Data(base64Encoded: encrypted.cipherKey)!, with: privateKey, padding: .oaep)
+    let decryptedData = try AES256.decrypt(data: encrypted.data, key: decryptedCipherKey.prefix(32), iv: decryptedCipherKey.suffix(16), blockMode: .gcm)
+
+    // then
+    XCTAssertEqual(decryptedCipherKey.count, 48)
+    XCTAssertEqual(decryptedData, messageData)
+  }
+
+  func testEncrypt_cbcPKCS1__shouldThrowPublicError() throws {
+    // given
+    let messageData = UUID().uuidString.data(using: .utf8)!
+
+    // when
+    XCTAssertThrowsError(try EHREncryption.encrypt(data: messageData, with: publicKey, version: .cbcPKCS1)) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.encryptionFailed)
+    }
+  }
+
+  func testSerializedData__shouldDecryptAfterDeserialization() throws {
+    // given
+    let message = UUID().uuidString
+    let messageData = message.data(using: .utf8)!
+
+    for version in [EHREncryption.Version.gcmOAEP, .gcmOAEPCompact] {
+      let encrypted = try EHREncryption.encrypt(data: messageData, with: publicKey, version: version)
+
+      // when
+      let deserialized = try EHREncryption.EncryptedData(serializedData: try encrypted.serializedData())
+      let decrypted = try EHREncryption.decrypt(encryptedData: deserialized, with: privateKey)
+
+      // then
+      XCTAssertEqual(deserialized.version, version)
+      XCTAssertEqual(deserialized.cipherKey, encrypted.cipherKey)
+      XCTAssertEqual(deserialized.data, encrypted.data)
+      XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+    }
+  }
+
+  func testSerializedData_contract_cbcPKCS1__shouldKeepBase64CipherKey() throws {
+    // given
+    let encryptedContractData = TestData.ehrContractCBCMessage.base64Decoded
+    let contractCipherKey = String(data: TestData.ehrContractCBCCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: contractCipherKey, data: encryptedContractData, version: .cbcPKCS1)
+
+    // when
+    let serialized = try encryptedData.serializedData()
+    let deserialized = try EHREncryption.EncryptedData(serializedData: serialized)
+    let decrypted = try EHREncryption.decrypt(encryptedData: deserialized, with: privateKey)
+
+    // then
+    XCTAssertEqual(serialized.count, 1 + 2 + Data(base64Encoded: contractCipherKey)!.count + 4 + encryptedContractData.count)
+    XCTAssertEqual(deserialized.cipherKey, contractCipherKey)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, slogan)
+  }
+
+  func testSerializedData_invalidBlob__shouldThrowPublicError() throws {
+    // given
+    let messageData = UUID().uuidString.data(using: .utf8)!
+    let serialized = try EHREncryption.encrypt(data: messageData, with: publicKey, version: .gcmOAEPCompact).serializedData()
+    var unknownVersion = serialized
+    unknownVersion[0] = 0xFF
+
+    for invalid in [serialized.dropLast(), serialized + Data([0]), unknownVersion, Data()] {
+      // when
+      XCTAssertThrowsError(try EHREncryption.EncryptedData(serializedData: Data(invalid))) {
+        // then
+        XCTAssertEqual($0 as? PublicError, PublicError.decryptionFailed)
+      }
+    }
+  }
+
+  func testSerializedData_invalidBase64CipherKey__shouldThrowPublicError() throws {
+    // given
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: "not base64", data: Data(), version: .gcmOAEP)
+
+    // when
+    XCTAssertThrowsError(try encryptedData.serializedData()) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.encryptionFailed)
+    }
+  }
+
+  func testPerformanceDecrypt_gcmOAEP() throws {
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .gcmOAEP)
+    let serialized = try encrypted.serializedData()
+    measure {
+      for _ in 0 ..< 20 {
+        _ = try? EHREncryption.decrypt(encryptedData: try EHREncryption.EncryptedData(serializedData: serialized), with: privateKey)
+      }
+    }
+  }
+
+  func testPerformanceDecrypt_gcmOAEPCompact() throws {
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .gcmOAEPCompact)
+    let serialized = try encrypted.serializedData()
+    measure {
+      for _ in 0 ..< 20 {
+        _ = try? EHREncryption.decrypt(encryptedData: try EHREncryption.EncryptedData(serializedData: serialized), with: privateKey)
+      }
+    }
+  }
+
+  func testDecryptBatch__shouldKeepOrderAndReportFailuresPerItem() throws {
+    // given
+    let messages = (0 ..< 12).map { "\($0) \(UUID().uuidString)" }
+    var batch = try messages.map { try EHREncryption.encrypt(data: $0.data(using: .utf8)!, with: publicKey) }
+    batch[3] = EHREncryption.EncryptedData(cipherKey: "invalid", data: batch[3].data, version: .gcmOAEP)
+    batch[7] = EHREncryption.EncryptedData(cipherKey: batch[7].cipherKey, data: batch[8].data, version: .gcmOAEP)
+
+    // when
+    let results = EHREncryption.decrypt(batch: batch, with: privateKey)
+
+    // then
+    XCTAssertEqual(results.count, messages.count)
+    for (index, result) in results.enumerated() {
+      switch (index, result) {
+      case (3, .failure(let error)), (7, .failure(let error)):
+        XCTAssertEqual(error, PublicError.decryptionFailed)
+      case let (_, .success(decrypted)):
+        XCTAssertEqual(String(data: decrypted, encoding: .utf8), messages[index])
+      default:
+        XCTFail("unexpected result \(result) at \(index)")
+      }
+    }
+  }
+
+  func testDecryptBatch_contract__shouldDecryptBothVersions() throws {
+    // given
+    let gcmCipherKey = String(data: TestData.ehrContractGCMCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let cbcCipherKey = String(data: TestData.ehrContractCBCCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let batch = [
+      EHREncryption.EncryptedData(cipherKey: gcmCipherKey, data: TestData.ehrContractGCMMessage.base64Decoded, version: .gcmOAEP),
+      EHREncryption.EncryptedData(cipherKey: cbcCipherKey, data: TestData.ehrContractCBCMessage.base64Decoded, version: .cbcPKCS1),
+    ]
+
+    // when
+    let results = EHREncryption.decrypt(batch: batch, with: privateKey)
+
+    // then
+    XCTAssertEqual(try results.map { String(data: try $0.get(), encoding: .utf8)! }, [slogan, slogan])
+  }
+
+  func testDecryptBatch_empty__shouldReturnNoResults() {
+    // when
+    let results = EHREncryption.decrypt(batch: [], with: privateKey)
+
+    // then
+    XCTAssertTrue(results.isEmpty)
+  }
+
+  func testPerformanceDecryptBatch() throws {
+    let batch = try (0 ..< 64).map { _ in try EHREncryption.encrypt(data: Data(count: 4096), with: publicKey) }
+    measure {
+      _ = EHREncryption.decrypt(batch: batch, with: privateKey)
+    }
+  }
+
+  func testPerformanceDecryptSerial() throws {
+    let batch = try (0 ..< 64).map { _ in try EHREncryption.encrypt(data: Data(count: 4096), with: publicKey) }
+    measure {
+      _ = batch.map { try? EHREncryption.decrypt(encryptedData: $0, with: privateKey) }
+    }
+  }
+
+  func testEncryptMultiRecipient__shouldDecryptForEveryRecipient() throws {
+    // given
+    let message = UUID().uuidString
+    let publicKey2048 = try Key(pem: TestData.openSSLPublicKey2048PEM.data, access: .public, size: .bit_2048)
+    let privateKey2048 = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+
+    // when
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, for: [publicKey, publicKey2048])
+    let decrypted = try EHREncryption.decrypt(multiRecipientEncryptedData: encrypted, with: privateKey)
+    let decrypted2048 = try EHREncryption.decrypt(multiRecipientEncryptedData: encrypted, with: privateKey2048)
+
+    // then
+    XCTAssertEqual(encrypted.recipients.count, 2)
+    XCTAssertEqual(encrypted.recipients.map { $0.keyID }, [try publicKey.publicKeyDigest(), try publicKey2048.publicKeyDigest()].map { $0.map { String(format: "%02x", $0) }.joined() })
+    XCTAssertEqual(encrypted.data.count, message.utf8.count + 16)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+    XCTAssertEqual(String(data: decrypted2048, encoding: .utf8), message)
+  }
+
+  func testEncryptMultiRecipient_singleRecipientView__shouldDecryptWithEncryptedDataAPI() throws {
+    // given
+    let message = UUID().uuidString
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, for: [publicKey], version: .gcmOAEPCompact)
+
+    // when
+    let encryptedData = try XCTUnwrap(encrypted.encryptedData(for: encrypted.recipients[0].keyID))
+    let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey)
+
+    // then
+    XCTAssertEqual(encryptedData.version, .gcmOAEPCompact)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+    XCTAssertNil(encrypted.encryptedData(for: "unknown"))
+  }
+
+  func testDecryptMultiRecipient_notARecipient__shouldThrowPublicError() throws {
+    // given
+    let privateKey2048 = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+    let encrypted = try EHREncryption.encrypt(data: Data([1]), for: [publicKey])
+
+    // when
+    XCTAssertThrowsError(try EHREncryption.decrypt(multiRecipientEncryptedData: encrypted, with: privateKey2048)) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.decryptionFailed)
+    }
+  }
+
+  func testEncryptMultiRecipient_noRecipients__shouldThrowPublicError() throws {
+    // when
+    XCTAssertThrowsError(try EHREncryption.encrypt(data: Data([1]), for: [])) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.encryptionFailed)
+    }
+  }
+
+  func testRewrap__shouldKeepDataAndDecryptWithNewKey() throws {
+    // given
+    let message = UUID().uuidString
+    let publicKey2048 = try Key(pem: TestData.openSSLPublicKey2048PEM.data, access: .public, size: .bit_2048)
+    let privateKey2048 = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey)
+
+    // when
+    let rewrapped = try EHREncryption.rewrap(encryptedData: encrypted, with: privateKey, for: publicKey2048)
+    let decrypted = try EHREncryption.decrypt(encryptedData: rewrapped, with: privateKey2048)
+
+    // then
+    XCTAssertEqual(rewrapped.data, encrypted.data)
+    XCTAssertEqual(rewrapped.version, encrypted.version)
+    XCTAssertNotEqual(rewrapped.cipherKey, encrypted.cipherKey)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+    XCTAssertThrowsError(try EHREncryption.decrypt(encryptedData: rewrapped, with: privateKey))
+  }
+
+  func testRewrap_contractCBC__shouldKeepVersion() throws {
+    // given
+    let encryptedContractData = TestData.ehrContractCBCMessage.base64Decoded
+    let contractCipherKey = String(data: TestData.ehrContractCBCCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: contractCipherKey, data: encryptedContractData, version: .cbcPKCS1)
+
+    // when
+    let rewrapped = try EHREncryption.rewrap(encryptedData: encryptedData, with: privateKey, for: publicKey)
+    let decrypted = try EHREncryption.decrypt(encryptedData: rewrapped, with: privateKey)
+
+    // then
+    XCTAssertEqual(rewrapped.version, .cbcPKCS1)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, slogan)
+  }
+
+  func testRewrap_multipleKeys__shouldDecryptForEveryRecipient() throws {
+    // given
+    let message = UUID().uuidString
+    let publicKey2048 = try Key(pem: TestData.openSSLPublicKey2048PEM.data, access: .public, size: .bit_2048)
+    let privateKey2048 = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey)
+
+    // when
+    let shared = try EHREncryption.rewrap(encryptedData: encrypted, with: privateKey, for: [publicKey, publicKey2048])
+
+    // then
+    XCTAssertEqual(shared.data, encrypted.data)
+    XCTAssertEqual(String(data: try EHREncryption.decrypt(multiRecipientEncryptedData: shared, with: privateKey), encoding: .utf8), message)
+    XCTAssertEqual(String(data: try EHREncryption.decrypt(multiRecipientEncryptedData: shared, with: privateKey2048), encoding: .utf8), message)
+  }
+
+  func testRewrap_file__shouldNotTouchFile() throws {
+    // given
+    let message = UUID().uuidString
+    let input = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    let encryptedURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    let decryptedURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    defer {
+      [input, encryptedURL, decryptedURL].forEach { try? FileManager.default.removeItem(at: $0) }
+    }
+    try message.data(using: .utf8)!.write(to: input)
+    let encryptedFile = try EHREncryption.encrypt(file: input, to: encryptedURL, with: publicKey)
+    let encryptedContent = try Data(contentsOf: encryptedURL)
+    let privateKey2048 = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+    let publicKey2048 = try Key(pem: TestData.openSSLPublicKey2048PEM.data, access: .public, size: .bit_2048)
+
+    // when
+    let rewrapped = try EHREncryption.rewrap(encryptedFile: encryptedFile, with: privateKey, for: publicKey2048)
+    try EHREncryption.decrypt(encryptedFile: rewrapped, to: decryptedURL, with: privateKey2048)
+
+    // then
+    XCTAssertEqual(rewrapped.url, encryptedURL)
+    XCTAssertEqual(try Data(contentsOf: encryptedURL), encryptedContent)
+    XCTAssertEqual(String(data: try Data(contentsOf: decryptedURL), encoding: .utf8), message)
+  }
+
+  func testRewrap_stream__shouldDeliverResultsInOrder() throws {
+    // given
+    let messages = (0 ..< 7).map { "\($0)" }
+    var records = try messages.map { try EHREncryption.encrypt(data: $0.data(using: .utf8)!, with: publicKey, version: .gcmOAEPCompact) }
+    records[4] = EHREncryption.EncryptedData(cipherKey: "invalid", data: records[4].data, version: .gcmOAEPCompact)
+    var delivered = [(EHREncryption.EncryptedData, Result<EHREncryption.EncryptedData, PublicError>)]()
+
+    // when
+    EHREncryption.rewrap(records, with: privateKey, for: publicKey, chunkSize: 3) { record, result in
+      delivered.append((record, result))
+    }
+
+    // then
+    XCTAssertEqual(delivered.map { $0.0.data }, records.map { $0.data })
+    for (index, (_, result)) in delivered.enumerated() {
+      if index == 4 {
+        XCTAssertThrowsError(try result.get())
+      } else {
+        let decrypted = try EHREncryption.decrypt(encryptedData: try result.get(), with: privateKey)
+        XCTAssertEqual(String(data: decrypted, encoding: .utf8), messages[index])
+      }
+    }
+  }
+
+  func testRewrap_streamHandlerThrows__shouldStop() throws {
+    // given
+    let records = try (0 ..< 5).map { _ in try EHREncryption.encrypt(data: Data([1]), with: publicKey) }
+    var handled = 0
+
+    // when
+    XCTAssertThrowsError(
+      try EHREncryption.rewrap(records, with: privateKey, for: publicKey, chunkSize: 2) { _, _ in
+        handled += 1
+        throw PublicError.encryptionFailed
+      }
+    )
+
+    // then
+    XCTAssertEqual(handled, 1)
+  }
+
+  func testEncryptDecrypt_chachaPolyOAEP__shouldDoWholeLoop() throws {
+    // given
+    let message = UUID().uuidString
+
+    // when
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey, version: .chachaPolyOAEP)
+    let restored = try EHREncryption.EncryptedData(serializedData: try encrypted.serializedData())
+    let decrypted = try EHREncryption.decrypt(encryptedData: restored, with: privateKey)
+
+    // then
+    XCTAssertEqual(restored.version, .chachaPolyOAEP)
+    XCTAssertEqual(try RSA.decrypt(data: Data(base64Encoded: encrypted.cipherKey)!, with: privateKey, padding: .oaep).count, 44)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+  }
+
+  func testDecrypt_chachaPolyOAEP_cache__shouldDecryptFromCache() throws {
+    // given
+    let cache = try UnwrappedKeyCache(capacity: 4, timeToLive: 60)
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: .chachaPolyOAEP)
+
+    // when
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(cache.statistics.hits, 1)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), slogan)
+  }
+
+  func testDecryptBatch_mixedAEADVersions__shouldDecryptAll() throws {
+    // given
+    let versions: [EHREncryption.Version] = [.gcmOAEP, .chachaPolyOAEP, .gcmOAEPCompact, .chachaPolyOAEP]
+    let batch = try versions.map { try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, version: $0) }
+
+    // when
+    let results = EHREncryption.decrypt(batch: batch, with: privateKey)
+
+    // then
+    XCTAssertEqual(try results.map { String(data: try $0.get(), encoding: .utf8) }, Array(repeating: slogan, count: versions.count))
+  }
+
+  func testEncrypt_fastestAEADPolicy__shouldUseBenchmarkedVersion() throws {
+    // when
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, policy: .fastestAEAD)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey)
+
+    // then
+    XCTAssertEqual(encrypted.version, EHREncryption.aeadBenchmark.fastestVersion)
+    XCTAssertTrue(EHREncryption.aeadBenchmark.gcmOAEP.isFinite)
+    XCTAssertTrue(EHREncryption.aeadBenchmark.chachaPolyOAEP.isFinite)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), slogan)
+  }
+
+  func testEncrypt_fixedPolicy__shouldUseGivenVersion() throws {
+    // when
+    let encrypted = try EHREncryption.encrypt(data: slogan.data(using: .utf8)!, with: publicKey, policy: .fixed(.gcmOAEPCompact))
+
+    // then
+    XCTAssertEqual(encrypted.version, .gcmOAEPCompact)
+  }
 }
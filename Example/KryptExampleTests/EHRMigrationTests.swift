@@ -0,0 +1,112 @@
+//
+//  EHRMigrationTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class EHRMigrationTests: XCTestCase {
+  let publicKey = try! Key(pem: TestData.openSSLPublicKeyPEM.data, access: .public)
+  let privateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+
+  func testMigrate__shouldReencryptLegacyRecordsAsGCMOAEP() throws {
+    // given
+    let messages = (0 ..< 10).map { "message \($0)" }
+    var records = try messages.enumerated().map { EHRMigration.Record(id: "\($0.offset)", encryptedData: try legacyRecord($0.element)) }
+    records[2] = EHRMigration.Record(id: "2", encryptedData: try EHREncryption.encrypt(data: messages[2].data(using: .utf8)!, with: publicKey))
+    records[5] = EHRMigration.Record(id: "5", encryptedData: EHREncryption.EncryptedData(cipherKey: "invalid", data: Data(), version: .cbcPKCS1))
+    let migration = EHRMigration(privateKey: privateKey, publicKey: publicKey, configuration: EHRMigration.Configuration(maxRecordsInFlight: 3))
+    var handled = [(String, Result<EHREncryption.EncryptedData, PublicError>)]()
+    var progressReports = 0
+
+    // when
+    let progress = try migration.migrate(records, progress: { _ in progressReports += 1 }) { record, result in
+      handled.append((record.id, result))
+    }
+
+    // then
+    XCTAssertEqual(handled.map { $0.0 }, ["0", "1", "3", "4", "5", "6", "7", "8", "9"])
+    for (id, result) in handled where id != "5" {
+      let migrated = try result.get()
+      XCTAssertEqual(migrated.version, .gcmOAEP)
+      XCTAssertEqual(String(data: try EHREncryption.decrypt(encryptedData: migrated, with: privateKey), encoding: .utf8), messages[Int(id)!])
+    }
+    XCTAssertThrowsError(try handled[4].1.get())
+    XCTAssertEqual(progress.position, 10)
+    XCTAssertEqual(progress.migrated, 8)
+    XCTAssertEqual(progress.skipped, 1)
+    XCTAssertEqual(progress.failed, 1)
+    XCTAssertEqual(progressReports, 4)
+  }
+
+  func testMigrate_interrupted__shouldResumeFromCheckpoint() throws {
+    // given
+    let checkpointURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    defer { try? FileManager.default.removeItem(at: checkpointURL) }
+    let records = try (0 ..< 6).map { EHRMigration.Record(id: "\($0)", encryptedData: try legacyRecord("\($0)")) }
+    let configuration = EHRMigration.Configuration(maxRecordsInFlight: 2, checkpointURL: checkpointURL, checkpointInterval: 1)
+    var handledIDs = [String]()
+    _ = try? EHRMigration(privateKey: privateKey, publicKey: publicKey, configuration: configuration).migrate(records) { record, _ in
+      guard record.id != "3" else {
+        throw PublicError.encryptionFailed
+      }
+      handledIDs.append(record.id)
+    }
+
+    // when
+    let progress = try EHRMigration(privateKey: privateKey, publicKey: publicKey, configuration: configuration).migrate(records) { record, _ in
+      handledIDs.append(record.id)
+    }
+
+    // then
+    XCTAssertEqual(handledIDs, ["0", "1", "2", "3", "4", "5"])
+    XCTAssertEqual(progress.position, 6)
+    XCTAssertEqual(progress.migrated, 3)
+  }
+
+  func testMigrate_otherRecords__shouldThrowCheckpointMismatch() throws {
+    // given
+    let checkpointURL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    defer { try? FileManager.default.removeItem(at: checkpointURL) }
+    let records = try (0 ..< 2).map { EHRMigration.Record(id: "\($0)", encryptedData: try legacyRecord("\($0)")) }
+    let configuration = EHRMigration.Configuration(checkpointURL: checkpointURL)
+    try EHRMigration(privateKey: privateKey, publicKey: publicKey, configuration: configuration).migrate(records) { _, _ in }
+
+    // when
+    XCTAssertThrowsError(try EHRMigration(privateKey: privateKey, publicKey: publicKey, configuration: configuration).migrate(records.reversed()) { _, _ in }) {
+      // then
+      XCTAssertEqual($0 as? EHRMigration.Error, .checkpointMismatch)
+    }
+  }
+
+  func testInitPEM__shouldMigrateContractRecord() throws {
+    // given
+    let encryptedContractData = TestData.ehrContractCBCMessage.base64Decoded
+    let contractCipherKey = String(data: TestData.ehrContractCBCCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let record = EHRMigration.Record(id: "contract", encryptedData: EHREncryption.EncryptedData(cipherKey: contractCipherKey, data: encryptedContractData, version: .cbcPKCS1))
+    let migration = try EHRMigration(privateKeyPEM: TestData.openSSLPrivateKeyPEM.data, publicKeyPEM: TestData.openSSLPublicKeyPEM.data)
+    var migrated: EHREncryption.EncryptedData?
+
+    // when
+    try migration.migrate([record]) { _, result in
+      migrated = try result.get()
+    }
+
+    // then
+    let decrypted = try EHREncryption.decrypt(encryptedData: try XCTUnwrap(migrated), with: privateKey)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), "A Healthier Life is a Happier Life")
+  }
+}
+
+private extension EHRMigrationTests {
+  func legacyRecord(_ message: String) throws -> EHREncryption.EncryptedData {
+    let (encrypted, key, iv) = try AES256.encrypt(data: message.data(using: .utf8)!, blockMode: .cbc)
+    let cipherKeyData = try JSONEncoder().encode(CipherAttr(key: key, iv: iv))
+    let cipherKey = try RSA.encrypt(data: cipherKeyData, with: publicKey, padding: .pkcs1).base64EncodedString()
+    return EHREncryption.EncryptedData(cipherKey: cipherKey, data: encrypted, version: .cbcPKCS1)
+  }
+}
@@ -107,6 +107,26 @@ final class KeyTests: XCTestCase {
     XCTAssertNoThrow(try Key(pem: pem, type: .ecSECPrimeRandom, access: .public, size: .bit_256))
   }
 
+  func testInit_pemString_privateKeyECSECPrime256R1SEC1__shouldInitialize() throws {
+    // given
+    let pem = TestData.openSSLPrivateKeyECPRIME256R1SEC1PEM.string
+
+    // then
+    XCTAssertNoThrow(try Key(pem: pem, type: .ecSECPrimeRandom, access: .private, size: .bit_256))
+  }
+
+  func testConvertedToPEM_privateKeyECSECPrime256R1__shouldMatchSEC1PEM() throws {
+    // given
+    let pem = TestData.openSSLPrivateKeyECPRIME256R1SEC1PEM.string
+    let key = try Key(pem: pem, type: .ecSECPrimeRandom, access: .private, size: .bit_256)
+
+    // when
+    let converted = try key.convertedToPEM()
+
+    // then
+    XCTAssertEqual(converted, pem)
+  }
+
   func testDerivePublicKeyFromPrivateKey_usingPrivateKey_shouldReturnCorrectPublicKey() {
     // given
     let pem = TestData.openSSLPrivateKeyPEM.data
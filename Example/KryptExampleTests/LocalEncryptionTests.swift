@@ -0,0 +1,106 @@
+//
+//  LocalEncryptionTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class LocalEncryptionTests: XCTestCase {
+  let publicKey = try! Key(pem: TestData.openSSLPublicKeyPEM.data, access: .public)
+  let privateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+
+  func testEncryptDecrypt_masterKey__shouldDoWholeLoop() throws {
+    // given
+    let message = UUID().uuidString
+    let masterKey = LocalEncryption.MasterKey.generate()
+
+    // when
+    let encrypted = try LocalEncryption.encrypt(data: message.data(using: .utf8)!, with: masterKey)
+    let decrypted = try LocalEncryption.decrypt(encryptedData: encrypted, with: masterKey)
+
+    // then
+    XCTAssertEqual(encrypted.version, .gcmHKDF)
+    XCTAssertEqual(Data(base64Encoded: encrypted.cipherKey)?.count, 32)
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8), message)
+  }
+
+  func testEncrypt_masterKey__shouldUseFreshSaltPerItem() throws {
+    // given
+    let messageData = UUID().uuidString.data(using: .utf8)!
+    let masterKey = LocalEncryption.MasterKey.generate()
+
+    // when
+    let first = try LocalEncryption.encrypt(data: messageData, with: masterKey)
+    let second = try LocalEncryption.encrypt(data: messageData, with: masterKey)
+
+    // then
+    XCTAssertNotEqual(first.cipherKey, second.cipherKey)
+    XCTAssertNotEqual(first.data, second.data)
+  }
+
+  func testCipherAttr__shouldMatchHKDFSHA256() throws {
+    // given
+    let masterKey = try LocalEncryption.MasterKey(data: Data((0 ..< 32).map { UInt8($0) }))
+    let salt = Data((32 ..< 64).map { UInt8($0) })
+
+    // when
+    let cipherAttr = try masterKey.cipherAttr(salt: salt)
+
+    // then
+    XCTAssertEqual(cipherAttr.key, Data(hex: "4f0b9df6e1a6bfd6996038e859e2593773396871a4a4292473e87930b56616fa"))
+    XCTAssertEqual(cipherAttr.iv, Data(hex: "71cdf984a320d728434fb65465803952"))
+  }
+
+  func testDecrypt_otherMasterKey__shouldThrowPublicError() throws {
+    // given
+    let encrypted = try LocalEncryption.encrypt(data: Data([1]), with: LocalEncryption.MasterKey.generate())
+
+    // when
+    XCTAssertThrowsError(try LocalEncryption.decrypt(encryptedData: encrypted, with: LocalEncryption.MasterKey.generate())) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.decryptionFailed)
+    }
+  }
+
+  func testDecrypt_masterKeyRecordWithRSAKey__shouldThrowPublicError() throws {
+    // given
+    let encrypted = try LocalEncryption.encrypt(data: Data([1]), with: LocalEncryption.MasterKey.generate())
+
+    // when
+    XCTAssertThrowsError(try LocalEncryption.decrypt(encryptedData: encrypted, with: privateKey)) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.decryptionFailed)
+    }
+  }
+
+  func testMasterKey_wrapped__shouldUnwrapSameKey() throws {
+    // given
+    let masterKey = LocalEncryption.MasterKey.generate()
+    let encrypted = try LocalEncryption.encrypt(data: Data([1, 2, 3]), with: masterKey)
+
+    // when
+    let wrapped = try masterKey.wrapped(with: publicKey)
+    let unwrapped = try LocalEncryption.MasterKey(wrapped: wrapped, with: privateKey)
+
+    // then
+    XCTAssertEqual(try LocalEncryption.decrypt(encryptedData: encrypted, with: unwrapped), Data([1, 2, 3]))
+  }
+
+  func testMasterKey_invalidLength__shouldThrow() {
+    XCTAssertThrowsError(try LocalEncryption.MasterKey(data: Data(count: 16)))
+  }
+
+  func testPerformanceEncrypt_masterKey() {
+    let masterKey = LocalEncryption.MasterKey.generate()
+    let data = Data(count: 1024)
+    measure {
+      for _ in 0 ..< 100 {
+        _ = try? LocalEncryption.encrypt(data: data, with: masterKey)
+      }
+    }
+  }
+}
@@ -131,4 +131,41 @@ final class PEMConverterTests: XCTestCase {
     // then
     XCTAssertEqual(pem, expectedPEM)
   }
+
+  func testConvertDERToPEM_whenDERIsECPrivateKeyFromSecKey__shouldCreateSEC1PEM() {
+    // given
+    let format = PEMFormat(contentType: .ec, standard: .pkcs1, keyAccess: .private)
+    let expectedPEM = TestData.openSSLPrivateKeyECPRIME256R1SEC1PEM.string
+
+    // when
+    let pem = try? PEMConverter.convertDER(ecPrivateKeyX963, toPEMFormat: format)
+
+    // then
+    XCTAssertEqual(pem, expectedPEM)
+  }
+
+  func testConvertECPrivateKeyPEMToX963_sec1PEM__shouldGiveSecKeyRepresentation() {
+    // given
+    let pem = TestData.openSSLPrivateKeyECPRIME256R1SEC1PEM.string
+
+    // when
+    let der = PEMConverter.convertECPrivateKeyPEMToX963(pem)
+
+    // then
+    XCTAssertEqual(der, ecPrivateKeyX963)
+  }
+
+  func testConvertDERToPEM_whenECPrivateKeyHasWrongLength__shouldThrow() {
+    // given
+    let format = PEMFormat(contentType: .ec, standard: .pkcs1, keyAccess: .private)
+
+    // then
+    XCTAssertThrowsError(try PEMConverter.convertDER(ecPrivateKeyX963.dropLast(), toPEMFormat: format))
+  }
+
+  /// 04 || X || Y || D of `openssl-private-key-ec-prime256r1-sec1-pem`, the form of `SecKeyCopyExternalRepresentation`
+  private var ecPrivateKeyX963: Data {
+    let base64 = "BMbYE1PMd4BBbmhN+Pm0hjKxtQjf4ZSgApDc4OZ44djh82ySlohGHfusbhPAyrrNvPR1QSZoNm7tJwdBYwaBou/mPnRzMuRohhfdawj8l1RPXf7PkJikdLagFeYiS9kUPQ=="
+    return Data(base64Encoded: base64)!
+  }
 }
@@ -194,6 +194,32 @@ final class PKCS8Tests: XCTestCase {
     // then
     XCTAssertEqual(decrypted, expectedDecryptedPEM)
   }
+
+  func testDecryptDER_encryptedExample_whenPasswordIsCorrect__shouldMatchDecodedPEM() {
+    // given
+    let encryptedPEMData = TestData.openSSLPrivateKeyEncryptedPKCS8PEM.data
+    let password = "password"
+    let expectedDER = TestData.openSSLPrivateKeyPEM.string.der
+
+    // when
+    let decryptedDER = PKCS8.decryptDER(encryptedPEMData, password: password)
+
+    // then
+    XCTAssertEqual(decryptedDER, expectedDER)
+  }
+
+  func testEncryptDER_simplePassword__shouldContainRightEncryptionParameters() {
+    // given
+    let pkcs1PEMData = TestData.openSSLPrivateKeyPEM.data
+    let password = "password"
+
+    // when
+    let der = PKCS8.encryptDER(pkcs1PEMData, password: password)
+
+    // then
+    XCTAssertEqual(der?.keyDerivationFunctionBytes, PKCS8.encrypt(pkcs1PEMData, password: password)?.der.keyDerivationFunctionBytes)
+    XCTAssertEqual(der?.symmetricEncryptionAlgorithmBytes, PKCS8.encrypt(pkcs1PEMData, password: password)?.der.symmetricEncryptionAlgorithmBytes)
+  }
 }
 
 private extension String {
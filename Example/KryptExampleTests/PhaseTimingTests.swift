@@ -0,0 +1,48 @@
+//
+//  PhaseTimingTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class PhaseTimingTests: XCTestCase {
+  override func tearDown() {
+    PhaseTiming.isEnabled = false
+    PhaseTiming.reset()
+    super.tearDown()
+  }
+
+  func testStatistics_enabled__shouldRecordPhasesOfCSR() throws {
+    // given
+    let privateKey = try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+    PhaseTiming.isEnabled = true
+    PhaseTiming.reset()
+
+    // when
+    let der = try CSR.createDER(with: privateKey, attributes: .withCorrectAttributes)
+
+    // then
+    for phase in ["csr_subject", "csr_key", "csr_sign", "csr_encode"] {
+      XCTAssertEqual(PhaseTiming.statistics(for: phase)?.count, 1, phase)
+    }
+    XCTAssertGreaterThan(PhaseTiming.statistics(for: "csr_sign")?.totalTime ?? 0, 0)
+    XCTAssertEqual(PhaseTiming.statistics(for: "csr_encode")?.bytes, UInt64(der.count))
+  }
+
+  func testStatistics_disabled__shouldRecordNothing() throws {
+    // given
+    let privateKey = try Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+    PhaseTiming.isEnabled = false
+    PhaseTiming.reset()
+
+    // when
+    _ = try CSR.createDER(with: privateKey, attributes: .withCorrectAttributes)
+
+    // then
+    XCTAssertTrue(PhaseTiming.statistics.allSatisfy { $0.count == 0 })
+  }
+}
@@ -0,0 +1,110 @@
+//
+//  RSAExecutorTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class RSAExecutorTests: XCTestCase {
+  let publicKey = try! Key(pem: TestData.openSSLPublicKeyPEM.data, access: .public)
+  let privateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+
+  func testSubmit_work__shouldCompleteWithResult() throws {
+    // given
+    let executor = try RSAExecutor(threadCount: 2, queueCapacity: 4)
+    let completed = expectation(description: "completed")
+    var result: Result<Int, Error>?
+
+    // when
+    try executor.submit({ 6 * 7 }) {
+      result = $0
+      completed.fulfill()
+    }
+
+    // then
+    wait(for: [completed], timeout: 5)
+    XCTAssertEqual(try result?.get(), 42)
+  }
+
+  func testSubmit_fullQueue__shouldThrowQueueFull() throws {
+    // given
+    let executor = try RSAExecutor(threadCount: 1, queueCapacity: 1)
+    let started = DispatchSemaphore(value: 0)
+    let release = DispatchSemaphore(value: 0)
+    try executor.submit({ started.signal(); release.wait() }, completion: { _ in })
+    started.wait()
+    try executor.submit({}, completion: { _ in })
+
+    // when
+    XCTAssertThrowsError(try executor.submit({}, completion: { _ in })) { error in
+      // then
+      XCTAssertEqual(error as? RSAExecutor.Error, .queueFull)
+    }
+    XCTAssertEqual(executor.statistics.rejected, 1)
+    XCTAssertEqual(executor.statistics.queueDepth, 1)
+    release.signal()
+  }
+
+  func testStatistics_completedRequests__shouldCountAndRecordLatencies() throws {
+    // given
+    let executor = try RSAExecutor(threadCount: 2, queueCapacity: 16)
+    let group = DispatchGroup()
+
+    // when
+    for _ in 0 ..< 8 {
+      group.enter()
+      try executor.submit(timeout: -1, { usleep(1000) }, completion: { _ in group.leave() })
+    }
+    group.wait()
+
+    // then
+    let statistics = executor.statistics
+    XCTAssertEqual(statistics.threadCount, 2)
+    XCTAssertEqual(statistics.submitted, 8)
+    XCTAssertEqual(statistics.completed, 8)
+    XCTAssertEqual(statistics.serviceTime.count, 8)
+    XCTAssertGreaterThanOrEqual(statistics.serviceTime.percentile(50), 0.001)
+    XCTAssertGreaterThanOrEqual(statistics.serviceTime.max, statistics.serviceTime.mean)
+  }
+
+  func testDecrypt_ehrOnExecutor__shouldDecrypt() throws {
+    // given
+    let message = UUID().uuidString
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey)
+    let completed = expectation(description: "completed")
+    var decrypted: Data?
+
+    // when
+    try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, executor: .shared) {
+      decrypted = try? $0.get()
+      completed.fulfill()
+    }
+
+    // then
+    wait(for: [completed], timeout: 10)
+    XCTAssertEqual(decrypted.flatMap { String(data: $0, encoding: .utf8) }, message)
+  }
+
+  func testDecrypt_ehrOnExecutor__shouldDecryptContentOnQueue() throws {
+    // given
+    let encrypted = try EHREncryption.encrypt(data: Data(count: 1 << 20), with: publicKey)
+    let queue = DispatchQueue(label: "content")
+    let completed = expectation(description: "completed")
+    var decrypted: Data?
+
+    // when
+    try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, executor: .shared, queue: queue) {
+      dispatchPrecondition(condition: .onQueue(queue))
+      decrypted = try? $0.get()
+      completed.fulfill()
+    }
+
+    // then
+    wait(for: [completed], timeout: 10)
+    XCTAssertEqual(decrypted, Data(count: 1 << 20))
+  }
+}
@@ -40,4 +40,73 @@ final class RSATests: XCTestCase {
     // then
     XCTAssertEqual(decryptedMessage, message)
   }
+
+  func testPreparedKey_encryptDecrypt__shouldBeInterchangeableWithSecurity() throws {
+    // given
+    let messageData = UUID().uuidString.data(using: .utf8)!
+    let preparedPublicKey = try RSA.PreparedKey(key: publicKey)
+    let preparedPrivateKey = try RSA.PreparedKey(key: privateKey)
+
+    // when
+    let encryptedByEngine = try preparedPublicKey.encrypt(data: messageData, padding: .oaep)
+    let encryptedBySecurity = try RSA.encrypt(data: messageData, with: publicKey, padding: .pkcs1)
+
+    // then
+    XCTAssertEqual(preparedPublicKey.blockCount, 512)
+    XCTAssertEqual(try RSA.decrypt(data: encryptedByEngine, with: privateKey, padding: .oaep), messageData)
+    XCTAssertEqual(try preparedPrivateKey.decrypt(data: encryptedBySecurity, padding: .pkcs1), messageData)
+  }
+
+  func testPreparedKey_pem_contract__shouldDecryptCipherKey() throws {
+    // given
+    let preparedKey = try RSA.PreparedKey(pem: TestData.openSSLPrivateKeyPEM.string, access: .private)
+
+    // when
+    let cipherAttr = try preparedKey.decrypt(data: TestData.ehrContractGCMCipherKey.base64Decoded, padding: .oaep)
+
+    // then
+    XCTAssertTrue(String(data: cipherAttr, encoding: .utf8)!.contains("base64EncodedKey"))
+  }
+
+  func testPreparedKey_wrongPadding__shouldThrowOperationFailed() throws {
+    // given
+    let preparedKey = try RSA.PreparedKey(key: privateKey)
+    let encrypted = try RSA.encrypt(data: Data([1, 2, 3]), with: publicKey, padding: .oaep)
+
+    // when
+    XCTAssertThrowsError(try preparedKey.decrypt(data: encrypted, padding: .pkcs1)) { error in
+      // then
+      XCTAssertEqual(error as? RSA.PreparedKey.Error, .operationFailed)
+    }
+  }
+
+  func testPreparedKey_decryptWithPublicKey__shouldThrowInvalidKey() throws {
+    // given
+    let preparedKey = try RSA.PreparedKey(pem: TestData.openSSLPublicKeyPEM.string, access: .public)
+
+    // when
+    XCTAssertThrowsError(try preparedKey.decrypt(data: Data(count: 512), padding: .oaep)) { error in
+      // then
+      XCTAssertEqual(error as? RSA.PreparedKey.Error, .invalidKey)
+    }
+  }
+
+  func testPerformancePreparedKey_encrypt() throws {
+    let preparedKey = try RSA.PreparedKey(key: publicKey)
+    let payload = Data(count: 48)
+    measure {
+      for _ in 0 ..< 100 {
+        _ = try? preparedKey.encrypt(data: payload, padding: .oaep)
+      }
+    }
+  }
+
+  func testPerformanceSecurity_encrypt() throws {
+    let payload = Data(count: 48)
+    measure {
+      for _ in 0 ..< 100 {
+        _ = try? RSA.encrypt(data: payload, with: publicKey, padding: .oaep)
+      }
+    }
+  }
 }
@@ -0,0 +1,144 @@
+//
+//  UnwrappedKeyCacheTests.swift
+//  Krypt_Tests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 CocoaPods. All rights reserved.
+//
+
+@testable import Krypt
+import XCTest
+
+final class UnwrappedKeyCacheTests: XCTestCase {
+  let publicKey = try! Key(pem: TestData.openSSLPublicKeyPEM.data, access: .public)
+  let privateKey = try! Key(pem: TestData.openSSLPrivateKeyPEM.data, access: .private)
+
+  func testDecrypt_twice__shouldHitCacheOnSecondDecrypt() throws {
+    // given
+    let message = UUID().uuidString
+    let encrypted = try EHREncryption.encrypt(data: message.data(using: .utf8)!, with: publicKey)
+    let cache = try UnwrappedKeyCache()
+
+    // when
+    let first = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+    let second = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(String(data: first, encoding: .utf8), message)
+    XCTAssertEqual(String(data: second, encoding: .utf8), message)
+    XCTAssertEqual(cache.statistics.hits, 1)
+    XCTAssertEqual(cache.statistics.misses, 1)
+    XCTAssertEqual(cache.statistics.count, 1)
+    XCTAssertEqual(cache.statistics.hitRate, 0.5)
+  }
+
+  func testDecrypt_gcmOAEP_12BytesIV__shouldHitCache() throws {
+    // given
+    let message = UUID().uuidString
+    let iv = Data((0..<12).map { _ in UInt8.random(in: 0...255) })
+    let (encrypted, key, _) = try AES256.encrypt(data: message.data(using: .utf8)!, iv: iv, blockMode: .gcm)
+    let cipherKeyData = try JSONEncoder().encode(CipherAttr(key: key, iv: iv))
+    let cipherKey = try RSA.encrypt(data: cipherKeyData, with: publicKey, padding: .oaep).base64EncodedString()
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: cipherKey, data: encrypted, version: .gcmOAEP)
+    let cache = try UnwrappedKeyCache()
+
+    // when
+    _ = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey, cache: cache)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, message)
+    XCTAssertEqual(cache.statistics.hits, 1)
+  }
+
+  func testDecrypt_contractCBC__shouldHitCache() throws {
+    // given
+    let encryptedContractData = TestData.ehrContractCBCMessage.base64Decoded
+    let contractCipherKey = String(data: TestData.ehrContractCBCCipherKey.data, encoding: .utf8)!.trimmingCharacters(in: .whitespacesAndNewlines)
+    let encryptedData = EHREncryption.EncryptedData(cipherKey: contractCipherKey, data: encryptedContractData, version: .cbcPKCS1)
+    let cache = try UnwrappedKeyCache()
+
+    // when
+    _ = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey, cache: cache)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(String(data: decrypted, encoding: .utf8)!, "A Healthier Life is a Happier Life")
+    XCTAssertEqual(cache.statistics.hits, 1)
+  }
+
+  func testDecrypt_fullCache__shouldEvictLeastRecentlyUsed() throws {
+    // given
+    let cache = try UnwrappedKeyCache(capacity: 1)
+    let first = try EHREncryption.encrypt(data: Data([1]), with: publicKey)
+    let second = try EHREncryption.encrypt(data: Data([2]), with: publicKey)
+
+    // when
+    _ = try EHREncryption.decrypt(encryptedData: first, with: privateKey, cache: cache)
+    _ = try EHREncryption.decrypt(encryptedData: second, with: privateKey, cache: cache)
+    let decrypted = try EHREncryption.decrypt(encryptedData: first, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(decrypted, Data([1]))
+    XCTAssertEqual(cache.statistics.hits, 0)
+    XCTAssertEqual(cache.statistics.evictions, 2)
+    XCTAssertEqual(cache.statistics.count, 1)
+  }
+
+  func testDecrypt_expiredEntry__shouldUnwrapAgain() throws {
+    // given
+    let cache = try UnwrappedKeyCache(timeToLive: 0.1)
+    let encrypted = try EHREncryption.encrypt(data: Data([1]), with: publicKey)
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // when
+    Thread.sleep(forTimeInterval: 0.2)
+    let decrypted = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(decrypted, Data([1]))
+    XCTAssertEqual(cache.statistics.hits, 0)
+    XCTAssertEqual(cache.statistics.expirations, 1)
+  }
+
+  func testRemoveAll__shouldEmptyCache() throws {
+    // given
+    let cache = try UnwrappedKeyCache()
+    let encrypted = try EHREncryption.encrypt(data: Data([1]), with: publicKey)
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // when
+    cache.removeAll()
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // then
+    XCTAssertEqual(cache.statistics.hits, 0)
+    XCTAssertEqual(cache.statistics.misses, 2)
+  }
+
+  func testDecrypt_otherPrivateKey__shouldNotUseCachedKey() throws {
+    // given
+    let cache = try UnwrappedKeyCache()
+    let otherPrivateKey = try Key(pem: TestData.openSSLPrivateKey2048PEM.data, access: .private, size: .bit_2048)
+    let encrypted = try EHREncryption.encrypt(data: Data([1]), with: publicKey)
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+
+    // when
+    XCTAssertThrowsError(try EHREncryption.decrypt(encryptedData: encrypted, with: otherPrivateKey, cache: cache)) {
+      // then
+      XCTAssertEqual($0 as? PublicError, PublicError.decryptionFailed)
+    }
+    XCTAssertEqual(cache.statistics.hits, 0)
+  }
+
+  func testPerformanceDecrypt_cached() throws {
+    let encrypted = try EHREncryption.encrypt(data: Data(count: 1024), with: publicKey)
+    let cache = try UnwrappedKeyCache()
+    _ = try EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+    measure {
+      for _ in 0 ..< 100 {
+        _ = try? EHREncryption.decrypt(encryptedData: encrypted, with: privateKey, cache: cache)
+      }
+    }
+  }
+}
@@ -66,6 +66,21 @@ class X509Tests: XCTestCase {
     XCTAssertEqual(attributes?[kSecAttrKeyType] as! CFString, kSecAttrKeyTypeECSECPrimeRandom)
     XCTAssertEqual(attributes?[kSecAttrKeySizeInBits] as! Int, 256)
   }
+
+  func testWrapDERPublicKeyPEM_whenKeyIsRSA2048bitPKCS8__shouldCreateCertificateWithExpectedKey() {
+    // given
+    let testKey = TestData.openSSLPublicKey2048PEM
+
+    // when
+    let der = X509.wrapDER(publicKeyPEM: testKey.string)
+
+    // then
+    let cert = der.flatMap { SecCertificateCreateWithData(nil, $0 as CFData) }
+    XCTAssertNotNil(cert)
+    let attributes = cert?.secKey?.attributes
+    XCTAssertEqual(attributes?[kSecAttrKeyType] as! CFString, kSecAttrKeyTypeRSA)
+    XCTAssertEqual(attributes?[kSecAttrKeySizeInBits] as! Int, 2048)
+  }
 }
 
 private extension String {
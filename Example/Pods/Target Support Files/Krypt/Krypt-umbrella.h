@@ -10,9 +10,24 @@
 #endif
 #endif
 
+#import "aes256.h"
+#import "ca.h"
+#import "chacha20_poly1305.h"
+#import "cipher_attr.h"
 #import "csr.h"
+#import "csr_batch.h"
+#import "der_buffer.h"
+#import "ecies.h"
+#import "file_crypt.h"
 #import "helper.h"
+#import "kdf.h"
+#import "key_cache.h"
+#import "key_pool.h"
+#import "phase_timing.h"
 #import "pkcs8.h"
+#import "rsa_engine.h"
+#import "rsa_executor.h"
+#import "rsa_keygen.h"
 #import "smime.h"
 #import "x509.h"
 
@@ -18,8 +18,20 @@ public struct AES256 {
   /// Error returned when dealing with CommonCrypto or in this case with CBC block mode AES
   ///
   /// - ccError: with `CCCryptorStatus`
+  /// - invalidKeyOrIV: key is not 32 bytes or IV is not 16 bytes long
+  /// - invalidInput: input length does not fit the block mode, e.g. CBC ciphertext that is not a multiple of 16 bytes
+  /// - fileOperationFailed: reading or writing one of the files failed
+  /// - authenticationFailed: GCM tag of the encrypted file or buffer does not match
+  /// - bufferTooSmall: output buffer cannot hold the result
+  /// - cipherFailed: the cipher rejected the input, e.g. invalid CBC padding
   public enum Error: LocalizedError {
     case ccError(status: CCCryptorStatus)
+    case invalidKeyOrIV
+    case invalidInput
+    case fileOperationFailed
+    case authenticationFailed
+    case bufferTooSmall
+    case cipherFailed
   }
 
   /// Supported block modes
@@ -31,6 +43,15 @@ public struct AES256 {
     case cbc
   }
 
+  /// How files are read and written when encrypting them
+  ///
+  /// - pipelined: chunks are read, ciphered and written by overlapping stages
+  /// - memoryMapped: both files are mapped into memory and ciphered without intermediate copies
+  public enum FileAccess {
+    case pipelined
+    case memoryMapped
+  }
+
   /// - Parameters:
   ///   - data: data to encrypt
   ///   - key: authentication key
@@ -63,9 +84,104 @@ public struct AES256 {
       return digest
     }
   }
+
+  /// Number of bytes `encrypt(_:into:key:iv:blockMode:)` writes for the given plaintext length
+  ///
+  /// - Parameters:
+  ///   - count: plaintext length
+  ///   - blockMode: which `BlockMode` to use
+  /// - Returns: ciphertext length, including the GCM tag or the CBC padding
+  public static func encryptedCount(for count: Int, blockMode: BlockMode) -> Int {
+    return aes256_encrypted_length(blockMode.aes256BlockMode, count)
+  }
+
+  /// Encrypts caller supplied memory into caller supplied memory without any intermediate copies.
+  /// After the first call on a thread no memory is allocated.
+  /// `input` and `output` may start at the same address for in place encryption, other overlaps are not supported.
+  ///
+  /// - Parameters:
+  ///   - input: plaintext
+  ///   - output: buffer of at least `encryptedCount(for:blockMode:)` bytes
+  ///   - key: 32 bytes authentication key
+  ///   - iv: 16 bytes initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  /// - Returns: number of bytes written to `output`
+  /// - Throws: `AES256.Error`
+  public static func encrypt(
+    _ input: UnsafeRawBufferPointer,
+    into output: UnsafeMutableRawBufferPointer,
+    key: UnsafeRawBufferPointer,
+    iv: UnsafeRawBufferPointer,
+    blockMode: BlockMode
+  ) throws -> Int {
+    return try cryptBuffer(input, into: output, key: key, iv: iv, blockMode: blockMode, operation: CCOperation(kCCEncrypt))
+  }
+
+  /// Decrypts caller supplied memory into caller supplied memory without any intermediate copies.
+  /// After the first call on a thread no memory is allocated.
+  /// `input` and `output` may start at the same address for in place decryption, other overlaps are not supported.
+  ///
+  /// - Parameters:
+  ///   - input: ciphertext, for GCM followed by the tag
+  ///   - output: buffer of at least `input.count` bytes (GCM: `input.count - 16`)
+  ///   - key: 32 bytes authentication key
+  ///   - iv: 16 bytes initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  /// - Returns: number of bytes written to `output`
+  /// - Throws: `AES256.Error`
+  public static func decrypt(
+    _ input: UnsafeRawBufferPointer,
+    into output: UnsafeMutableRawBufferPointer,
+    key: UnsafeRawBufferPointer,
+    iv: UnsafeRawBufferPointer,
+    blockMode: BlockMode
+  ) throws -> Int {
+    return try cryptBuffer(input, into: output, key: key, iv: iv, blockMode: blockMode, operation: CCOperation(kCCDecrypt))
+  }
+
+  /// Encrypts a file into another file without loading it into memory.
+  /// Reading, encryption and writing overlap, the output has the same layout as `encrypt(data:key:iv:blockMode:)`.
+  ///
+  /// - Parameters:
+  ///   - input: URL of the file to encrypt
+  ///   - output: URL of the encrypted file, replaced if it exists
+  ///   - key: authentication key
+  ///   - iv: initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  ///   - access: which `FileAccess` to use
+  /// - Returns: tuple of authentication key and initialization vector used for encryption
+  /// - Throws: `AES256.Error`
+  public static func encrypt(
+    file input: URL,
+    to output: URL,
+    key: Data? = nil,
+    iv: Data? = nil,
+    blockMode: BlockMode,
+    access: FileAccess = .pipelined
+  ) throws -> (key: Data, iv: Data) {
+    let key = key ?? randomData(count: kCCKeySizeAES256)
+    let iv = iv ?? randomData(count: kCCKeySizeAES128)
+    try cryptFile(input, to: output, key: key, iv: iv, blockMode: blockMode, access: access, operation: CCOperation(kCCEncrypt))
+    return (key, iv)
+  }
+
+  /// Decrypts a file into another file without loading it into memory.
+  /// When GCM authentication fails the output file is removed.
+  ///
+  /// - Parameters:
+  ///   - input: URL of the encrypted file
+  ///   - output: URL of the decrypted file, replaced if it exists
+  ///   - key: authentication key
+  ///   - iv: initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  ///   - access: which `FileAccess` to use
+  /// - Throws: `AES256.Error`
+  public static func decrypt(file input: URL, to output: URL, key: Data, iv: Data, blockMode: BlockMode, access: FileAccess = .pipelined) throws {
+    try cryptFile(input, to: output, key: key, iv: iv, blockMode: blockMode, access: access, operation: CCOperation(kCCDecrypt))
+  }
 }
 
-private extension AES256 {
+extension AES256 {
   /// Generates random data of provided length
   ///
   /// - Parameter count: length of data
@@ -83,7 +199,62 @@ private extension AES256 {
     }
     return data
   }
+}
+
+extension AES256 {
+  /// Encrypts data through the buffer encryption of the C core (OpenSSL EVP, AES instructions where available),
+  /// the output is the same as `encrypt(data:key:iv:blockMode:)`
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - key: authentication key, random if `nil`
+  ///   - iv: initialization vector, random if `nil`
+  ///   - blockMode: which `BlockMode` to use
+  /// - Returns: tuple of encrypted data, authentication key and initialization vector used for encryption
+  /// - Throws: `AES256.Error`
+  static func encryptEVP(data: Data, key: Data?, iv: Data?, blockMode: BlockMode) throws -> (encrypted: Data, key: Data, iv: Data) {
+    let key = key ?? randomData(count: kCCKeySizeAES256)
+    let iv = iv ?? randomData(count: kCCKeySizeAES128)
+    var encrypted = Data(count: encryptedCount(for: data.count, blockMode: blockMode))
+    let written = try encrypted.withUnsafeMutableBytes { output in
+      try data.withUnsafeBytes { input in
+        try key.withUnsafeBytes { key in
+          try iv.withUnsafeBytes { iv in
+            try cryptBuffer(input, into: output, key: key, iv: iv, blockMode: blockMode, operation: CCOperation(kCCEncrypt))
+          }
+        }
+      }
+    }
+    encrypted.count = written
+    return (encrypted, key, iv)
+  }
+
+  /// Decrypts data through the buffer encryption of the C core, see `encryptEVP(data:key:iv:blockMode:)`
+  ///
+  /// - Parameters:
+  ///   - data: data to decrypt
+  ///   - key: authentication key
+  ///   - iv: initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  /// - Returns: decrypted data
+  /// - Throws: `AES256.Error`
+  static func decryptEVP(data: Data, key: Data, iv: Data, blockMode: BlockMode) throws -> Data {
+    var decrypted = Data(count: blockMode == .gcm ? max(data.count - Int(AES256_TAG_LENGTH), 0) : data.count)
+    let written = try decrypted.withUnsafeMutableBytes { output in
+      try data.withUnsafeBytes { input in
+        try key.withUnsafeBytes { key in
+          try iv.withUnsafeBytes { iv in
+            try cryptBuffer(input, into: output, key: key, iv: iv, blockMode: blockMode, operation: CCOperation(kCCDecrypt))
+          }
+        }
+      }
+    }
+    decrypted.count = written
+    return decrypted
+  }
+}
 
+private extension AES256 {
   /// Encrypts data with GCM block mode
   /// Key and IV are randomly generated inside
   ///
@@ -169,4 +340,132 @@ private extension AES256 {
     let digest = Data(bytes: dataOut, count: dataOutMoved)
     return (digest, key, iv)
   }
+
+  private static let emptyOutput = UnsafeMutablePointer<UInt8>.allocate(capacity: 1)
+
+  /// Runs the buffer encryption of the C core
+  ///
+  /// - Parameters:
+  ///   - input: bytes to read
+  ///   - output: bytes to write
+  ///   - key: authentication key
+  ///   - iv: initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  ///   - operation: kCCEncrypt/kCCDecrypt
+  /// - Returns: number of bytes written to `output`
+  /// - Throws: `AES256.Error`
+  static func cryptBuffer(
+    _ input: UnsafeRawBufferPointer,
+    into output: UnsafeMutableRawBufferPointer,
+    key: UnsafeRawBufferPointer,
+    iv: UnsafeRawBufferPointer,
+    blockMode: BlockMode,
+    operation: CCOperation
+  ) throws -> Int {
+    guard
+      key.count == kCCKeySizeAES256,
+      iv.count == kCCKeySizeAES128,
+      let keyBytes = key.baseAddress?.assumingMemoryBound(to: UInt8.self),
+      let ivBytes = iv.baseAddress?.assumingMemoryBound(to: UInt8.self)
+    else {
+      throw Error.invalidKeyOrIV
+    }
+    let encrypt = operation == CCOperation(kCCEncrypt)
+    let expectedCount: Int
+    if encrypt {
+      expectedCount = encryptedCount(for: input.count, blockMode: blockMode)
+    } else {
+      expectedCount = blockMode == .gcm ? max(input.count - Int(AES256_TAG_LENGTH), 0) : input.count
+    }
+    guard output.count >= expectedCount else {
+      throw Error.bufferTooSmall
+    }
+    // an empty buffer has no address, the C core writes nothing to it but needs one
+    let outputBytes = output.baseAddress?.assumingMemoryBound(to: UInt8.self) ?? emptyOutput
+    let inputBytes = input.baseAddress?.assumingMemoryBound(to: UInt8.self)
+
+    var written = 0
+    var error = Aes256_error(0)
+    let result: Int32
+    if encrypt {
+      result = aes256_encrypt(blockMode.aes256BlockMode, keyBytes, ivBytes, inputBytes, input.count, outputBytes, output.count, &written, &error)
+    } else {
+      result = aes256_decrypt(blockMode.aes256BlockMode, keyBytes, ivBytes, inputBytes, input.count, outputBytes, output.count, &written, &error)
+    }
+    guard result == 1 else {
+      switch error {
+      case Aes256_error_buffer_too_small:
+        throw Error.bufferTooSmall
+      case Aes256_error_authentication:
+        throw Error.authenticationFailed
+      case Aes256_error_invalid_input:
+        throw Error.invalidInput
+      default:
+        throw Error.cipherFailed
+      }
+    }
+    return written
+  }
+
+  /// Runs the file encryption of the C core
+  ///
+  /// - Parameters:
+  ///   - input: URL of the file to read
+  ///   - output: URL of the file to write
+  ///   - key: authentication key
+  ///   - iv: initialization vector
+  ///   - blockMode: which `BlockMode` to use
+  ///   - access: which `FileAccess` to use
+  ///   - operation: kCCEncrypt/kCCDecrypt
+  /// - Throws: `AES256.Error`
+  static func cryptFile(
+    _ input: URL,
+    to output: URL,
+    key: Data,
+    iv: Data,
+    blockMode: BlockMode,
+    access: FileAccess,
+    operation: CCOperation
+  ) throws {
+    guard key.count == kCCKeySizeAES256, iv.count == kCCKeySizeAES128 else {
+      throw Error.invalidKeyOrIV
+    }
+    var error = File_crypt_error(0)
+    let result = key.withUnsafeBytes { keyPtr in
+      iv.withUnsafeBytes { ivPtr -> Int32 in
+        let keyBytes = keyPtr.baseAddress?.assumingMemoryBound(to: UInt8.self)
+        let ivBytes = ivPtr.baseAddress?.assumingMemoryBound(to: UInt8.self)
+        let mode = blockMode.aes256BlockMode
+        switch (access, operation == CCOperation(kCCEncrypt)) {
+        case (.pipelined, true):
+          return file_encrypt(input.path, output.path, mode, keyBytes, ivBytes, nil, &error)
+        case (.pipelined, false):
+          return file_decrypt(input.path, output.path, mode, keyBytes, ivBytes, nil, &error)
+        case (.memoryMapped, true):
+          return file_encrypt_mapped(input.path, output.path, mode, keyBytes, ivBytes, &error)
+        case (.memoryMapped, false):
+          return file_decrypt_mapped(input.path, output.path, mode, keyBytes, ivBytes, &error)
+        }
+      }
+    }
+    guard result == 1 else {
+      switch error {
+      case File_crypt_error_authentication:
+        throw Error.authenticationFailed
+      default:
+        throw Error.fileOperationFailed
+      }
+    }
+  }
+}
+
+private extension AES256.BlockMode {
+  var aes256BlockMode: Aes256_block_mode {
+    switch self {
+    case .gcm:
+      return Aes256_block_mode_gcm
+    case .cbc:
+      return Aes256_block_mode_cbc
+    }
+  }
 }
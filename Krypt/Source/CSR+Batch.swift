@@ -0,0 +1,184 @@
+//
+//  CSR+Batch.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension CSR {
+  enum Format {
+    case der
+    case pem
+  }
+
+  /// Private key loaded once and used for many CSRs
+  final class SigningKey {
+    fileprivate let key: OpaquePointer
+
+    /// Loads a private key. P-256 keys are loaded from their X9.63 representation without a PEM round trip,
+    /// their signatures use the built-in generator table of OpenSSL.
+    ///
+    /// - Parameter key: RSA or EC private key
+    /// - Throws: `CSR.Error.invalidKey` or errors of the key export
+    public convenience init(key: Key) throws {
+      guard key.access == .private else {
+        throw Error.invalidKey
+      }
+      guard key.type == .ecSECPrimeRandom else {
+        try self.init(pem: try key.convertedToPEM())
+        return
+      }
+      var raw = try key.convertedToDER()
+      defer { raw.resetBytes(in: 0 ..< raw.count) }
+      let signingKey = raw.withUnsafeBytes { rawBuffer in
+        csr_key_new_ec_p256(rawBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self), rawBuffer.count, nil)
+      }
+      guard let loaded = signingKey else {
+        throw Error.invalidKey
+      }
+      self.init(loaded: loaded)
+    }
+
+    /// Loads a private key
+    ///
+    /// - Parameter pem: private key in PKCS#1, SEC1 or PKCS#8 PEM format
+    /// - Throws: `CSR.Error.invalidKey`
+    public init(pem: String) throws {
+      guard let key = csr_key_new_pem(pem, nil) else {
+        throw Error.invalidKey
+      }
+      self.key = key
+    }
+
+    private init(loaded key: OpaquePointer) {
+      self.key = key
+    }
+
+    deinit {
+      csr_key_free(key)
+    }
+  }
+
+  /// Subject shared by the CSRs of a batch, fixed entries are encoded once, placeholders are filled per request
+  struct SubjectTemplate {
+    public enum Value {
+      case fixed(String)
+      case placeholder
+    }
+
+    /// Attribute names like "C", "O", "emailAddress" with their values, in subject order
+    public let entries: [(field: String, value: Value)]
+
+    public init(_ entries: [(field: String, value: Value)]) {
+      self.entries = entries
+    }
+
+    /// Template with the attributes of `CSRAttributes`, nil attributes become placeholders
+    ///
+    /// - Parameter attributes: fixed attributes
+    public init(attributes: CSRAttributes) {
+      let fields: [(String, String?)] = [
+        ("C", attributes.country),
+        ("ST", attributes.state),
+        ("L", attributes.location),
+        ("O", attributes.organization),
+        ("OU", attributes.organizationUnit),
+        ("emailAddress", attributes.emailAddress),
+        ("UID", attributes.uniqueIdentifier),
+        ("GN", attributes.givenName),
+        ("SN", attributes.surname)
+      ]
+      self.init(fields.map { field, value in (field, value.map { .fixed($0) } ?? .placeholder) })
+    }
+  }
+
+  struct BatchRequest {
+    public let key: SigningKey
+    /// One value per placeholder of the template, an empty value omits the attribute
+    public let values: [String]
+
+    public init(key: SigningKey, values: [String]) {
+      self.key = key
+      self.values = values
+    }
+  }
+
+  /// Creates many Certificate signing requests (CSR), the signing is spread over threads.
+  /// Per request only the placeholder values are encoded, the result equals `create(with:attributes:)` for the same
+  /// key and subject.
+  ///
+  /// - Parameters:
+  ///   - batch: key and placeholder values per CSR
+  ///   - template: subject of the CSRs
+  ///   - format: DER or PEM output
+  ///   - threadCount: number of signing threads
+  /// - Returns: one CSR per request in request order
+  /// - Throws: `CSR.Error.failedCreatingCSR` if any CSR fails
+  static func create(
+    batch: [BatchRequest],
+    template: SubjectTemplate,
+    format: Format = .pem,
+    threadCount: Int = ProcessInfo.processInfo.activeProcessorCount
+  ) throws -> [Data] {
+    var strings: [UnsafeMutablePointer<CChar>] = []
+    var valueLists: [UnsafeMutablePointer<UnsafePointer<CChar>?>] = []
+    defer {
+      strings.forEach { free($0) }
+      valueLists.forEach { $0.deallocate() }
+    }
+    func cString(_ string: String) -> UnsafePointer<CChar> {
+      let copy = strdup(string)!
+      strings.append(copy)
+      return UnsafePointer(copy)
+    }
+
+    let entries = template.entries.map { entry -> Csr_template_entry in
+      switch entry.value {
+      case let .fixed(value):
+        return Csr_template_entry(field: cString(entry.field), value: cString(value))
+      case .placeholder:
+        return Csr_template_entry(field: cString(entry.field), value: nil)
+      }
+    }
+    guard let subject = csr_template_new(entries, entries.count, nil) else {
+      throw Error.failedCreatingCSR
+    }
+    defer { csr_template_free(subject) }
+
+    let placeholders = csr_template_placeholders(subject)
+    let requests = try batch.map { request -> Csr_batch_request in
+      guard request.values.count == placeholders else {
+        throw Error.failedCreatingCSR
+      }
+      let values = UnsafeMutablePointer<UnsafePointer<CChar>?>.allocate(capacity: max(placeholders, 1))
+      valueLists.append(values)
+      for (index, value) in request.values.enumerated() {
+        values[index] = cString(value)
+      }
+      return Csr_batch_request(key: request.key.key, values: UnsafePointer(values))
+    }
+
+    var outputs = [Csr_batch_output](repeating: Csr_batch_output(), count: requests.count)
+    defer { csr_batch_output_free(&outputs, outputs.count) }
+    let status = withExtendedLifetime(batch) {
+      csr_batch_create(subject, requests, requests.count, format.batchFormat, Int32(max(threadCount, 1)), &outputs, nil)
+    }
+    guard status == 1 else {
+      throw Error.failedCreatingCSR
+    }
+    return outputs.map { Data(bytes: $0.data, count: $0.length) }
+  }
+}
+
+private extension CSR.Format {
+  var batchFormat: Csr_batch_format {
+    switch self {
+    case .der:
+      return Csr_batch_format_der
+    case .pem:
+      return Csr_batch_format_pem
+    }
+  }
+}
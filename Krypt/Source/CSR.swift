@@ -21,7 +21,7 @@ public struct CSR {
   /// Creates Certificate signing request (CSR)
   ///
   /// - Parameters:
-  ///   - key: Private key to use to create CSR
+  ///   - key: RSA or P-256 private key to use to create CSR
   ///   - attributes: Object with attributes specified in X.509 standard
   /// - Returns: `String` representing CSR
   /// - Throws: `CSR.Error` or `Key.Error`
@@ -51,4 +51,38 @@ public struct CSR {
 
     return String(cString: csr)
   }
+
+  /// Creates Certificate signing request (CSR) in DER format, without the PEM encoding of `create(with:attributes:)`
+  ///
+  /// - Parameters:
+  ///   - key: RSA or P-256 private key to use to create CSR
+  ///   - attributes: Object with attributes specified in X.509 standard
+  /// - Returns: `Data` representing CSR
+  /// - Throws: `CSR.Error` or `Key.Error`
+  public static func createDER(with key: Key, attributes: CSRAttributes?) throws -> Data {
+    guard key.access == .private else {
+      throw Error.invalidKey
+    }
+
+    let keyPEM = try key.convertedToPEM()
+
+    let result = createCSR_der(
+      keyPEM.unsafeUtf8cString,
+      (attributes?.country ?? "").unsafeUtf8cString,
+      (attributes?.state ?? "").unsafeUtf8cString,
+      (attributes?.location ?? "").unsafeUtf8cString,
+      (attributes?.organization ?? "").unsafeUtf8cString,
+      (attributes?.organizationUnit ?? "").unsafeUtf8cString,
+      (attributes?.emailAddress ?? "").unsafeUtf8cString,
+      (attributes?.uniqueIdentifier ?? "").unsafeUtf8cString,
+      (attributes?.givenName ?? "").unsafeUtf8cString,
+      (attributes?.surname ?? "").unsafeUtf8cString
+    )
+
+    guard let csr = Data(consuming: result) else {
+      throw Error.failedCreatingCSR
+    }
+
+    return csr
+  }
 }
@@ -0,0 +1,218 @@
+//
+//  CertificateAuthority.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Local certificate authority for test and device certificates, e.g. S/MIME certificates for load tests of
+/// `SMIME.verify`. Certificates get random 159 bits serial numbers, SHA256 signatures and the email address as
+/// subjectAltName.
+public final class CertificateAuthority {
+  public enum Error: LocalizedError {
+    case creationFailed
+    case issuingFailed
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  public enum Format {
+    case der
+    case pem
+  }
+
+  public struct Profile {
+    /// Time the certificates are valid from issuance
+    public let validity: TimeInterval
+    /// Time notBefore lies before issuance, tolerates clock skew of the verifier
+    public let backdate: TimeInterval
+    /// Key usages and extended key usage for S/MIME, otherwise digitalSignature only
+    public let emailProtection: Bool
+
+    public init(validity: TimeInterval, backdate: TimeInterval = 300, emailProtection: Bool = true) {
+      self.validity = validity
+      self.backdate = backdate
+      self.emailProtection = emailProtection
+    }
+
+    /// S/MIME certificates valid for one year
+    public static let smime = Profile(validity: 365 * 24 * 60 * 60)
+  }
+
+  public struct Request {
+    let csrPEM: String?
+    let publicKeyPEM: String?
+    let commonName: String?
+    let email: String?
+
+    /// Certifies the subject and public key of a CSR, its signature is verified
+    ///
+    /// - Parameters:
+    ///   - pem: CSR in PEM format
+    ///   - email: email address of the subjectAltName extension
+    public static func csr(_ pem: String, email: String? = nil) -> Request {
+      return Request(csrPEM: pem, publicKeyPEM: nil, commonName: nil, email: email)
+    }
+
+    /// Certifies a public key
+    ///
+    /// - Parameters:
+    ///   - pem: public key in PKCS#8 PEM format
+    ///   - commonName: common name of the subject
+    ///   - email: email address of the subjectAltName extension
+    public static func publicKey(_ pem: String, commonName: String? = nil, email: String? = nil) -> Request {
+      return Request(csrPEM: nil, publicKeyPEM: pem, commonName: commonName, email: email)
+    }
+  }
+
+  private let ca: OpaquePointer
+
+  /// Loads a certificate authority
+  ///
+  /// - Parameters:
+  ///   - keyPEM: private key of the CA in PEM format
+  ///   - certificatePEM: certificate of the CA in PEM format
+  /// - Throws: `creationFailed` if the key or certificate are invalid or do not belong together
+  public init(keyPEM: String, certificatePEM: String) throws {
+    guard let ca = ca_new_pem(keyPEM, certificatePEM, nil) else {
+      throw Error.creationFailed
+    }
+    self.ca = ca
+  }
+
+  /// Creates a certificate authority with a new self signed root certificate
+  ///
+  /// - Parameters:
+  ///   - keyPEM: private key of the CA in PEM format
+  ///   - commonName: common name of the root certificate
+  ///   - validity: time the root certificate is valid
+  /// - Throws: `creationFailed`
+  public init(keyPEM: String, commonName: String, validity: TimeInterval) throws {
+    guard let ca = ca_new_self_signed(keyPEM, commonName, Int(validity), nil) else {
+      throw Error.creationFailed
+    }
+    self.ca = ca
+  }
+
+  /// Creates an intermediate certificate authority, its certificate is issued by `issuer`
+  ///
+  /// - Parameters:
+  ///   - keyPEM: private key of the intermediate CA in PEM format
+  ///   - commonName: common name of the intermediate certificate
+  ///   - validity: time the intermediate certificate is valid
+  ///   - issuer: CA issuing the intermediate certificate
+  /// - Throws: `creationFailed`
+  public init(keyPEM: String, commonName: String, validity: TimeInterval, issuer: CertificateAuthority) throws {
+    guard let ca = ca_new_intermediate(issuer.ca, keyPEM, commonName, Int(validity), nil) else {
+      throw Error.creationFailed
+    }
+    self.ca = ca
+  }
+
+  deinit {
+    ca_free(ca)
+  }
+
+  /// Certificate of the CA in PEM format, e.g. for the trusted certificates of `SMIME.verify`
+  public var certificatePEM: String {
+    guard let pem = ca_certificate_pem(ca) else {
+      return ""
+    }
+    defer { free(pem) }
+    return String(cString: pem)
+  }
+
+  /// Issues one certificate
+  ///
+  /// - Parameters:
+  ///   - request: subject, public key and email address of the certificate
+  ///   - profile: validity and key usage of the certificate
+  /// - Returns: certificate in DER format
+  /// - Throws: `issuingFailed`
+  public func issue(_ request: Request, profile: Profile = .smime) throws -> Data {
+    var cProfile = profile.cProfile
+    let result = withCRequests([request]) { requests in
+      ca_issue_der(ca, &cProfile, requests, nil)
+    }
+    guard let certificate = Data(consuming: result) else {
+      throw Error.issuingFailed
+    }
+    return certificate
+  }
+
+  /// Issues one certificate per request, the signing is spread over threads
+  ///
+  /// - Parameters:
+  ///   - batch: subject, public key and email address per certificate
+  ///   - profile: validity and key usage of the certificates
+  ///   - format: DER or PEM output
+  ///   - threadCount: number of signing threads
+  /// - Returns: one certificate per request in request order
+  /// - Throws: `issuingFailed` if any certificate fails
+  public func issue(
+    batch: [Request],
+    profile: Profile = .smime,
+    format: Format = .der,
+    threadCount: Int = ProcessInfo.processInfo.activeProcessorCount
+  ) throws -> [Data] {
+    guard !batch.isEmpty else {
+      return []
+    }
+    var cProfile = profile.cProfile
+    var outputs = [Ca_output](repeating: Ca_output(), count: batch.count)
+    defer { ca_output_free(&outputs, outputs.count) }
+    let status = withCRequests(batch) { requests in
+      ca_issue_batch(ca, &cProfile, requests, batch.count, format.caFormat, Int32(max(threadCount, 1)), &outputs, nil)
+    }
+    guard status == 1 else {
+      throw Error.issuingFailed
+    }
+    return outputs.map { Data(bytes: $0.data, count: $0.length) }
+  }
+}
+
+private extension CertificateAuthority {
+  /// Calls `body` with C requests whose strings live until `body` returns
+  func withCRequests<T>(_ requests: [Request], _ body: (UnsafePointer<Ca_request>) -> T) -> T {
+    var strings: [UnsafeMutablePointer<CChar>] = []
+    defer { strings.forEach { free($0) } }
+    func cString(_ string: String?) -> UnsafePointer<CChar>? {
+      guard let string = string, let copy = strdup(string) else {
+        return nil
+      }
+      strings.append(copy)
+      return UnsafePointer(copy)
+    }
+
+    let cRequests = requests.map {
+      Ca_request(
+        csr_pem: cString($0.csrPEM),
+        public_key_pem: cString($0.publicKeyPEM),
+        common_name: cString($0.commonName),
+        email: cString($0.email)
+      )
+    }
+    return cRequests.withUnsafeBufferPointer { body($0.baseAddress!) }
+  }
+}
+
+private extension CertificateAuthority.Profile {
+  var cProfile: Ca_profile {
+    return Ca_profile(validity_seconds: Int(validity), backdate_seconds: Int(backdate), email_protection: emailProtection ? 1 : 0)
+  }
+}
+
+private extension CertificateAuthority.Format {
+  var caFormat: Ca_format {
+    switch self {
+    case .der:
+      return Ca_format_der
+    case .pem:
+      return Ca_format_pem
+    }
+  }
+}
@@ -0,0 +1,113 @@
+//
+//  ChaCha20Poly1305.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Symetric AEAD encryption with ChaCha20-Poly1305 (RFC 8439).
+///
+/// Faster than AES 256 GCM on CPUs without AES instructions. Keys are 32 bytes, nonces 12 bytes,
+/// the encrypted data is the ciphertext followed by the 16 bytes tag like with `AES256.BlockMode.gcm`.
+public struct ChaCha20Poly1305 {
+  /// - invalidKeyOrNonce: key is not 32 bytes or nonce is not 12 bytes long
+  /// - authenticationFailed: tag of the encrypted data does not match
+  /// - cipherFailed: the cipher rejected the input
+  public enum Error: LocalizedError {
+    case invalidKeyOrNonce
+    case authenticationFailed
+    case cipherFailed
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  /// Length of the key
+  public static let keyCount = Int(CHACHA20_POLY1305_KEY_LENGTH)
+
+  /// Length of the nonce
+  public static let nonceCount = Int(CHACHA20_POLY1305_NONCE_LENGTH)
+
+  /// Length of the tag appended to the ciphertext
+  public static let tagCount = Int(CHACHA20_POLY1305_TAG_LENGTH)
+
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - key: 32 bytes key, random if `nil`
+  ///   - nonce: 12 bytes nonce, random if `nil`. Must never be reused with the same key
+  /// - Returns: tuple of encrypted data, key and nonce used for encryption
+  /// - Throws: `ChaCha20Poly1305.Error`
+  public static func encrypt(data: Data, key: Data? = nil, nonce: Data? = nil) throws -> (encrypted: Data, key: Data, nonce: Data) {
+    let key = key ?? AES256.randomData(count: keyCount)
+    let nonce = nonce ?? AES256.randomData(count: nonceCount)
+    var encrypted = Data(count: data.count + tagCount)
+    let written = try crypt(data, into: &encrypted, key: key, nonce: nonce, encrypt: true)
+    return (encrypted.prefix(written), key, nonce)
+  }
+
+  /// - Parameters:
+  ///   - data: ciphertext followed by the tag
+  ///   - key: 32 bytes key
+  ///   - nonce: 12 bytes nonce
+  /// - Returns: decrypted data
+  /// - Throws: `ChaCha20Poly1305.Error`
+  public static func decrypt(data: Data, key: Data, nonce: Data) throws -> Data {
+    guard data.count >= tagCount else {
+      throw Error.authenticationFailed
+    }
+    // never empty, the C core needs an output address also for an empty plaintext
+    var decrypted = Data(count: max(data.count - tagCount, 1))
+    let written = try crypt(data, into: &decrypted, key: key, nonce: nonce, encrypt: false)
+    return decrypted.prefix(written)
+  }
+}
+
+private extension ChaCha20Poly1305 {
+  /// Runs the cipher of the C core
+  ///
+  /// - Parameters:
+  ///   - input: bytes to read
+  ///   - output: bytes to write
+  ///   - key: 32 bytes key
+  ///   - nonce: 12 bytes nonce
+  ///   - encrypt: `true` to encrypt, `false` to decrypt
+  /// - Returns: number of bytes written to `output`
+  /// - Throws: `ChaCha20Poly1305.Error`
+  static func crypt(_ input: Data, into output: inout Data, key: Data, nonce: Data, encrypt: Bool) throws -> Int {
+    guard key.count == keyCount, nonce.count == nonceCount else {
+      throw Error.invalidKeyOrNonce
+    }
+    var written = 0
+    var error = Chacha20_poly1305_error(0)
+    let result = input.withUnsafeBytes { inputBuffer in
+      output.withUnsafeMutableBytes { outputBuffer in
+        key.withUnsafeBytes { keyBuffer in
+          nonce.withUnsafeBytes { nonceBuffer -> Int32 in
+            let inputBytes = inputBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+            let outputBytes = outputBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+            let keyBytes = keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+            let nonceBytes = nonceBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+            if encrypt {
+              return chacha20_poly1305_encrypt(keyBytes, nonceBytes, inputBytes, inputBuffer.count, outputBytes, outputBuffer.count, &written, &error)
+            }
+            return chacha20_poly1305_decrypt(keyBytes, nonceBytes, inputBytes, inputBuffer.count, outputBytes, outputBuffer.count, &written, &error)
+          }
+        }
+      }
+    }
+    guard result == 1 else {
+      switch error {
+      case Chacha20_poly1305_error_authentication:
+        throw Error.authenticationFailed
+      case Chacha20_poly1305_error_invalid_input:
+        throw Error.invalidKeyOrNonce
+      default:
+        throw Error.cipherFailed
+      }
+    }
+    return written
+  }
+}
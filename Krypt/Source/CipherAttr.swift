@@ -17,3 +17,64 @@ struct CipherAttr: Codable {
     case iv = "base64EncodedIV"
   }
 }
+
+extension CipherAttr {
+  /// Length of the AES 256 key
+  static let keyCount = 32
+
+  /// Length of the initialization vector
+  static let ivCount = 16
+
+  /// Length of the ChaCha20-Poly1305 nonce stored as IV by `EHREncryption.Version.chachaPolyOAEP`
+  static let nonceCount = 12
+
+  /// Fixed size binary form used by `EHREncryption.Version.gcmOAEPCompact`: 32 bytes key followed by 16 bytes IV,
+  /// `chachaPolyOAEP` stores the 12 bytes nonce instead of the IV
+  var compactData: Data? {
+    guard key.count == CipherAttr.keyCount, iv.count == CipherAttr.ivCount || iv.count == CipherAttr.nonceCount else {
+      return nil
+    }
+    return key + iv
+  }
+
+  init?(compactData: Data, ivCount: Int = CipherAttr.ivCount) {
+    guard compactData.count == CipherAttr.keyCount + ivCount else {
+      return nil
+    }
+    let bytes = [UInt8](compactData)
+    self.init(key: Data(bytes[0 ..< CipherAttr.keyCount]), iv: Data(bytes[CipherAttr.keyCount...]))
+  }
+}
+
+extension CipherAttr {
+  /// Decodes the JSON form used by the gcmOAEP and cbcPKCS1 versions.
+  /// The known `{"base64EncodedKey":…,"base64EncodedIV":…}` layout is parsed by `cipher_attr_parse` straight into
+  /// the key and IV buffers, any other layout falls back to `JSONDecoder`.
+  ///
+  /// - Parameter json: JSON encoded `CipherAttr`
+  init?(json: Data) {
+    var key = Data(count: CipherAttr.keyCount)
+    var iv = Data(count: CipherAttr.ivCount)
+    let parsed = json.withUnsafeBytes { jsonBuffer in
+      key.withUnsafeMutableBytes { keyBuffer in
+        iv.withUnsafeMutableBytes { ivBuffer in
+          cipher_attr_parse(
+            jsonBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            jsonBuffer.count,
+            keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            ivBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+          )
+        }
+      }
+    }
+    if parsed == 1 {
+      self.init(key: key, iv: iv)
+      return
+    }
+
+    guard let cipherAttr = try? JSONDecoder().decode(CipherAttr.self, from: json) else {
+      return nil
+    }
+    self = cipherAttr
+  }
+}
@@ -0,0 +1,21 @@
+//
+//  Data+DerBuffer.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+extension Data {
+  /// Copies the DER output of a `*_der` C function and frees the buffer
+  ///
+  /// - Parameter derBuffer: buffer returned by the C function, nil on failure
+  init?(consuming derBuffer: UnsafeMutablePointer<Der_buffer>?) {
+    guard let buffer = derBuffer else {
+      return nil
+    }
+    defer { der_buffer_free(buffer) }
+    self.init(bytes: buffer.pointee.data, count: buffer.pointee.length)
+  }
+}
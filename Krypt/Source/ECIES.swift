@@ -0,0 +1,101 @@
+//
+//  ECIES.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Hybrid encryption on P-256: an ephemeral-static ECDH agreement replaces the RSA wrap of the AES key.
+/// The AES 256 GCM key and IV are derived from the shared secret with HKDF SHA256,
+/// the ephemeral public key (65 bytes X9.63) travels in place of the RSA encrypted cipher key.
+enum ECIES {
+  enum Error: LocalizedError {
+    case invalidKey
+    case keyAgreementFailed
+
+    var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  /// Derives a fresh AES key and IV for the recipient
+  ///
+  /// - Parameter publicKey: P-256 public key of the recipient
+  /// - Returns: ephemeral public key to send along the data and the AES key and IV
+  /// - Throws: `invalidKey` or `keyAgreementFailed`
+  static func cipherAttr(for publicKey: Key) throws -> (ephemeralPublicKey: Data, cipherAttr: CipherAttr) {
+    let recipientPublicKey = try externalRepresentation(of: publicKey, access: .public)
+    var ephemeralPublicKey = Data(count: Int(ECIES_P256_PUBLIC_KEY_LENGTH))
+    var key = Data(count: CipherAttr.keyCount)
+    var iv = Data(count: CipherAttr.ivCount)
+    var err = Ecies_error(0)
+    let status = recipientPublicKey.withUnsafeBytes { recipientBuffer in
+      ephemeralPublicKey.withUnsafeMutableBytes { ephemeralBuffer in
+        key.withUnsafeMutableBytes { keyBuffer in
+          iv.withUnsafeMutableBytes { ivBuffer in
+            ecies_p256_derive_for_recipient(
+              recipientBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              recipientBuffer.count,
+              ephemeralBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              ivBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              &err
+            )
+          }
+        }
+      }
+    }
+    guard status == 1 else {
+      throw err == Ecies_error_invalid_key ? Error.invalidKey : Error.keyAgreementFailed
+    }
+    return (ephemeralPublicKey, CipherAttr(key: key, iv: iv))
+  }
+
+  /// Derives the AES key and IV chosen by the sender
+  ///
+  /// - Parameters:
+  ///   - ephemeralPublicKey: ephemeral public key of the sender
+  ///   - privateKey: P-256 private key of the recipient
+  /// - Returns: AES key and IV
+  /// - Throws: `invalidKey` or `keyAgreementFailed`
+  static func cipherAttr(ephemeralPublicKey: Data, with privateKey: Key) throws -> CipherAttr {
+    var recipientPrivateKey = try externalRepresentation(of: privateKey, access: .private)
+    defer { recipientPrivateKey.resetBytes(in: 0 ..< recipientPrivateKey.count) }
+    var key = Data(count: CipherAttr.keyCount)
+    var iv = Data(count: CipherAttr.ivCount)
+    var err = Ecies_error(0)
+    let status = recipientPrivateKey.withUnsafeBytes { privateBuffer in
+      ephemeralPublicKey.withUnsafeBytes { ephemeralBuffer in
+        key.withUnsafeMutableBytes { keyBuffer in
+          iv.withUnsafeMutableBytes { ivBuffer in
+            ecies_p256_derive_for_private_key(
+              privateBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              privateBuffer.count,
+              ephemeralBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              ephemeralBuffer.count,
+              keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              ivBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              &err
+            )
+          }
+        }
+      }
+    }
+    guard status == 1 else {
+      throw err == Ecies_error_invalid_key ? Error.invalidKey : Error.keyAgreementFailed
+    }
+    return CipherAttr(key: key, iv: iv)
+  }
+}
+
+private extension ECIES {
+  /// X9.63 representation of a P-256 key: `04 || X || Y` for public keys, `04 || X || Y || K` for private keys
+  static func externalRepresentation(of key: Key, access: Key.Access) throws -> Data {
+    guard key.type == .ecSECPrimeRandom, key.size == .bit_256, key.access == access else {
+      throw Error.invalidKey
+    }
+    return try key.convertedToDER()
+  }
+}
@@ -0,0 +1,104 @@
+//
+//  EHREncryption+Batch.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension EHREncryption {
+  /// Asymetrically decrypts many records with the same private key, e.g. a whole timeline.
+  ///
+  /// The RSA unwraps run on a pool of workers sized to the number of active cores, taking the records in order.
+  /// Each unwrapped record is handed to a concurrent AES stage right away, so the workers continue
+  /// with the next RSA operation while the content of the previous record is decrypted.
+  ///
+  /// - Parameters:
+  ///   - batch: records to decrypt
+  ///   - key: RSA private key to decrypt with
+  ///   - cache: cache of unwrapped keys, `nil` unwraps with RSA every time
+  /// - Returns: decrypted data or `PublicError.decryptionFailed` for every record, in the order of `batch`
+  static func decrypt(batch: [EncryptedData], with key: Key, cache: UnwrappedKeyCache? = nil) -> [Result<Data, PublicError>] {
+    let aesQueue = DispatchQueue(label: "com.vivy.krypt.batch-decrypt.aes", qos: .userInitiated, attributes: .concurrent)
+    let aesGroup = DispatchGroup()
+
+    let results = ResultSlots<Data>(count: batch.count, initial: .failure(.decryptionFailed))
+    forEachConcurrently(count: batch.count) { index in
+      let encryptedData = batch[index]
+      guard
+        let wrappedKey = encryptedData.wrappedKeyData,
+        let cipherAttr = try? unwrap(wrappedKey: wrappedKey, with: key, version: encryptedData.version, cache: cache)
+      else {
+        return
+      }
+
+      aesQueue.async(group: aesGroup) {
+        let decrypted = try? encryptedData.version.open(encryptedData.data, with: cipherAttr)
+        if let decrypted = decrypted {
+          results[index] = .success(decrypted)
+        }
+      }
+    }
+    aesGroup.wait()
+
+    return results.array
+  }
+}
+
+// MARK: - Worker pool
+
+extension EHREncryption {
+  /// Runs `body` for every index in `0 ..< count` on a pool of workers sized to the number of active cores.
+  /// The indices are taken in ascending order, the call returns when all of them are processed.
+  static func forEachConcurrently(count: Int, body: (Int) -> Void) {
+    guard count > 0 else {
+      return
+    }
+    let indexLock = NSLock()
+    var nextIndex = 0
+
+    let workerCount = min(count, ProcessInfo.processInfo.activeProcessorCount)
+    DispatchQueue.concurrentPerform(iterations: workerCount) { _ in
+      while true {
+        indexLock.lock()
+        let index = nextIndex
+        nextIndex += 1
+        indexLock.unlock()
+        guard index < count else {
+          return
+        }
+        body(index)
+      }
+    }
+  }
+
+  /// Fixed number of result slots written concurrently.
+  /// Every slot must be written by one task at a time, so the slots need no locking.
+  final class ResultSlots<Success> {
+    private let slots: UnsafeMutableBufferPointer<Result<Success, PublicError>>
+
+    init(count: Int, initial: Result<Success, PublicError>) {
+      slots = UnsafeMutableBufferPointer.allocate(capacity: count)
+      slots.initialize(repeating: initial)
+    }
+
+    deinit {
+      slots.baseAddress?.deinitialize(count: slots.count)
+      slots.deallocate()
+    }
+
+    subscript(index: Int) -> Result<Success, PublicError> {
+      get {
+        return slots[index]
+      }
+      set {
+        slots[index] = newValue
+      }
+    }
+
+    var array: [Result<Success, PublicError>] {
+      return Array(slots)
+    }
+  }
+}
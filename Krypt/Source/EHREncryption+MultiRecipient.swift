@@ -0,0 +1,114 @@
+//
+//  EHREncryption+MultiRecipient.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension EHREncryption {
+  /// Data encrypted once for several recipients.
+  /// Every recipient gets the same AES key and IV wrapped with their own RSA public key.
+  struct MultiRecipientEncryptedData {
+    /// AES key and IV wrapped for one recipient
+    public struct Recipient {
+      /// hex encoded `Key.publicKeyDigest()` of the recipient's key pair
+      public let keyID: String
+
+      /// base64 encoded
+      public let cipherKey: String
+
+      public init(keyID: String, cipherKey: String) {
+        self.keyID = keyID
+        self.cipherKey = cipherKey
+      }
+    }
+
+    /// encrypted data, shared by all recipients
+    public let data: Data
+
+    /// one entry per recipient
+    public let recipients: [Recipient]
+
+    /// raw value of `EHREncryption.Version`
+    public let version: Version
+
+    public init(data: Data, recipients: [Recipient], version: Version) {
+      self.data = data
+      self.recipients = recipients
+      self.version = version
+    }
+
+    /// Single recipient view for the given recipient, which decrypts with `EHREncryption.decrypt(encryptedData:with:)`
+    ///
+    /// - Parameter keyID: `Recipient.keyID` of the recipient
+    /// - Returns: `EncryptedData` sharing the encrypted data, `nil` if there is no such recipient
+    public func encryptedData(for keyID: String) -> EncryptedData? {
+      guard let recipient = recipients.first(where: { $0.keyID == keyID }) else {
+        return nil
+      }
+      return EncryptedData(cipherKey: recipient.cipherKey, data: data, version: version)
+    }
+  }
+
+  /// Asymetrically encrypts the provided data once with AES 256 GCM and wraps the AES key and IV
+  /// with RSA OAEP SHA256 for every recipient
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - keys: RSA public keys of the recipients
+  ///   - version: `gcmOAEP` or `gcmOAEPCompact`
+  /// - Returns: `MultiRecipientEncryptedData` object
+  /// - Throws: `PublicError.encryptionFailed`
+  static func encrypt(data: Data, for keys: [Key], version: Version = .gcmOAEP) throws -> MultiRecipientEncryptedData {
+    do {
+      guard !keys.isEmpty, version.isAuthenticated, version.rsaPadding != nil else {
+        throw PublicError.encryptionFailed
+      }
+
+      // 1. Encrypt content once with AES or ChaCha20-Poly1305
+      let (encryptedData, cipherAttr) = try version.seal(data)
+
+      // 2. Wrap the key and IV with RSA for every recipient
+      let recipients = try keys.map { key in
+        MultiRecipientEncryptedData.Recipient(
+          keyID: try key.publicKeyDigest().hexEncodedString,
+          cipherKey: try wrap(cipherAttr, with: key, version: version).base64EncodedString()
+        )
+      }
+
+      return MultiRecipientEncryptedData(
+        data: encryptedData,
+        recipients: recipients,
+        version: version
+      )
+    } catch {
+      throw PublicError.encryptionFailed
+    }
+  }
+
+  /// Asymetrically decrypts data encrypted for several recipients with the private key of one of them
+  ///
+  /// - Parameters:
+  ///   - multiRecipientEncryptedData: `MultiRecipientEncryptedData` object that contains data, recipients and version
+  ///   - key: RSA private key of one of the recipients
+  /// - Returns: decrypted data
+  /// - Throws: `PublicError.decryptionFailed`, also if the key does not belong to a recipient
+  static func decrypt(multiRecipientEncryptedData: MultiRecipientEncryptedData, with key: Key) throws -> Data {
+    guard
+      let keyID = try? key.publicKeyDigest().hexEncodedString,
+      let encryptedData = multiRecipientEncryptedData.encryptedData(for: keyID)
+    else {
+      throw PublicError.decryptionFailed
+    }
+    return try decrypt(encryptedData: encryptedData, with: key)
+  }
+}
+
+extension Data {
+  /// lowercase hex representation
+  var hexEncodedString: String {
+    return map { String(format: "%02x", $0) }.joined()
+  }
+}
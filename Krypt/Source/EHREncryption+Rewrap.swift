@@ -0,0 +1,124 @@
+//
+//  EHREncryption+Rewrap.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension EHREncryption {
+  /// Wraps the AES key and IV of a record for another key pair, e.g. for key rotation.
+  /// Only the cipher key is replaced, `data` stays byte identical and the version is kept.
+  ///
+  /// - Parameters:
+  ///   - encryptedData: record to re-key
+  ///   - privateKey: RSA private key the record is currently wrapped for
+  ///   - publicKey: RSA public key to wrap for
+  ///   - cache: cache of unwrapped keys, `nil` unwraps with RSA every time
+  /// - Returns: record with the new cipher key
+  /// - Throws: `PublicError.encryptionFailed`
+  static func rewrap(encryptedData: EncryptedData, with privateKey: Key, for publicKey: Key, cache: UnwrappedKeyCache? = nil) throws -> EncryptedData {
+    do {
+      let version = encryptedData.version
+      let cipherAttr = try unwrappedCipherAttr(of: encryptedData, with: privateKey, cache: cache)
+      let wrappedKey = try wrap(cipherAttr, with: publicKey, version: version)
+      return EncryptedData(wrappedKey: .raw(wrappedKey), data: encryptedData.data, version: version)
+    } catch {
+      throw PublicError.encryptionFailed
+    }
+  }
+
+  /// Wraps the AES key and IV of a record for several key pairs, e.g. to grant access.
+  /// The encrypted data is shared, not re-encrypted.
+  ///
+  /// - Parameters:
+  ///   - encryptedData: record to re-key
+  ///   - privateKey: RSA private key the record is currently wrapped for
+  ///   - publicKeys: RSA public keys of the recipients
+  /// - Returns: `MultiRecipientEncryptedData` with one entry per public key
+  /// - Throws: `PublicError.encryptionFailed`
+  static func rewrap(encryptedData: EncryptedData, with privateKey: Key, for publicKeys: [Key]) throws -> MultiRecipientEncryptedData {
+    do {
+      guard !publicKeys.isEmpty else {
+        throw PublicError.encryptionFailed
+      }
+      let version = encryptedData.version
+      let cipherAttr = try unwrappedCipherAttr(of: encryptedData, with: privateKey, cache: nil)
+      let recipients = try publicKeys.map { publicKey in
+        MultiRecipientEncryptedData.Recipient(
+          keyID: try publicKey.publicKeyDigest().hexEncodedString,
+          cipherKey: try wrap(cipherAttr, with: publicKey, version: version).base64EncodedString()
+        )
+      }
+      return MultiRecipientEncryptedData(data: encryptedData.data, recipients: recipients, version: version)
+    } catch {
+      throw PublicError.encryptionFailed
+    }
+  }
+
+  /// Wraps the AES key and IV of an encrypted file for another key pair. The file is not read or written.
+  ///
+  /// - Parameters:
+  ///   - encryptedFile: encrypted file to re-key
+  ///   - privateKey: RSA private key the file is currently wrapped for
+  ///   - publicKey: RSA public key to wrap for
+  /// - Returns: `EncryptedFile` with the same location and the new cipher key
+  /// - Throws: `PublicError.encryptionFailed`
+  static func rewrap(encryptedFile: EncryptedFile, with privateKey: Key, for publicKey: Key) throws -> EncryptedFile {
+    let encryptedData = EncryptedData(cipherKey: encryptedFile.cipherKey, data: Data(), version: encryptedFile.version)
+    let rewrapped = try rewrap(encryptedData: encryptedData, with: privateKey, for: publicKey)
+    return EncryptedFile(cipherKey: rewrapped.cipherKey, url: encryptedFile.url, version: encryptedFile.version)
+  }
+
+  /// Re-keys a stream of records, e.g. all records of a store during key rotation.
+  ///
+  /// The records are read in chunks, the RSA work of a chunk is spread over all cores and the results are passed
+  /// to `handler` in the order of `records` before the next chunk is read. At most `chunkSize` records are held at once.
+  ///
+  /// - Parameters:
+  ///   - records: records to re-key, read once
+  ///   - privateKey: RSA private key the records are currently wrapped for
+  ///   - publicKey: RSA public key to wrap for
+  ///   - chunkSize: number of records processed concurrently
+  ///   - handler: receives every original record with the re-keyed record or `PublicError.encryptionFailed`
+  /// - Throws: rethrows errors of `handler`, which stop the rewrap
+  static func rewrap<Records: Sequence>(
+    _ records: Records,
+    with privateKey: Key,
+    for publicKey: Key,
+    chunkSize: Int = 64,
+    handler: (EncryptedData, Result<EncryptedData, PublicError>) throws -> Void
+  ) rethrows where Records.Element == EncryptedData {
+    var iterator = records.makeIterator()
+    var chunk = [EncryptedData]()
+    chunk.reserveCapacity(max(chunkSize, 1))
+
+    repeat {
+      chunk.removeAll(keepingCapacity: true)
+      while chunk.count < max(chunkSize, 1), let record = iterator.next() {
+        chunk.append(record)
+      }
+
+      let current = chunk
+      let results = ResultSlots<EncryptedData>(count: current.count, initial: .failure(.encryptionFailed))
+      forEachConcurrently(count: current.count) { index in
+        if let rewrapped = try? rewrap(encryptedData: current[index], with: privateKey, for: publicKey) {
+          results[index] = .success(rewrapped)
+        }
+      }
+      for (index, record) in current.enumerated() {
+        try handler(record, results[index])
+      }
+    } while chunk.count == max(chunkSize, 1)
+  }
+}
+
+private extension EHREncryption {
+  static func unwrappedCipherAttr(of encryptedData: EncryptedData, with privateKey: Key, cache: UnwrappedKeyCache?) throws -> CipherAttr {
+    guard let wrappedKey = encryptedData.wrappedKeyData else {
+      throw PublicError.decryptionFailed
+    }
+    return try unwrap(wrappedKey: wrappedKey, with: privateKey, version: encryptedData.version, cache: cache)
+  }
+}
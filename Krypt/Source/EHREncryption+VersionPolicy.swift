@@ -0,0 +1,85 @@
+//
+//  EHREncryption+VersionPolicy.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension EHREncryption {
+  /// How the version of new records is chosen
+  ///
+  /// - fixed: always the given version
+  /// - fastestAEAD: `gcmOAEP` or `chachaPolyOAEP`, whichever bulk cipher is faster on this device, see `aeadBenchmark`
+  enum VersionPolicy {
+    case fixed(Version)
+    case fastestAEAD
+  }
+
+  /// Time AES 256 GCM and ChaCha20-Poly1305 took to encrypt and decrypt the same sample on this device
+  struct AEADBenchmark {
+    /// seconds per round trip with `gcmOAEP`
+    public let gcmOAEP: TimeInterval
+
+    /// seconds per round trip with `chachaPolyOAEP`
+    public let chachaPolyOAEP: TimeInterval
+
+    /// the faster of both versions, `gcmOAEP` on a tie
+    public var fastestVersion: Version {
+      return chachaPolyOAEP < gcmOAEP ? .chachaPolyOAEP : .gcmOAEP
+    }
+  }
+
+  /// Both AEAD ciphers benchmarked once, on first access. Takes a few milliseconds,
+  /// call early (e.g. on app start) to keep the measurement off the first encryption.
+  static let aeadBenchmark = AEADBenchmark(
+    gcmOAEP: roundTripDuration(of: .gcmOAEP),
+    chachaPolyOAEP: roundTripDuration(of: .chachaPolyOAEP)
+  )
+
+  /// Asymetrically encrypts the provided data with the version chosen by the policy.
+  /// Decryption does not need the policy, the version travels with `EncryptedData`.
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - key: RSA public key to encrypts with
+  ///   - policy: how to choose the version
+  /// - Returns: `EncryptedData` object
+  /// - Throws: `PublicError.encryptionFailed`
+  static func encrypt(data: Data, with key: Key, policy: VersionPolicy) throws -> EncryptedData {
+    switch policy {
+    case let .fixed(version):
+      return try encrypt(data: data, with: key, version: version)
+    case .fastestAEAD:
+      return try encrypt(data: data, with: key, version: aeadBenchmark.fastestVersion)
+    }
+  }
+}
+
+private extension EHREncryption {
+  static let benchmarkSampleCount = 64 * 1024
+  static let benchmarkRounds = 5
+
+  /// Fastest of several encrypt and decrypt round trips of a 64 KB sample, after one warm up round.
+  /// Only the bulk cipher is measured, the RSA part is the same for both versions. `seal` and `open` run
+  /// GCM and ChaCha20-Poly1305 through OpenSSL EVP, so both are measured on the same layer records use.
+  static func roundTripDuration(of version: Version) -> TimeInterval {
+    let sample = Data(count: benchmarkSampleCount)
+    var fastest = UInt64.max
+    for round in 0 ... benchmarkRounds {
+      let start = DispatchTime.now().uptimeNanoseconds
+      guard
+        let sealed = try? version.seal(sample),
+        (try? version.open(sealed.encrypted, with: sealed.cipherAttr)) != nil
+      else {
+        return .infinity
+      }
+      let elapsed = DispatchTime.now().uptimeNanoseconds - start
+      if round > 0 {
+        fastest = min(fastest, elapsed)
+      }
+    }
+    return TimeInterval(fastest) / 1_000_000_000
+  }
+}
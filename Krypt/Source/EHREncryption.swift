@@ -13,15 +13,41 @@ public struct EHREncryption {
   ///
   /// - gcmOAEP: AES 256 GCM symetric | RSA OAEP SHA256 asymetric
   /// - cbcPKCS1: AES 256 CBC symetric | RSA PKCS7 asymetric
+  /// - gcmOAEPCompact: AES 256 GCM symetric | RSA OAEP SHA256 asymetric, key and IV wrapped as 48 raw bytes instead of JSON
+  /// - gcmHKDF: AES 256 GCM symetric with key and IV derived by HKDF SHA256 from a `LocalEncryption.MasterKey`,
+  ///   no asymetric part, `cipherKey` holds the salt. Only used by `LocalEncryption`
+  /// - gcmECIES: AES 256 GCM symetric | ECDH P-256 asymetric, key and IV derived by HKDF SHA256 from the shared secret,
+  ///   `cipherKey` holds the ephemeral public key. Needs P-256 keys instead of RSA keys
+  /// - chachaPolyOAEP: ChaCha20-Poly1305 symetric | RSA OAEP SHA256 asymetric, key and 12 bytes nonce wrapped as 44 raw bytes.
+  ///   Faster than AES on CPUs without AES instructions, see `EHREncryption.fastestVersion`
   public enum Version {
     case gcmOAEP
     case cbcPKCS1
+    case gcmOAEPCompact
+    case gcmHKDF
+    case gcmECIES
+    case chachaPolyOAEP
   }
 
   /// I/O object when interacting with EHR E2EE
   public struct EncryptedData {
+    /// RSA encrypted AES key and IV as received or as produced by `EHREncryption.encrypt`
+    enum WrappedKey {
+      case base64(String)
+      case raw(Data)
+    }
+
+    let wrappedKey: WrappedKey
+
     /// base64 encoded
-    public let cipherKey: String
+    public var cipherKey: String {
+      switch wrappedKey {
+      case let .base64(cipherKey):
+        return cipherKey
+      case let .raw(data):
+        return data.base64EncodedString()
+      }
+    }
 
     /// encrypted data
     public let data: Data
@@ -30,10 +56,24 @@ public struct EHREncryption {
     public let version: Version
 
     public init(cipherKey: String, data: Data, version: Version) {
-      self.cipherKey = cipherKey
+      self.init(wrappedKey: .base64(cipherKey), data: data, version: version)
+    }
+
+    init(wrappedKey: WrappedKey, data: Data, version: Version) {
+      self.wrappedKey = wrappedKey
       self.data = data
       self.version = version
     }
+
+    /// RSA encrypted AES key and IV, `nil` if `cipherKey` is not valid base64
+    var wrappedKeyData: Data? {
+      switch wrappedKey {
+      case let .base64(cipherKey):
+        return Data(base64Encoded: cipherKey)
+      case let .raw(data):
+        return data
+      }
+    }
   }
 
   /// Asymetrically encrypts the provided data with AES 256 GCM and RSA OAEP SHA256
@@ -44,23 +84,42 @@ public struct EHREncryption {
   /// - Returns: `EncryptedData` object
   /// - Throws: `PublicError.encryptionFailed`
   public static func encrypt(data: Data, with key: Key) throws -> EncryptedData {
+    return try encrypt(data: data, with: key, version: .gcmOAEP)
+  }
+
+  /// Asymetrically encrypts the provided data with the given version.
+  /// Only the GCM versions are allowed for encryption, `cbcPKCS1` is supported for decryption only.
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - key: RSA public key to encrypts with, P-256 public key for `gcmECIES`
+  ///   - version: `gcmOAEP`, `gcmOAEPCompact`, `chachaPolyOAEP` or `gcmECIES`
+  /// - Returns: `EncryptedData` object
+  /// - Throws: `PublicError.encryptionFailed`
+  public static func encrypt(data: Data, with key: Key, version: Version) throws -> EncryptedData {
     do {
-      // Encrypting only with AES 256 GCM and RSA OAEP SHA256
-      let version = Version.gcmOAEP
+      if version == .gcmECIES {
+        // 1. Agree on the AES key and IV with an ephemeral key pair
+        let (ephemeralPublicKey, cipherAttr) = try ECIES.cipherAttr(for: key)
+
+        // 2. Encrypt content with AES
+        let (encryptedData, _) = try version.seal(data, with: cipherAttr)
 
-      // 1. Encrypt content with AES
-      let (encryptedData, aesKey, aesIV) = try AES256.encrypt(data: data, blockMode: version.aesBlockMode)
+        return EncryptedData(wrappedKey: .raw(ephemeralPublicKey), data: encryptedData, version: version)
+      }
+
+      guard version.isAuthenticated, version.rsaPadding != nil else {
+        throw PublicError.encryptionFailed
+      }
 
-      // 2. Create cipher auth from the AES key and IV
-      let cipherAttr = CipherAttr(key: aesKey, iv: aesIV)
-      let cipherAttrJSONData = try JSONEncoder().encode(cipherAttr)
+      // 1. Encrypt content with AES or ChaCha20-Poly1305
+      let (encryptedData, cipherAttr) = try version.seal(data)
 
-      // 3. Encrypt meta message with RSA
-      let encryptedCipherAttr = try RSA.encrypt(data: cipherAttrJSONData, with: key, padding: version.rsaPadding)
-      let encryptedCipherAttrBase64 = encryptedCipherAttr.base64EncodedString()
+      // 2. Wrap the key and IV with RSA
+      let wrappedKey = try wrap(cipherAttr, with: key, version: version)
 
       return EncryptedData(
-        cipherKey: encryptedCipherAttrBase64,
+        wrappedKey: .raw(wrappedKey),
         data: encryptedData,
         version: version
       )
@@ -77,48 +136,364 @@ public struct EHREncryption {
   /// - Returns: decrypted data
   /// - Throws: `PublicError.decryptionFailed`
   public static func decrypt(encryptedData: EncryptedData, with key: Key) throws -> Data {
+    return try decrypt(encryptedData: encryptedData, with: key, cache: nil)
+  }
+
+  /// Asymetrically decrypts the provided encrypted data depending on the version provided,
+  /// reusing the unwrapped AES key and IV of records that were decrypted before
+  ///
+  /// - Parameters:
+  ///   - encryptedData: `EncryptedData` object that contains data, cipher key and version
+  ///   - key: RSA private key to decrypt with
+  ///   - cache: cache of unwrapped keys, `nil` unwraps with RSA every time
+  /// - Returns: decrypted data
+  /// - Throws: `PublicError.decryptionFailed`
+  public static func decrypt(encryptedData: EncryptedData, with key: Key, cache: UnwrappedKeyCache?) throws -> Data {
     do {
       let version = encryptedData.version
 
-      // 1. Decrypt cipher auth
-      guard let encryptedCipherAuth = Data(base64Encoded: encryptedData.cipherKey) else {
+      // 1. Unwrap the AES key and IV
+      guard let wrappedKey = encryptedData.wrappedKeyData else {
         throw PublicError.decryptionFailed
       }
-      let cipherAttrData = try RSA.decrypt(data: encryptedCipherAuth, with: key, padding: version.rsaPadding)
+      let cipherAttr = try unwrap(wrappedKey: wrappedKey, with: key, version: version, cache: cache)
 
-      // 2. Decode cipher auth with the AES key in IV
-      guard let cipherAttr = try? JSONDecoder().decode(CipherAttr.self, from: cipherAttrData) else {
-        throw PublicError.decryptionFailed
+      // 2. Decrypt content with AES or ChaCha20-Poly1305
+      let decryptedData = try version.open(encryptedData.data, with: cipherAttr)
+
+      return decryptedData
+    } catch {
+      throw PublicError.decryptionFailed
+    }
+  }
+}
+
+// MARK: - Binary envelope
+
+public extension EHREncryption.EncryptedData {
+  /// Serialises version, RSA encrypted cipher key and encrypted data into a single binary blob without any base64:
+  /// `version (1 byte) | cipher key length (2 bytes) | cipher key | data length (4 bytes) | data`, lengths are big endian
+  ///
+  /// - Returns: binary representation, readable with `init(serializedData:)`
+  /// - Throws: `PublicError.encryptionFailed` if `cipherKey` is not base64 or a part does not fit its length field
+  func serializedData() throws -> Data {
+    guard let wrappedKey = wrappedKeyData, wrappedKey.count <= Int(UInt16.max), UInt64(data.count) <= UInt64(UInt32.max) else {
+      throw PublicError.encryptionFailed
+    }
+    var serialized = Data(capacity: 7 + wrappedKey.count + data.count)
+    serialized.append(version.binaryTag)
+    serialized.appendBigEndian(UInt64(wrappedKey.count), byteCount: 2)
+    serialized.append(wrappedKey)
+    serialized.appendBigEndian(UInt64(data.count), byteCount: 4)
+    serialized.append(data)
+    return serialized
+  }
+
+  /// Reads `EncryptedData` from the output of `serializedData()`
+  ///
+  /// - Parameter serializedData: binary representation
+  /// - Throws: `PublicError.decryptionFailed` if the blob is truncated, has trailing bytes or an unknown version
+  init(serializedData: Data) throws {
+    let bytes = [UInt8](serializedData)
+    var offset = 0
+
+    func read(_ count: Int) -> ArraySlice<UInt8>? {
+      guard count <= bytes.count - offset else {
+        return nil
       }
+      defer { offset += count }
+      return bytes[offset ..< offset + count]
+    }
 
-      // 3. Decrypt content with AES
-      let decryptedData = try AES256.decrypt(data: encryptedData.data, key: cipherAttr.key, iv: cipherAttr.iv, blockMode: version.aesBlockMode)
+    func readLength(byteCount: Int) -> Int? {
+      return read(byteCount)?.reduce(0) { $0 << 8 | Int($1) }
+    }
 
-      return decryptedData
+    guard let tag = read(1)?.first,
+      let version = EHREncryption.Version(binaryTag: tag),
+      let wrappedKeyCount = readLength(byteCount: 2),
+      let wrappedKey = read(wrappedKeyCount),
+      let dataCount = readLength(byteCount: 4),
+      let data = read(dataCount),
+      offset == bytes.count else {
+      throw PublicError.decryptionFailed
+    }
+    self.init(wrappedKey: .raw(Data(wrappedKey)), data: Data(data), version: version)
+  }
+}
+
+// MARK: - Files
+
+public extension EHREncryption {
+  /// Result of encrypting a file with EHR E2EE
+  struct EncryptedFile {
+    /// base64 encoded
+    public let cipherKey: String
+
+    /// location of the encrypted file
+    public let url: URL
+
+    /// raw value of `EHREncryption.Version`
+    public let version: Version
+
+    public init(cipherKey: String, url: URL, version: Version) {
+      self.cipherKey = cipherKey
+      self.url = url
+      self.version = version
+    }
+  }
+
+  /// Asymetrically encrypts a file with AES 256 GCM and RSA OAEP SHA256.
+  /// The file is streamed through the cipher, the encrypted file has the same content as `EncryptedData.data`
+  /// would have for the whole file.
+  ///
+  /// - Parameters:
+  ///   - input: URL of the file to encrypt
+  ///   - output: URL of the encrypted file, replaced if it exists
+  ///   - key: RSA public key to encrypts with
+  /// - Returns: `EncryptedFile` object
+  /// - Throws: `PublicError.encryptionFailed`
+  static func encrypt(file input: URL, to output: URL, with key: Key) throws -> EncryptedFile {
+    do {
+      let version = Version.gcmOAEP
+      let (aesKey, aesIV) = try AES256.encrypt(file: input, to: output, blockMode: .gcm)
+      let cipherKey = try wrap(CipherAttr(key: aesKey, iv: aesIV), with: key, version: version).base64EncodedString()
+      return EncryptedFile(cipherKey: cipherKey, url: output, version: version)
     } catch {
+      try? FileManager.default.removeItem(at: output)
+      throw PublicError.encryptionFailed
+    }
+  }
+
+  /// Asymetrically decrypts an encrypted file depending on the version provided
+  ///
+  /// - Parameters:
+  ///   - encryptedFile: `EncryptedFile` object that contains location, cipher key and version
+  ///   - output: URL of the decrypted file, replaced if it exists
+  ///   - key: RSA private key to decrypt with
+  /// - Throws: `PublicError.decryptionFailed`
+  static func decrypt(encryptedFile: EncryptedFile, to output: URL, with key: Key) throws {
+    do {
+      let version = encryptedFile.version
+      guard let wrappedKey = Data(base64Encoded: encryptedFile.cipherKey) else {
+        throw PublicError.decryptionFailed
+      }
+      guard let blockMode = version.aesBlockMode else {
+        throw PublicError.decryptionFailed
+      }
+      let cipherAttr = try unwrap(wrappedKey: wrappedKey, with: key, version: version)
+      try AES256.decrypt(file: encryptedFile.url, to: output, key: cipherAttr.key, iv: cipherAttr.iv, blockMode: blockMode)
+    } catch {
+      throw PublicError.decryptionFailed
+    }
+  }
+}
+
+// MARK: - Key wrapping
+
+extension EHREncryption {
+  /// Encodes the AES key and IV and encrypts them with RSA.
+  /// `gcmOAEPCompact` encrypts the raw key and IV bytes, the other versions the JSON encoded `CipherAttr`.
+  ///
+  /// - Parameters:
+  ///   - cipherAttr: AES key and IV
+  ///   - key: RSA public key to encrypt with
+  ///   - version: version determining the encoding and RSA padding
+  /// - Returns: RSA encrypted cipher key
+  /// - Throws: encoding or RSA errors
+  static func wrap(_ cipherAttr: CipherAttr, with key: Key, version: Version) throws -> Data {
+    let encodedCipherAttr: Data
+    if version.usesCompactCipherAttr {
+      guard let compactCipherAttr = cipherAttr.compactData else {
+        throw PublicError.encryptionFailed
+      }
+      encodedCipherAttr = compactCipherAttr
+    } else {
+      encodedCipherAttr = try JSONEncoder().encode(cipherAttr)
+    }
+    guard let padding = version.rsaPadding else {
+      throw PublicError.encryptionFailed
+    }
+    return try RSA.encrypt(data: encodedCipherAttr, with: key, padding: padding)
+  }
+
+  /// Returns the AES key and IV from the cache or unwraps and caches them
+  ///
+  /// - Parameters:
+  ///   - wrappedKey: RSA encrypted cipher key
+  ///   - key: RSA private key to decrypt with
+  ///   - version: version determining the encoding and RSA padding
+  ///   - cache: cache of unwrapped keys, `nil` always unwraps
+  /// - Returns: AES key and IV
+  /// - Throws: `PublicError.decryptionFailed` or RSA errors
+  static func unwrap(wrappedKey: Data, with key: Key, version: Version, cache: UnwrappedKeyCache?) throws -> CipherAttr {
+    guard let cache = cache, let identifier = cache.identifier(wrappedKey: wrappedKey, key: key, version: version) else {
+      return try unwrap(wrappedKey: wrappedKey, with: key, version: version)
+    }
+    if let cipherAttr = cache.cipherAttr(for: identifier) {
+      return cipherAttr
+    }
+    let cipherAttr = try unwrap(wrappedKey: wrappedKey, with: key, version: version)
+    cache.insert(cipherAttr, for: identifier)
+    return cipherAttr
+  }
+
+  /// Decrypts the cipher key with RSA and decodes the AES key and IV
+  ///
+  /// - Parameters:
+  ///   - wrappedKey: RSA encrypted cipher key
+  ///   - key: RSA private key to decrypt with, P-256 private key for `gcmECIES`
+  ///   - version: version determining the encoding and RSA padding
+  /// - Returns: AES key and IV
+  /// - Throws: `PublicError.decryptionFailed` or RSA errors
+  static func unwrap(wrappedKey: Data, with key: Key, version: Version) throws -> CipherAttr {
+    if version == .gcmECIES {
+      // the ephemeral public key takes the place of the RSA encrypted cipher key
+      return try ECIES.cipherAttr(ephemeralPublicKey: wrappedKey, with: key)
+    }
+    guard let padding = version.rsaPadding else {
       throw PublicError.decryptionFailed
     }
+    let cipherAttrData = try RSA.decrypt(data: wrappedKey, with: key, padding: padding)
+
+    let cipherAttr: CipherAttr?
+    if version.usesCompactCipherAttr {
+      cipherAttr = CipherAttr(compactData: cipherAttrData, ivCount: version.ivCount)
+    } else {
+      cipherAttr = CipherAttr(json: cipherAttrData)
+    }
+    guard let decodedCipherAttr = cipherAttr else {
+      throw PublicError.decryptionFailed
+    }
+    return decodedCipherAttr
   }
 }
 
-private extension EHREncryption.Version {
-  /// returns AES block mode depending on Vivy encryption version
-  var aesBlockMode: AES256.BlockMode {
+extension EHREncryption.Version {
+  /// identifies the version in `EncryptedData.serializedData()` and in `UnwrappedKeyCache` identifiers
+  var binaryTag: UInt8 {
     switch self {
     case .gcmOAEP:
+      return 1
+    case .cbcPKCS1:
+      return 2
+    case .gcmOAEPCompact:
+      return 3
+    case .gcmHKDF:
+      return 4
+    case .gcmECIES:
+      return 5
+    case .chachaPolyOAEP:
+      return 6
+    }
+  }
+
+  init?(binaryTag: UInt8) {
+    switch binaryTag {
+    case 1:
+      self = .gcmOAEP
+    case 2:
+      self = .cbcPKCS1
+    case 3:
+      self = .gcmOAEPCompact
+    case 4:
+      self = .gcmHKDF
+    case 5:
+      self = .gcmECIES
+    case 6:
+      self = .chachaPolyOAEP
+    default:
+      return nil
+    }
+  }
+
+  /// returns AES block mode depending on Vivy encryption version, `nil` if the content is not encrypted with AES
+  var aesBlockMode: AES256.BlockMode? {
+    switch self {
+    case .gcmOAEP, .gcmOAEPCompact, .gcmHKDF, .gcmECIES:
       return .gcm
     case .cbcPKCS1:
       return .cbc
+    case .chachaPolyOAEP:
+      return nil
+    }
+  }
+
+  /// whether the content is encrypted with an AEAD cipher, only those versions are used for new records
+  var isAuthenticated: Bool {
+    return aesBlockMode == .gcm || self == .chachaPolyOAEP
+  }
+
+  /// length of the IV, or the nonce for ChaCha20-Poly1305
+  var ivCount: Int {
+    return self == .chachaPolyOAEP ? CipherAttr.nonceCount : CipherAttr.ivCount
+  }
+
+  /// Encrypts the content with the symetric cipher of the version.
+  /// GCM with 16 bytes IVs and ChaCha20-Poly1305 both run through OpenSSL EVP, CBC through CommonCrypto.
+  /// GCM with other IV lengths stays on CryptoSwift, the EVP contexts are configured for 16 bytes IVs.
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - cipherAttr: key and IV, random if `nil`
+  /// - Returns: tuple of encrypted data and the key and IV used
+  /// - Throws: `AES256.Error` or `ChaCha20Poly1305.Error`
+  func seal(_ data: Data, with cipherAttr: CipherAttr? = nil) throws -> (encrypted: Data, cipherAttr: CipherAttr) {
+    guard let blockMode = aesBlockMode else {
+      let (encrypted, key, nonce) = try ChaCha20Poly1305.encrypt(data: data, key: cipherAttr?.key, nonce: cipherAttr?.iv)
+      return (encrypted, CipherAttr(key: key, iv: nonce))
+    }
+    let (encrypted, key, iv) = blockMode == .gcm && Version.evpSupports(iv: cipherAttr?.iv)
+      ? try AES256.encryptEVP(data: data, key: cipherAttr?.key, iv: cipherAttr?.iv, blockMode: blockMode)
+      : try AES256.encrypt(data: data, key: cipherAttr?.key, iv: cipherAttr?.iv, blockMode: blockMode)
+    return (encrypted, CipherAttr(key: key, iv: iv))
+  }
+
+  /// Decrypts the content with the symetric cipher of the version, GCM records with IVs other than 16 bytes,
+  /// e.g. 12 bytes, through CryptoSwift
+  ///
+  /// - Parameters:
+  ///   - data: encrypted data
+  ///   - cipherAttr: key and IV
+  /// - Returns: decrypted data
+  /// - Throws: `AES256.Error` or `ChaCha20Poly1305.Error`
+  func open(_ data: Data, with cipherAttr: CipherAttr) throws -> Data {
+    guard let blockMode = aesBlockMode else {
+      return try ChaCha20Poly1305.decrypt(data: data, key: cipherAttr.key, nonce: cipherAttr.iv)
+    }
+    if blockMode == .gcm && Version.evpSupports(iv: cipherAttr.iv) {
+      return try AES256.decryptEVP(data: data, key: cipherAttr.key, iv: cipherAttr.iv, blockMode: blockMode)
     }
+    return try AES256.decrypt(data: data, key: cipherAttr.key, iv: cipherAttr.iv, blockMode: blockMode)
   }
 
-  /// returns RSA padding depending on Vivy encryption version
-  var rsaPadding: RSA.Padding {
+  /// whether the OpenSSL EVP path handles the IV, `nil` means a random IV of the default length
+  private static func evpSupports(iv: Data?) -> Bool {
+    return iv.map { $0.count == CipherAttr.ivCount } ?? true
+  }
+
+  /// returns RSA padding depending on Vivy encryption version, `nil` if the key is not wrapped with RSA
+  var rsaPadding: RSA.Padding? {
     switch self {
-    case .gcmOAEP:
+    case .gcmOAEP, .gcmOAEPCompact, .chachaPolyOAEP:
       return .oaep
     case .cbcPKCS1:
       return .pkcs1
+    case .gcmHKDF, .gcmECIES:
+      return nil
+    }
+  }
+
+  /// whether the AES key and IV are wrapped as raw bytes instead of JSON
+  var usesCompactCipherAttr: Bool {
+    return self == .gcmOAEPCompact || self == .chachaPolyOAEP
+  }
+}
+
+private extension Data {
+  mutating func appendBigEndian(_ value: UInt64, byteCount: Int) {
+    for shift in stride(from: (byteCount - 1) * 8, through: 0, by: -8) {
+      append(UInt8(truncatingIfNeeded: value >> UInt64(shift)))
     }
   }
 }
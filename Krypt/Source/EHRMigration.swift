@@ -0,0 +1,262 @@
+//
+//  EHRMigration.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Migrates legacy `cbcPKCS1` records to `gcmOAEP`.
+///
+/// Records are read from a sequence in chunks bounded by count and size, the chunks are decrypted and re-encrypted
+/// on all cores and the migrated records are handed out in the order of the sequence.
+/// The number of handled records is stored in a checkpoint file, so an interrupted migration continues
+/// where it stopped when it is started again with the same sequence.
+public final class EHRMigration {
+  public enum Error: LocalizedError {
+    /// the checkpoint file exists but can not be read
+    case invalidCheckpoint
+    /// the record at the checkpoint position is not the one the checkpoint was written for
+    case checkpointMismatch
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  /// Record of the store to migrate
+  public struct Record {
+    /// stable identifier, used to validate the checkpoint
+    public let id: String
+
+    public let encryptedData: EHREncryption.EncryptedData
+
+    public init(id: String, encryptedData: EHREncryption.EncryptedData) {
+      self.id = id
+      self.encryptedData = encryptedData
+    }
+  }
+
+  public struct Configuration {
+    /// maximum number of records in flight
+    public var maxRecordsInFlight: Int
+
+    /// maximum size of the encrypted data in flight, a single larger record is still processed alone
+    public var maxBytesInFlight: Int
+
+    /// file storing the position of the migration, `nil` to not resume
+    public var checkpointURL: URL?
+
+    /// number of handled records after which the checkpoint is written
+    public var checkpointInterval: Int
+
+    public init(
+      maxRecordsInFlight: Int = 4 * ProcessInfo.processInfo.activeProcessorCount,
+      maxBytesInFlight: Int = 64 * 1024 * 1024,
+      checkpointURL: URL? = nil,
+      checkpointInterval: Int = 1000
+    ) {
+      self.maxRecordsInFlight = maxRecordsInFlight
+      self.maxBytesInFlight = maxBytesInFlight
+      self.checkpointURL = checkpointURL
+      self.checkpointInterval = checkpointInterval
+    }
+  }
+
+  /// Progress and throughput of a migration run
+  public struct Progress {
+    /// records handled since the start of the store, including the ones handled before a resume
+    public let position: Int
+    /// records migrated in this run
+    public let migrated: Int
+    /// records in this run that were not `cbcPKCS1` and were left untouched
+    public let skipped: Int
+    /// records in this run that could not be migrated
+    public let failed: Int
+    /// size of the encrypted data read in this run
+    public let bytes: Int
+    /// duration of this run in seconds
+    public let elapsed: TimeInterval
+
+    public var recordsPerSecond: Double {
+      return elapsed > 0 ? Double(migrated + skipped + failed) / elapsed : 0
+    }
+
+    public var bytesPerSecond: Double {
+      return elapsed > 0 ? Double(bytes) / elapsed : 0
+    }
+  }
+
+  private let privateKey: Key
+  private let publicKey: Key
+  private let configuration: Configuration
+
+  /// Creates a migration between key objects that are parsed already
+  ///
+  /// - Parameters:
+  ///   - privateKey: RSA private key the legacy records are wrapped for
+  ///   - publicKey: RSA public key to wrap the migrated records for
+  ///   - configuration: limits and checkpoint
+  public init(privateKey: Key, publicKey: Key, configuration: Configuration = Configuration()) {
+    self.privateKey = privateKey
+    self.publicKey = publicKey
+    self.configuration = configuration
+  }
+
+  /// Creates a migration parsing both PEM keys once
+  ///
+  /// - Parameters:
+  ///   - privateKeyPEM: RSA private key in PKCS#1 or PKCS#8 PEM
+  ///   - publicKeyPEM: RSA public key in PKCS#1 or PKCS#8 PEM
+  ///   - configuration: limits and checkpoint
+  /// - Throws: any errors that can occur while parsing the keys
+  public convenience init(privateKeyPEM: Data, publicKeyPEM: Data, configuration: Configuration = Configuration()) throws {
+    self.init(
+      privateKey: try Key(pem: privateKeyPEM, access: .private),
+      publicKey: try Key(pem: publicKeyPEM, access: .public),
+      configuration: configuration
+    )
+  }
+
+  /// Migrates all `cbcPKCS1` records of the sequence.
+  /// When a checkpoint exists, the records before its position are skipped without being decrypted.
+  ///
+  /// - Parameters:
+  ///   - records: records of the store, always in the same order
+  ///   - progress: called after every chunk
+  ///   - handler: receives every `cbcPKCS1` record with the `gcmOAEP` record or the `PublicError` of the failed step
+  /// - Returns: progress at the end of the run
+  /// - Throws: `Error` for an invalid checkpoint, errors of `handler` which stop the migration
+  @discardableResult
+  public func migrate<Records: Sequence>(
+    _ records: Records,
+    progress: ((Progress) -> Void)? = nil,
+    handler: (Record, Result<EHREncryption.EncryptedData, PublicError>) throws -> Void
+  ) throws -> Progress where Records.Element == Record {
+    let start = DispatchTime.now().uptimeNanoseconds
+    var iterator = records.makeIterator()
+    var counters = Counters(position: 0)
+
+    let checkpoint = try readCheckpoint()
+    if let checkpoint = checkpoint {
+      var lastSkipped: Record?
+      while counters.position < checkpoint.position, let record = iterator.next() {
+        lastSkipped = record
+        counters.position += 1
+      }
+      guard counters.position == checkpoint.position, lastSkipped?.id == checkpoint.lastRecordID else {
+        throw Error.checkpointMismatch
+      }
+    }
+
+    var lastRecordID = checkpoint?.lastRecordID
+    var checkpointPosition = counters.position
+    defer {
+      if counters.position != checkpointPosition {
+        try? writeCheckpoint(Checkpoint(position: counters.position, lastRecordID: lastRecordID))
+      }
+    }
+
+    var pending: Record? = iterator.next()
+    while pending != nil {
+      // 1. Read a chunk within the limits
+      var chunk = [Record]()
+      var chunkBytes = 0
+      while let record = pending,
+        chunk.isEmpty || (chunk.count < configuration.maxRecordsInFlight && chunkBytes + record.encryptedData.data.count <= configuration.maxBytesInFlight) {
+        chunk.append(record)
+        chunkBytes += record.encryptedData.data.count
+        pending = iterator.next()
+      }
+
+      // 2. Migrate the chunk on all cores
+      let results = migrate(chunk)
+
+      // 3. Hand out the results in order
+      for (index, record) in chunk.enumerated() {
+        counters.bytes += record.encryptedData.data.count
+        if let result = results[index] {
+          try handler(record, result)
+          if case .success = result {
+            counters.migrated += 1
+          } else {
+            counters.failed += 1
+          }
+        } else {
+          counters.skipped += 1
+        }
+        counters.position += 1
+        lastRecordID = record.id
+      }
+
+      if counters.position - checkpointPosition >= configuration.checkpointInterval {
+        try? writeCheckpoint(Checkpoint(position: counters.position, lastRecordID: lastRecordID))
+        checkpointPosition = counters.position
+      }
+      progress?(counters.progress(since: start))
+    }
+    return counters.progress(since: start)
+  }
+}
+
+private extension EHRMigration {
+  struct Checkpoint: Codable {
+    let position: Int
+    let lastRecordID: String?
+  }
+
+  struct Counters {
+    var position: Int
+    var migrated = 0
+    var skipped = 0
+    var failed = 0
+    var bytes = 0
+
+    init(position: Int) {
+      self.position = position
+    }
+
+    func progress(since start: UInt64) -> Progress {
+      let elapsed = TimeInterval(DispatchTime.now().uptimeNanoseconds - start) / 1_000_000_000
+      return Progress(position: position, migrated: migrated, skipped: skipped, failed: failed, bytes: bytes, elapsed: elapsed)
+    }
+  }
+
+  /// Migrates the records concurrently, `nil` for records that are not `cbcPKCS1`
+  func migrate(_ chunk: [Record]) -> [Result<EHREncryption.EncryptedData, PublicError>?] {
+    let results = EHREncryption.ResultSlots<EHREncryption.EncryptedData>(count: chunk.count, initial: .failure(.decryptionFailed))
+    EHREncryption.forEachConcurrently(count: chunk.count) { index in
+      let encryptedData = chunk[index].encryptedData
+      guard encryptedData.version == .cbcPKCS1 else {
+        return
+      }
+      do {
+        let decrypted = try EHREncryption.decrypt(encryptedData: encryptedData, with: privateKey)
+        results[index] = .success(try EHREncryption.encrypt(data: decrypted, with: publicKey, version: .gcmOAEP))
+      } catch {
+        results[index] = .failure(error as? PublicError ?? .decryptionFailed)
+      }
+    }
+    return chunk.enumerated().map { index, record in
+      record.encryptedData.version == .cbcPKCS1 ? results[index] : nil
+    }
+  }
+
+  func readCheckpoint() throws -> Checkpoint? {
+    guard let url = configuration.checkpointURL, FileManager.default.fileExists(atPath: url.path) else {
+      return nil
+    }
+    guard let data = try? Data(contentsOf: url), let checkpoint = try? JSONDecoder().decode(Checkpoint.self, from: data) else {
+      throw Error.invalidCheckpoint
+    }
+    return checkpoint
+  }
+
+  func writeCheckpoint(_ checkpoint: Checkpoint) throws {
+    guard let url = configuration.checkpointURL else {
+      return
+    }
+    try JSONEncoder().encode(checkpoint).write(to: url, options: .atomic)
+  }
+}
@@ -82,13 +82,18 @@ public extension Key {
   /// Initializes `Key` from PEM string
   ///
   /// - Parameters:
-  ///   - pem: `String` in PKCS#1 or PKCS#8
+  ///   - pem: `String` in PKCS#1 or PKCS#8, EC private keys in SEC1 ("EC PRIVATE KEY")
   ///   - type: `Type` of key to expect
   ///   - access: `Access` level of the key
   /// - Throws: any errors that can occur while converting the key from PEM -> DER -> SecKey
   convenience init(pem: String, type: Type, access: Access, size: Size) throws {
     if access == .public, let secKey = pem.publicKey {
       self.init(key: secKey, access: access)
+    } else if type == .ecSECPrimeRandom, access == .private {
+      guard let der = PEMConverter.convertECPrivateKeyPEMToX963(pem) else {
+        throw KeyError.invalidPEMData
+      }
+      try self.init(der: der, type: type, access: access, size: size)
     } else {
       guard let der = PEMConverter.convertPEMToDER(pem) else {
         throw KeyError.invalidPEMData
@@ -125,7 +130,7 @@ public extension Key {
 
   /// Converts the underlying `secRef` to PEM
   ///
-  /// - Returns: `String` in PKCS#1 PEM
+  /// - Returns: `String` in PKCS#1 PEM, SEC1 PEM for EC private keys
   /// - Throws: errors occuring during `SecKeyCopyExternalRepresentation`
   func convertedToPEM() throws -> String {
     let der = try convertedToDER()
@@ -145,6 +150,23 @@ public extension Key {
 
     return try Key(der: der, access: .public)
   }
+
+  /// Identifies the key pair: SHA256 of the public key in PKCS#1 DER format.
+  /// The public and the private key of a pair have the same digest.
+  ///
+  /// - Returns: 32 bytes digest
+  /// - Throws: `KeyError.failedToDerivePublicKey` if the public key cannot be derived or exported
+  func publicKeyDigest() throws -> Data {
+    let publicKey = access == .public ? secRef : SecKeyCopyPublicKey(secRef)
+    guard
+      let publicSecKey = publicKey,
+      let der = SecKeyCopyExternalRepresentation(publicSecKey, nil) as Data?,
+      let digest = SHA256.digest(der)
+    else {
+      throw KeyError.failedToDerivePublicKey
+    }
+    return digest
+  }
 }
 
 private extension Key {
@@ -241,10 +263,7 @@ private extension CFDictionary {
 
 private extension String {
   var publicKey: SecKey? {
-    guard let certPEM = X509.wrap(publicKeyPEM: self) else {
-      return nil
-    }
-    guard let certDER = PEMConverter.convertPEMToDER(certPEM) else {
+    guard let certDER = X509.wrapDER(publicKeyPEM: self) else {
       return nil
     }
     guard let cert = SecCertificateCreateWithData(nil, certDER as CFData) else {
@@ -0,0 +1,155 @@
+//
+//  KeyPool.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Pool of pre-generated private keys, e.g. for the registration flow where a new key and a CSR are created.
+///
+/// Generating an RSA 4096 key takes seconds with a high variance, so low priority background threads keep
+/// `capacity` keys ready and refill the pool after every `take()`. Taking a key from a non empty pool is O(1),
+/// from an empty pool the key is generated on the calling thread with the RSA prime search spread over all processors
+/// (counted in `Statistics.misses`).
+public final class KeyPool {
+  public enum KeyType {
+    case rsa2048
+    case rsa4096
+    case p256
+  }
+
+  public enum Error: LocalizedError {
+    case creationFailed
+    case generationFailed
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  public struct Statistics {
+    /// keys ready to be taken
+    public let depth: Int
+    /// number of keys the pool keeps ready
+    public let capacity: Int
+    public let threadCount: Int
+    /// keys generated, in the background and on misses
+    public let generated: UInt
+    public let taken: UInt
+    /// keys generated on the calling thread because the pool was empty
+    public let misses: UInt
+    /// background generations that failed, the background threads back off after each
+    public let failures: UInt
+    /// mean generation time in seconds
+    public let meanGenerationTime: TimeInterval
+    public let minGenerationTime: TimeInterval
+    public let maxGenerationTime: TimeInterval
+  }
+
+  public let keyType: KeyType
+  private let pool: OpaquePointer
+
+  /// Creates a pool and starts filling it in the background
+  ///
+  /// - Parameters:
+  ///   - keyType: type of the generated keys
+  ///   - capacity: number of keys to keep ready
+  ///   - threadCount: number of background threads generating keys
+  /// - Throws: `creationFailed`
+  public init(keyType: KeyType, capacity: Int = 2, threadCount: Int = 1) throws {
+    guard capacity > 0, threadCount > 0, let pool = key_pool_new(keyType.poolType, capacity, Int32(threadCount)) else {
+      throw Error.creationFailed
+    }
+    self.keyType = keyType
+    self.pool = pool
+  }
+
+  /// Stops the background threads, a running generation is finished first
+  deinit {
+    key_pool_free(pool)
+  }
+
+  /// Takes a private key out of the pool
+  ///
+  /// - Returns: private key, usable with `CSR.create(with:attributes:)`
+  /// - Throws: `generationFailed` or `KeyError.creatingSecKey`
+  public func take() throws -> Key {
+    var der = Data(count: Int(KEY_POOL_MAX_DER_LENGTH))
+    defer { der.resetBytes(in: 0 ..< der.count) }
+    var length = 0
+    let status = der.withUnsafeMutableBytes { derBuffer in
+      key_pool_take_der(pool, derBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self), derBuffer.count, &length, nil)
+    }
+    guard status == 1 else {
+      throw Error.generationFailed
+    }
+    return try Key(der: der.prefix(length), type: keyType.type, access: .private, size: keyType.size)
+  }
+
+  /// Takes a private key out of the pool as PKCS#8 PEM, the format `createCSR` reads
+  ///
+  /// - Returns: private key in PEM format
+  /// - Throws: `generationFailed`
+  public func takePEM() throws -> String {
+    guard let pem = key_pool_take_pem(pool, nil) else {
+      throw Error.generationFailed
+    }
+    defer {
+      memset(pem, 0, strlen(pem))
+      free(pem)
+    }
+    return String(cString: pem)
+  }
+
+  public var statistics: Statistics {
+    var stats = Key_pool_stats()
+    key_pool_get_stats(pool, &stats)
+    return Statistics(
+      depth: stats.depth,
+      capacity: stats.capacity,
+      threadCount: Int(stats.threads),
+      generated: UInt(stats.generated),
+      taken: UInt(stats.taken),
+      misses: UInt(stats.misses),
+      failures: UInt(stats.failures),
+      meanGenerationTime: stats.generated > 0 ? stats.generation_total_us / Double(stats.generated) / 1_000_000 : 0,
+      minGenerationTime: stats.generation_min_us / 1_000_000,
+      maxGenerationTime: stats.generation_max_us / 1_000_000
+    )
+  }
+}
+
+private extension KeyPool.KeyType {
+  var poolType: Key_pool_type {
+    switch self {
+    case .rsa2048:
+      return Key_pool_type_rsa_2048
+    case .rsa4096:
+      return Key_pool_type_rsa_4096
+    case .p256:
+      return Key_pool_type_ec_p256
+    }
+  }
+
+  var type: Key.`Type` {
+    switch self {
+    case .rsa2048, .rsa4096:
+      return .rsa
+    case .p256:
+      return .ecSECPrimeRandom
+    }
+  }
+
+  var size: Key.Size {
+    switch self {
+    case .rsa2048:
+      return .bit_2048
+    case .rsa4096:
+      return .bit_4096
+    case .p256:
+      return .bit_256
+    }
+  }
+}
@@ -16,3 +16,158 @@ public struct LocalEncryption {
     return try EHREncryption.decrypt(encryptedData: encryptedData, with: key)
   }
 }
+
+// MARK: - Master key
+
+public extension LocalEncryption {
+  /// Symmetric key for data that never leaves the device.
+  /// Every item is encrypted with its own AES key and IV derived by HKDF SHA256 from the master key and a random salt,
+  /// so there is no RSA operation per item. The master key itself is stored wrapped with RSA and unwrapped once per session.
+  ///
+  /// The key bytes are kept in memory locked against swapping when the process is allowed to (see `isLocked`)
+  /// and zeroed when the object is released.
+  final class MasterKey {
+    public enum Error: LocalizedError {
+      case invalidKeyLength
+      case derivationFailed
+
+      public var errorDescription: String? {
+        return String(describing: self)
+      }
+    }
+
+    static let keyCount = 32
+    static let saltCount = 32
+    static let info = Data("Krypt LocalEncryption gcmHKDF".utf8)
+
+    private let bytes: UnsafeMutableRawBufferPointer
+
+    /// true if the key bytes are locked against swapping, false if `mlock` was not permitted
+    public let isLocked: Bool
+
+    /// Creates a master key from raw key bytes
+    ///
+    /// - Parameter data: 32 bytes key
+    /// - Throws: `invalidKeyLength`
+    public init(data: Data) throws {
+      guard data.count == MasterKey.keyCount else {
+        throw Error.invalidKeyLength
+      }
+      bytes = UnsafeMutableRawBufferPointer.allocate(byteCount: MasterKey.keyCount, alignment: MemoryLayout<UInt64>.alignment)
+      isLocked = mlock(bytes.baseAddress, bytes.count) == 0
+      data.withUnsafeBytes { bytes.copyMemory(from: $0) }
+    }
+
+    /// Unwraps a master key stored with `wrapped(with:)`
+    ///
+    /// - Parameters:
+    ///   - wrapped: wrapped master key
+    ///   - key: RSA private key to unwrap with
+    /// - Throws: `PublicError.decryptionFailed` or `invalidKeyLength`
+    public convenience init(wrapped: EHREncryption.EncryptedData, with key: Key) throws {
+      var data = try EHREncryption.decrypt(encryptedData: wrapped, with: key)
+      defer { data.resetBytes(in: 0 ..< data.count) }
+      try self.init(data: data)
+    }
+
+    deinit {
+      memset_s(bytes.baseAddress, bytes.count, 0, bytes.count)
+      if isLocked {
+        munlock(bytes.baseAddress, bytes.count)
+      }
+      bytes.deallocate()
+    }
+
+    /// Generates a random master key
+    ///
+    /// - Returns: new master key
+    public static func generate() -> MasterKey {
+      var data = AES256.randomData(count: keyCount)
+      defer { data.resetBytes(in: 0 ..< data.count) }
+      return try! MasterKey(data: data)
+    }
+
+    /// Wraps the master key with RSA for storage
+    ///
+    /// - Parameter key: RSA public key to wrap with
+    /// - Returns: wrapped master key, readable with `init(wrapped:with:)`
+    /// - Throws: `PublicError.encryptionFailed`
+    public func wrapped(with key: Key) throws -> EHREncryption.EncryptedData {
+      var raw = Data(bytes)
+      defer { raw.resetBytes(in: 0 ..< raw.count) }
+      return try EHREncryption.encrypt(data: raw, with: key, version: .gcmOAEPCompact)
+    }
+
+    /// Derives the AES key and IV of one item
+    ///
+    /// - Parameter salt: salt of the item
+    /// - Returns: 32 bytes AES key and 16 bytes IV
+    /// - Throws: `derivationFailed`
+    func cipherAttr(salt: Data) throws -> CipherAttr {
+      var derived = Data(count: CipherAttr.keyCount + CipherAttr.ivCount)
+      defer { derived.resetBytes(in: 0 ..< derived.count) }
+      let status = salt.withUnsafeBytes { saltBuffer in
+        MasterKey.info.withUnsafeBytes { infoBuffer in
+          derived.withUnsafeMutableBytes { derivedBuffer in
+            hkdf_sha256(
+              bytes.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              bytes.count,
+              saltBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              saltBuffer.count,
+              infoBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              infoBuffer.count,
+              derivedBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+              derivedBuffer.count
+            )
+          }
+        }
+      }
+      guard status == 1, let cipherAttr = CipherAttr(compactData: derived) else {
+        throw Error.derivationFailed
+      }
+      return cipherAttr
+    }
+  }
+
+  /// Symetrically encrypts the provided data with AES 256 GCM through OpenSSL like the other GCM versions,
+  /// the key and IV are derived from the master key and a random per item salt
+  ///
+  /// - Parameters:
+  ///   - data: data to encrypt
+  ///   - masterKey: master key of the session
+  /// - Returns: `EncryptedData` object with version `gcmHKDF`, `cipherKey` holds the salt
+  /// - Throws: `PublicError.encryptionFailed`
+  static func encrypt(data: Data, with masterKey: MasterKey) throws -> EHREncryption.EncryptedData {
+    do {
+      let salt = AES256.randomData(count: MasterKey.saltCount)
+      let cipherAttr = try masterKey.cipherAttr(salt: salt)
+      let (encrypted, _) = try EHREncryption.Version.gcmHKDF.seal(data, with: cipherAttr)
+      return EHREncryption.EncryptedData(wrappedKey: .raw(salt), data: encrypted, version: .gcmHKDF)
+    } catch {
+      throw PublicError.encryptionFailed
+    }
+  }
+
+  /// Symetrically decrypts data encrypted with `encrypt(data:with:)` and a master key
+  ///
+  /// - Parameters:
+  ///   - encryptedData: `EncryptedData` object with version `gcmHKDF`
+  ///   - masterKey: master key the data was encrypted with
+  /// - Returns: decrypted data
+  /// - Throws: `PublicError.decryptionFailed`
+  static func decrypt(encryptedData: EHREncryption.EncryptedData, with masterKey: MasterKey) throws -> Data {
+    do {
+      guard
+        encryptedData.version == .gcmHKDF,
+        let salt = encryptedData.wrappedKeyData,
+        salt.count == MasterKey.saltCount
+      else {
+        throw PublicError.decryptionFailed
+      }
+      let cipherAttr = try masterKey.cipherAttr(salt: salt)
+      return try EHREncryption.Version.gcmHKDF.open(encryptedData.data, with: cipherAttr)
+    } catch {
+      throw PublicError.decryptionFailed
+    }
+  }
+}
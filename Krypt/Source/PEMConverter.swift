@@ -19,7 +19,15 @@ struct PEMConverter {
     return Data(base64Encoded: stripped)
   }
 
-  /// Converts DER to `PKCS1`
+  /// Converts an "EC PRIVATE KEY" PEM (SEC1) of a P-256 key to the X9.63 form `SecKeyCreateWithData` expects
+  ///
+  /// - Parameter pem: SEC1 PEM including the optional public key
+  /// - Returns: 04 || X || Y || D, nil if the PEM is not a P-256 SEC1 key with public key
+  static func convertECPrivateKeyPEMToX963(_ pem: String) -> Data? {
+    return convertPEMToDER(pem)?.ecPrivateKeyX963
+  }
+
+  /// Converts DER to `PKCS1`, for EC private keys from `SecKeyCopyExternalRepresentation` to SEC1
   ///
   /// - Parameters:
   ///   - der: DER data
@@ -27,6 +35,11 @@ struct PEMConverter {
   /// - Returns: PEM representation of DER
   static func convertDER(_ der: Data, toPEMFormat format: PEMFormat) throws -> String {
     switch format.standard {
+    case .pkcs1 where format.contentType == .ec && format.keyAccess != .public:
+      guard let sec1 = der.ecPrivateKeySEC1DER else {
+        throw PEMConverterError.invalidDERData
+      }
+      return try wrapDER(sec1, inPEMFormat: format)
     case .pkcs1, .pkcs12:
       return try wrapDER(der, inPEMFormat: format)
     case .pkcs8:
@@ -144,6 +157,40 @@ private extension PEMFormat {
 }
 
 private extension Data {
+  /// SEC1 ECPrivateKey of a P-256 key without the 32 bytes scalar and the 65 bytes public point:
+  /// SEQUENCE { INTEGER 1, OCTET STRING d, [0] prime256v1, [1] BIT STRING point }
+  static let ecPrivateKeySEC1Prefix: [UInt8] = [0x30, 0x77, 0x02, 0x01, 0x01, 0x04, 0x20]
+  static let ecPrivateKeySEC1Infix: [UInt8] = [0xA0, 0x0A, 0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07, 0xA1, 0x44, 0x03, 0x42, 0x00]
+  static let ecP256PointCount = 65
+  static let ecP256ScalarCount = 32
+
+  /// SEC1 DER of a P-256 private key in X9.63 form, 04 || X || Y || D as exported by `SecKeyCopyExternalRepresentation`
+  var ecPrivateKeySEC1DER: Data? {
+    guard count == Data.ecP256PointCount + Data.ecP256ScalarCount, first == 0x04 else {
+      return nil
+    }
+    let bytes = [UInt8](self)
+    let point = bytes[0 ..< Data.ecP256PointCount]
+    let scalar = bytes[Data.ecP256PointCount...]
+    return Data(Data.ecPrivateKeySEC1Prefix + scalar + Data.ecPrivateKeySEC1Infix + point)
+  }
+
+  /// X9.63 form of a P-256 SEC1 DER private key, the inverse of `ecPrivateKeySEC1DER`
+  var ecPrivateKeyX963: Data? {
+    let prefixCount = Data.ecPrivateKeySEC1Prefix.count
+    let infixStart = prefixCount + Data.ecP256ScalarCount
+    let pointStart = infixStart + Data.ecPrivateKeySEC1Infix.count
+    let bytes = [UInt8](self)
+    guard
+      bytes.count == pointStart + Data.ecP256PointCount,
+      Array(bytes[0 ..< prefixCount]) == Data.ecPrivateKeySEC1Prefix,
+      Array(bytes[infixStart ..< pointStart]) == Data.ecPrivateKeySEC1Infix
+    else {
+      return nil
+    }
+    return Data(bytes[pointStart...] + bytes[prefixCount ..< infixStart])
+  }
+
   var ecPublicKeyDERWithHeaderInfo: Data {
     let header: [UInt8] = [0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01, 0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00]
     let headerLength = 26
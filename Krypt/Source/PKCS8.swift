@@ -47,4 +47,36 @@ public final class PKCS8 {
 
     return String(cString: decryptedPEMCString)
   }
+
+  // MARK: - DER output
+
+  /// Converts a PKCS#1 RSA public key to a SubjectPublicKeyInfo
+  ///
+  /// - Parameter pem: RSA public key in PKCS#1 PEM format
+  /// - Returns: SubjectPublicKeyInfo in DER format
+  public static func convertPKCS1PEMToPKCS8DER(_ pem: String) -> Data? {
+    return Data(consuming: convert_pkcs1_to_pkcs8_der(pem.unsafeUtf8cString))
+  }
+
+  /// Encrypts a private key with the password
+  ///
+  /// - Parameters:
+  ///   - pem: private key in PEM format
+  ///   - password: non empty password
+  /// - Returns: encrypted PKCS#8 in DER format
+  public static func encryptDER(_ pem: Data, password: String) -> Data? {
+    guard !password.isEmpty, let pemCString = pem.unsafeUtf8cString else { return nil }
+    return Data(consuming: pkcs8_encrypt_der(pemCString, password.unsafeUtf8cString))
+  }
+
+  /// Decrypts an encrypted PKCS#8 private key
+  ///
+  /// - Parameters:
+  ///   - pem: encrypted PKCS#8 in PEM format
+  ///   - password: password
+  /// - Returns: private key in DER format, PKCS#1 for RSA keys, usable with `Key(der:access:)`
+  public static func decryptDER(_ pem: Data, password: String) -> Data? {
+    guard let pemCString = pem.unsafeUtf8cString else { return nil }
+    return Data(consuming: pkcs8_decrypt_der(pemCString, password.unsafeUtf8cString))
+  }
 }
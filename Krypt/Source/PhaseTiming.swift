@@ -0,0 +1,65 @@
+//
+//  PhaseTiming.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Per-phase timing of the C core operations: S/MIME decryption and verification, CSR creation, PKCS#8 encryption
+/// and decryption and public key wrapping, e.g. `smime_verify_chain` or `csr_sign`.
+///
+/// Disabled by default, a disabled phase costs one atomic load. Statistics are aggregated across all threads
+/// since the last `reset()`.
+public enum PhaseTiming {
+  public struct Statistics {
+    /// name of the phase, e.g. "smime_verify_digest"
+    public let phase: String
+    public let count: UInt
+    public let totalTime: TimeInterval
+    public let maxTime: TimeInterval
+    /// input bytes of parsing phases, output bytes of the others, 0 if the phase has none
+    public let bytes: UInt64
+
+    /// mean duration in seconds
+    public var meanTime: TimeInterval {
+      return count > 0 ? totalTime / Double(count) : 0
+    }
+  }
+
+  public static var isEnabled: Bool {
+    get {
+      return phase_timing_enabled() != 0
+    }
+    set {
+      phase_timing_set_enabled(newValue ? 1 : 0)
+    }
+  }
+
+  /// Statistics of every phase in the order of the operations, including phases that did not run yet
+  public static var statistics: [Statistics] {
+    let count = Int(Phase_count.rawValue)
+    var stats = [Phase_timing_stats](repeating: Phase_timing_stats(), count: count)
+    phase_timing_get_stats(&stats)
+    return stats.enumerated().map { index, stats in
+      Statistics(
+        phase: String(cString: phase_name(Phase(rawValue: UInt32(index)))),
+        count: UInt(stats.count),
+        totalTime: Double(stats.total_ns) / 1_000_000_000,
+        maxTime: Double(stats.max_ns) / 1_000_000_000,
+        bytes: UInt64(stats.bytes)
+      )
+    }
+  }
+
+  /// Statistics of one phase by name, nil for an unknown name
+  public static func statistics(for phase: String) -> Statistics? {
+    return statistics.first { $0.phase == phase }
+  }
+
+  /// Clears the statistics of every phase, e.g. after a warm up
+  public static func reset() {
+    phase_timing_reset_stats()
+  }
+}
@@ -0,0 +1,133 @@
+//
+//  RSA+PreparedKey.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+public extension RSA {
+  /// RSA key loaded once into the OpenSSL core for many operations.
+  ///
+  /// `RSA.encrypt` and `RSA.decrypt` check the algorithm and set up the operation for every call.
+  /// A prepared key keeps its Montgomery contexts, blinding and the configured OAEP SHA256 and PKCS1 contexts,
+  /// so wrapping or unwrapping a small payload only pays for the RSA operation itself.
+  /// Ciphertexts are interchangeable with `RSA.encrypt` and `RSA.decrypt`. Safe to use from multiple threads.
+  final class PreparedKey {
+    public enum Error: LocalizedError {
+      case invalidKey
+      case operationFailed
+
+      public var errorDescription: String? {
+        return String(describing: self)
+      }
+    }
+
+    /// whether the key can decrypt
+    public let access: Key.Access
+
+    /// modulus length in bytes, the length of every ciphertext
+    public let blockCount: Int
+
+    private let engineKey: OpaquePointer
+
+    /// Prepares an RSA `Key`
+    ///
+    /// - Parameter key: RSA key with `public` or `private` access
+    /// - Throws: `invalidKey` or errors occuring during `SecKeyCopyExternalRepresentation`
+    public convenience init(key: Key) throws {
+      guard key.type == .rsa else {
+        throw Error.invalidKey
+      }
+      // PKCS#1 DER for RSA keys
+      var der = try key.convertedToDER()
+      defer { der.resetBytes(in: 0 ..< der.count) }
+      let engineKey = der.withUnsafeBytes { derBuffer in
+        rsa_engine_key_new_der(derBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self), derBuffer.count, key.access == .private ? 1 : 0, nil)
+      }
+      try self.init(engineKey: engineKey, access: key.access)
+    }
+
+    /// Prepares a key in PEM without going through Security
+    ///
+    /// - Parameters:
+    ///   - pem: PKCS#1 or PKCS#8 private key, PKCS#1 or PKCS#8 public key
+    ///   - access: `Access` level of the key
+    /// - Throws: `invalidKey`
+    public convenience init(pem: String, access: Key.Access) throws {
+      try self.init(engineKey: rsa_engine_key_new_pem(pem, access == .private ? 1 : 0, nil), access: access)
+    }
+
+    private init(engineKey: OpaquePointer?, access: Key.Access) throws {
+      guard let engineKey = engineKey else {
+        throw Error.invalidKey
+      }
+      self.engineKey = engineKey
+      self.access = access
+      self.blockCount = rsa_engine_key_size(engineKey)
+    }
+
+    deinit {
+      rsa_engine_key_free(engineKey)
+    }
+
+    /// Encrypts data with the public part of the key
+    ///
+    /// - Parameters:
+    ///   - data: `Data` to encrypt
+    ///   - padding: padding to determine which algorithm to use
+    /// - Returns: encrypted `Data`
+    /// - Throws: `operationFailed`, e.g. if the data is too long for the key
+    public func encrypt(data: Data, padding: Padding) throws -> Data {
+      return try crypt(data, padding: padding, encrypt: true)
+    }
+
+    /// Decrypts data with the private key
+    ///
+    /// - Parameters:
+    ///   - data: `Data` to decrypt
+    ///   - padding: padding to determine which algorithm to use
+    /// - Returns: decrypted `Data`
+    /// - Throws: `invalidKey` for public keys, `operationFailed` if the padding does not match
+    public func decrypt(data: Data, padding: Padding) throws -> Data {
+      guard access == .private else {
+        throw Error.invalidKey
+      }
+      return try crypt(data, padding: padding, encrypt: false)
+    }
+  }
+}
+
+private extension RSA.PreparedKey {
+  func crypt(_ input: Data, padding: RSA.Padding, encrypt: Bool) throws -> Data {
+    var output = Data(count: blockCount)
+    var written = 0
+    let result = input.withUnsafeBytes { inputBuffer in
+      output.withUnsafeMutableBytes { outputBuffer -> Int32 in
+        // the C core needs an input address also for an empty plaintext
+        let inputBytes = inputBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self) ?? outputBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+        let outputBytes = outputBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self)
+        if encrypt {
+          return rsa_engine_encrypt(engineKey, padding.enginePadding, inputBytes, inputBuffer.count, outputBytes, outputBuffer.count, &written, nil)
+        }
+        return rsa_engine_decrypt(engineKey, padding.enginePadding, inputBytes, inputBuffer.count, outputBytes, outputBuffer.count, &written, nil)
+      }
+    }
+    guard result == 1 else {
+      throw Error.operationFailed
+    }
+    return output.prefix(written)
+  }
+}
+
+private extension RSA.Padding {
+  var enginePadding: Rsa_engine_padding {
+    switch self {
+    case .pkcs1:
+      return Rsa_engine_padding_pkcs1
+    case .oaep:
+      return Rsa_engine_padding_oaep_sha256
+    }
+  }
+}
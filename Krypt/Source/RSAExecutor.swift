@@ -0,0 +1,229 @@
+//
+//  RSAExecutor.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Fixed pool of threads for RSA private key operations: S/MIME decryption, CSR signing and cipher key unwrapping.
+///
+/// Requests are queued and run asynchronously, the completion is called on the executor thread.
+/// When the queue is full `submit` fails with `queueFull` or waits up to the given timeout,
+/// so callers feel the backpressure instead of piling up work. See `statistics` for queue depth and latencies.
+public final class RSAExecutor {
+  public enum Error: LocalizedError {
+    case creationFailed
+    case queueFull
+    case shuttingDown
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  /// Latency distribution with power of two buckets in microseconds, see `rsa_executor_histogram`
+  public struct Histogram {
+    /// number of durations per bucket, bucket `i` counts durations in [2^(i-1), 2^i) µs
+    public let counts: [UInt]
+    /// number of recorded durations
+    public let count: UInt
+    /// mean duration in seconds
+    public let mean: TimeInterval
+    /// longest duration in seconds
+    public let max: TimeInterval
+
+    private let histogram: Rsa_executor_histogram
+
+    init(_ histogram: Rsa_executor_histogram) {
+      self.histogram = histogram
+      counts = withUnsafeBytes(of: histogram.counts) { Array($0.bindMemory(to: UInt.self)) }
+      count = UInt(histogram.count)
+      mean = histogram.count > 0 ? histogram.total_us / Double(histogram.count) / 1_000_000 : 0
+      max = histogram.max_us / 1_000_000
+    }
+
+    /// Upper bound of the bucket the percentile falls into
+    ///
+    /// - Parameter percentile: percentile between 0 and 100, e.g. 99
+    /// - Returns: duration in seconds
+    public func percentile(_ percentile: Double) -> TimeInterval {
+      var histogram = self.histogram
+      return rsa_executor_histogram_percentile(&histogram, percentile) / 1_000_000
+    }
+  }
+
+  public struct Statistics {
+    /// requests waiting in the queue
+    public let queueDepth: Int
+    /// highest queue depth seen
+    public let maxQueueDepth: Int
+    /// maximum number of waiting requests
+    public let queueCapacity: Int
+    /// requests being executed
+    public let running: Int
+    public let threadCount: Int
+    public let submitted: UInt
+    public let completed: UInt
+    /// requests refused because the queue was full
+    public let rejected: UInt
+    /// time from submission until a thread picked the request up
+    public let waitTime: Histogram
+    /// time the operation ran
+    public let serviceTime: Histogram
+  }
+
+  /// Executor shared by the asynchronous Krypt APIs, one thread per active processor and room for 256 waiting requests
+  public static let shared = try! RSAExecutor(threadCount: ProcessInfo.processInfo.activeProcessorCount, queueCapacity: 256)
+
+  private let executor: OpaquePointer
+
+  /// Creates an executor and starts its threads
+  ///
+  /// - Parameters:
+  ///   - threadCount: number of threads, RSA private operations running at the same time
+  ///   - queueCapacity: maximum number of waiting requests
+  /// - Throws: `creationFailed`
+  public init(threadCount: Int, queueCapacity: Int) throws {
+    guard threadCount > 0, queueCapacity > 0, let executor = rsa_executor_new(Int32(threadCount), queueCapacity) else {
+      throw Error.creationFailed
+    }
+    self.executor = executor
+  }
+
+  /// Runs the queued requests and stops the threads
+  deinit {
+    rsa_executor_free(executor)
+  }
+
+  /// Queues an operation
+  ///
+  /// - Parameters:
+  ///   - timeout: how long to wait for space in a full queue, 0 fails immediately
+  ///   - work: operation to run on an executor thread
+  ///   - completion: called on the executor thread with the result of `work`
+  /// - Throws: `queueFull` or `shuttingDown`, neither work nor completion are called then
+  public func submit<T>(timeout: TimeInterval = 0, _ work: @escaping () throws -> T, completion: @escaping (Result<T, Swift.Error>) -> Void) throws {
+    var result: Result<T, Swift.Error>?
+    let job = Unmanaged.passRetained(Job(
+      run: { result = Result { try work() } },
+      complete: { result.map(completion) }
+    ))
+    var error = Rsa_executor_error(0)
+    // completion runs as the C completion, after the statistics count the request
+    let submitted = rsa_executor_submit(executor, { context in
+      Unmanaged<Job>.fromOpaque(context!).takeUnretainedValue().run()
+    }, { context, _, _ in
+      Unmanaged<Job>.fromOpaque(context!).takeRetainedValue().complete()
+    }, job.toOpaque(), timeout, &error)
+    guard submitted == 1 else {
+      job.release()
+      throw error == Rsa_executor_error_shutting_down ? Error.shuttingDown : Error.queueFull
+    }
+  }
+
+  public var statistics: Statistics {
+    var stats = Rsa_executor_stats()
+    rsa_executor_get_stats(executor, &stats)
+    return Statistics(
+      queueDepth: stats.queue_depth,
+      maxQueueDepth: stats.max_queue_depth,
+      queueCapacity: stats.queue_capacity,
+      running: Int(stats.running),
+      threadCount: Int(stats.threads),
+      submitted: UInt(stats.submitted),
+      completed: UInt(stats.completed),
+      rejected: UInt(stats.rejected),
+      waitTime: Histogram(stats.wait),
+      serviceTime: Histogram(stats.service)
+    )
+  }
+
+  /// Clears counters and histograms, e.g. after a warm up phase
+  public func resetStatistics() {
+    rsa_executor_reset_stats(executor)
+  }
+}
+
+private extension RSAExecutor {
+  final class Job {
+    let run: () -> Void
+    let complete: () -> Void
+
+    init(run: @escaping () -> Void, complete: @escaping () -> Void) {
+      self.run = run
+      self.complete = complete
+    }
+  }
+}
+
+// MARK: - Private key operations
+
+public extension SMIME {
+  /// Decrypts encrypted SMIME content on an `RSAExecutor`
+  ///
+  /// - Parameters:
+  ///   - data: encrypted SMIME content
+  ///   - key: private key
+  ///   - executor: executor to run the decryption on
+  ///   - completion: called on the executor thread with the decrypted content or a `SMIMEError`
+  /// - Throws: `RSAExecutor.Error` if the request is not queued
+  static func decrypt(data: Data, key: Key, executor: RSAExecutor, completion: @escaping (Result<Data, Swift.Error>) -> Void) throws {
+    try executor.submit({ try decrypt(data: data, key: key) }, completion: completion)
+  }
+}
+
+public extension CSR {
+  /// Creates a Certificate signing request (CSR) on an `RSAExecutor`
+  ///
+  /// - Parameters:
+  ///   - key: Private key to use to create CSR
+  ///   - attributes: Object with attributes specified in X.509 standard
+  ///   - executor: executor to run the signing on
+  ///   - completion: called on the executor thread with the CSR or a `CSR.Error`
+  /// - Throws: `RSAExecutor.Error` if the request is not queued
+  static func create(with key: Key, attributes: CSRAttributes?, executor: RSAExecutor, completion: @escaping (Result<String, Swift.Error>) -> Void) throws {
+    try executor.submit({ try create(with: key, attributes: attributes) }, completion: completion)
+  }
+}
+
+public extension EHREncryption {
+  /// Asymetrically decrypts the provided encrypted data, only the cipher key unwrap runs on an `RSAExecutor`,
+  /// the content is decrypted on `queue` so large records do not hold a private key thread
+  ///
+  /// - Parameters:
+  ///   - encryptedData: `EncryptedData` object that contains data, cipher key and version
+  ///   - key: private key to decrypt with
+  ///   - cache: cache of unwrapped keys, a hit skips the RSA operation but still runs on the executor
+  ///   - executor: executor to run the unwrap on
+  ///   - queue: queue to decrypt the content and call the completion on
+  ///   - completion: called on `queue` with the decrypted data or `PublicError.decryptionFailed`
+  /// - Throws: `RSAExecutor.Error` if the request is not queued
+  static func decrypt(
+    encryptedData: EncryptedData,
+    with key: Key,
+    cache: UnwrappedKeyCache? = nil,
+    executor: RSAExecutor,
+    queue: DispatchQueue = .global(qos: .userInitiated),
+    completion: @escaping (Result<Data, Swift.Error>) -> Void
+  ) throws {
+    let version = encryptedData.version
+    try executor.submit({ () throws -> CipherAttr in
+      guard let wrappedKey = encryptedData.wrappedKeyData else {
+        throw PublicError.decryptionFailed
+      }
+      return try unwrap(wrappedKey: wrappedKey, with: key, version: version, cache: cache)
+    }, completion: { unwrapped in
+      queue.async {
+        completion(Result {
+          do {
+            return try version.open(encryptedData.data, with: unwrapped.get())
+          } catch {
+            throw PublicError.decryptionFailed
+          }
+        })
+      }
+    })
+  }
+}
@@ -0,0 +1,169 @@
+//
+//  UnwrappedKeyCache.swift
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+import Foundation
+
+/// Opt-in cache of RSA unwrapped AES keys and IVs for `EHREncryption.decrypt`.
+/// Opening the same record again skips the RSA private key operation and only costs the AES work.
+///
+/// Entries are identified by a SHA256 digest of the private key's public key, the version and the cipher key.
+/// The unwrapped keys are stored in memory locked against swapping, and zeroed when they are evicted,
+/// when their time to live passes, on `removeAll()` and when the cache is released.
+public final class UnwrappedKeyCache {
+  public enum Error: LocalizedError {
+    case allocationFailed
+
+    public var errorDescription: String? {
+      return String(describing: self)
+    }
+  }
+
+  /// Counters of the cache since its creation
+  public struct Statistics {
+    public let hits: Int
+    public let misses: Int
+    public let insertions: Int
+    public let evictions: Int
+    public let expirations: Int
+    public let count: Int
+    public let capacity: Int
+    /// whether the entries are locked in memory, locking can be refused by the system
+    public let isMemoryLocked: Bool
+
+    /// share of lookups served from the cache, 0 before the first lookup
+    public var hitRate: Double {
+      let lookups = hits + misses
+      return lookups > 0 ? Double(hits) / Double(lookups) : 0
+    }
+  }
+
+  private let cache: OpaquePointer
+  private let keyIdentityLock = NSLock()
+  private weak var lastKey: Key?
+  private var lastKeyIdentity: Data?
+
+  /// Creates an empty cache
+  ///
+  /// - Parameters:
+  ///   - capacity: maximum number of entries, the least recently used entry is evicted when full
+  ///   - timeToLive: lifetime of an entry in seconds, 0 keeps entries until they are evicted
+  /// - Throws: `allocationFailed`
+  public init(capacity: Int = 256, timeToLive: TimeInterval = 300) throws {
+    guard capacity > 0, let cache = key_cache_new(capacity, timeToLive) else {
+      throw Error.allocationFailed
+    }
+    self.cache = cache
+  }
+
+  deinit {
+    key_cache_free(cache)
+  }
+
+  /// Current counters
+  public var statistics: Statistics {
+    var stats = Key_cache_stats()
+    key_cache_get_stats(cache, &stats)
+    return Statistics(
+      hits: Int(stats.hits),
+      misses: Int(stats.misses),
+      insertions: Int(stats.insertions),
+      evictions: Int(stats.evictions),
+      expirations: Int(stats.expirations),
+      count: stats.count,
+      capacity: stats.capacity,
+      isMemoryLocked: stats.locked == 1
+    )
+  }
+
+  /// Zeroes and removes all entries, e.g. when the user logs out
+  public func removeAll() {
+    key_cache_remove_all(cache)
+  }
+}
+
+// MARK: - Lookup
+
+extension UnwrappedKeyCache {
+  /// Identifies an unwrapped key
+  ///
+  /// - Parameters:
+  ///   - wrappedKey: RSA encrypted cipher key
+  ///   - key: RSA private key the cipher key is unwrapped with
+  ///   - version: version of the record
+  /// - Returns: 32 bytes identifier, `nil` if the public key can not be derived from the private key
+  func identifier(wrappedKey: Data, key: Key, version: EHREncryption.Version) -> Data? {
+    guard let keyIdentity = identity(of: key) else {
+      return nil
+    }
+    var input = keyIdentity
+    input.append(version.binaryTag)
+    input.append(wrappedKey)
+    return SHA256.digest(input)
+  }
+
+  /// Looks up an unwrapped key
+  ///
+  /// - Parameters:
+  /// - Parameter identifier: identifier from `identifier(wrappedKey:key:version:)`
+  /// - Returns: AES key and IV with the length it was inserted with, `nil` if not cached
+  func cipherAttr(for identifier: Data) -> CipherAttr? {
+    var key = Data(count: CipherAttr.keyCount)
+    var iv = Data(count: CipherAttr.ivCount)
+    var ivCount = 0
+    let hit = identifier.withUnsafeBytes { identifierBuffer in
+      key.withUnsafeMutableBytes { keyBuffer in
+        iv.withUnsafeMutableBytes { ivBuffer in
+          key_cache_get(
+            cache,
+            identifierBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            ivBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            &ivCount
+          )
+        }
+      }
+    }
+    return hit == 1 ? CipherAttr(key: key, iv: iv.prefix(ivCount)) : nil
+  }
+
+  func insert(_ cipherAttr: CipherAttr, for identifier: Data) {
+    guard cipherAttr.key.count == CipherAttr.keyCount, cipherAttr.iv.count <= CipherAttr.ivCount else {
+      return
+    }
+    identifier.withUnsafeBytes { identifierBuffer in
+      cipherAttr.key.withUnsafeBytes { keyBuffer in
+        cipherAttr.iv.withUnsafeBytes { ivBuffer in
+          key_cache_put(
+            cache,
+            identifierBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            keyBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            ivBuffer.baseAddress?.assumingMemoryBound(to: UInt8.self),
+            ivBuffer.count
+          )
+        }
+      }
+    }
+  }
+}
+
+private extension UnwrappedKeyCache {
+  /// SHA256 of the public key belonging to the private key, remembered for the last key used
+  func identity(of key: Key) -> Data? {
+    keyIdentityLock.lock()
+    defer { keyIdentityLock.unlock() }
+
+    if let lastKey = lastKey, lastKey === key {
+      return lastKeyIdentity
+    }
+    guard let keyIdentity = try? key.publicKeyDigest() else {
+      return nil
+    }
+    lastKey = key
+    lastKeyIdentity = keyIdentity
+    return keyIdentity
+  }
+}
@@ -0,0 +1,202 @@
+//
+//  aes256.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "aes256.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+
+/*
+ Cipher contexts of one thread, indexed by block mode and direction.
+ */
+struct aes256_contexts {
+  EVP_CIPHER_CTX *ctx[2][2];
+};
+
+static pthread_key_t aes256_contexts_key;
+static pthread_once_t aes256_contexts_once = PTHREAD_ONCE_INIT;
+
+static void aes256_contexts_free(void *arg) {
+  struct aes256_contexts *contexts = arg;
+  for (int mode = 0; mode < 2; mode++) {
+    for (int encrypt = 0; encrypt < 2; encrypt++) {
+      EVP_CIPHER_CTX_free(contexts->ctx[mode][encrypt]);
+    }
+  }
+  free(contexts);
+}
+
+static void aes256_contexts_init(void) {
+  pthread_key_create(&aes256_contexts_key, aes256_contexts_free);
+}
+
+/*
+ Returns the cipher context of the calling thread keyed with key and iv.
+ The context is created on first use, afterwards only the key schedule and IV are replaced.
+ */
+static EVP_CIPHER_CTX *aes256_thread_ctx(enum Aes256_block_mode mode, int encrypt, const unsigned char *key, const unsigned char *iv) {
+  pthread_once(&aes256_contexts_once, aes256_contexts_init);
+  struct aes256_contexts *contexts = pthread_getspecific(aes256_contexts_key);
+  if (!contexts) {
+    contexts = calloc(1, sizeof(struct aes256_contexts));
+    if (!contexts || pthread_setspecific(aes256_contexts_key, contexts) != 0) {
+      free(contexts);
+      return NULL;
+    }
+  }
+
+  int m = mode == Aes256_block_mode_gcm ? 0 : 1;
+  int e = encrypt ? 1 : 0;
+  EVP_CIPHER_CTX *ctx = contexts->ctx[m][e];
+  if (!ctx) {
+    ctx = aes256_cipher_ctx_new(mode, encrypt, key, iv);
+    contexts->ctx[m][e] = ctx;
+    return ctx;
+  }
+
+  // Passing no cipher keeps the already allocated cipher data, also the GCM IV length stays configured
+  if (EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, encrypt) != 1) {
+    EVP_CIPHER_CTX_free(ctx);
+    contexts->ctx[m][e] = NULL;
+    return NULL;
+  }
+  return ctx;
+}
+
+EVP_CIPHER_CTX *aes256_cipher_ctx_new(enum Aes256_block_mode mode, int encrypt, const unsigned char *key, const unsigned char *iv) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  if (!ctx) {
+    return NULL;
+  }
+  const EVP_CIPHER *cipher = mode == Aes256_block_mode_gcm ? EVP_aes_256_gcm() : EVP_aes_256_cbc();
+  int ok = EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, encrypt);
+  if (ok && mode == Aes256_block_mode_gcm) {
+    // Vivy uses 16 bytes IVs for GCM, OpenSSL defaults to 12
+    ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, AES256_IV_LENGTH, NULL);
+  }
+  if (ok) {
+    ok = EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, encrypt);
+  }
+  if (!ok) {
+    EVP_CIPHER_CTX_free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+size_t aes256_encrypted_length(enum Aes256_block_mode mode, size_t length) {
+  if (mode == Aes256_block_mode_gcm) {
+    return length + AES256_TAG_LENGTH;
+  }
+  return (length / AES256_BLOCK_LENGTH + 1) * AES256_BLOCK_LENGTH;
+}
+
+static int aes256_fail(enum Aes256_error *err, enum Aes256_error error) {
+  if (err) {
+    *err = error;
+  }
+  return 0;
+}
+
+int aes256_encrypt(enum Aes256_block_mode mode,
+                   const unsigned char *key,
+                   const unsigned char *iv,
+                   const unsigned char *in,
+                   size_t in_length,
+                   unsigned char *out,
+                   size_t out_capacity,
+                   size_t *out_length,
+                   enum Aes256_error *err) {
+  if (!key || !iv || (!in && in_length > 0) || !out || in_length > INT_MAX - 2 * AES256_BLOCK_LENGTH) {
+    return aes256_fail(err, Aes256_error_invalid_input);
+  }
+  if (out_capacity < aes256_encrypted_length(mode, in_length)) {
+    return aes256_fail(err, Aes256_error_buffer_too_small);
+  }
+
+  EVP_CIPHER_CTX *ctx = aes256_thread_ctx(mode, 1, key, iv);
+  if (!ctx) {
+    return aes256_fail(err, Aes256_error_cipher);
+  }
+
+  int updatel = 0;
+  int finall = 0;
+  if (in_length > 0 && EVP_EncryptUpdate(ctx, out, &updatel, in, (int)in_length) != 1) {
+    return aes256_fail(err, Aes256_error_cipher);
+  }
+  if (EVP_EncryptFinal_ex(ctx, out + updatel, &finall) != 1) {
+    return aes256_fail(err, Aes256_error_cipher);
+  }
+  size_t length = (size_t)updatel + (size_t)finall;
+
+  if (mode == Aes256_block_mode_gcm) {
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AES256_TAG_LENGTH, out + length) != 1) {
+      return aes256_fail(err, Aes256_error_cipher);
+    }
+    length += AES256_TAG_LENGTH;
+  }
+
+  if (out_length) {
+    *out_length = length;
+  }
+  return 1;
+}
+
+int aes256_decrypt(enum Aes256_block_mode mode,
+                   const unsigned char *key,
+                   const unsigned char *iv,
+                   const unsigned char *in,
+                   size_t in_length,
+                   unsigned char *out,
+                   size_t out_capacity,
+                   size_t *out_length,
+                   enum Aes256_error *err) {
+  if (!key || !iv || (!in && in_length > 0) || !out || in_length > INT_MAX) {
+    return aes256_fail(err, Aes256_error_invalid_input);
+  }
+
+  size_t payload_length = in_length;
+  if (mode == Aes256_block_mode_gcm) {
+    if (in_length < AES256_TAG_LENGTH) {
+      return aes256_fail(err, Aes256_error_authentication);
+    }
+    payload_length -= AES256_TAG_LENGTH;
+  } else if (in_length == 0 || in_length % AES256_BLOCK_LENGTH != 0) {
+    return aes256_fail(err, Aes256_error_invalid_input);
+  }
+  if (out_capacity < payload_length) {
+    return aes256_fail(err, Aes256_error_buffer_too_small);
+  }
+
+  EVP_CIPHER_CTX *ctx = aes256_thread_ctx(mode, 0, key, iv);
+  if (!ctx) {
+    return aes256_fail(err, Aes256_error_cipher);
+  }
+
+  if (mode == Aes256_block_mode_gcm) {
+    // EVP copies the tag, so in place decryption may overwrite the input afterwards
+    unsigned char *tag = (unsigned char *)in + payload_length;
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AES256_TAG_LENGTH, tag) != 1) {
+      return aes256_fail(err, Aes256_error_cipher);
+    }
+  }
+
+  int updatel = 0;
+  int finall = 0;
+  if (payload_length > 0 && EVP_DecryptUpdate(ctx, out, &updatel, in, (int)payload_length) != 1) {
+    return aes256_fail(err, Aes256_error_cipher);
+  }
+  if (EVP_DecryptFinal_ex(ctx, out + updatel, &finall) != 1) {
+    return aes256_fail(err, mode == Aes256_block_mode_gcm ? Aes256_error_authentication : Aes256_error_cipher);
+  }
+
+  if (out_length) {
+    *out_length = (size_t)updatel + (size_t)finall;
+  }
+  return 1;
+}
@@ -0,0 +1,108 @@
+//
+//  aes256.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef aes256_h
+#define aes256_h
+
+#include <stdio.h>
+#include <openssl/evp.h>
+
+#define AES256_KEY_LENGTH 32
+#define AES256_IV_LENGTH 16
+#define AES256_TAG_LENGTH 16
+#define AES256_BLOCK_LENGTH 16
+
+enum Aes256_block_mode {
+  Aes256_block_mode_gcm,
+  Aes256_block_mode_cbc
+};
+
+enum Aes256_error {
+  Aes256_error_none = 0,
+  Aes256_error_invalid_input,
+  Aes256_error_buffer_too_small,
+  Aes256_error_cipher,
+  Aes256_error_authentication
+};
+
+/**
+ Returns the output capacity needed to encrypt the given number of bytes.
+ GCM appends the 16 bytes tag, CBC pads up to the next full block.
+
+ @param mode AES block mode
+ @param length Number of plaintext bytes
+ @return Number of ciphertext bytes
+ */
+size_t aes256_encrypted_length(enum Aes256_block_mode mode, size_t length);
+
+/**
+ Encrypts caller supplied memory into caller supplied memory.
+
+ The cipher contexts are kept per thread and only re-keyed, so after the first call on a thread
+ no memory is allocated. `in` and `out` may point to the same memory for in place encryption,
+ partially overlapping buffers are not supported.
+ The output has the same layout as `AES256.encrypt`: GCM appends the tag, CBC uses PKCS7 padding.
+
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param in Plaintext
+ @param in_length Number of plaintext bytes
+ @param out Buffer for the ciphertext, at least `aes256_encrypted_length` bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int aes256_encrypt(enum Aes256_block_mode mode,
+                   const unsigned char *key,
+                   const unsigned char *iv,
+                   const unsigned char *in,
+                   size_t in_length,
+                   unsigned char *out,
+                   size_t out_capacity,
+                   size_t *out_length,
+                   enum Aes256_error *err);
+
+/**
+ Decrypts caller supplied memory into caller supplied memory. See `aes256_encrypt`.
+ For GCM the tag is expected at the end of the input, the output needs `in_length - 16` bytes.
+ For CBC the output needs `in_length` bytes, the padding is removed.
+
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param in Ciphertext
+ @param in_length Number of ciphertext bytes
+ @param out Buffer for the plaintext
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int aes256_decrypt(enum Aes256_block_mode mode,
+                   const unsigned char *key,
+                   const unsigned char *iv,
+                   const unsigned char *in,
+                   size_t in_length,
+                   unsigned char *out,
+                   size_t out_capacity,
+                   size_t *out_length,
+                   enum Aes256_error *err);
+
+/**
+ Creates an AES 256 cipher context keyed with key and iv, configured for the 16 bytes IVs used in Vivy.
+
+ @param mode AES block mode
+ @param encrypt 1 = encryption, 0 = decryption
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @return Cipher context, NULL on failure
+ */
+EVP_CIPHER_CTX *aes256_cipher_ctx_new(enum Aes256_block_mode mode, int encrypt, const unsigned char *key, const unsigned char *iv);
+
+#endif /* aes256_h */
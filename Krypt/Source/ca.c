@@ -0,0 +1,500 @@
+//
+//  ca.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "ca.h"
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include "helper.h"
+
+/*
+ * IETF RFC 5280 says serial number must be <= 20 bytes. Use 159 bits
+ * so that the first bit will never be one, so that the DER encoding
+ * rules won't force a leading octet.
+ */
+# define SERIAL_RAND_BITS 159
+
+struct Ca {
+  EVP_PKEY *key;
+  X509 *certificate;
+  /// Subject of the CA certificate, its encoding is cached before threads copy it
+  X509_NAME *issuer;
+  /// Extensions shared by the issued certificates, NULL if not used
+  X509_EXTENSION *basic_constraints;
+  X509_EXTENSION *authority_key_identifier;
+  X509_EXTENSION *key_usage;
+  X509_EXTENSION *key_usage_email;
+  X509_EXTENSION *extended_key_usage_email;
+};
+
+struct ca_batch_work {
+  const struct Ca *ca;
+  const struct Ca_profile *profile;
+  const ASN1_TIME *not_before;
+  const ASN1_TIME *not_after;
+  const struct Ca_request *requests;
+  size_t count;
+  enum Ca_format format;
+  struct Ca_output *outputs;
+};
+
+static void *ca_fail(enum Ca_error *err, enum Ca_error error) {
+  if (err) {
+    *err = error;
+  }
+  return NULL;
+}
+
+static int ca_set_random_serial(X509 *x) {
+  BIGNUM *serial = BN_new();
+  int ok = serial != NULL;
+  do {
+    ok = ok && BN_rand(serial, SERIAL_RAND_BITS, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY) == 1;
+  } while (ok && BN_is_zero(serial));
+  ok = ok && BN_to_ASN1_INTEGER(serial, X509_get_serialNumber(x)) != NULL;
+  BN_free(serial);
+  return ok;
+}
+
+/// Extension in the syntax of the openssl.cnf v3 sections, e.g. "critical,CA:FALSE"
+static X509_EXTENSION *ca_extension(X509 *issuer, X509 *subject, int nid, const char *value) {
+  X509V3_CTX ctx;
+  X509V3_set_ctx_nodb(&ctx);
+  X509V3_set_ctx(&ctx, issuer, subject, NULL, NULL, 0);
+  return X509V3_EXT_nconf_nid(NULL, &ctx, nid, value);
+}
+
+static int ca_add_extension(X509 *x, X509_EXTENSION *extension) {
+  int ok = extension && X509_add_ext(x, extension, -1) == 1;
+  X509_EXTENSION_free(extension);
+  return ok;
+}
+
+static int ca_add_subject_key_identifier(X509 *x) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  ASN1_OCTET_STRING *identifier = ASN1_OCTET_STRING_new();
+  int ok = identifier &&
+           X509_pubkey_digest(x, EVP_sha1(), digest, &digest_length) == 1 &&
+           ASN1_OCTET_STRING_set(identifier, digest, (int)digest_length) == 1 &&
+           X509_add1_ext_i2d(x, NID_subject_key_identifier, identifier, 0, X509V3_ADD_DEFAULT) == 1;
+  ASN1_OCTET_STRING_free(identifier);
+  return ok;
+}
+
+static int ca_add_email(X509 *x, const char *email) {
+  GENERAL_NAMES *names = GENERAL_NAMES_new();
+  GENERAL_NAME *name = GENERAL_NAME_new();
+  ASN1_IA5STRING *address = ASN1_IA5STRING_new();
+  int ok = names && name && address && ASN1_STRING_set(address, email, -1) == 1;
+  if (ok) {
+    GENERAL_NAME_set0_value(name, GEN_EMAIL, address);
+    address = NULL;
+    ok = sk_GENERAL_NAME_push(names, name) > 0;
+  }
+  if (ok) {
+    name = NULL;
+    ok = X509_add1_ext_i2d(x, NID_subject_alt_name, names, 0, X509V3_ADD_DEFAULT) == 1;
+  }
+  ASN1_IA5STRING_free(address);
+  GENERAL_NAME_free(name);
+  GENERAL_NAMES_free(names);
+  return ok;
+}
+
+static int ca_sign(X509 *x, EVP_PKEY *key, EVP_MD_CTX *md_ctx) {
+  EVP_MD_CTX_reset(md_ctx);
+  return EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, key) == 1 && X509_sign_ctx(x, md_ctx) > 0;
+}
+
+/// Takes ownership of the key and the certificate
+static struct Ca *ca_new(EVP_PKEY *key, X509 *certificate, enum Ca_error *err) {
+  struct Ca *ca = calloc(1, sizeof(struct Ca));
+  if (!ca) {
+    EVP_PKEY_free(key);
+    X509_free(certificate);
+    return ca_fail(err, Ca_error_out_of_memory);
+  }
+  ca->key = key;
+  ca->certificate = certificate;
+  if (X509_check_private_key(certificate, key) != 1) {
+    ca_free(ca);
+    return ca_fail(err, Ca_error_invalid_key);
+  }
+  ca->issuer = X509_NAME_dup(X509_get_subject_name(certificate));
+  int has_key_identifier = X509_get_ext_by_NID(certificate, NID_subject_key_identifier, -1) >= 0;
+  ca->basic_constraints = ca_extension(certificate, NULL, NID_basic_constraints, "critical,CA:FALSE");
+  ca->authority_key_identifier = has_key_identifier ? ca_extension(certificate, NULL, NID_authority_key_identifier, "keyid:always") : NULL;
+  ca->key_usage = ca_extension(certificate, NULL, NID_key_usage, "critical,digitalSignature");
+  ca->key_usage_email = ca_extension(certificate, NULL, NID_key_usage, "critical,digitalSignature,keyEncipherment");
+  ca->extended_key_usage_email = ca_extension(certificate, NULL, NID_ext_key_usage, "emailProtection");
+  if (!ca->issuer || i2d_X509_NAME(ca->issuer, NULL) <= 0 || !ca->basic_constraints ||
+      (has_key_identifier && !ca->authority_key_identifier) || !ca->key_usage || !ca->key_usage_email ||
+      !ca->extended_key_usage_email) {
+    ca_free(ca);
+    return ca_fail(err, Ca_error_invalid_certificate);
+  }
+  return ca;
+}
+
+struct Ca *ca_new_pem(const char *key_pem, const char *certificate_pem, enum Ca_error *err) {
+  if (!key_pem || !certificate_pem) {
+    return ca_fail(err, Ca_error_invalid_input);
+  }
+  EVP_PKEY *key = get_key(key_pem);
+  if (!key) {
+    return ca_fail(err, Ca_error_invalid_key);
+  }
+  BIO *membuf = BIO_from_str(certificate_pem);
+  X509 *certificate = membuf ? PEM_read_bio_X509(membuf, NULL, NULL, NULL) : NULL;
+  BIO_free(membuf);
+  if (!certificate) {
+    EVP_PKEY_free(key);
+    return ca_fail(err, Ca_error_invalid_certificate);
+  }
+  return ca_new(key, certificate, err);
+}
+
+/// CA certificate of `key`, signed by `issuer_key` or self signed if `issuer` is NULL
+static X509 *ca_certificate(EVP_PKEY *key, const char *common_name, long validity_seconds, X509 *issuer, EVP_PKEY *issuer_key) {
+  X509 *x = X509_new();
+  EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+  X509_NAME *name = x ? X509_get_subject_name(x) : NULL;
+  X509 *signer = issuer ? issuer : x;
+  int ok = name && md_ctx &&
+           X509_set_version(x, 2) == 1 &&
+           ca_set_random_serial(x) &&
+           X509_gmtime_adj(X509_getm_notBefore(x), 0) != NULL &&
+           X509_gmtime_adj(X509_getm_notAfter(x), validity_seconds) != NULL &&
+           X509_set_pubkey(x, key) == 1 &&
+           X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_UTF8, (const unsigned char *)common_name, -1, -1, 0) == 1 &&
+           X509_set_issuer_name(x, X509_get_subject_name(signer)) == 1 &&
+           ca_add_extension(x, ca_extension(signer, x, NID_basic_constraints, "critical,CA:TRUE")) &&
+           ca_add_extension(x, ca_extension(signer, x, NID_key_usage, "critical,keyCertSign,cRLSign,digitalSignature")) &&
+           ca_add_subject_key_identifier(x) &&
+           (!issuer || ca_add_extension(x, ca_extension(signer, x, NID_authority_key_identifier, "keyid:always"))) &&
+           ca_sign(x, issuer ? issuer_key : key, md_ctx);
+  EVP_MD_CTX_free(md_ctx);
+  if (!ok) {
+    X509_free(x);
+    return NULL;
+  }
+  return x;
+}
+
+struct Ca *ca_new_self_signed(const char *key_pem, const char *common_name, long validity_seconds, enum Ca_error *err) {
+  if (!key_pem || !common_name || validity_seconds <= 0) {
+    return ca_fail(err, Ca_error_invalid_input);
+  }
+  EVP_PKEY *key = get_key(key_pem);
+  if (!key) {
+    return ca_fail(err, Ca_error_invalid_key);
+  }
+  X509 *x = ca_certificate(key, common_name, validity_seconds, NULL, NULL);
+  if (!x) {
+    EVP_PKEY_free(key);
+    return ca_fail(err, Ca_error_signing);
+  }
+  return ca_new(key, x, err);
+}
+
+struct Ca *ca_new_intermediate(const struct Ca *parent, const char *key_pem, const char *common_name, long validity_seconds, enum Ca_error *err) {
+  if (!parent || !key_pem || !common_name || validity_seconds <= 0) {
+    return ca_fail(err, Ca_error_invalid_input);
+  }
+  EVP_PKEY *key = get_key(key_pem);
+  if (!key) {
+    return ca_fail(err, Ca_error_invalid_key);
+  }
+  X509 *x = ca_certificate(key, common_name, validity_seconds, parent->certificate, parent->key);
+  if (!x) {
+    EVP_PKEY_free(key);
+    return ca_fail(err, Ca_error_signing);
+  }
+  return ca_new(key, x, err);
+}
+
+void ca_free(struct Ca *ca) {
+  if (!ca) {
+    return;
+  }
+  X509_EXTENSION_free(ca->extended_key_usage_email);
+  X509_EXTENSION_free(ca->key_usage_email);
+  X509_EXTENSION_free(ca->key_usage);
+  X509_EXTENSION_free(ca->authority_key_identifier);
+  X509_EXTENSION_free(ca->basic_constraints);
+  X509_NAME_free(ca->issuer);
+  X509_free(ca->certificate);
+  EVP_PKEY_free(ca->key);
+  free(ca);
+}
+
+char *ca_certificate_pem(const struct Ca *ca) {
+  if (!ca) {
+    return NULL;
+  }
+  unsigned char *der = NULL;
+  int der_length = i2d_X509(ca->certificate, &der);
+  size_t pem_length = 0;
+  unsigned char *pem = der_length > 0 ? pem_encode("CERTIFICATE", der, (size_t)der_length, &pem_length) : NULL;
+  OPENSSL_free(der);
+  return (char *)pem;
+}
+
+static void *ca_dup_parameter(int type, const void *value) {
+  if (type == V_ASN1_OBJECT) {
+    return OBJ_dup(value);
+  }
+  if (type == V_ASN1_NULL || type == V_ASN1_UNDEF) {
+    return NULL;
+  }
+  return ASN1_STRING_dup(value);
+}
+
+/// Copies the encoded SubjectPublicKeyInfo, avoids decoding the key into an EVP_PKEY and encoding it again
+static int ca_set_public_key(X509 *x, const X509_ALGOR *algorithm, const unsigned char *key, int key_length) {
+  const ASN1_OBJECT *object = NULL;
+  const void *parameter = NULL;
+  int parameter_type = V_ASN1_UNDEF;
+  X509_ALGOR_get0(&object, &parameter_type, &parameter, algorithm);
+  ASN1_OBJECT *object_copy = OBJ_dup(object);
+  void *parameter_copy = ca_dup_parameter(parameter_type, parameter);
+  unsigned char *key_copy = OPENSSL_memdup(key, (size_t)key_length);
+  if (object_copy && key_copy && (parameter_copy || parameter_type == V_ASN1_NULL || parameter_type == V_ASN1_UNDEF) &&
+      X509_PUBKEY_set0_param(X509_get_X509_PUBKEY(x), object_copy, parameter_type, parameter_copy, key_copy, key_length) == 1) {
+    return 1;
+  }
+  ASN1_OBJECT_free(object_copy);
+  if (parameter_type == V_ASN1_OBJECT) {
+    ASN1_OBJECT_free(parameter_copy);
+  } else {
+    ASN1_STRING_free(parameter_copy);
+  }
+  OPENSSL_free(key_copy);
+  return 0;
+}
+
+/// SEQUENCE { AlgorithmIdentifier, BIT STRING } of a "PUBLIC KEY" PEM. The key is copied as encoded, a malformed key
+/// is only noticed by the verifier of the certificate
+static enum Ca_error ca_set_public_key_pem(X509 *x, const char *pem) {
+  BIO *membuf = BIO_from_str(pem);
+  char *name = NULL;
+  char *header = NULL;
+  unsigned char *der = NULL;
+  long der_length = 0;
+  int read = membuf && PEM_read_bio(membuf, &name, &header, &der, &der_length) == 1;
+  BIO_free(membuf);
+
+  enum Ca_error error = Ca_error_invalid_request;
+  const unsigned char *p = der;
+  long length = 0;
+  int tag = 0;
+  int class = 0;
+  if (read && strcmp(name, PEM_STRING_PUBLIC) == 0 &&
+      ASN1_get_object(&p, &length, &tag, &class, der_length) == V_ASN1_CONSTRUCTED && tag == V_ASN1_SEQUENCE &&
+      p + length == der + der_length) {
+    const unsigned char *end = p + length;
+    X509_ALGOR *algorithm = d2i_X509_ALGOR(NULL, &p, end - p);
+    if (algorithm && ASN1_get_object(&p, &length, &tag, &class, end - p) == 0 && tag == V_ASN1_BIT_STRING &&
+        length >= 2 && p + length == end && p[0] == 0) {
+      error = ca_set_public_key(x, algorithm, p + 1, (int)length - 1) ? Ca_error_none : Ca_error_issuing;
+    }
+    X509_ALGOR_free(algorithm);
+  }
+  OPENSSL_free(name);
+  OPENSSL_free(header);
+  OPENSSL_free(der);
+  return error;
+}
+
+/// Subject and public key of the request, the CSR signature proves possession of the private key
+static enum Ca_error ca_set_subject(X509 *x, const struct Ca_request *request) {
+  if (request->csr_pem) {
+    BIO *membuf = BIO_from_str(request->csr_pem);
+    X509_REQ *csr = membuf ? PEM_read_bio_X509_REQ(membuf, NULL, NULL, NULL) : NULL;
+    BIO_free(membuf);
+    EVP_PKEY *key = csr ? X509_REQ_get0_pubkey(csr) : NULL;
+    const unsigned char *encoded_key = NULL;
+    int encoded_key_length = 0;
+    X509_ALGOR *algorithm = NULL;
+    enum Ca_error error = Ca_error_none;
+    if (!key || X509_REQ_verify(csr, key) != 1 ||
+        X509_PUBKEY_get0_param(NULL, &encoded_key, &encoded_key_length, &algorithm, X509_REQ_get_X509_PUBKEY(csr)) != 1) {
+      error = Ca_error_invalid_request;
+    } else if (X509_set_subject_name(x, X509_REQ_get_subject_name(csr)) != 1 ||
+               !ca_set_public_key(x, algorithm, encoded_key, encoded_key_length)) {
+      error = Ca_error_issuing;
+    }
+    X509_REQ_free(csr);
+    return error;
+  }
+
+  if (!request->public_key_pem) {
+    return Ca_error_invalid_input;
+  }
+  enum Ca_error error = ca_set_public_key_pem(x, request->public_key_pem);
+  X509_NAME *name = X509_get_subject_name(x);
+  if (error == Ca_error_none && request->common_name &&
+      X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_UTF8, (const unsigned char *)request->common_name, -1, -1, 0) != 1) {
+    error = Ca_error_issuing;
+  }
+  return error;
+}
+
+static enum Ca_error ca_issue_one(const struct ca_batch_work *work, const struct Ca_request *request, EVP_MD_CTX *md_ctx, X509 **issued) {
+  const struct Ca *ca = work->ca;
+  X509 *x = X509_new();
+  if (!x) {
+    return Ca_error_out_of_memory;
+  }
+  enum Ca_error error = ca_set_subject(x, request);
+  int email_protection = work->profile->email_protection;
+  int ok = error == Ca_error_none &&
+           X509_set_version(x, 2) == 1 &&
+           ca_set_random_serial(x) &&
+           X509_set1_notBefore(x, work->not_before) == 1 &&
+           X509_set1_notAfter(x, work->not_after) == 1 &&
+           X509_set_issuer_name(x, ca->issuer) == 1 &&
+           X509_add_ext(x, ca->basic_constraints, -1) == 1 &&
+           X509_add_ext(x, email_protection ? ca->key_usage_email : ca->key_usage, -1) == 1 &&
+           (!email_protection || X509_add_ext(x, ca->extended_key_usage_email, -1) == 1) &&
+           ca_add_subject_key_identifier(x) &&
+           (!ca->authority_key_identifier || X509_add_ext(x, ca->authority_key_identifier, -1) == 1) &&
+           (!request->email || ca_add_email(x, request->email));
+  if (error == Ca_error_none && !ok) {
+    error = Ca_error_issuing;
+  }
+  if (error == Ca_error_none && !ca_sign(x, ca->key, md_ctx)) {
+    error = Ca_error_signing;
+  }
+  if (error != Ca_error_none) {
+    X509_free(x);
+    return error;
+  }
+  *issued = x;
+  return Ca_error_none;
+}
+
+static enum Ca_error ca_issue_output(const struct ca_batch_work *work, const struct Ca_request *request, EVP_MD_CTX *md_ctx, struct Ca_output *output) {
+  X509 *x = NULL;
+  enum Ca_error error = ca_issue_one(work, request, md_ctx, &x);
+  if (error != Ca_error_none) {
+    return error;
+  }
+  int length = i2d_X509(x, NULL);
+  unsigned char *der = length > 0 ? malloc((size_t)length) : NULL;
+  unsigned char *p = der;
+  if (!der || i2d_X509(x, &p) != length) {
+    free(der);
+    X509_free(x);
+    return Ca_error_out_of_memory;
+  }
+  X509_free(x);
+  output->length = (size_t)length;
+  if (work->format == Ca_format_pem) {
+    unsigned char *pem = pem_encode("CERTIFICATE", der, output->length, &output->length);
+    free(der);
+    if (!pem) {
+      return Ca_error_out_of_memory;
+    }
+    der = pem;
+  }
+  output->data = der;
+  return Ca_error_none;
+}
+
+static void ca_batch_worker(void *context, size_t first, size_t stride) {
+  struct ca_batch_work *work = context;
+  EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+  for (size_t i = first; i < work->count; i += stride) {
+    struct Ca_output *output = &work->outputs[i];
+    *output = (struct Ca_output){ NULL, 0, Ca_error_out_of_memory };
+    if (md_ctx) {
+      output->error = ca_issue_output(work, &work->requests[i], md_ctx, output);
+    }
+  }
+  EVP_MD_CTX_free(md_ctx);
+}
+
+static int ca_profile_valid(const struct Ca_profile *profile) {
+  return profile && profile->validity_seconds > 0 && profile->backdate_seconds >= 0;
+}
+
+struct Der_buffer *ca_issue_der(const struct Ca *ca, const struct Ca_profile *profile, const struct Ca_request *request, enum Ca_error *err) {
+  if (!ca || !ca_profile_valid(profile) || !request) {
+    return ca_fail(err, Ca_error_invalid_input);
+  }
+  ASN1_TIME *not_before = X509_gmtime_adj(NULL, -profile->backdate_seconds);
+  ASN1_TIME *not_after = X509_gmtime_adj(NULL, profile->validity_seconds);
+  EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+  struct ca_batch_work work = { ca, profile, not_before, not_after, request, 1, Ca_format_der, NULL };
+  X509 *x = NULL;
+  enum Ca_error error = not_before && not_after && md_ctx ? ca_issue_one(&work, request, md_ctx, &x) : Ca_error_out_of_memory;
+  EVP_MD_CTX_free(md_ctx);
+  ASN1_TIME_free(not_after);
+  ASN1_TIME_free(not_before);
+  if (error != Ca_error_none) {
+    return ca_fail(err, error);
+  }
+
+  int length = i2d_X509(x, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_X509(x, &p) != length) {
+    der_buffer_free(der);
+    der = ca_fail(err, Ca_error_out_of_memory);
+  }
+  X509_free(x);
+  return der;
+}
+
+int ca_issue_batch(const struct Ca *ca,
+                   const struct Ca_profile *profile,
+                   const struct Ca_request *requests,
+                   size_t count,
+                   enum Ca_format format,
+                   int threads,
+                   struct Ca_output *outputs,
+                   enum Ca_error *err) {
+  if (!ca || !ca_profile_valid(profile) || (!requests && count > 0) || (!outputs && count > 0) || threads < 1) {
+    ca_fail(err, Ca_error_invalid_input);
+    return 0;
+  }
+  ASN1_TIME *not_before = X509_gmtime_adj(NULL, -profile->backdate_seconds);
+  ASN1_TIME *not_after = X509_gmtime_adj(NULL, profile->validity_seconds);
+  if (!not_before || !not_after) {
+    ASN1_TIME_free(not_after);
+    ASN1_TIME_free(not_before);
+    ca_fail(err, Ca_error_out_of_memory);
+    return 0;
+  }
+
+  struct ca_batch_work work = { ca, profile, not_before, not_after, requests, count, format, outputs };
+  batch_run(count, threads, ca_batch_worker, &work);
+  ASN1_TIME_free(not_after);
+  ASN1_TIME_free(not_before);
+
+  for (size_t i = 0; i < count; i++) {
+    if (outputs[i].error != Ca_error_none) {
+      ca_fail(err, outputs[i].error);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void ca_output_free(struct Ca_output *outputs, size_t count) {
+  for (size_t i = 0; outputs && i < count; i++) {
+    free(outputs[i].data);
+    outputs[i].data = NULL;
+    outputs[i].length = 0;
+  }
+}
@@ -0,0 +1,158 @@
+//
+//  ca.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef ca_h
+#define ca_h
+
+#include <stdio.h>
+#include "der_buffer.h"
+
+enum Ca_error {
+  Ca_error_none = 0,
+  Ca_error_invalid_key,
+  Ca_error_invalid_certificate,
+  Ca_error_invalid_input,
+  Ca_error_invalid_request,
+  Ca_error_issuing,
+  Ca_error_signing,
+  Ca_error_out_of_memory
+};
+
+enum Ca_format {
+  Ca_format_der = 0,
+  Ca_format_pem
+};
+
+/**
+ Local certificate authority: the issuer key and certificate loaded once, with the issuer name and the extensions
+ every certificate shares encoded up front. Meant for test and device certificates, e.g. to mint S/MIME
+ certificates for load tests of `smime_verify`.
+ */
+struct Ca;
+
+struct Ca_profile {
+  /// Seconds the certificates are valid from the time of issuance
+  long validity_seconds;
+  /// Seconds notBefore lies before the time of issuance, tolerates clock skew of the verifier
+  long backdate_seconds;
+  /// 1 = end entity certificates for S/MIME: digitalSignature and keyEncipherment, extended key usage
+  /// emailProtection. 0 = digitalSignature only
+  int email_protection;
+};
+
+struct Ca_request {
+  /// CSR in PEM format, its signature is verified and its subject and public key are certified. NULL to use
+  /// `public_key_pem` and `common_name`
+  const char *csr_pem;
+  /// Public key in PKCS#8 PEM format, used when `csr_pem` is NULL
+  const char *public_key_pem;
+  /// Subject common name, used when `csr_pem` is NULL, may be NULL for an empty subject
+  const char *common_name;
+  /// Email address of the subjectAltName extension, may be NULL
+  const char *email;
+};
+
+struct Ca_output {
+  /// DER or PEM of the certificate, NULL on failure. Free with `ca_output_free`
+  unsigned char *data;
+  size_t length;
+  enum Ca_error error;
+};
+
+/**
+ Loads a certificate authority
+
+ @param key_pem Private key of the CA in PKCS#1, SEC1 or PKCS#8 PEM format
+ @param certificate_pem Certificate of the CA in PEM format, must belong to the key
+ @param err Error code of the failure, may be NULL
+ @return CA, NULL on failure. Free with `ca_free`
+ */
+struct Ca *ca_new_pem(const char *key_pem, const char *certificate_pem, enum Ca_error *err);
+
+/**
+ Creates a certificate authority with a new self signed root certificate
+
+ @param key_pem Private key of the CA in PKCS#1, SEC1 or PKCS#8 PEM format
+ @param common_name Common name of the root certificate
+ @param validity_seconds Seconds the root certificate is valid
+ @param err Error code of the failure, may be NULL
+ @return CA, NULL on failure. Free with `ca_free`
+ */
+struct Ca *ca_new_self_signed(const char *key_pem, const char *common_name, long validity_seconds, enum Ca_error *err);
+
+/**
+ Creates an intermediate certificate authority whose certificate is issued by `parent`
+
+ @param parent CA issuing the intermediate certificate
+ @param key_pem Private key of the intermediate CA in PKCS#1, SEC1 or PKCS#8 PEM format
+ @param common_name Common name of the intermediate certificate
+ @param validity_seconds Seconds the intermediate certificate is valid
+ @param err Error code of the failure, may be NULL
+ @return CA, NULL on failure. Free with `ca_free`
+ */
+struct Ca *ca_new_intermediate(const struct Ca *parent, const char *key_pem, const char *common_name, long validity_seconds, enum Ca_error *err);
+
+/**
+ Frees the CA
+
+ @param ca CA to free, may be NULL
+ */
+void ca_free(struct Ca *ca);
+
+/**
+ Certificate of the CA, e.g. for the trusted certificates of `smime_verify`
+
+ @param ca CA
+ @return Certificate in PEM format, NULL on failure. Free with `free`
+ */
+char *ca_certificate_pem(const struct Ca *ca);
+
+/**
+ Issues one certificate
+
+ @param ca CA signing the certificate
+ @param profile Validity and key usage of the certificate
+ @param request Subject, public key and email address of the certificate
+ @param err Error code of the failure, may be NULL
+ @return Certificate in DER format, NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *ca_issue_der(const struct Ca *ca, const struct Ca_profile *profile, const struct Ca_request *request, enum Ca_error *err);
+
+/**
+ Issues one certificate per request, the requests are spread over threads.
+
+ Every certificate gets a random 159 bits serial number, SHA256 signature, the subjectAltName email of the request,
+ subject and authority key identifiers and basicConstraints CA:FALSE.
+
+ @param ca CA signing the certificates
+ @param profile Validity and key usage of the certificates, notBefore and notAfter are the same for the whole batch
+ @param requests Subject, public key and email address per certificate
+ @param count Number of requests
+ @param format DER or PEM output
+ @param threads Number of threads, 1 issues the certificates on the calling thread, at most BATCH_MAX_THREADS (64) are used
+ @param outputs Receives one certificate or error per request, `count` elements
+ @param err Error code of the failure of the whole batch, may be NULL
+ @return Status: 1 = every certificate was issued, 0 = failure, see the errors of the outputs
+ */
+int ca_issue_batch(const struct Ca *ca,
+                   const struct Ca_profile *profile,
+                   const struct Ca_request *requests,
+                   size_t count,
+                   enum Ca_format format,
+                   int threads,
+                   struct Ca_output *outputs,
+                   enum Ca_error *err);
+
+/**
+ Frees the certificates of a batch
+
+ @param outputs Outputs of `ca_issue_batch`
+ @param count Number of outputs
+ */
+void ca_output_free(struct Ca_output *outputs, size_t count);
+
+#endif /* ca_h */
@@ -0,0 +1,163 @@
+//
+//  chacha20_poly1305.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "chacha20_poly1305.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+/*
+ Cipher contexts of one thread, indexed by direction.
+ */
+struct chacha20_poly1305_contexts {
+  EVP_CIPHER_CTX *ctx[2];
+};
+
+static pthread_key_t chacha20_poly1305_contexts_key;
+static pthread_once_t chacha20_poly1305_contexts_once = PTHREAD_ONCE_INIT;
+
+static void chacha20_poly1305_contexts_free(void *arg) {
+  struct chacha20_poly1305_contexts *contexts = arg;
+  EVP_CIPHER_CTX_free(contexts->ctx[0]);
+  EVP_CIPHER_CTX_free(contexts->ctx[1]);
+  free(contexts);
+}
+
+static void chacha20_poly1305_contexts_init(void) {
+  pthread_key_create(&chacha20_poly1305_contexts_key, chacha20_poly1305_contexts_free);
+}
+
+/*
+ Returns the cipher context of the calling thread keyed with key and nonce, see `aes256_thread_ctx`.
+ */
+static EVP_CIPHER_CTX *chacha20_poly1305_thread_ctx(int encrypt, const unsigned char *key, const unsigned char *nonce) {
+  pthread_once(&chacha20_poly1305_contexts_once, chacha20_poly1305_contexts_init);
+  struct chacha20_poly1305_contexts *contexts = pthread_getspecific(chacha20_poly1305_contexts_key);
+  if (!contexts) {
+    contexts = calloc(1, sizeof(struct chacha20_poly1305_contexts));
+    if (!contexts || pthread_setspecific(chacha20_poly1305_contexts_key, contexts) != 0) {
+      free(contexts);
+      return NULL;
+    }
+  }
+
+  int e = encrypt ? 1 : 0;
+  EVP_CIPHER_CTX *ctx = contexts->ctx[e];
+  if (!ctx) {
+    ctx = EVP_CIPHER_CTX_new();
+    int ok = ctx &&
+             EVP_CipherInit_ex(ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL, encrypt) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, CHACHA20_POLY1305_NONCE_LENGTH, NULL) == 1;
+    if (!ok) {
+      EVP_CIPHER_CTX_free(ctx);
+      return NULL;
+    }
+    contexts->ctx[e] = ctx;
+  }
+
+  if (EVP_CipherInit_ex(ctx, NULL, NULL, key, nonce, encrypt) != 1) {
+    EVP_CIPHER_CTX_free(ctx);
+    contexts->ctx[e] = NULL;
+    return NULL;
+  }
+  return ctx;
+}
+
+static int chacha20_poly1305_fail(enum Chacha20_poly1305_error *err, enum Chacha20_poly1305_error error) {
+  if (err) {
+    *err = error;
+  }
+  return 0;
+}
+
+int chacha20_poly1305_encrypt(const unsigned char *key,
+                              const unsigned char *nonce,
+                              const unsigned char *in,
+                              size_t in_length,
+                              unsigned char *out,
+                              size_t out_capacity,
+                              size_t *out_length,
+                              enum Chacha20_poly1305_error *err) {
+  if (!key || !nonce || (!in && in_length > 0) || !out || in_length > INT_MAX - CHACHA20_POLY1305_TAG_LENGTH) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_invalid_input);
+  }
+  if (out_capacity < in_length + CHACHA20_POLY1305_TAG_LENGTH) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_buffer_too_small);
+  }
+
+  EVP_CIPHER_CTX *ctx = chacha20_poly1305_thread_ctx(1, key, nonce);
+  if (!ctx) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+
+  int updatel = 0;
+  int finall = 0;
+  if (in_length > 0 && EVP_EncryptUpdate(ctx, out, &updatel, in, (int)in_length) != 1) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+  if (EVP_EncryptFinal_ex(ctx, out + updatel, &finall) != 1) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+  size_t length = (size_t)updatel + (size_t)finall;
+  if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, CHACHA20_POLY1305_TAG_LENGTH, out + length) != 1) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+
+  if (out_length) {
+    *out_length = length + CHACHA20_POLY1305_TAG_LENGTH;
+  }
+  return 1;
+}
+
+int chacha20_poly1305_decrypt(const unsigned char *key,
+                              const unsigned char *nonce,
+                              const unsigned char *in,
+                              size_t in_length,
+                              unsigned char *out,
+                              size_t out_capacity,
+                              size_t *out_length,
+                              enum Chacha20_poly1305_error *err) {
+  if (!key || !nonce || (!in && in_length > 0) || !out || in_length > INT_MAX) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_invalid_input);
+  }
+  if (in_length < CHACHA20_POLY1305_TAG_LENGTH) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_authentication);
+  }
+  size_t payload_length = in_length - CHACHA20_POLY1305_TAG_LENGTH;
+  if (out_capacity < payload_length) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_buffer_too_small);
+  }
+
+  EVP_CIPHER_CTX *ctx = chacha20_poly1305_thread_ctx(0, key, nonce);
+  if (!ctx) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+
+  // EVP copies the tag, so in place decryption may overwrite the input afterwards
+  unsigned char *tag = (unsigned char *)in + payload_length;
+  if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, CHACHA20_POLY1305_TAG_LENGTH, tag) != 1) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+
+  int updatel = 0;
+  int finall = 0;
+  if (payload_length > 0 && EVP_DecryptUpdate(ctx, out, &updatel, in, (int)payload_length) != 1) {
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_cipher);
+  }
+  if (EVP_DecryptFinal_ex(ctx, out + updatel, &finall) != 1) {
+    // The stream cipher already produced unauthenticated plaintext
+    OPENSSL_cleanse(out, payload_length);
+    return chacha20_poly1305_fail(err, Chacha20_poly1305_error_authentication);
+  }
+
+  if (out_length) {
+    *out_length = (size_t)updatel + (size_t)finall;
+  }
+  return 1;
+}
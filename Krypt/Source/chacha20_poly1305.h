@@ -0,0 +1,72 @@
+//
+//  chacha20_poly1305.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef chacha20_poly1305_h
+#define chacha20_poly1305_h
+
+#include <stdio.h>
+
+#define CHACHA20_POLY1305_KEY_LENGTH 32
+#define CHACHA20_POLY1305_NONCE_LENGTH 12
+#define CHACHA20_POLY1305_TAG_LENGTH 16
+
+enum Chacha20_poly1305_error {
+  Chacha20_poly1305_error_none = 0,
+  Chacha20_poly1305_error_invalid_input,
+  Chacha20_poly1305_error_buffer_too_small,
+  Chacha20_poly1305_error_cipher,
+  Chacha20_poly1305_error_authentication
+};
+
+/**
+ Encrypts caller supplied memory with ChaCha20-Poly1305 (RFC 8439) into caller supplied memory.
+
+ Like `aes256_encrypt` the cipher contexts are kept per thread and only re-keyed,
+ `in` and `out` may point to the same memory. The output is the ciphertext followed by the 16 bytes tag.
+
+ @param key 32 bytes key
+ @param nonce 12 bytes nonce, must never repeat for the same key
+ @param in Plaintext
+ @param in_length Number of plaintext bytes
+ @param out Buffer for the ciphertext, at least in_length + 16 bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int chacha20_poly1305_encrypt(const unsigned char *key,
+                              const unsigned char *nonce,
+                              const unsigned char *in,
+                              size_t in_length,
+                              unsigned char *out,
+                              size_t out_capacity,
+                              size_t *out_length,
+                              enum Chacha20_poly1305_error *err);
+
+/**
+ Decrypts data produced by `chacha20_poly1305_encrypt`. The output is zeroed when the tag does not match.
+
+ @param key 32 bytes key
+ @param nonce 12 bytes nonce
+ @param in Ciphertext followed by the tag
+ @param in_length Number of ciphertext bytes
+ @param out Buffer for the plaintext, at least in_length - 16 bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int chacha20_poly1305_decrypt(const unsigned char *key,
+                              const unsigned char *nonce,
+                              const unsigned char *in,
+                              size_t in_length,
+                              unsigned char *out,
+                              size_t out_capacity,
+                              size_t *out_length,
+                              enum Chacha20_poly1305_error *err);
+
+#endif /* chacha20_poly1305_h */
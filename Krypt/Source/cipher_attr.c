@@ -0,0 +1,177 @@
+//
+//  cipher_attr.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "cipher_attr.h"
+#include <string.h>
+#include "aes256.h"
+
+static const char cipher_attr_key_name[] = "base64EncodedKey";
+static const char cipher_attr_iv_name[] = "base64EncodedIV";
+
+/*
+ Position in the JSON input, `p` never passes `end`.
+ */
+struct cipher_attr_cursor {
+  const unsigned char *p;
+  const unsigned char *end;
+};
+
+static void cipher_attr_skip_whitespace(struct cipher_attr_cursor *c) {
+  while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) {
+    c->p++;
+  }
+}
+
+static int cipher_attr_expect(struct cipher_attr_cursor *c, unsigned char token) {
+  cipher_attr_skip_whitespace(c);
+  if (c->p == c->end || *c->p != token) {
+    return 0;
+  }
+  c->p++;
+  return 1;
+}
+
+/*
+ Reads a member name without escapes and returns 1 for the key, 2 for the IV, 0 otherwise.
+ */
+static int cipher_attr_member(struct cipher_attr_cursor *c) {
+  if (!cipher_attr_expect(c, '"')) {
+    return 0;
+  }
+  const unsigned char *start = c->p;
+  while (c->p < c->end && *c->p != '"' && *c->p != '\\') {
+    c->p++;
+  }
+  if (c->p == c->end || *c->p != '"') {
+    return 0;
+  }
+  size_t length = (size_t)(c->p - start);
+  c->p++;
+  if (length == sizeof(cipher_attr_key_name) - 1 && memcmp(start, cipher_attr_key_name, length) == 0) {
+    return 1;
+  }
+  if (length == sizeof(cipher_attr_iv_name) - 1 && memcmp(start, cipher_attr_iv_name, length) == 0) {
+    return 2;
+  }
+  return 0;
+}
+
+/*
+ Value of every base64 alphabet character, 64 for characters outside the alphabet.
+ */
+static const unsigned char cipher_attr_sextets[256] = {
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64,
+  64,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 64, 64, 64, 64, 64,
+  64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+  64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+};
+
+/*
+ Decodes a padded base64 string value into exactly `out_length` bytes.
+ */
+static int cipher_attr_base64_value(struct cipher_attr_cursor *c, unsigned char *out, size_t out_length) {
+  if (!cipher_attr_expect(c, '"')) {
+    return 0;
+  }
+
+  unsigned int quantum = 0;
+  int sextets = 0;
+  int padding = 0;
+  size_t written = 0;
+  while (c->p < c->end && *c->p != '"') {
+    unsigned char ch = *c->p++;
+    if (ch == '\\') {
+      // JSONEncoder escapes the slash, other escapes never occur in base64
+      if (c->p == c->end || *c->p != '/') {
+        return 0;
+      }
+      ch = *c->p++;
+    }
+    if (ch == '=') {
+      // Padding is only valid in the last two positions of the final quantum
+      if (sextets < 2 || ++padding > 2) {
+        return 0;
+      }
+      quantum <<= 6;
+    } else {
+      unsigned char sextet = cipher_attr_sextets[ch];
+      if (sextet > 63 || padding > 0) {
+        return 0;
+      }
+      quantum = quantum << 6 | sextet;
+    }
+    if (++sextets < 4) {
+      continue;
+    }
+
+    size_t bytes = 3 - (size_t)padding;
+    if (written + bytes > out_length) {
+      return 0;
+    }
+    unsigned char decoded[3] = { (unsigned char)(quantum >> 16), (unsigned char)(quantum >> 8), (unsigned char)quantum };
+    memcpy(out + written, decoded, bytes);
+    written += bytes;
+    quantum = 0;
+    sextets = 0;
+    if (padding > 0) {
+      // Nothing may follow the padded quantum
+      if (c->p == c->end || *c->p != '"') {
+        return 0;
+      }
+    }
+  }
+  if (c->p == c->end || sextets != 0 || written != out_length) {
+    return 0;
+  }
+  c->p++;
+  return 1;
+}
+
+int cipher_attr_parse(const unsigned char *json, size_t length, unsigned char *key, unsigned char *iv) {
+  if (!json || !key || !iv) {
+    return 0;
+  }
+  struct cipher_attr_cursor c = { json, json + length };
+  int seen = 0;
+
+  int ok = cipher_attr_expect(&c, '{');
+  for (int i = 0; ok && i < 2; i++) {
+    if (i > 0) {
+      ok = cipher_attr_expect(&c, ',');
+    }
+    int member = ok ? cipher_attr_member(&c) : 0;
+    if (!member || (seen & member) || !cipher_attr_expect(&c, ':')) {
+      ok = 0;
+      break;
+    }
+    seen |= member;
+    ok = member == 1 ? cipher_attr_base64_value(&c, key, AES256_KEY_LENGTH) : cipher_attr_base64_value(&c, iv, AES256_IV_LENGTH);
+  }
+  if (ok) {
+    ok = cipher_attr_expect(&c, '}');
+    cipher_attr_skip_whitespace(&c);
+    ok = ok && c.p == c.end;
+  }
+
+  if (!ok) {
+    memset(key, 0, AES256_KEY_LENGTH);
+    memset(iv, 0, AES256_IV_LENGTH);
+  }
+  return ok;
+}
@@ -0,0 +1,29 @@
+//
+//  cipher_attr.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef cipher_attr_h
+#define cipher_attr_h
+
+#include <stdio.h>
+
+/**
+ Parses the JSON encoded `CipherAttr` of the gcmOAEP and cbcPKCS1 versions,
+ `{"base64EncodedKey":"…","base64EncodedIV":"…"}`, and base64 decodes the values straight into the output buffers.
+
+ Only this fixed schema is handled: both members exactly once in any order, whitespace between tokens
+ and `\/` escapes inside the values. Anything else fails, so the caller can fall back to a general JSON decoder.
+ Nothing is allocated.
+
+ @param json JSON bytes
+ @param length Number of JSON bytes
+ @param key Buffer for the 32 bytes AES key
+ @param iv Buffer for the 16 bytes initialization vector
+ @return Status: 1 = success, 0 = not the expected layout (key and iv are zeroed)
+ */
+int cipher_attr_parse(const unsigned char *json, size_t length, unsigned char *key, unsigned char *iv);
+
+#endif /* cipher_attr_h */
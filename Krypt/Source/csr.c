@@ -12,20 +12,25 @@
 #include <openssl/pem.h>
 #include <openssl/x509.h>
 #include "helper.h"
+#include "phase_timing.h"
 
 EVP_PKEY *getPrivateKey(const char *key);
 void freeAll(X509_REQ *req, BIO *out, EVP_PKEY *key);
 
-char *createCSR(const char *key,
-                const char *country,
-                const char *state,
-                const char *location,
-                const char *organization,
-                const char *organizationUnit,
-                const char *emailAddress,
-                const char *uniqueIdentifier,
-                const char *givenName,
-                const char *surname) {
+/*
+ Builds and signs the request shared by the PEM and DER outputs
+ */
+static X509_REQ *createX509Req(const char *key,
+                               const char *country,
+                               const char *state,
+                               const char *location,
+                               const char *organization,
+                               const char *organizationUnit,
+                               const char *emailAddress,
+                               const char *uniqueIdentifier,
+                               const char *givenName,
+                               const char *surname,
+                               uint64_t *phase) {
 
   int             ret = 0;
   int             version = 0;
@@ -126,8 +131,12 @@ char *createCSR(const char *key,
     }
   }
   
+  X509_NAME_free(x509_name);
+  *phase = phase_end(Phase_csr_subject, *phase, 0);
+
   // set public key of x509 req
   privateKey = getPrivateKey(key);
+  *phase = phase_end(Phase_csr_key, *phase, 0);
 
   ret = X509_REQ_set_pubkey(x509_req, privateKey);
   if (ret != 1) {
@@ -137,25 +146,80 @@ char *createCSR(const char *key,
 
   // set sign key of x509 req
   ret = X509_REQ_sign(x509_req, privateKey, EVP_sha256());    // return x509_req->signature->length
+  *phase = phase_end(Phase_csr_sign, *phase, 0);
   if (ret <= 0) {
     freeAll(x509_req, out, privateKey);
     return NULL;
   }
 
+  EVP_PKEY_free(privateKey);
+  return x509_req;
+}
+
+char *createCSR(const char *key,
+                const char *country,
+                const char *state,
+                const char *location,
+                const char *organization,
+                const char *organizationUnit,
+                const char *emailAddress,
+                const char *uniqueIdentifier,
+                const char *givenName,
+                const char *surname) {
+  uint64_t phase = phase_begin();
+  X509_REQ *x509_req = createX509Req(key, country, state, location, organization, organizationUnit,
+                                     emailAddress, uniqueIdentifier, givenName, surname, &phase);
+  if (x509_req == NULL) {
+    return NULL;
+  }
+
   // Convert to PEM
-  out = BIO_new(BIO_s_mem());
+  BIO *out = BIO_new(BIO_s_mem());
   BIO_set_mem_eof_return(out, 0);
-  ret = PEM_write_bio_X509_REQ(out, x509_req);
+  int ret = PEM_write_bio_X509_REQ(out, x509_req);
   if (ret <= 0) {
-    freeAll(x509_req, out, privateKey);
+    freeAll(x509_req, out, NULL);
     return NULL;
   }
 
+  size_t length = (size_t)BIO_pending(out);
   char *data = str_from_BIO(out);
+  freeAll(x509_req, out, NULL);
+  phase_end(Phase_csr_encode, phase, length);
 
   return data;
 }
 
+struct Der_buffer *createCSR_der(const char *key,
+                                 const char *country,
+                                 const char *state,
+                                 const char *location,
+                                 const char *organization,
+                                 const char *organizationUnit,
+                                 const char *emailAddress,
+                                 const char *uniqueIdentifier,
+                                 const char *givenName,
+                                 const char *surname) {
+  uint64_t phase = phase_begin();
+  X509_REQ *x509_req = createX509Req(key, country, state, location, organization, organizationUnit,
+                                     emailAddress, uniqueIdentifier, givenName, surname, &phase);
+  if (x509_req == NULL) {
+    return NULL;
+  }
+
+  int length = i2d_X509_REQ(x509_req, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_X509_REQ(x509_req, &p) != length) {
+    der_buffer_free(der);
+    der = NULL;
+  }
+  freeAll(x509_req, NULL, NULL);
+  phase_end(Phase_csr_encode, phase, der ? der->length : 0);
+
+  return der;
+}
+
 void freeAll(X509_REQ *req, BIO *out, EVP_PKEY *key) {
   X509_REQ_free(req);
   BIO_free_all(out);
@@ -163,7 +227,5 @@ void freeAll(X509_REQ *req, BIO *out, EVP_PKEY *key) {
 }
 
 EVP_PKEY *getPrivateKey(const char *key) {
-  BIO *membuf = BIO_from_str(key);
-  EVP_PKEY *privateKey = PEM_read_bio_PrivateKey(membuf, NULL, 0, NULL);
-  return privateKey;
+  return get_key(key);
 }
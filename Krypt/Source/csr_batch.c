@@ -0,0 +1,402 @@
+//
+//  csr_batch.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "csr_batch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include "helper.h"
+
+#define CSR_DER_SEQUENCE 0x30
+#define CSR_DER_SET 0x31
+#define CSR_DER_BIT_STRING 0x03
+
+/// CSR version 1, encoded as INTEGER 0
+static const unsigned char csr_version[] = { 0x02, 0x01, 0x00 };
+/// Empty attributes, [0] IMPLICIT SET
+static const unsigned char csr_attributes[] = { 0xa0, 0x00 };
+static const unsigned char csr_sha256_with_rsa[] = {
+  0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00
+};
+static const unsigned char csr_ecdsa_with_sha256[] = {
+  0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02
+};
+
+struct Csr_key {
+  EVP_PKEY *pkey;
+  /// DER encoded SubjectPublicKeyInfo
+  unsigned char *spki;
+  size_t spki_length;
+  /// DER encoded AlgorithmIdentifier of the signature
+  const unsigned char *algorithm;
+  size_t algorithm_length;
+};
+
+struct csr_template_part {
+  /// Encoded RDNs of consecutive fixed entries, NULL for a placeholder
+  unsigned char *der;
+  size_t length;
+  /// Attribute of a placeholder
+  char *field;
+};
+
+struct Csr_template {
+  struct csr_template_part *parts;
+  size_t count;
+  size_t placeholders;
+};
+
+struct csr_batch_work {
+  const struct Csr_template *subject;
+  const struct Csr_batch_request *requests;
+  size_t count;
+  enum Csr_batch_format format;
+  struct Csr_batch_output *outputs;
+};
+
+static void *csr_batch_fail(enum Csr_batch_error *err, enum Csr_batch_error error) {
+  if (err) {
+    *err = error;
+  }
+  return NULL;
+}
+
+static size_t csr_der_header_length(size_t length) {
+  if (length <= 0x7f) {
+    return 2;
+  }
+  size_t header = 2;
+  for (size_t rest = length; rest > 0; rest >>= 8) {
+    header++;
+  }
+  return header;
+}
+
+static unsigned char *csr_der_put_header(unsigned char *p, unsigned char tag, size_t length) {
+  *p++ = tag;
+  if (length <= 0x7f) {
+    *p++ = (unsigned char)length;
+    return p;
+  }
+  size_t bytes = csr_der_header_length(length) - 2;
+  *p++ = (unsigned char)(0x80 | bytes);
+  for (size_t i = bytes; i > 0; i--) {
+    *p++ = (unsigned char)(length >> (8 * (i - 1)));
+  }
+  return p;
+}
+
+/// SET { AttributeTypeAndValue }, the string type is chosen like `X509_NAME_add_entry_by_txt` does for UTF-8 input
+static unsigned char *csr_encode_rdn(const char *field, const char *value, size_t *length) {
+  X509_NAME_ENTRY *entry = X509_NAME_ENTRY_create_by_txt(NULL, field, MBSTRING_UTF8, (const unsigned char *)value, -1);
+  int entry_length = entry ? i2d_X509_NAME_ENTRY(entry, NULL) : -1;
+  unsigned char *rdn = NULL;
+  if (entry_length > 0) {
+    size_t header_length = csr_der_header_length((size_t)entry_length);
+    rdn = malloc(header_length + (size_t)entry_length);
+    if (rdn) {
+      unsigned char *p = csr_der_put_header(rdn, CSR_DER_SET, (size_t)entry_length);
+      i2d_X509_NAME_ENTRY(entry, &p);
+      *length = header_length + (size_t)entry_length;
+    }
+  }
+  X509_NAME_ENTRY_free(entry);
+  return rdn;
+}
+
+/// Takes ownership of the key
+static struct Csr_key *csr_key_from_pkey(EVP_PKEY *pkey, enum Csr_batch_error *err) {
+  struct Csr_key *key = calloc(1, sizeof(struct Csr_key));
+  if (!key) {
+    EVP_PKEY_free(pkey);
+    return csr_batch_fail(err, Csr_batch_error_out_of_memory);
+  }
+  key->pkey = pkey;
+  int id = pkey ? EVP_PKEY_id(pkey) : NID_undef;
+  if (id == EVP_PKEY_RSA) {
+    key->algorithm = csr_sha256_with_rsa;
+    key->algorithm_length = sizeof(csr_sha256_with_rsa);
+  } else if (id == EVP_PKEY_EC) {
+    key->algorithm = csr_ecdsa_with_sha256;
+    key->algorithm_length = sizeof(csr_ecdsa_with_sha256);
+  }
+  int spki_length = key->algorithm ? i2d_PUBKEY(key->pkey, &key->spki) : -1;
+  if (spki_length <= 0) {
+    csr_key_free(key);
+    return csr_batch_fail(err, Csr_batch_error_invalid_key);
+  }
+  key->spki_length = (size_t)spki_length;
+  return key;
+}
+
+struct Csr_key *csr_key_new_pem(const char *pem, enum Csr_batch_error *err) {
+  if (!pem) {
+    return csr_batch_fail(err, Csr_batch_error_invalid_input);
+  }
+  BIO *membuf = BIO_from_str(pem);
+  EVP_PKEY *pkey = membuf ? PEM_read_bio_PrivateKey(membuf, NULL, 0, NULL) : NULL;
+  BIO_free(membuf);
+  if (!pkey) {
+    return csr_batch_fail(err, Csr_batch_error_invalid_key);
+  }
+  return csr_key_from_pkey(pkey, err);
+}
+
+struct Csr_key *csr_key_new_ec_p256(const unsigned char *raw, size_t length, enum Csr_batch_error *err) {
+  if (!raw || length != CSR_EC_P256_RAW_LENGTH) {
+    return csr_batch_fail(err, Csr_batch_error_invalid_input);
+  }
+  size_t point_length = CSR_EC_P256_RAW_LENGTH - 32;
+  EC_KEY *ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+  EVP_PKEY *pkey = EVP_PKEY_new();
+  int ok = ec && pkey &&
+           EC_KEY_oct2key(ec, raw, point_length, NULL) == 1 &&
+           EC_KEY_oct2priv(ec, raw + point_length, 32) == 1 &&
+           EC_KEY_check_key(ec) == 1 &&
+           EVP_PKEY_assign_EC_KEY(pkey, ec) == 1;
+  if (!ok) {
+    EC_KEY_free(ec);
+    EVP_PKEY_free(pkey);
+    return csr_batch_fail(err, Csr_batch_error_invalid_key);
+  }
+  return csr_key_from_pkey(pkey, err);
+}
+
+void csr_key_free(struct Csr_key *key) {
+  if (!key) {
+    return;
+  }
+  OPENSSL_free(key->spki);
+  EVP_PKEY_free(key->pkey);
+  free(key);
+}
+
+struct Csr_template *csr_template_new(const struct Csr_template_entry *entries, size_t count, enum Csr_batch_error *err) {
+  if (!entries && count > 0) {
+    return csr_batch_fail(err, Csr_batch_error_invalid_input);
+  }
+  struct Csr_template *subject = calloc(1, sizeof(struct Csr_template));
+  if (!subject || !(subject->parts = calloc(count + 1, sizeof(struct csr_template_part)))) {
+    free(subject);
+    return csr_batch_fail(err, Csr_batch_error_out_of_memory);
+  }
+
+  enum Csr_batch_error error = Csr_batch_error_none;
+  for (size_t i = 0; i < count && error == Csr_batch_error_none; i++) {
+    const struct Csr_template_entry *entry = &entries[i];
+    if (!entry->field || OBJ_txt2nid(entry->field) == NID_undef) {
+      error = Csr_batch_error_invalid_input;
+    } else if (!entry->value) {
+      struct csr_template_part *part = &subject->parts[subject->count++];
+      part->field = strdup(entry->field);
+      subject->placeholders++;
+      error = part->field ? Csr_batch_error_none : Csr_batch_error_out_of_memory;
+    } else if (strlen(entry->value) != 0) {
+      size_t length = 0;
+      unsigned char *rdn = csr_encode_rdn(entry->field, entry->value, &length);
+      struct csr_template_part *last = subject->count > 0 ? &subject->parts[subject->count - 1] : NULL;
+      if (!rdn) {
+        error = Csr_batch_error_encoding;
+      } else if (last && last->der) {
+        // appended to the preceding fixed entries
+        unsigned char *der = realloc(last->der, last->length + length);
+        if (der) {
+          memcpy(der + last->length, rdn, length);
+          last->der = der;
+          last->length += length;
+        } else {
+          error = Csr_batch_error_out_of_memory;
+        }
+        free(rdn);
+      } else {
+        subject->parts[subject->count++] = (struct csr_template_part){ rdn, length, NULL };
+      }
+    }
+  }
+  if (error != Csr_batch_error_none) {
+    csr_template_free(subject);
+    return csr_batch_fail(err, error);
+  }
+  return subject;
+}
+
+void csr_template_free(struct Csr_template *subject) {
+  if (!subject) {
+    return;
+  }
+  for (size_t i = 0; i < subject->count; i++) {
+    free(subject->parts[i].der);
+    free(subject->parts[i].field);
+  }
+  free(subject->parts);
+  free(subject);
+}
+
+size_t csr_template_placeholders(const struct Csr_template *subject) {
+  return subject ? subject->placeholders : 0;
+}
+
+static enum Csr_batch_error csr_batch_create_one(const struct Csr_template *subject,
+                                                 const struct Csr_batch_request *request,
+                                                 enum Csr_batch_format format,
+                                                 EVP_MD_CTX *md_ctx,
+                                                 struct Csr_batch_output *output) {
+  const struct Csr_key *key = request->key;
+  if (!key || (subject->placeholders > 0 && !request->values)) {
+    return Csr_batch_error_invalid_input;
+  }
+
+  // placeholder values, encoded first to know the lengths
+  size_t rdn_lengths[subject->placeholders + 1];
+  unsigned char *rdns[subject->placeholders + 1];
+  size_t subject_length = 0;
+  size_t placeholder = 0;
+  enum Csr_batch_error error = Csr_batch_error_none;
+  for (size_t i = 0; i < subject->count; i++) {
+    const struct csr_template_part *part = &subject->parts[i];
+    if (part->der) {
+      subject_length += part->length;
+      continue;
+    }
+    const char *value = request->values[placeholder];
+    rdns[placeholder] = NULL;
+    rdn_lengths[placeholder] = 0;
+    if (value && strlen(value) != 0) {
+      rdns[placeholder] = csr_encode_rdn(part->field, value, &rdn_lengths[placeholder]);
+      error = rdns[placeholder] ? error : Csr_batch_error_encoding;
+    }
+    subject_length += rdn_lengths[placeholder];
+    placeholder++;
+  }
+
+  size_t info_length = sizeof(csr_version) + csr_der_header_length(subject_length) + subject_length +
+                       key->spki_length + sizeof(csr_attributes);
+  size_t tbs_length = csr_der_header_length(info_length) + info_length;
+  size_t signature_capacity = (size_t)EVP_PKEY_size(key->pkey);
+  size_t bit_string_capacity = 1 + signature_capacity;
+  size_t content_capacity = tbs_length + key->algorithm_length + csr_der_header_length(bit_string_capacity) + bit_string_capacity;
+  size_t der_capacity = csr_der_header_length(content_capacity) + content_capacity;
+  // the TBS is built at its final offset behind the longest possible outer header
+  size_t tbs_offset = csr_der_header_length(content_capacity);
+  unsigned char *der = error == Csr_batch_error_none ? malloc(der_capacity) : NULL;
+  error = der || error != Csr_batch_error_none ? error : Csr_batch_error_out_of_memory;
+
+  if (der) {
+    unsigned char *p = csr_der_put_header(der + tbs_offset, CSR_DER_SEQUENCE, info_length);
+    memcpy(p, csr_version, sizeof(csr_version));
+    p = csr_der_put_header(p + sizeof(csr_version), CSR_DER_SEQUENCE, subject_length);
+    placeholder = 0;
+    for (size_t i = 0; i < subject->count; i++) {
+      const struct csr_template_part *part = &subject->parts[i];
+      const unsigned char *rdn = part->der ? part->der : rdns[placeholder];
+      size_t length = part->der ? part->length : rdn_lengths[placeholder++];
+      if (length > 0) {
+        memcpy(p, rdn, length);
+        p += length;
+      }
+    }
+    memcpy(p, key->spki, key->spki_length);
+    p += key->spki_length;
+    memcpy(p, csr_attributes, sizeof(csr_attributes));
+    p += sizeof(csr_attributes);
+
+    // signature BIT STRING, its header is only known after signing
+    unsigned char *algorithm = p;
+    memcpy(algorithm, key->algorithm, key->algorithm_length);
+    unsigned char *signature = algorithm + key->algorithm_length + csr_der_header_length(bit_string_capacity) + 1;
+    size_t signature_length = signature_capacity;
+    EVP_MD_CTX_reset(md_ctx);
+    if (EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, key->pkey) != 1 ||
+        EVP_DigestSign(md_ctx, signature, &signature_length, der + tbs_offset, tbs_length) != 1) {
+      error = Csr_batch_error_signing;
+    } else {
+      unsigned char *bit_string = algorithm + key->algorithm_length;
+      size_t header_length = csr_der_header_length(1 + signature_length);
+      if (signature != bit_string + header_length + 1) {
+        memmove(bit_string + header_length + 1, signature, signature_length);
+      }
+      p = csr_der_put_header(bit_string, CSR_DER_BIT_STRING, 1 + signature_length);
+      *p++ = 0x00;
+      p += signature_length;
+
+      // outer SEQUENCE header placed right before the TBS
+      size_t content_length = (size_t)(p - (der + tbs_offset));
+      size_t outer_length = csr_der_header_length(content_length);
+      unsigned char *start = der + tbs_offset - outer_length;
+      csr_der_put_header(start, CSR_DER_SEQUENCE, content_length);
+      output->length = outer_length + content_length;
+      if (start != der) {
+        memmove(der, start, output->length);
+      }
+    }
+  }
+  for (size_t i = 0; i < placeholder && i < subject->placeholders; i++) {
+    free(rdns[i]);
+  }
+
+  if (error != Csr_batch_error_none) {
+    free(der);
+    return error;
+  }
+  if (format == Csr_batch_format_pem) {
+    unsigned char *pem = pem_encode("CERTIFICATE REQUEST", der, output->length, &output->length);
+    free(der);
+    der = pem;
+    if (!der) {
+      return Csr_batch_error_out_of_memory;
+    }
+  }
+  output->data = der;
+  return Csr_batch_error_none;
+}
+
+static void csr_batch_worker(void *context, size_t first, size_t stride) {
+  struct csr_batch_work *work = context;
+  EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+  for (size_t i = first; i < work->count; i += stride) {
+    struct Csr_batch_output *output = &work->outputs[i];
+    *output = (struct Csr_batch_output){ NULL, 0, Csr_batch_error_out_of_memory };
+    if (md_ctx) {
+      output->error = csr_batch_create_one(work->subject, &work->requests[i], work->format, md_ctx, output);
+    }
+  }
+  EVP_MD_CTX_free(md_ctx);
+}
+
+int csr_batch_create(const struct Csr_template *subject,
+                     const struct Csr_batch_request *requests,
+                     size_t count,
+                     enum Csr_batch_format format,
+                     int threads,
+                     struct Csr_batch_output *outputs,
+                     enum Csr_batch_error *err) {
+  if (!subject || (!requests && count > 0) || (!outputs && count > 0) || threads < 1) {
+    csr_batch_fail(err, Csr_batch_error_invalid_input);
+    return 0;
+  }
+  struct csr_batch_work work = { subject, requests, count, format, outputs };
+  batch_run(count, threads, csr_batch_worker, &work);
+
+  for (size_t i = 0; i < count; i++) {
+    if (outputs[i].error != Csr_batch_error_none) {
+      csr_batch_fail(err, outputs[i].error);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void csr_batch_output_free(struct Csr_batch_output *outputs, size_t count) {
+  for (size_t i = 0; outputs && i < count; i++) {
+    free(outputs[i].data);
+    outputs[i].data = NULL;
+    outputs[i].length = 0;
+  }
+}
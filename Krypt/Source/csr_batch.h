@@ -0,0 +1,146 @@
+//
+//  csr_batch.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef csr_batch_h
+#define csr_batch_h
+
+#include <stdio.h>
+
+/// Length of a P-256 private key in X9.63 form: uncompressed public point 04 || X || Y followed by the scalar D
+#define CSR_EC_P256_RAW_LENGTH 97
+
+enum Csr_batch_error {
+  Csr_batch_error_none = 0,
+  Csr_batch_error_invalid_key,
+  Csr_batch_error_invalid_input,
+  Csr_batch_error_encoding,
+  Csr_batch_error_signing,
+  Csr_batch_error_out_of_memory
+};
+
+enum Csr_batch_format {
+  Csr_batch_format_der = 0,
+  Csr_batch_format_pem
+};
+
+/**
+ Private key loaded once for many CSRs: the parsed key and its DER encoded SubjectPublicKeyInfo.
+ RSA keys sign with SHA256 and PKCS#1 v1.5 padding like `createCSR`, EC keys with ECDSA SHA256.
+ P-256 signatures use the built-in table of generator multiples of OpenSSL, the key adds no table of its own.
+ */
+struct Csr_key;
+
+/**
+ Subject of the CSRs of a batch, fixed entries are DER encoded once when the template is created,
+ placeholders are filled per request.
+ */
+struct Csr_template;
+
+struct Csr_template_entry {
+  /// Short or long name of the attribute, e.g. "C", "O", "emailAddress"
+  const char *field;
+  /// UTF-8 value, NULL for a placeholder filled per request
+  const char *value;
+};
+
+struct Csr_batch_request {
+  const struct Csr_key *key;
+  /// One UTF-8 value per placeholder of the template in template order, an empty value omits the entry
+  const char *const *values;
+};
+
+struct Csr_batch_output {
+  /// DER or PEM of the CSR, NULL on failure. Free with `csr_batch_output_free`
+  unsigned char *data;
+  size_t length;
+  enum Csr_batch_error error;
+};
+
+/**
+ Loads a private key for `csr_batch_create`
+
+ @param pem Private key in PKCS#1, SEC1 or PKCS#8 PEM format
+ @param err Error code of the failure, may be NULL
+ @return Key, NULL on failure. Free with `csr_key_free`
+ */
+struct Csr_key *csr_key_new_pem(const char *pem, enum Csr_batch_error *err);
+
+/**
+ Loads a P-256 private key in the X9.63 form `SecKeyCopyExternalRepresentation` exports, without a PEM round trip
+
+ @param raw 04 || X || Y || D, `CSR_EC_P256_RAW_LENGTH` bytes
+ @param length Length of `raw`
+ @param err Error code of the failure, may be NULL
+ @return Key, NULL on failure. Free with `csr_key_free`
+ */
+struct Csr_key *csr_key_new_ec_p256(const unsigned char *raw, size_t length, enum Csr_batch_error *err);
+
+/**
+ Frees the key
+
+ @param key Key to free, may be NULL
+ */
+void csr_key_free(struct Csr_key *key);
+
+/**
+ Creates a subject template
+
+ @param entries Entries of the subject in order, empty fixed values are omitted like in `createCSR`
+ @param count Number of entries
+ @param err Error code of the failure, may be NULL
+ @return Template, NULL on failure. Free with `csr_template_free`
+ */
+struct Csr_template *csr_template_new(const struct Csr_template_entry *entries, size_t count, enum Csr_batch_error *err);
+
+/**
+ Frees the template
+
+ @param subject Template to free, may be NULL
+ */
+void csr_template_free(struct Csr_template *subject);
+
+/**
+ Number of placeholders of the template, the number of values every request provides
+
+ @param subject Template
+ @return Number of placeholders
+ */
+size_t csr_template_placeholders(const struct Csr_template *subject);
+
+/**
+ Creates one CSR per request, the requests are spread over threads.
+
+ The CertificationRequestInfo is assembled from the pre-encoded template, the pre-encoded public key and the
+ encoded placeholder values, so per request the cost is the signature plus a few copies. The result is the
+ same CSR `createCSR` produces for the same key and subject.
+
+ @param subject Subject template
+ @param requests Key and placeholder values per CSR
+ @param count Number of requests
+ @param format DER or PEM output
+ @param threads Number of threads, 1 creates the CSRs on the calling thread, at most BATCH_MAX_THREADS (64) are used
+ @param outputs Receives one CSR or error per request, `count` elements
+ @param err Error code of the failure of the whole batch, may be NULL
+ @return Status: 1 = every CSR was created, 0 = failure, see the errors of the outputs
+ */
+int csr_batch_create(const struct Csr_template *subject,
+                     const struct Csr_batch_request *requests,
+                     size_t count,
+                     enum Csr_batch_format format,
+                     int threads,
+                     struct Csr_batch_output *outputs,
+                     enum Csr_batch_error *err);
+
+/**
+ Frees the CSRs of a batch
+
+ @param outputs Outputs of `csr_batch_create`
+ @param count Number of outputs
+ */
+void csr_batch_output_free(struct Csr_batch_output *outputs, size_t count);
+
+#endif /* csr_batch_h */
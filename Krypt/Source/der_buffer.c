@@ -0,0 +1,31 @@
+//
+//  der_buffer.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "der_buffer.h"
+#include <stdlib.h>
+#include <openssl/crypto.h>
+
+struct Der_buffer *der_buffer_new(size_t length) {
+  if (length > (size_t)-1 - sizeof(struct Der_buffer)) {
+    return NULL;
+  }
+  struct Der_buffer *buffer = malloc(sizeof(struct Der_buffer) + length);
+  if (!buffer) {
+    return NULL;
+  }
+  buffer->length = length;
+  buffer->data = (unsigned char *)(buffer + 1);
+  return buffer;
+}
+
+void der_buffer_free(struct Der_buffer *buffer) {
+  if (!buffer) {
+    return;
+  }
+  OPENSSL_cleanse(buffer->data, buffer->length);
+  free(buffer);
+}
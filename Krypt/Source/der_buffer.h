@@ -0,0 +1,39 @@
+//
+//  der_buffer.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef der_buffer_h
+#define der_buffer_h
+
+#include <stdio.h>
+
+/**
+ DER output of the `*_der` functions: the length followed by the encoding in one allocation,
+ so callers get the raw bytes without the PEM base64 round trip.
+ */
+struct Der_buffer {
+  /// Length of the encoding
+  size_t length;
+  /// Encoding, stored right behind the struct
+  unsigned char *data;
+};
+
+/**
+ Allocates a buffer for an encoding
+
+ @param length Length of the encoding
+ @return Buffer with uninitialized data, NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *der_buffer_new(size_t length);
+
+/**
+ Zeroes and frees the buffer, DER of private keys passes through it
+
+ @param buffer Buffer to free, may be NULL
+ */
+void der_buffer_free(struct Der_buffer *buffer);
+
+#endif /* der_buffer_h */
@@ -0,0 +1,241 @@
+//
+//  ecies.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "ecies.h"
+#include <pthread.h>
+#include <string.h>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/ecdh.h>
+#include <openssl/obj_mac.h>
+#include "aes256.h"
+#include "kdf.h"
+
+static const char ecies_info_label[] = "Krypt ECIES P-256 AES-256-GCM";
+
+static EC_GROUP *ecies_group;
+static pthread_once_t ecies_group_once = PTHREAD_ONCE_INIT;
+
+static void ecies_group_init(void) {
+  ecies_group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+}
+
+/*
+ The curve with its precomputed tables is shared, creating it is more expensive than a single ECDH.
+ */
+static const EC_GROUP *ecies_p256(void) {
+  pthread_once(&ecies_group_once, ecies_group_init);
+  return ecies_group;
+}
+
+static int ecies_fail(enum Ecies_error *err, enum Ecies_error error) {
+  if (err) {
+    *err = error;
+  }
+  return 0;
+}
+
+static EC_KEY *ecies_public_key(const unsigned char *public_key, size_t length) {
+  const EC_GROUP *group = ecies_p256();
+  if (!group || !public_key || length != ECIES_P256_PUBLIC_KEY_LENGTH || public_key[0] != 0x04) {
+    return NULL;
+  }
+  EC_KEY *key = EC_KEY_new();
+  EC_POINT *point = EC_POINT_new(group);
+  // oct2point rejects points that are not on the curve
+  int ok = key && point &&
+           EC_KEY_set_group(key, group) == 1 &&
+           EC_POINT_oct2point(group, point, public_key, length, NULL) == 1 &&
+           EC_KEY_set_public_key(key, point) == 1;
+  EC_POINT_free(point);
+  if (!ok) {
+    EC_KEY_free(key);
+    return NULL;
+  }
+  return key;
+}
+
+static EC_KEY *ecies_private_key(const unsigned char *private_key, size_t length) {
+  const EC_GROUP *group = ecies_p256();
+  if (!group || !private_key || (length != ECIES_P256_PRIVATE_KEY_LENGTH && length != ECIES_P256_SCALAR_LENGTH)) {
+    return NULL;
+  }
+  const unsigned char *scalar = private_key + length - ECIES_P256_SCALAR_LENGTH;
+  EC_KEY *key = EC_KEY_new();
+  BIGNUM *d = BN_bin2bn(scalar, ECIES_P256_SCALAR_LENGTH, NULL);
+  EC_POINT *point = NULL;
+  int ok = key && d && EC_KEY_set_group(key, group) == 1 && EC_KEY_set_private_key(key, d) == 1;
+  if (ok) {
+    point = EC_POINT_new(group);
+    if (length == ECIES_P256_PRIVATE_KEY_LENGTH) {
+      ok = point && EC_POINT_oct2point(group, point, private_key, ECIES_P256_PUBLIC_KEY_LENGTH, NULL) == 1;
+    } else {
+      ok = point && EC_POINT_mul(group, point, d, NULL, NULL, NULL) == 1;
+    }
+    // Keys exported by Security carry the public point, recomputing it would double the cost of a decryption
+    ok = ok && EC_KEY_set_public_key(key, point) == 1;
+  }
+  EC_POINT_free(point);
+  BN_clear_free(d);
+  if (!ok) {
+    EC_KEY_free(key);
+    return NULL;
+  }
+  return key;
+}
+
+static int ecies_encode_public_key(const EC_KEY *key, unsigned char *out) {
+  return EC_POINT_point2oct(EC_KEY_get0_group(key), EC_KEY_get0_public_key(key), POINT_CONVERSION_UNCOMPRESSED,
+                            out, ECIES_P256_PUBLIC_KEY_LENGTH, NULL) == ECIES_P256_PUBLIC_KEY_LENGTH;
+}
+
+/*
+ ECDH of private with peer, followed by HKDF SHA256 with info = label || ephemeral public key || recipient public key.
+ */
+static int ecies_derive(const EC_KEY *private, const EC_KEY *peer,
+                        const unsigned char *ephemeral_public_key, const unsigned char *recipient_public_key,
+                        unsigned char *key, unsigned char *iv) {
+  unsigned char secret[32];
+  if (ECDH_compute_key(secret, sizeof(secret), EC_KEY_get0_public_key(peer), (EC_KEY *)private, NULL) != (int)sizeof(secret)) {
+    OPENSSL_cleanse(secret, sizeof(secret));
+    return 0;
+  }
+
+  unsigned char info[sizeof(ecies_info_label) - 1 + 2 * ECIES_P256_PUBLIC_KEY_LENGTH];
+  memcpy(info, ecies_info_label, sizeof(ecies_info_label) - 1);
+  memcpy(info + sizeof(ecies_info_label) - 1, ephemeral_public_key, ECIES_P256_PUBLIC_KEY_LENGTH);
+  memcpy(info + sizeof(ecies_info_label) - 1 + ECIES_P256_PUBLIC_KEY_LENGTH, recipient_public_key, ECIES_P256_PUBLIC_KEY_LENGTH);
+
+  unsigned char derived[AES256_KEY_LENGTH + AES256_IV_LENGTH];
+  int ok = hkdf_sha256(secret, sizeof(secret), NULL, 0, info, sizeof(info), derived, sizeof(derived));
+  if (ok) {
+    memcpy(key, derived, AES256_KEY_LENGTH);
+    memcpy(iv, derived + AES256_KEY_LENGTH, AES256_IV_LENGTH);
+  }
+  OPENSSL_cleanse(secret, sizeof(secret));
+  OPENSSL_cleanse(derived, sizeof(derived));
+  return ok;
+}
+
+int ecies_p256_derive_for_recipient(const unsigned char *recipient_public_key,
+                                    size_t recipient_public_key_length,
+                                    unsigned char *ephemeral_public_key,
+                                    unsigned char *key,
+                                    unsigned char *iv,
+                                    enum Ecies_error *err) {
+  if (!ephemeral_public_key || !key || !iv) {
+    return ecies_fail(err, Ecies_error_invalid_input);
+  }
+  EC_KEY *recipient = ecies_public_key(recipient_public_key, recipient_public_key_length);
+  if (!recipient) {
+    return ecies_fail(err, Ecies_error_invalid_key);
+  }
+
+  EC_KEY *ephemeral = EC_KEY_new();
+  int ok = ephemeral &&
+           EC_KEY_set_group(ephemeral, ecies_p256()) == 1 &&
+           EC_KEY_generate_key(ephemeral) == 1 &&
+           ecies_encode_public_key(ephemeral, ephemeral_public_key) &&
+           ecies_derive(ephemeral, recipient, ephemeral_public_key, recipient_public_key, key, iv);
+  EC_KEY_free(ephemeral);
+  EC_KEY_free(recipient);
+  if (!ok) {
+    return ecies_fail(err, Ecies_error_key_agreement);
+  }
+  return 1;
+}
+
+int ecies_p256_derive_for_private_key(const unsigned char *private_key,
+                                      size_t private_key_length,
+                                      const unsigned char *ephemeral_public_key,
+                                      size_t ephemeral_public_key_length,
+                                      unsigned char *key,
+                                      unsigned char *iv,
+                                      enum Ecies_error *err) {
+  if (!key || !iv) {
+    return ecies_fail(err, Ecies_error_invalid_input);
+  }
+  EC_KEY *recipient = ecies_private_key(private_key, private_key_length);
+  if (!recipient) {
+    return ecies_fail(err, Ecies_error_invalid_key);
+  }
+  EC_KEY *ephemeral = ecies_public_key(ephemeral_public_key, ephemeral_public_key_length);
+  if (!ephemeral) {
+    EC_KEY_free(recipient);
+    return ecies_fail(err, Ecies_error_invalid_input);
+  }
+
+  unsigned char recipient_public_key[ECIES_P256_PUBLIC_KEY_LENGTH];
+  int ok = ecies_encode_public_key(recipient, recipient_public_key) &&
+           ecies_derive(recipient, ephemeral, ephemeral_public_key, recipient_public_key, key, iv);
+  EC_KEY_free(ephemeral);
+  EC_KEY_free(recipient);
+  if (!ok) {
+    return ecies_fail(err, Ecies_error_key_agreement);
+  }
+  return 1;
+}
+
+static enum Ecies_error ecies_aes_error(enum Aes256_error error) {
+  switch (error) {
+    case Aes256_error_buffer_too_small:
+      return Ecies_error_buffer_too_small;
+    case Aes256_error_authentication:
+      return Ecies_error_authentication;
+    case Aes256_error_invalid_input:
+      return Ecies_error_invalid_input;
+    default:
+      return Ecies_error_cipher;
+  }
+}
+
+int ecies_p256_encrypt(const unsigned char *recipient_public_key,
+                       size_t recipient_public_key_length,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *ephemeral_public_key,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Ecies_error *err) {
+  if (out_capacity < aes256_encrypted_length(Aes256_block_mode_gcm, in_length)) {
+    return ecies_fail(err, Ecies_error_buffer_too_small);
+  }
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  if (!ecies_p256_derive_for_recipient(recipient_public_key, recipient_public_key_length, ephemeral_public_key, key, iv, err)) {
+    return 0;
+  }
+  enum Aes256_error aes_err = Aes256_error_none;
+  int ok = aes256_encrypt(Aes256_block_mode_gcm, key, iv, in, in_length, out, out_capacity, out_length, &aes_err);
+  OPENSSL_cleanse(key, sizeof(key));
+  OPENSSL_cleanse(iv, sizeof(iv));
+  return ok ? 1 : ecies_fail(err, ecies_aes_error(aes_err));
+}
+
+int ecies_p256_decrypt(const unsigned char *private_key,
+                       size_t private_key_length,
+                       const unsigned char *ephemeral_public_key,
+                       size_t ephemeral_public_key_length,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Ecies_error *err) {
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  if (!ecies_p256_derive_for_private_key(private_key, private_key_length, ephemeral_public_key, ephemeral_public_key_length, key, iv, err)) {
+    return 0;
+  }
+  enum Aes256_error aes_err = Aes256_error_none;
+  int ok = aes256_decrypt(Aes256_block_mode_gcm, key, iv, in, in_length, out, out_capacity, out_length, &aes_err);
+  OPENSSL_cleanse(key, sizeof(key));
+  OPENSSL_cleanse(iv, sizeof(iv));
+  return ok ? 1 : ecies_fail(err, ecies_aes_error(aes_err));
+}
@@ -0,0 +1,122 @@
+//
+//  ecies.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef ecies_h
+#define ecies_h
+
+#include <stdio.h>
+
+/// Uncompressed X9.63 P-256 public key: 0x04 || X || Y
+#define ECIES_P256_PUBLIC_KEY_LENGTH 65
+/// P-256 private scalar
+#define ECIES_P256_SCALAR_LENGTH 32
+/// X9.63 P-256 private key as exported by Security: 0x04 || X || Y || K
+#define ECIES_P256_PRIVATE_KEY_LENGTH 97
+
+enum Ecies_error {
+  Ecies_error_none = 0,
+  Ecies_error_invalid_key,
+  Ecies_error_invalid_input,
+  Ecies_error_buffer_too_small,
+  Ecies_error_key_agreement,
+  Ecies_error_cipher,
+  Ecies_error_authentication
+};
+
+/**
+ Sender side of ECIES on P-256: generates an ephemeral key pair, agrees on a shared secret with the recipient (ECDH)
+ and derives the AES 256 GCM key and the 16 bytes IV from it with HKDF SHA256.
+ The HKDF info binds both public keys, so the derived key is unique to this ephemeral key and recipient.
+
+ @param recipient_public_key Uncompressed X9.63 public key of the recipient
+ @param recipient_public_key_length Length of the recipient public key, 65
+ @param ephemeral_public_key Returns the 65 bytes uncompressed ephemeral public key, to be sent along the ciphertext
+ @param key Returns the 32 bytes AES key
+ @param iv Returns the 16 bytes IV
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int ecies_p256_derive_for_recipient(const unsigned char *recipient_public_key,
+                                    size_t recipient_public_key_length,
+                                    unsigned char *ephemeral_public_key,
+                                    unsigned char *key,
+                                    unsigned char *iv,
+                                    enum Ecies_error *err);
+
+/**
+ Recipient side of ECIES on P-256: derives the AES key and IV from the ephemeral public key of the sender.
+ See `ecies_p256_derive_for_recipient`.
+
+ @param private_key X9.63 private key (97 bytes) or the raw private scalar (32 bytes)
+ @param private_key_length Length of the private key
+ @param ephemeral_public_key Uncompressed ephemeral public key of the sender
+ @param ephemeral_public_key_length Length of the ephemeral public key, 65
+ @param key Returns the 32 bytes AES key
+ @param iv Returns the 16 bytes IV
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int ecies_p256_derive_for_private_key(const unsigned char *private_key,
+                                      size_t private_key_length,
+                                      const unsigned char *ephemeral_public_key,
+                                      size_t ephemeral_public_key_length,
+                                      unsigned char *key,
+                                      unsigned char *iv,
+                                      enum Ecies_error *err);
+
+/**
+ Encrypts with ECIES on P-256 and AES 256 GCM.
+ The output has the same layout as `aes256_encrypt` with GCM: ciphertext followed by the 16 bytes tag.
+
+ @param recipient_public_key Uncompressed X9.63 public key of the recipient
+ @param recipient_public_key_length Length of the recipient public key, 65
+ @param in Plaintext
+ @param in_length Number of plaintext bytes
+ @param ephemeral_public_key Returns the 65 bytes ephemeral public key
+ @param out Buffer for the ciphertext, at least in_length + 16 bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int ecies_p256_encrypt(const unsigned char *recipient_public_key,
+                       size_t recipient_public_key_length,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *ephemeral_public_key,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Ecies_error *err);
+
+/**
+ Decrypts data produced by `ecies_p256_encrypt`.
+
+ @param private_key X9.63 private key (97 bytes) or the raw private scalar (32 bytes)
+ @param private_key_length Length of the private key
+ @param ephemeral_public_key Ephemeral public key of the sender
+ @param ephemeral_public_key_length Length of the ephemeral public key, 65
+ @param in Ciphertext followed by the tag
+ @param in_length Number of ciphertext bytes
+ @param out Buffer for the plaintext, at least in_length - 16 bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int ecies_p256_decrypt(const unsigned char *private_key,
+                       size_t private_key_length,
+                       const unsigned char *ephemeral_public_key,
+                       size_t ephemeral_public_key_length,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Ecies_error *err);
+
+#endif /* ecies_h */
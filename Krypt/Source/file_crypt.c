@@ -0,0 +1,923 @@
+//
+//  file_crypt.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// sync_file_range
+#define _GNU_SOURCE
+#endif
+
+#include "file_crypt.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define FILE_CRYPT_IO_URING 1
+#endif
+#endif
+#endif
+
+#define FILE_CRYPT_DEFAULT_CHUNK_SIZE (256 * 1024)
+#define FILE_CRYPT_DEFAULT_RING_SLOTS 8
+#define FILE_CRYPT_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+// Room for what EVP_CipherUpdate may hold back from the previous chunk plus padding or the tag
+#define FILE_CRYPT_OUT_PADDING 64
+// Part of the mappings that is ciphered before its pages are released
+#define FILE_CRYPT_MAPPED_WINDOW (8 * 1024 * 1024)
+
+// MARK: RING
+
+enum slot_state {
+  slot_state_free,
+  slot_state_read,
+  slot_state_ciphered
+};
+
+struct slot {
+  enum slot_state state;
+  unsigned char *in;
+  unsigned char *out;
+  size_t in_length;
+  size_t out_length;
+  off_t in_offset;
+  int last;
+};
+
+struct pipeline {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  struct slot *slots;
+  int slot_count;
+  size_t chunk_size;
+
+  int in_fd;
+  int out_fd;
+  off_t payload_length;
+  int use_io_uring;
+
+  EVP_CIPHER_CTX *ctx;
+  enum Aes256_block_mode mode;
+  int encrypt;
+  unsigned char tag[AES256_TAG_LENGTH];
+
+  int failed;
+  enum File_crypt_error error;
+};
+
+/*
+ Marks the pipeline as failed and wakes up all stages so they can bail out.
+ Only the first error is kept.
+ */
+static void pipeline_fail(struct pipeline *p, enum File_crypt_error error) {
+  pthread_mutex_lock(&p->lock);
+  if (!p->failed) {
+    p->failed = 1;
+    p->error = error;
+  }
+  pthread_cond_broadcast(&p->changed);
+  pthread_mutex_unlock(&p->lock);
+}
+
+/*
+ Waits until the slot at index reaches the state and returns the number of consecutive slots
+ (up to max) that are in that state. Returns 0 if the pipeline failed meanwhile.
+ */
+static int pipeline_wait(struct pipeline *p, long index, enum slot_state state, int max) {
+  pthread_mutex_lock(&p->lock);
+  while (!p->failed && p->slots[index % p->slot_count].state != state) {
+    pthread_cond_wait(&p->changed, &p->lock);
+  }
+  int count = 0;
+  if (!p->failed) {
+    while (count < max && p->slots[(index + count) % p->slot_count].state == state) {
+      count++;
+      if (p->slots[(index + count - 1) % p->slot_count].last) {
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&p->lock);
+  return count;
+}
+
+static void pipeline_publish(struct pipeline *p, long index, int count, enum slot_state state) {
+  pthread_mutex_lock(&p->lock);
+  for (int i = 0; i < count; i++) {
+    p->slots[(index + i) % p->slot_count].state = state;
+  }
+  pthread_cond_broadcast(&p->changed);
+  pthread_mutex_unlock(&p->lock);
+}
+
+// MARK: POSIX I/O
+
+static int read_fully(int fd, unsigned char *buf, size_t length, off_t offset) {
+  size_t done = 0;
+  while (done < length) {
+    ssize_t ret = pread(fd, buf + done, length - done, offset + (off_t)done);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return 0;
+    }
+    done += (size_t)ret;
+  }
+  return 1;
+}
+
+static int write_fully(int fd, const unsigned char *buf, size_t length, off_t offset) {
+  size_t done = 0;
+  while (done < length) {
+    ssize_t ret = pwrite(fd, buf + done, length - done, offset + (off_t)done);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return 0;
+    }
+    done += (size_t)ret;
+  }
+  return 1;
+}
+
+// MARK: IO_URING
+
+#ifdef FILE_CRYPT_IO_URING
+
+struct uring {
+  int fd;
+  unsigned entries;
+  void *sq_ptr;
+  size_t sq_length;
+  void *cq_ptr;
+  size_t cq_length;
+  struct io_uring_sqe *sqes;
+  size_t sqes_length;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+};
+
+static void uring_close(struct uring *ring) {
+  if (ring->sqes && ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_length);
+  }
+  if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+    munmap(ring->cq_ptr, ring->cq_length);
+  }
+  if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) {
+    munmap(ring->sq_ptr, ring->sq_length);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+/*
+ Sets up an io_uring instance with raw syscalls. Returns 0 when io_uring is not available
+ (old kernel, seccomp, disabled by sysctl), in which case the caller uses pread/pwrite.
+ */
+static int uring_open(struct uring *ring, unsigned entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(*ring));
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    ring->fd = -1;
+    return 0;
+  }
+  ring->entries = params.sq_entries;
+
+  ring->sq_length = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_length = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && ring->cq_length > ring->sq_length) {
+    ring->sq_length = ring->cq_length;
+  }
+
+  ring->sq_ptr = mmap(NULL, ring->sq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED) {
+    uring_close(ring);
+    return 0;
+  }
+  if (single_mmap) {
+    ring->cq_ptr = ring->sq_ptr;
+  } else {
+    ring->cq_ptr = mmap(NULL, ring->cq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED) {
+      uring_close(ring);
+      return 0;
+    }
+  }
+  ring->sqes_length = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    uring_close(ring);
+    return 0;
+  }
+
+  unsigned char *sq = ring->sq_ptr;
+  unsigned char *cq = ring->cq_ptr;
+  ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+  ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return 1;
+}
+
+/*
+ Submits one vectored read or write per iovec and waits for all of them.
+ Short transfers are completed with pread/pwrite. If submitting fails, the entries the kernel did not take are
+ transferred with pread/pwrite and the ones it took are still waited for, so no buffer is in use on return.
+ Returns 1 on success.
+ */
+static int uring_transfer(struct uring *ring, int fd, int is_write, struct iovec *iovs, const off_t *offsets, unsigned count) {
+  unsigned tail = *ring->sq_tail;
+  unsigned mask = *ring->sq_mask;
+  for (unsigned i = 0; i < count; i++) {
+    unsigned index = (tail + i) & mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)&iovs[i];
+    sqe->len = 1;
+    sqe->off = (unsigned long long)offsets[i];
+    sqe->user_data = i;
+    ring->sq_array[index] = index;
+  }
+  __atomic_store_n(ring->sq_tail, tail + count, __ATOMIC_RELEASE);
+
+  // entries the kernel owns are waited for, `expected` drops to `submitted` when submitting fails
+  unsigned submitted = 0;
+  unsigned expected = count;
+  unsigned completed = 0;
+  int ok = 1;
+  while (completed < expected) {
+    int ret = (int)syscall(__NR_io_uring_enter, ring->fd, expected - submitted, expected - completed,
+                           IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0 && (errno == EINTR || submitted == expected)) {
+      // only waiting, the submitted requests still read into or write from the buffers
+      continue;
+    }
+    if (ret < 0) {
+      // take back the entries the kernel has not consumed and transfer them here
+      submitted = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) - tail;
+      __atomic_store_n(ring->sq_tail, tail + submitted, __ATOMIC_RELEASE);
+      for (unsigned i = submitted; i < count; i++) {
+        ok &= is_write ? write_fully(fd, iovs[i].iov_base, iovs[i].iov_len, offsets[i])
+                       : read_fully(fd, iovs[i].iov_base, iovs[i].iov_len, offsets[i]);
+      }
+      expected = submitted;
+      continue;
+    }
+    submitted += (unsigned)ret < expected - submitted ? (unsigned)ret : expected - submitted;
+
+    unsigned head = *ring->cq_head;
+    unsigned cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != cq_tail) {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      unsigned i = (unsigned)cqe->user_data;
+      if (cqe->res < 0) {
+        ok = 0;
+      } else if ((size_t)cqe->res < iovs[i].iov_len) {
+        size_t done = (size_t)cqe->res;
+        unsigned char *base = (unsigned char *)iovs[i].iov_base + done;
+        size_t rest = iovs[i].iov_len - done;
+        off_t offset = offsets[i] + (off_t)done;
+        ok &= is_write ? write_fully(fd, base, rest, offset) : read_fully(fd, base, rest, offset);
+      }
+      head++;
+      completed++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+  return ok;
+}
+
+#endif
+
+// MARK: STAGES
+
+/*
+ Reads consecutive chunks of the payload into free slots.
+ */
+static void *pipeline_reader(void *arg) {
+  struct pipeline *p = arg;
+  off_t offset = 0;
+  long index = 0;
+  int done = 0;
+
+#ifdef FILE_CRYPT_IO_URING
+  struct uring ring;
+  int use_io_uring = p->use_io_uring && uring_open(&ring, (unsigned)p->slot_count);
+  struct iovec *iovs = calloc((size_t)p->slot_count, sizeof(struct iovec));
+  off_t *offsets = calloc((size_t)p->slot_count, sizeof(off_t));
+  if (!iovs || !offsets) {
+    use_io_uring = 0;
+  }
+#endif
+
+  while (!done) {
+    int count = pipeline_wait(p, index, slot_state_free, p->slot_count);
+    if (count == 0) {
+      break;
+    }
+
+    int filled = 0;
+    for (; filled < count && !done; filled++) {
+      struct slot *s = &p->slots[(index + filled) % p->slot_count];
+      off_t remaining = p->payload_length - offset;
+      s->in_offset = offset;
+      s->in_length = remaining < (off_t)p->chunk_size ? (size_t)remaining : p->chunk_size;
+      offset += (off_t)s->in_length;
+      s->last = offset >= p->payload_length;
+      done = s->last;
+    }
+
+    int ok = 1;
+#ifdef FILE_CRYPT_IO_URING
+    if (use_io_uring) {
+      for (int i = 0; i < filled; i++) {
+        struct slot *s = &p->slots[(index + i) % p->slot_count];
+        iovs[i].iov_base = s->in;
+        iovs[i].iov_len = s->in_length;
+        offsets[i] = s->in_offset;
+      }
+      ok = uring_transfer(&ring, p->in_fd, 0, iovs, offsets, (unsigned)filled);
+    } else
+#endif
+    {
+      for (int i = 0; i < filled && ok; i++) {
+        struct slot *s = &p->slots[(index + i) % p->slot_count];
+        ok = read_fully(p->in_fd, s->in, s->in_length, s->in_offset);
+      }
+    }
+    if (!ok) {
+      pipeline_fail(p, File_crypt_error_io);
+      break;
+    }
+
+    pipeline_publish(p, index, filled, slot_state_read);
+    index += filled;
+  }
+
+#ifdef FILE_CRYPT_IO_URING
+  if (use_io_uring) {
+    uring_close(&ring);
+  }
+  free(iovs);
+  free(offsets);
+#endif
+  return NULL;
+}
+
+/*
+ Writes ciphered slots in order and hands them back to the reader.
+ */
+static void *pipeline_writer(void *arg) {
+  struct pipeline *p = arg;
+  off_t offset = 0;
+  long index = 0;
+  int done = 0;
+
+#ifdef FILE_CRYPT_IO_URING
+  struct uring ring;
+  int use_io_uring = p->use_io_uring && uring_open(&ring, (unsigned)p->slot_count);
+  struct iovec *iovs = calloc((size_t)p->slot_count, sizeof(struct iovec));
+  off_t *offsets = calloc((size_t)p->slot_count, sizeof(off_t));
+  if (!iovs || !offsets) {
+    use_io_uring = 0;
+  }
+#endif
+
+  while (!done) {
+    int count = pipeline_wait(p, index, slot_state_ciphered, p->slot_count);
+    if (count == 0) {
+      break;
+    }
+
+    int ok = 1;
+#ifdef FILE_CRYPT_IO_URING
+    if (use_io_uring) {
+      unsigned submitted = 0;
+      off_t next = offset;
+      for (int i = 0; i < count; i++) {
+        struct slot *s = &p->slots[(index + i) % p->slot_count];
+        if (s->out_length == 0) {
+          continue;
+        }
+        iovs[submitted].iov_base = s->out;
+        iovs[submitted].iov_len = s->out_length;
+        offsets[submitted] = next;
+        next += (off_t)s->out_length;
+        submitted++;
+      }
+      ok = submitted == 0 || uring_transfer(&ring, p->out_fd, 1, iovs, offsets, submitted);
+      offset = next;
+    } else
+#endif
+    {
+      for (int i = 0; i < count && ok; i++) {
+        struct slot *s = &p->slots[(index + i) % p->slot_count];
+        ok = write_fully(p->out_fd, s->out, s->out_length, offset);
+        offset += (off_t)s->out_length;
+      }
+    }
+    if (!ok) {
+      pipeline_fail(p, File_crypt_error_io);
+      break;
+    }
+
+    done = p->slots[(index + count - 1) % p->slot_count].last;
+    pipeline_publish(p, index, count, slot_state_free);
+    index += count;
+  }
+
+#ifdef FILE_CRYPT_IO_URING
+  if (use_io_uring) {
+    uring_close(&ring);
+  }
+  free(iovs);
+  free(offsets);
+#endif
+  return NULL;
+}
+
+/*
+ Runs the cipher over the read slots in order. Finalizes the cipher on the last slot,
+ appending the padding (CBC) or the tag (GCM encryption) to its output.
+ */
+static void pipeline_cipher(struct pipeline *p) {
+  long index = 0;
+  for (;;) {
+    if (pipeline_wait(p, index, slot_state_read, 1) == 0) {
+      return;
+    }
+    struct slot *s = &p->slots[index % p->slot_count];
+    // once published the writer frees the slot and the reader may refill it, so it is not read afterwards
+    int last = s->last;
+
+    int outl = 0;
+    if (s->in_length > 0 && EVP_CipherUpdate(p->ctx, s->out, &outl, s->in, (int)s->in_length) != 1) {
+      pipeline_fail(p, File_crypt_error_cipher);
+      return;
+    }
+    s->out_length = (size_t)outl;
+
+    if (last) {
+      int finall = 0;
+      if (EVP_CipherFinal_ex(p->ctx, s->out + s->out_length, &finall) != 1) {
+        int gcm_decrypt = p->mode == Aes256_block_mode_gcm && !p->encrypt;
+        pipeline_fail(p, gcm_decrypt ? File_crypt_error_authentication : File_crypt_error_cipher);
+        return;
+      }
+      s->out_length += (size_t)finall;
+
+      if (p->mode == Aes256_block_mode_gcm && p->encrypt) {
+        if (EVP_CIPHER_CTX_ctrl(p->ctx, EVP_CTRL_GCM_GET_TAG, AES256_TAG_LENGTH, s->out + s->out_length) != 1) {
+          pipeline_fail(p, File_crypt_error_cipher);
+          return;
+        }
+        s->out_length += AES256_TAG_LENGTH;
+      }
+    }
+
+    pipeline_publish(p, index, 1, slot_state_ciphered);
+    if (last) {
+      return;
+    }
+    index++;
+  }
+}
+
+// MARK: SETUP
+
+static void pipeline_free(struct pipeline *p) {
+  if (p->slots) {
+    for (int i = 0; i < p->slot_count; i++) {
+      free(p->slots[i].in);
+      free(p->slots[i].out);
+    }
+    free(p->slots);
+  }
+  EVP_CIPHER_CTX_free(p->ctx);
+  if (p->in_fd >= 0) {
+    close(p->in_fd);
+  }
+  if (p->out_fd >= 0) {
+    close(p->out_fd);
+  }
+  pthread_cond_destroy(&p->changed);
+  pthread_mutex_destroy(&p->lock);
+}
+
+static int file_crypt(const char *in_path,
+               const char *out_path,
+               enum Aes256_block_mode mode,
+               int encrypt,
+               const unsigned char *key,
+               const unsigned char *iv,
+               const struct File_crypt_options *options,
+               enum File_crypt_error *err) {
+  enum File_crypt_error error = File_crypt_error_none;
+  struct pipeline p;
+  memset(&p, 0, sizeof(p));
+  p.in_fd = -1;
+  p.out_fd = -1;
+  p.mode = mode;
+  p.encrypt = encrypt;
+  pthread_mutex_init(&p.lock, NULL);
+  pthread_cond_init(&p.changed, NULL);
+
+  p.chunk_size = options && options->chunk_size ? options->chunk_size : FILE_CRYPT_DEFAULT_CHUNK_SIZE;
+  p.slot_count = options && options->ring_slots > 0 ? options->ring_slots : FILE_CRYPT_DEFAULT_RING_SLOTS;
+  p.use_io_uring = !(options && options->disable_io_uring);
+
+  if (!in_path || !out_path || !key || !iv || p.chunk_size > FILE_CRYPT_MAX_CHUNK_SIZE) {
+    pipeline_free(&p);
+    if (err) {
+      *err = File_crypt_error_invalid_input;
+    }
+    return 0;
+  }
+
+  struct stat st;
+  p.in_fd = open(in_path, O_RDONLY);
+  if (p.in_fd < 0 || fstat(p.in_fd, &st) != 0) {
+    pipeline_free(&p);
+    if (err) {
+      *err = File_crypt_error_io;
+    }
+    return 0;
+  }
+
+  p.payload_length = st.st_size;
+  if (mode == Aes256_block_mode_gcm && !encrypt) {
+    // Tag is stored after the ciphertext, it is needed only when finalizing
+    if (st.st_size < AES256_TAG_LENGTH) {
+      error = File_crypt_error_invalid_input;
+    } else {
+      p.payload_length = st.st_size - AES256_TAG_LENGTH;
+      if (!read_fully(p.in_fd, p.tag, AES256_TAG_LENGTH, p.payload_length)) {
+        error = File_crypt_error_io;
+      }
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    p.ctx = aes256_cipher_ctx_new(mode, encrypt, key, iv);
+    if (!p.ctx) {
+      error = File_crypt_error_cipher;
+    } else if (mode == Aes256_block_mode_gcm && !encrypt &&
+               EVP_CIPHER_CTX_ctrl(p.ctx, EVP_CTRL_GCM_SET_TAG, AES256_TAG_LENGTH, p.tag) != 1) {
+      error = File_crypt_error_cipher;
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    p.slots = calloc((size_t)p.slot_count, sizeof(struct slot));
+    for (int i = 0; p.slots && i < p.slot_count; i++) {
+      p.slots[i].in = malloc(p.chunk_size);
+      p.slots[i].out = malloc(p.chunk_size + FILE_CRYPT_OUT_PADDING);
+      if (!p.slots[i].in || !p.slots[i].out) {
+        error = File_crypt_error_out_of_memory;
+      }
+    }
+    if (!p.slots) {
+      error = File_crypt_error_out_of_memory;
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    p.out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (p.out_fd < 0) {
+      error = File_crypt_error_io;
+    }
+  }
+
+  if (error != File_crypt_error_none) {
+    pipeline_free(&p);
+    if (err) {
+      *err = error;
+    }
+    return 0;
+  }
+
+  pthread_t reader;
+  pthread_t writer;
+  int reader_started = pthread_create(&reader, NULL, pipeline_reader, &p) == 0;
+  int writer_started = reader_started && pthread_create(&writer, NULL, pipeline_writer, &p) == 0;
+  if (writer_started) {
+    pipeline_cipher(&p);
+  } else {
+    pipeline_fail(&p, File_crypt_error_out_of_memory);
+  }
+  if (reader_started) {
+    pthread_join(reader, NULL);
+  }
+  if (writer_started) {
+    pthread_join(writer, NULL);
+  }
+
+  error = p.failed ? p.error : File_crypt_error_none;
+  pipeline_free(&p);
+
+  if (error != File_crypt_error_none) {
+    unlink(out_path);
+    if (err) {
+      *err = error;
+    }
+    return 0;
+  }
+  return 1;
+}
+
+int file_encrypt(const char *in_path,
+                 const char *out_path,
+                 enum Aes256_block_mode mode,
+                 const unsigned char *key,
+                 const unsigned char *iv,
+                 const struct File_crypt_options *options,
+                 enum File_crypt_error *err) {
+  return file_crypt(in_path, out_path, mode, 1, key, iv, options, err);
+}
+
+int file_decrypt(const char *in_path,
+                 const char *out_path,
+                 enum Aes256_block_mode mode,
+                 const unsigned char *key,
+                 const unsigned char *iv,
+                 const struct File_crypt_options *options,
+                 enum File_crypt_error *err) {
+  return file_crypt(in_path, out_path, mode, 0, key, iv, options, err);
+}
+
+// MARK: MEMORY MAPPED
+
+/*
+ Starts writing back the output pages [start, end) without waiting for the disk.
+ Returns 0 if the write back could not be started.
+ */
+static int mapped_write_back_start(int fd, unsigned char *out, size_t start, size_t end) {
+#if defined(__linux__)
+  (void)out;
+  return sync_file_range(fd, (off_t)start, (off_t)(end - start), SYNC_FILE_RANGE_WRITE) == 0;
+#else
+  (void)fd;
+  return msync(out + start, end - start, MS_ASYNC) == 0;
+#endif
+}
+
+/*
+ Waits until the output pages [start, end) are written back and drops them from the mapping, so the resident set
+ stays bounded by two windows. Returns 0 if the write back failed.
+ */
+static int mapped_write_back_finish(int fd, unsigned char *out, size_t start, size_t end) {
+#if defined(__linux__)
+  unsigned int flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+  if (sync_file_range(fd, (off_t)start, (off_t)(end - start), flags) != 0) {
+    return 0;
+  }
+#else
+  (void)fd;
+  if (msync(out + start, end - start, MS_SYNC) != 0) {
+    return 0;
+  }
+#endif
+  madvise(out + start, end - start, MADV_DONTNEED);
+  return 1;
+}
+
+static int file_crypt_mapped(const char *in_path,
+                             const char *out_path,
+                             enum Aes256_block_mode mode,
+                             int encrypt,
+                             const unsigned char *key,
+                             const unsigned char *iv,
+                             enum File_crypt_error *err) {
+  enum File_crypt_error error = File_crypt_error_none;
+  int in_fd = -1;
+  int out_fd = -1;
+  unsigned char *in = NULL;
+  unsigned char *out = NULL;
+  size_t in_length = 0;
+  size_t payload_length = 0;
+  size_t out_capacity = 0;
+  size_t out_length = 0;
+  EVP_CIPHER_CTX *ctx = NULL;
+  int gcm = mode == Aes256_block_mode_gcm;
+
+  if (!in_path || !out_path || !key || !iv) {
+    error = File_crypt_error_invalid_input;
+  }
+
+  struct stat st;
+  if (error == File_crypt_error_none) {
+    in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0 || fstat(in_fd, &st) != 0) {
+      error = File_crypt_error_io;
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    in_length = (size_t)st.st_size;
+    payload_length = in_length;
+    if (encrypt) {
+      out_capacity = aes256_encrypted_length(mode, in_length);
+    } else if (gcm) {
+      if (in_length < AES256_TAG_LENGTH) {
+        error = File_crypt_error_invalid_input;
+      } else {
+        payload_length = in_length - AES256_TAG_LENGTH;
+        out_capacity = payload_length;
+      }
+    } else {
+      // Padding is only known after the last block, the file is truncated afterwards
+      out_capacity = in_length;
+    }
+  }
+
+  if (error == File_crypt_error_none && in_length > 0) {
+    in = mmap(NULL, in_length, PROT_READ, MAP_SHARED, in_fd, 0);
+    if (in == MAP_FAILED) {
+      in = NULL;
+      error = File_crypt_error_io;
+    } else {
+      madvise(in, in_length, MADV_SEQUENTIAL);
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (out_fd < 0 || ftruncate(out_fd, (off_t)out_capacity) != 0) {
+      error = File_crypt_error_io;
+    }
+  }
+
+  if (error == File_crypt_error_none && out_capacity > 0) {
+    out = mmap(NULL, out_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+    if (out == MAP_FAILED) {
+      out = NULL;
+      error = File_crypt_error_io;
+    } else {
+      madvise(out, out_capacity, MADV_SEQUENTIAL);
+    }
+  }
+
+  if (error == File_crypt_error_none) {
+    ctx = aes256_cipher_ctx_new(mode, encrypt, key, iv);
+    if (!ctx) {
+      error = File_crypt_error_cipher;
+    } else if (gcm && !encrypt &&
+               EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AES256_TAG_LENGTH, in + payload_length) != 1) {
+      error = File_crypt_error_cipher;
+    }
+  }
+
+  // Cipher straight from the input mapping into the output mapping
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t offset = 0;
+  size_t released_in = 0;
+  // Output pages of the previous window are being written back, those before it are written and dropped
+  size_t released_out = 0;
+  size_t started_out = 0;
+  while (error == File_crypt_error_none && offset < payload_length) {
+    size_t window = payload_length - offset < FILE_CRYPT_MAPPED_WINDOW ? payload_length - offset : FILE_CRYPT_MAPPED_WINDOW;
+#if defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+    // One call maps the pages of the window instead of a page fault per page, best effort
+    size_t in_page = offset - offset % page_size;
+    size_t out_page = out_length - out_length % page_size;
+    size_t out_end = out_length + window + AES256_BLOCK_LENGTH;
+    out_end = out_end < out_capacity ? out_end : out_capacity;
+    madvise(in + in_page, offset + window - in_page, MADV_POPULATE_READ);
+    madvise(out + out_page, out_end - out_page, MADV_POPULATE_WRITE);
+#endif
+    int outl = 0;
+    if (EVP_CipherUpdate(ctx, out + out_length, &outl, in + offset, (int)window) != 1) {
+      error = File_crypt_error_cipher;
+      break;
+    }
+    offset += window;
+    out_length += (size_t)outl;
+
+    // Input pages are clean and simply dropped
+    size_t ciphered_in = offset - offset % page_size;
+    if (ciphered_in > released_in) {
+      madvise(in + released_in, ciphered_in - released_in, MADV_DONTNEED);
+      released_in = ciphered_in;
+    }
+    // Output pages of this window start their write back while the next one is ciphered, those of the previous
+    // window are waited for one window behind
+    size_t ciphered_out = out_length - out_length % page_size;
+    if (ciphered_out > started_out && !mapped_write_back_start(out_fd, out, started_out, ciphered_out)) {
+      error = File_crypt_error_io;
+      break;
+    }
+    if (started_out > released_out && !mapped_write_back_finish(out_fd, out, released_out, started_out)) {
+      error = File_crypt_error_io;
+      break;
+    }
+    released_out = started_out;
+    started_out = ciphered_out > started_out ? ciphered_out : started_out;
+  }
+
+  if (error == File_crypt_error_none) {
+    // CBC writes its last block only here, GCM none, so a scratch block avoids writing past the mapping
+    unsigned char last[2 * AES256_BLOCK_LENGTH];
+    int finall = 0;
+    if (EVP_CipherFinal_ex(ctx, last, &finall) != 1) {
+      error = gcm && !encrypt ? File_crypt_error_authentication : File_crypt_error_cipher;
+    } else if (out_length + (size_t)finall > out_capacity) {
+      error = File_crypt_error_cipher;
+    } else if (finall > 0) {
+      memcpy(out + out_length, last, (size_t)finall);
+      out_length += (size_t)finall;
+    }
+  }
+
+  if (error == File_crypt_error_none && gcm && encrypt) {
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AES256_TAG_LENGTH, out + out_length) != 1) {
+      error = File_crypt_error_cipher;
+    } else {
+      out_length += AES256_TAG_LENGTH;
+    }
+  }
+
+  EVP_CIPHER_CTX_free(ctx);
+  if (in) {
+    munmap(in, in_length);
+  }
+  if (out) {
+    if (error == File_crypt_error_none && msync(out, out_capacity, MS_SYNC) != 0) {
+      error = File_crypt_error_io;
+    }
+    munmap(out, out_capacity);
+  }
+  if (error == File_crypt_error_none && out_length != out_capacity && ftruncate(out_fd, (off_t)out_length) != 0) {
+    error = File_crypt_error_io;
+  }
+  if (in_fd >= 0) {
+    close(in_fd);
+  }
+  if (out_fd >= 0) {
+    close(out_fd);
+  }
+
+  if (error != File_crypt_error_none) {
+    if (out_fd >= 0) {
+      unlink(out_path);
+    }
+    if (err) {
+      *err = error;
+    }
+    return 0;
+  }
+  return 1;
+}
+
+int file_encrypt_mapped(const char *in_path,
+                        const char *out_path,
+                        enum Aes256_block_mode mode,
+                        const unsigned char *key,
+                        const unsigned char *iv,
+                        enum File_crypt_error *err) {
+  return file_crypt_mapped(in_path, out_path, mode, 1, key, iv, err);
+}
+
+int file_decrypt_mapped(const char *in_path,
+                        const char *out_path,
+                        enum Aes256_block_mode mode,
+                        const unsigned char *key,
+                        const unsigned char *iv,
+                        enum File_crypt_error *err) {
+  return file_crypt_mapped(in_path, out_path, mode, 0, key, iv, err);
+}
@@ -0,0 +1,126 @@
+//
+//  file_crypt.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef file_crypt_h
+#define file_crypt_h
+
+#include <stdio.h>
+#include "aes256.h"
+
+enum File_crypt_error {
+  File_crypt_error_none = 0,
+  File_crypt_error_invalid_input,
+  File_crypt_error_io,
+  File_crypt_error_cipher,
+  File_crypt_error_authentication,
+  File_crypt_error_out_of_memory
+};
+
+/**
+ Tuning of the file encryption pipeline. Zeroed fields fall back to the defaults.
+ */
+struct File_crypt_options {
+  /// Number of bytes read, encrypted and written per pipeline step (default 256 KB)
+  size_t chunk_size;
+  /// Number of chunks in flight between the reader, cipher and writer stages (default 8)
+  int ring_slots;
+  /// Forces the pread/pwrite backend even if io_uring is available
+  int disable_io_uring;
+};
+
+/**
+ Encrypts a file with AES 256 into another file.
+
+ Reading, encryption and writing run as separate stages connected by a bounded ring of chunks,
+ so disk I/O overlaps with the cipher work. On Linux the I/O stages submit batches through
+ io_uring when the kernel allows it and fall back to pread/pwrite otherwise.
+ The output has the same layout as `AES256.encrypt`: GCM appends the 16 byte tag, CBC uses PKCS7 padding.
+
+ @param in_path Path of the plaintext file
+ @param out_path Path of the encrypted file, created or truncated
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param options Pipeline tuning, NULL for defaults
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure (the output file is removed)
+ */
+int file_encrypt(const char *in_path,
+                 const char *out_path,
+                 enum Aes256_block_mode mode,
+                 const unsigned char *key,
+                 const unsigned char *iv,
+                 const struct File_crypt_options *options,
+                 enum File_crypt_error *err);
+
+/**
+ Decrypts a file produced by `file_encrypt` (or `AES256.encrypt`) into another file.
+
+ For GCM the plaintext is streamed out before the tag is checked. When the tag does not match,
+ the output file is removed and `File_crypt_error_authentication` is returned.
+
+ @param in_path Path of the encrypted file
+ @param out_path Path of the decrypted file, created or truncated
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param options Pipeline tuning, NULL for defaults
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure (the output file is removed)
+ */
+int file_decrypt(const char *in_path,
+                 const char *out_path,
+                 enum Aes256_block_mode mode,
+                 const unsigned char *key,
+                 const unsigned char *iv,
+                 const struct File_crypt_options *options,
+                 enum File_crypt_error *err);
+
+/**
+ Encrypts a file with AES 256 by mapping the input and the output file into memory.
+
+ The cipher reads straight from the input mapping and writes straight into the output mapping,
+ there are no intermediate heap copies of the content. Already processed pages are released while going,
+ so the resident memory of the mappings is bounded by two windows of a few megabytes instead of the file size.
+ Output pages are written back in the background one window behind the cipher, only the end waits for the disk.
+ The input file must not be truncated while it is being encrypted.
+
+ @param in_path Path of the plaintext file
+ @param out_path Path of the encrypted file, created or truncated
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure (the output file is removed)
+ */
+int file_encrypt_mapped(const char *in_path,
+                        const char *out_path,
+                        enum Aes256_block_mode mode,
+                        const unsigned char *key,
+                        const unsigned char *iv,
+                        enum File_crypt_error *err);
+
+/**
+ Decrypts a file with AES 256 by mapping the input and the output file into memory.
+ See `file_encrypt_mapped` and `file_decrypt`.
+
+ @param in_path Path of the encrypted file
+ @param out_path Path of the decrypted file, created or truncated
+ @param mode AES block mode
+ @param key 32 bytes AES key
+ @param iv 16 bytes initialization vector
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure (the output file is removed)
+ */
+int file_decrypt_mapped(const char *in_path,
+                        const char *out_path,
+                        enum Aes256_block_mode mode,
+                        const unsigned char *key,
+                        const unsigned char *iv,
+                        enum File_crypt_error *err);
+
+#endif /* file_crypt_h */
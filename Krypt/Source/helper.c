@@ -8,6 +8,7 @@
 #include "helper.h"
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <openssl/buffer.h>
 #include <openssl/pem.h>
 
@@ -69,3 +70,63 @@ EVP_PKEY *get_key(const char *privateKey) {
   return key;
 }
 
+unsigned char *pem_encode(const char *label, const unsigned char *der, size_t der_length, size_t *pem_length) {
+  size_t label_length = strlen(label);
+  size_t lines = (der_length + 47) / 48;
+  // "-----BEGIN " label "-----\n", lines of at most 64 characters and "\n", "-----END " label "-----\n", NUL
+  size_t capacity = 17 + label_length + lines * 65 + 15 + label_length + 1;
+  unsigned char *pem = malloc(capacity);
+  if (!pem) {
+    return NULL;
+  }
+  unsigned char *p = pem;
+  p += sprintf((char *)p, "-----BEGIN %s-----\n", label);
+  for (size_t offset = 0; offset < der_length; offset += 48) {
+    size_t chunk = der_length - offset < 48 ? der_length - offset : 48;
+    p += EVP_EncodeBlock(p, der + offset, (int)chunk);
+    *p++ = '\n';
+  }
+  p += sprintf((char *)p, "-----END %s-----\n", label);
+  *pem_length = (size_t)(p - pem);
+  return pem;
+}
+
+struct batch_worker {
+  void (*body)(void *context, size_t first, size_t stride);
+  void *context;
+  size_t first;
+  size_t stride;
+  pthread_t thread;
+};
+
+static void *batch_worker_run(void *arg) {
+  struct batch_worker *worker = arg;
+  worker->body(worker->context, worker->first, worker->stride);
+  return NULL;
+}
+
+void batch_run(size_t count, int threads, void (*body)(void *context, size_t first, size_t stride), void *context) {
+  size_t stride = threads > 1 ? (size_t)threads : 1;
+  stride = stride < BATCH_MAX_THREADS ? stride : BATCH_MAX_THREADS;
+  stride = stride < count ? stride : (count > 0 ? count : 1);
+  struct batch_worker workers[BATCH_MAX_THREADS];
+  size_t started = 0;
+  for (size_t i = 0; i < stride; i++) {
+    workers[i] = (struct batch_worker){ .body = body, .context = context, .first = i, .stride = stride };
+  }
+  for (size_t i = 1; i < stride; i++) {
+    if (pthread_create(&workers[i].thread, NULL, batch_worker_run, &workers[i]) != 0) {
+      break;
+    }
+    started = i;
+  }
+  // items of workers that could not be started run here
+  for (size_t i = started + 1; i < stride; i++) {
+    body(context, i, stride);
+  }
+  body(context, 0, stride);
+  for (size_t i = 1; i <= started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+}
+
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <openssl/bio.h>
+#include <openssl/evp.h>
 
 char *str_from_BIO(BIO *bio);
 BIO *BIO_from_str(const char *str);
@@ -25,4 +26,30 @@ int str_equal(const char *str1, const char *str2);
 
 EVP_PKEY *get_key(const char *privateKey);
 
+/// Upper bound of the threads of batch_run, larger thread counts are capped
+#define BATCH_MAX_THREADS 64
+
+/**
+ Encodes DER as PEM: base64 in lines of 64 characters between the header and footer of the label
+
+ @param label PEM label, e.g. "CERTIFICATE"
+ @param der DER to encode
+ @param der_length Length of the DER
+ @param pem_length Receives the length of the PEM without the NUL terminator
+ @return NUL terminated PEM, NULL on failure. Free with `free`
+ */
+unsigned char *pem_encode(const char *label, const unsigned char *der, size_t der_length, size_t *pem_length);
+
+/**
+ Spreads count items over threads: worker w runs body(context, w, stride) and handles the items w, w + stride, ...
+ The calling thread is worker 0, items of workers whose thread cannot be started run on the calling thread too.
+ Returns when all items are done.
+
+ @param count Number of items
+ @param threads Number of threads including the calling one, capped to count and BATCH_MAX_THREADS
+ @param body Handles the items first, first + stride, ... below count
+ @param context Passed to body
+ */
+void batch_run(size_t count, int threads, void (*body)(void *context, size_t first, size_t stride), void *context);
+
 #endif /* helper_h */
@@ -0,0 +1,41 @@
+//
+//  kdf.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "kdf.h"
+#include <limits.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+
+int hkdf_sha256(const unsigned char *ikm,
+                size_t ikm_length,
+                const unsigned char *salt,
+                size_t salt_length,
+                const unsigned char *info,
+                size_t info_length,
+                unsigned char *out,
+                size_t out_length) {
+  if (!ikm || ikm_length == 0 || ikm_length > INT_MAX || (!salt && salt_length > 0) || salt_length > INT_MAX ||
+      (!info && info_length > 0) || info_length > INT_MAX || !out || out_length == 0 || out_length > 255 * 32) {
+    return 0;
+  }
+
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+  if (!ctx) {
+    return 0;
+  }
+  // OpenSSL 1.1.1 rejects an empty salt and info, HKDF treats both as absent then anyway
+  size_t length = out_length;
+  int ok = EVP_PKEY_derive_init(ctx) == 1 &&
+           EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) == 1 &&
+           (salt_length == 0 || EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt, (int)salt_length) == 1) &&
+           EVP_PKEY_CTX_set1_hkdf_key(ctx, ikm, (int)ikm_length) == 1 &&
+           (info_length == 0 || EVP_PKEY_CTX_add1_hkdf_info(ctx, info, (int)info_length) == 1) &&
+           EVP_PKEY_derive(ctx, out, &length) == 1 &&
+           length == out_length;
+  EVP_PKEY_CTX_free(ctx);
+  return ok;
+}
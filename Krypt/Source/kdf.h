@@ -0,0 +1,35 @@
+//
+//  kdf.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef kdf_h
+#define kdf_h
+
+#include <stdio.h>
+
+/**
+ Derives key material with HKDF-SHA256 (RFC 5869), extract and expand.
+
+ @param ikm Input key material
+ @param ikm_length Number of input key material bytes
+ @param salt Salt, may be NULL when salt_length is 0
+ @param salt_length Number of salt bytes
+ @param info Context information, may be NULL when info_length is 0
+ @param info_length Number of context information bytes
+ @param out Buffer for the derived bytes
+ @param out_length Number of bytes to derive, at most 8160
+ @return Status: 1 = success, 0 = failure
+ */
+int hkdf_sha256(const unsigned char *ikm,
+                size_t ikm_length,
+                const unsigned char *salt,
+                size_t salt_length,
+                const unsigned char *info,
+                size_t info_length,
+                unsigned char *out,
+                size_t out_length);
+
+#endif /* kdf_h */
@@ -0,0 +1,315 @@
+//
+//  key_cache.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "key_cache.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <openssl/crypto.h>
+
+#define KEY_CACHE_NONE SIZE_MAX
+
+enum key_cache_order {
+  /// Least recently used first, the eviction order
+  key_cache_order_lru = 0,
+  /// Oldest insertion first, the expiry order since every entry lives for the same time
+  key_cache_order_ttl,
+  key_cache_orders
+};
+
+struct key_cache_link {
+  size_t prev;
+  size_t next;
+};
+
+struct key_cache_list {
+  size_t head;
+  size_t tail;
+};
+
+struct key_cache_entry {
+  unsigned char id[KEY_CACHE_ID_LENGTH];
+  unsigned char key[AES256_KEY_LENGTH];
+  unsigned char iv[AES256_IV_LENGTH];
+  size_t iv_length;
+  double expires_at;
+  /// Position in both orders, free entries are chained through the LRU link
+  struct key_cache_link links[key_cache_orders];
+};
+
+struct Key_cache {
+  pthread_mutex_t lock;
+  /// `capacity` entries followed by the index, both in one locked mapping
+  struct key_cache_entry *entries;
+  /// Open addressing table of entry number + 1 by the leading bytes of the id, 0 = empty slot
+  uint32_t *index;
+  size_t index_mask;
+  size_t mapped_length;
+  double ttl;
+  struct key_cache_list orders[key_cache_orders];
+  size_t free_head;
+  struct Key_cache_stats stats;
+};
+
+static double key_cache_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* The ids are digests, their leading bytes are already uniformly distributed */
+static size_t key_cache_home(const struct Key_cache *cache, const unsigned char *id) {
+  uint64_t hash;
+  memcpy(&hash, id, sizeof(hash));
+  return (size_t)hash & cache->index_mask;
+}
+
+static void key_cache_unlink(struct Key_cache *cache, enum key_cache_order order, size_t e) {
+  struct key_cache_link *link = &cache->entries[e].links[order];
+  struct key_cache_list *list = &cache->orders[order];
+  if (link->prev == KEY_CACHE_NONE) {
+    list->head = link->next;
+  } else {
+    cache->entries[link->prev].links[order].next = link->next;
+  }
+  if (link->next == KEY_CACHE_NONE) {
+    list->tail = link->prev;
+  } else {
+    cache->entries[link->next].links[order].prev = link->prev;
+  }
+}
+
+static void key_cache_append(struct Key_cache *cache, enum key_cache_order order, size_t e) {
+  struct key_cache_link *link = &cache->entries[e].links[order];
+  struct key_cache_list *list = &cache->orders[order];
+  link->prev = list->tail;
+  link->next = KEY_CACHE_NONE;
+  if (list->tail == KEY_CACHE_NONE) {
+    list->head = e;
+  } else {
+    cache->entries[list->tail].links[order].next = e;
+  }
+  list->tail = e;
+}
+
+/*
+ Returns the index slot of the entry with the id, KEY_CACHE_NONE if there is none.
+ */
+static size_t key_cache_find(const struct Key_cache *cache, const unsigned char *id) {
+  for (size_t slot = key_cache_home(cache, id); cache->index[slot]; slot = (slot + 1) & cache->index_mask) {
+    if (memcmp(cache->entries[cache->index[slot] - 1].id, id, KEY_CACHE_ID_LENGTH) == 0) {
+      return slot;
+    }
+  }
+  return KEY_CACHE_NONE;
+}
+
+/*
+ Empties the index slot and moves later entries of the probe sequence back, so lookups need no tombstones.
+ */
+static void key_cache_index_remove(struct Key_cache *cache, size_t slot) {
+  size_t mask = cache->index_mask;
+  for (size_t next = (slot + 1) & mask; cache->index[next]; next = (next + 1) & mask) {
+    size_t home = key_cache_home(cache, cache->entries[cache->index[next] - 1].id);
+    // the entry stays if its home lies cyclically in (slot, next]
+    if (((next - home) & mask) >= ((next - slot) & mask)) {
+      cache->index[slot] = cache->index[next];
+      slot = next;
+    }
+  }
+  cache->index[slot] = 0;
+}
+
+/*
+ Zeroes the entry in the index slot and returns it to the free entries.
+ */
+static void key_cache_remove(struct Key_cache *cache, size_t slot) {
+  size_t e = cache->index[slot] - 1;
+  struct key_cache_entry *entry = &cache->entries[e];
+  key_cache_index_remove(cache, slot);
+  key_cache_unlink(cache, key_cache_order_lru, e);
+  key_cache_unlink(cache, key_cache_order_ttl, e);
+  OPENSSL_cleanse(entry, sizeof(*entry));
+  entry->links[key_cache_order_lru].next = cache->free_head;
+  cache->free_head = e;
+  cache->stats.count--;
+}
+
+static int key_cache_expired(const struct Key_cache *cache, const struct key_cache_entry *entry, double now) {
+  return cache->ttl > 0 && now >= entry->expires_at;
+}
+
+/*
+ Chains all entries as free, empties both orders. The mapping must be zeroed.
+ */
+static void key_cache_reset(struct Key_cache *cache) {
+  for (size_t e = 0; e < cache->stats.capacity; e++) {
+    cache->entries[e].links[key_cache_order_lru].next = e + 1 < cache->stats.capacity ? e + 1 : KEY_CACHE_NONE;
+  }
+  cache->free_head = 0;
+  for (int order = 0; order < key_cache_orders; order++) {
+    cache->orders[order] = (struct key_cache_list){ KEY_CACHE_NONE, KEY_CACHE_NONE };
+  }
+  cache->stats.count = 0;
+}
+
+struct Key_cache *key_cache_new(size_t capacity, double ttl_seconds) {
+  // the index holds entry number + 1 in 32 bits and has at least twice as many slots as entries
+  if (capacity == 0 || capacity > UINT32_MAX / 4) {
+    return NULL;
+  }
+  size_t slots = 2;
+  while (slots < 2 * capacity) {
+    slots *= 2;
+  }
+  size_t entries_length = capacity * sizeof(struct key_cache_entry);
+  if (entries_length / sizeof(struct key_cache_entry) != capacity ||
+      entries_length > SIZE_MAX - slots * sizeof(uint32_t)) {
+    return NULL;
+  }
+  struct Key_cache *cache = calloc(1, sizeof(struct Key_cache));
+  if (!cache) {
+    return NULL;
+  }
+  cache->mapped_length = entries_length + slots * sizeof(uint32_t);
+  cache->entries = mmap(NULL, cache->mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (cache->entries == MAP_FAILED || pthread_mutex_init(&cache->lock, NULL) != 0) {
+    if (cache->entries != MAP_FAILED) {
+      munmap(cache->entries, cache->mapped_length);
+    }
+    free(cache);
+    return NULL;
+  }
+  // Locking may exceed RLIMIT_MEMLOCK, the cache still works then but reports it in the statistics
+  cache->stats.locked = mlock(cache->entries, cache->mapped_length) == 0;
+#ifdef MADV_DONTDUMP
+  madvise(cache->entries, cache->mapped_length, MADV_DONTDUMP);
+#endif
+  cache->index = (uint32_t *)((unsigned char *)cache->entries + entries_length);
+  cache->index_mask = slots - 1;
+  cache->stats.capacity = capacity;
+  cache->ttl = ttl_seconds;
+  key_cache_reset(cache);
+  return cache;
+}
+
+void key_cache_free(struct Key_cache *cache) {
+  if (!cache) {
+    return;
+  }
+  OPENSSL_cleanse(cache->entries, cache->mapped_length);
+  if (cache->stats.locked) {
+    munlock(cache->entries, cache->mapped_length);
+  }
+  munmap(cache->entries, cache->mapped_length);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
+
+int key_cache_get(struct Key_cache *cache, const unsigned char *id, unsigned char *key, unsigned char *iv, size_t *iv_length) {
+  if (!cache || !id || !key || !iv || !iv_length) {
+    return 0;
+  }
+  pthread_mutex_lock(&cache->lock);
+  size_t slot = key_cache_find(cache, id);
+  int hit = 0;
+  if (slot != KEY_CACHE_NONE) {
+    size_t e = cache->index[slot] - 1;
+    struct key_cache_entry *entry = &cache->entries[e];
+    if (key_cache_expired(cache, entry, key_cache_now())) {
+      key_cache_remove(cache, slot);
+      cache->stats.expirations++;
+    } else {
+      memcpy(key, entry->key, AES256_KEY_LENGTH);
+      memcpy(iv, entry->iv, entry->iv_length);
+      *iv_length = entry->iv_length;
+      key_cache_unlink(cache, key_cache_order_lru, e);
+      key_cache_append(cache, key_cache_order_lru, e);
+      hit = 1;
+    }
+  }
+  if (hit) {
+    cache->stats.hits++;
+  } else {
+    cache->stats.misses++;
+  }
+  pthread_mutex_unlock(&cache->lock);
+  return hit;
+}
+
+void key_cache_put(struct Key_cache *cache, const unsigned char *id, const unsigned char *key, const unsigned char *iv, size_t iv_length) {
+  if (!cache || !id || !key || !iv || iv_length > AES256_IV_LENGTH) {
+    return;
+  }
+  pthread_mutex_lock(&cache->lock);
+  double now = key_cache_now();
+
+  // Expired entries are the oldest insertions, they are dropped from the front of the expiry order
+  size_t oldest = cache->orders[key_cache_order_ttl].head;
+  while (oldest != KEY_CACHE_NONE && key_cache_expired(cache, &cache->entries[oldest], now)) {
+    key_cache_remove(cache, key_cache_find(cache, cache->entries[oldest].id));
+    cache->stats.expirations++;
+    oldest = cache->orders[key_cache_order_ttl].head;
+  }
+
+  // Prefer the entry with the same id, then a free entry, then the least recently used one
+  size_t slot = key_cache_find(cache, id);
+  size_t e;
+  if (slot != KEY_CACHE_NONE) {
+    e = cache->index[slot] - 1;
+    key_cache_unlink(cache, key_cache_order_lru, e);
+    key_cache_unlink(cache, key_cache_order_ttl, e);
+  } else {
+    if (cache->free_head == KEY_CACHE_NONE) {
+      size_t lru = cache->orders[key_cache_order_lru].head;
+      key_cache_remove(cache, key_cache_find(cache, cache->entries[lru].id));
+      cache->stats.evictions++;
+    }
+    e = cache->free_head;
+    cache->free_head = cache->entries[e].links[key_cache_order_lru].next;
+    slot = key_cache_home(cache, id);
+    while (cache->index[slot]) {
+      slot = (slot + 1) & cache->index_mask;
+    }
+    cache->index[slot] = (uint32_t)(e + 1);
+    cache->stats.count++;
+  }
+
+  struct key_cache_entry *entry = &cache->entries[e];
+  memcpy(entry->id, id, KEY_CACHE_ID_LENGTH);
+  memcpy(entry->key, key, AES256_KEY_LENGTH);
+  OPENSSL_cleanse(entry->iv, AES256_IV_LENGTH);
+  memcpy(entry->iv, iv, iv_length);
+  entry->iv_length = iv_length;
+  entry->expires_at = now + cache->ttl;
+  key_cache_append(cache, key_cache_order_lru, e);
+  key_cache_append(cache, key_cache_order_ttl, e);
+  cache->stats.insertions++;
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void key_cache_remove_all(struct Key_cache *cache) {
+  if (!cache) {
+    return;
+  }
+  pthread_mutex_lock(&cache->lock);
+  OPENSSL_cleanse(cache->entries, cache->mapped_length);
+  key_cache_reset(cache);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void key_cache_get_stats(struct Key_cache *cache, struct Key_cache_stats *stats) {
+  if (!cache || !stats) {
+    return;
+  }
+  pthread_mutex_lock(&cache->lock);
+  *stats = cache->stats;
+  pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,99 @@
+//
+//  key_cache.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef key_cache_h
+#define key_cache_h
+
+#include <stdio.h>
+#include "aes256.h"
+
+#define KEY_CACHE_ID_LENGTH 32
+
+/**
+ Bounded cache of unwrapped AES keys and IVs, identified by a 32 bytes digest chosen by the caller.
+
+ All entries live in one memory mapping that is locked against swapping (when the process is allowed to)
+ and excluded from core dumps. The mapping also holds an open addressing index by id, lookups, insertions,
+ evictions and expirations take constant time independent of the capacity. Entries are zeroed when they are evicted, expire, are removed or the cache is freed.
+ The cache is safe to use from multiple threads.
+ */
+struct Key_cache;
+
+struct Key_cache_stats {
+  /// Lookups that returned an entry
+  unsigned long hits;
+  /// Lookups that found no valid entry, including expired ones
+  unsigned long misses;
+  /// Entries stored
+  unsigned long insertions;
+  /// Entries dropped to make room for new ones
+  unsigned long evictions;
+  /// Entries dropped because their time to live passed
+  unsigned long expirations;
+  /// Entries currently stored
+  size_t count;
+  /// Maximum number of entries
+  size_t capacity;
+  /// 1 if the entries are locked in memory, 0 if locking was not permitted
+  int locked;
+};
+
+/**
+ Creates a cache.
+
+ @param capacity Maximum number of entries, the least recently used entry is evicted when full
+ @param ttl_seconds Lifetime of an entry, 0 or less keeps entries until they are evicted
+ @return Cache, NULL on failure. Free with `key_cache_free`
+ */
+struct Key_cache *key_cache_new(size_t capacity, double ttl_seconds);
+
+/**
+ Zeroes all entries and frees the cache.
+
+ @param cache Cache to free, may be NULL
+ */
+void key_cache_free(struct Key_cache *cache);
+
+/**
+ Looks up an entry. Expired entries are zeroed and count as miss.
+
+ @param cache Cache
+ @param id 32 bytes identifier
+ @param key Returns the 32 bytes AES key
+ @param iv Returns the initialization vector, room for 16 bytes
+ @param iv_length Returns the length of the IV as stored
+ @return 1 = hit, 0 = miss
+ */
+int key_cache_get(struct Key_cache *cache, const unsigned char *id, unsigned char *key, unsigned char *iv, size_t *iv_length);
+
+/**
+ Stores an entry, replacing an entry with the same identifier.
+
+ @param cache Cache
+ @param id 32 bytes identifier
+ @param key 32 bytes AES key
+ @param iv Initialization vector
+ @param iv_length Length of the IV, at most 16 bytes, longer IVs are not stored
+ */
+void key_cache_put(struct Key_cache *cache, const unsigned char *id, const unsigned char *key, const unsigned char *iv, size_t iv_length);
+
+/**
+ Zeroes and removes all entries, the statistics are kept.
+
+ @param cache Cache
+ */
+void key_cache_remove_all(struct Key_cache *cache);
+
+/**
+ Returns the statistics of the cache.
+
+ @param cache Cache
+ @param stats Returns the statistics
+ */
+void key_cache_get_stats(struct Key_cache *cache, struct Key_cache_stats *stats);
+
+#endif /* key_cache_h */
@@ -0,0 +1,348 @@
+//
+//  key_pool.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "key_pool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <unistd.h>
+#include "helper.h"
+#include "rsa_keygen.h"
+
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#define KEY_POOL_P256_PUBLIC_KEY_LENGTH 65
+#define KEY_POOL_P256_SCALAR_LENGTH 32
+// Pause of the background threads after a failed generation, doubled per consecutive failure up to the maximum
+#define KEY_POOL_BACKOFF_MIN_MS 10
+#define KEY_POOL_BACKOFF_MAX_MS 10000
+
+struct Key_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t needs_key;
+  enum Key_pool_type type;
+  /// Ring of ready keys
+  EVP_PKEY **keys;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  /// Keys being generated by the background threads
+  size_t in_flight;
+  /// Background generations that failed in a row
+  unsigned long consecutive_failures;
+  int stopping;
+  pthread_t *threads;
+  int thread_count;
+  struct Key_pool_stats stats;
+};
+
+static double key_pool_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void *key_pool_fail(enum Key_pool_error *err, enum Key_pool_error error) {
+  if (err) {
+    *err = error;
+  }
+  return NULL;
+}
+
+/// Background threads yield to the app: background QoS on Apple platforms, lowest nice value of the thread on Linux
+static void key_pool_lower_priority(void) {
+#if defined(__APPLE__)
+  pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+  setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+}
+
+/// Call with the lock held
+static void key_pool_record(struct Key_pool *pool, double us) {
+  pool->stats.generated++;
+  pool->stats.generation_total_us += us;
+  if (pool->stats.generated == 1 || us < pool->stats.generation_min_us) {
+    pool->stats.generation_min_us = us;
+  }
+  if (us > pool->stats.generation_max_us) {
+    pool->stats.generation_max_us = us;
+  }
+}
+
+EVP_PKEY *key_pool_generate(enum Key_pool_type type, enum Key_pool_error *err) {
+  int bits = 0;
+  switch (type) {
+    case Key_pool_type_rsa_2048:
+      bits = 2048;
+      break;
+    case Key_pool_type_rsa_4096:
+      bits = 4096;
+      break;
+    case Key_pool_type_ec_p256:
+      break;
+    default:
+      return key_pool_fail(err, Key_pool_error_invalid_input);
+  }
+
+  EVP_PKEY *pkey = NULL;
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(bits ? EVP_PKEY_RSA : EVP_PKEY_EC, NULL);
+  int ok = ctx && EVP_PKEY_keygen_init(ctx) == 1;
+  if (ok && bits) {
+    ok = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) == 1;
+  } else if (ok) {
+    ok = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) == 1 &&
+         EVP_PKEY_CTX_set_ec_param_enc(ctx, OPENSSL_EC_NAMED_CURVE) == 1;
+  }
+  ok = ok && EVP_PKEY_keygen(ctx, &pkey) == 1;
+  EVP_PKEY_CTX_free(ctx);
+  if (!ok) {
+    EVP_PKEY_free(pkey);
+    return key_pool_fail(err, Key_pool_error_generation);
+  }
+  return pkey;
+}
+
+/// A miss blocks the caller, so RSA primes are searched on all processors
+static EVP_PKEY *key_pool_generate_on_miss(enum Key_pool_type type, enum Key_pool_error *err) {
+  if (type == Key_pool_type_ec_p256) {
+    return key_pool_generate(type, err);
+  }
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  EVP_PKEY *pkey = rsa_keygen_parallel(type == Key_pool_type_rsa_2048 ? 2048 : 4096, processors > 1 ? (int)processors : 1, NULL);
+  return pkey ? pkey : key_pool_fail(err, Key_pool_error_generation);
+}
+
+/// Call with the lock held, returns early when the pool stops
+static void key_pool_backoff(struct Key_pool *pool) {
+  long ms = KEY_POOL_BACKOFF_MIN_MS;
+  for (unsigned long i = 1; i < pool->consecutive_failures && ms < KEY_POOL_BACKOFF_MAX_MS; i++) {
+    ms *= 2;
+  }
+  ms = ms < KEY_POOL_BACKOFF_MAX_MS ? ms : KEY_POOL_BACKOFF_MAX_MS;
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += ms / 1000;
+  deadline.tv_nsec += (ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+  // taken keys signal the same condition, only stopping ends the pause early
+  while (!pool->stopping && pthread_cond_timedwait(&pool->needs_key, &pool->lock, &deadline) != ETIMEDOUT) {
+  }
+}
+
+static void *key_pool_thread(void *arg) {
+  struct Key_pool *pool = arg;
+  key_pool_lower_priority();
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->count + pool->in_flight >= pool->capacity && !pool->stopping) {
+      pthread_cond_wait(&pool->needs_key, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    pool->in_flight++;
+    pthread_mutex_unlock(&pool->lock);
+
+    double start_us = key_pool_now_us();
+    EVP_PKEY *pkey = key_pool_generate(pool->type, NULL);
+    double us = key_pool_now_us() - start_us;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->in_flight--;
+    if (!pkey) {
+      // a persistent failure (entropy, provider) must not turn the thread into a busy loop
+      pool->stats.failures++;
+      pool->consecutive_failures++;
+      key_pool_backoff(pool);
+      continue;
+    }
+    pool->consecutive_failures = 0;
+    key_pool_record(pool, us);
+    if (pool->stopping) {
+      EVP_PKEY_free(pkey);
+      break;
+    }
+    pool->keys[(pool->head + pool->count) % pool->capacity] = pkey;
+    pool->count++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+struct Key_pool *key_pool_new(enum Key_pool_type type, size_t capacity, int threads) {
+  if (type < Key_pool_type_rsa_2048 || type > Key_pool_type_ec_p256 || capacity < 1 || threads < 1) {
+    return NULL;
+  }
+  struct Key_pool *pool = calloc(1, sizeof(struct Key_pool));
+  if (!pool) {
+    return NULL;
+  }
+  pool->keys = calloc(capacity, sizeof(EVP_PKEY *));
+  pool->threads = calloc((size_t)threads, sizeof(pthread_t));
+  if (!pool->keys || !pool->threads) {
+    free(pool->keys);
+    free(pool->threads);
+    free(pool);
+    return NULL;
+  }
+  pool->type = type;
+  pool->capacity = capacity;
+  pool->stats.capacity = capacity;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->needs_key, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, key_pool_thread, pool) != 0) {
+      break;
+    }
+    pool->thread_count++;
+  }
+  pool->stats.threads = pool->thread_count;
+  if (pool->thread_count == 0) {
+    key_pool_free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void key_pool_free(struct Key_pool *pool) {
+  if (!pool) {
+    return;
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = 1;
+  pthread_cond_broadcast(&pool->needs_key);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  for (size_t i = 0; i < pool->count; i++) {
+    EVP_PKEY_free(pool->keys[(pool->head + i) % pool->capacity]);
+  }
+  pthread_cond_destroy(&pool->needs_key);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->threads);
+  free(pool->keys);
+  free(pool);
+}
+
+EVP_PKEY *key_pool_take(struct Key_pool *pool, enum Key_pool_error *err) {
+  if (!pool) {
+    return key_pool_fail(err, Key_pool_error_invalid_input);
+  }
+  pthread_mutex_lock(&pool->lock);
+  if (pool->count > 0) {
+    EVP_PKEY *pkey = pool->keys[pool->head];
+    pool->keys[pool->head] = NULL;
+    pool->head = (pool->head + 1) % pool->capacity;
+    pool->count--;
+    pool->stats.taken++;
+    pthread_cond_signal(&pool->needs_key);
+    pthread_mutex_unlock(&pool->lock);
+    return pkey;
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  double start_us = key_pool_now_us();
+  EVP_PKEY *pkey = key_pool_generate_on_miss(pool->type, err);
+  double us = key_pool_now_us() - start_us;
+  if (pkey) {
+    pthread_mutex_lock(&pool->lock);
+    key_pool_record(pool, us);
+    pool->stats.taken++;
+    pool->stats.misses++;
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return pkey;
+}
+
+char *key_pool_take_pem(struct Key_pool *pool, enum Key_pool_error *err) {
+  EVP_PKEY *pkey = key_pool_take(pool, err);
+  if (!pkey) {
+    return NULL;
+  }
+  char *pem = NULL;
+  BIO *out = BIO_new(BIO_s_mem());
+  if (out && PEM_write_bio_PrivateKey(out, pkey, NULL, NULL, 0, NULL, NULL) == 1) {
+    pem = str_from_BIO(out);
+  }
+  BIO_free_all(out);
+  EVP_PKEY_free(pkey);
+  return pem ? pem : key_pool_fail(err, Key_pool_error_generation);
+}
+
+static int key_pool_export_der(EVP_PKEY *pkey, unsigned char *out, size_t out_capacity, size_t *out_length, enum Key_pool_error *err) {
+  if (EVP_PKEY_id(pkey) == EVP_PKEY_RSA) {
+    const RSA *rsa = EVP_PKEY_get0_RSA(pkey);
+    int length = i2d_RSAPrivateKey(rsa, NULL);
+    if (length <= 0 || (size_t)length > out_capacity) {
+      key_pool_fail(err, length <= 0 ? Key_pool_error_generation : Key_pool_error_buffer_too_small);
+      return 0;
+    }
+    unsigned char *p = out;
+    *out_length = (size_t)i2d_RSAPrivateKey(rsa, &p);
+    return 1;
+  }
+
+  if (out_capacity < KEY_POOL_P256_PUBLIC_KEY_LENGTH + KEY_POOL_P256_SCALAR_LENGTH) {
+    key_pool_fail(err, Key_pool_error_buffer_too_small);
+    return 0;
+  }
+  const EC_KEY *ec = EVP_PKEY_get0_EC_KEY(pkey);
+  if (!ec ||
+      EC_POINT_point2oct(EC_KEY_get0_group(ec), EC_KEY_get0_public_key(ec), POINT_CONVERSION_UNCOMPRESSED,
+                         out, KEY_POOL_P256_PUBLIC_KEY_LENGTH, NULL) != KEY_POOL_P256_PUBLIC_KEY_LENGTH ||
+      BN_bn2binpad(EC_KEY_get0_private_key(ec), out + KEY_POOL_P256_PUBLIC_KEY_LENGTH, KEY_POOL_P256_SCALAR_LENGTH) != KEY_POOL_P256_SCALAR_LENGTH) {
+    key_pool_fail(err, Key_pool_error_generation);
+    return 0;
+  }
+  *out_length = KEY_POOL_P256_PUBLIC_KEY_LENGTH + KEY_POOL_P256_SCALAR_LENGTH;
+  return 1;
+}
+
+int key_pool_take_der(struct Key_pool *pool, unsigned char *out, size_t out_capacity, size_t *out_length, enum Key_pool_error *err) {
+  if (!out || !out_length) {
+    key_pool_fail(err, Key_pool_error_invalid_input);
+    return 0;
+  }
+  EVP_PKEY *pkey = key_pool_take(pool, err);
+  if (!pkey) {
+    return 0;
+  }
+  int ok = key_pool_export_der(pkey, out, out_capacity, out_length, err);
+  EVP_PKEY_free(pkey);
+  return ok;
+}
+
+void key_pool_get_stats(struct Key_pool *pool, struct Key_pool_stats *stats) {
+  if (!pool || !stats) {
+    return;
+  }
+  pthread_mutex_lock(&pool->lock);
+  *stats = pool->stats;
+  stats->depth = pool->count;
+  pthread_mutex_unlock(&pool->lock);
+}
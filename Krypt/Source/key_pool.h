@@ -0,0 +1,128 @@
+//
+//  key_pool.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef key_pool_h
+#define key_pool_h
+
+#include <stdio.h>
+#include <openssl/evp.h>
+
+/// Large enough for the DER form of every supported key type (RSA 4096 PKCS#1 private key)
+#define KEY_POOL_MAX_DER_LENGTH 2560
+
+enum Key_pool_type {
+  Key_pool_type_rsa_2048 = 0,
+  Key_pool_type_rsa_4096,
+  Key_pool_type_ec_p256
+};
+
+enum Key_pool_error {
+  Key_pool_error_none = 0,
+  Key_pool_error_invalid_input,
+  Key_pool_error_buffer_too_small,
+  Key_pool_error_generation
+};
+
+/**
+ Pool of pre-generated private keys of one type.
+
+ RSA key generation takes from a few hundred milliseconds to seconds with a high variance, so keys are generated
+ ahead of time by low priority background threads and handed out in O(1). Every taken key is refilled
+ automatically. When the pool is empty the key is generated on the calling thread (a miss), RSA primes are then
+ searched on all processors with `rsa_keygen_parallel`.
+ */
+struct Key_pool;
+
+struct Key_pool_stats {
+  /// Keys ready to be taken
+  size_t depth;
+  /// Number of keys the pool keeps ready
+  size_t capacity;
+  /// Number of background threads
+  int threads;
+  /// Keys generated, in the background and on misses
+  unsigned long generated;
+  /// Keys handed out
+  unsigned long taken;
+  /// Keys generated on the calling thread because the pool was empty
+  unsigned long misses;
+  /// Background generations that failed, the threads pause 10 ms doubled per failure in a row (at most 10 s)
+  unsigned long failures;
+  /// Sum of all generation times in µs
+  double generation_total_us;
+  /// Shortest generation time in µs
+  double generation_min_us;
+  /// Longest generation time in µs
+  double generation_max_us;
+};
+
+/**
+ Generates one private key on the calling thread
+
+ @param type Type of the key
+ @param err Error code of the failure, may be NULL
+ @return Private key, NULL on failure. Free with EVP_PKEY_free
+ */
+EVP_PKEY *key_pool_generate(enum Key_pool_type type, enum Key_pool_error *err);
+
+/**
+ Creates a pool and starts filling it in the background
+
+ @param type Type of the keys
+ @param capacity Number of keys to keep ready
+ @param threads Number of background threads generating keys
+ @return Pool, NULL on failure
+ */
+struct Key_pool *key_pool_new(enum Key_pool_type type, size_t capacity, int threads);
+
+/**
+ Stops the background threads, waiting for running generations, and frees the pool with its keys
+
+ @param pool Pool to free, may be NULL
+ */
+void key_pool_free(struct Key_pool *pool);
+
+/**
+ Takes a key out of the pool, generates one on the calling thread and all processors if the pool is empty
+
+ @param pool Pool
+ @param err Error code of the failure, may be NULL
+ @return Private key, NULL on failure. Free with EVP_PKEY_free
+ */
+EVP_PKEY *key_pool_take(struct Key_pool *pool, enum Key_pool_error *err);
+
+/**
+ Takes a key out of the pool as PKCS#8 PEM, the format `createCSR` expects
+
+ @param pool Pool
+ @param err Error code of the failure, may be NULL
+ @return PEM string, NULL on failure. Free with free
+ */
+char *key_pool_take_pem(struct Key_pool *pool, enum Key_pool_error *err);
+
+/**
+ Takes a key out of the pool in the external representation of `SecKey`:
+ PKCS#1 DER for RSA, uncompressed public point followed by the private scalar (97 bytes) for P-256
+
+ @param pool Pool
+ @param out Buffer for the key, KEY_POOL_MAX_DER_LENGTH bytes are enough
+ @param out_capacity Size of out
+ @param out_length Length of the written key
+ @param err Error code of the failure, may be NULL
+ @return Status: 1 = success, 0 = failure
+ */
+int key_pool_take_der(struct Key_pool *pool, unsigned char *out, size_t out_capacity, size_t *out_length, enum Key_pool_error *err);
+
+/**
+ Copies the statistics of the pool
+
+ @param pool Pool
+ @param stats Receives the statistics
+ */
+void key_pool_get_stats(struct Key_pool *pool, struct Key_pool_stats *stats);
+
+#endif /* key_pool_h */
@@ -0,0 +1,118 @@
+//
+//  phase_timing.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "phase_timing.h"
+#include <time.h>
+
+static const char *phase_names[Phase_count] = {
+  "smime_decrypt_key",
+  "smime_decrypt_parse",
+  "smime_decrypt_decrypt",
+  "smime_decrypt_output",
+  "smime_verify_parse",
+  "smime_verify_store",
+  "smime_verify_email",
+  "smime_verify_chain",
+  "smime_verify_digest",
+  "smime_verify_output",
+  "csr_subject",
+  "csr_key",
+  "csr_sign",
+  "csr_encode",
+  "pkcs8_encrypt_key",
+  "pkcs8_encrypt_encrypt",
+  "pkcs8_encrypt_encode",
+  "pkcs8_decrypt_parse",
+  "pkcs8_decrypt_decrypt",
+  "pkcs8_decrypt_encode",
+  "x509_wrap_keys",
+  "x509_wrap_sign",
+  "x509_wrap_encode",
+};
+
+static int phase_timing_on = 0;
+static Phase_timing_callback phase_callback = NULL;
+static void *phase_callback_context = NULL;
+/// Updated with relaxed atomics, a snapshot may mix phases completed during the copy
+static struct Phase_timing_stats phase_stats[Phase_count];
+
+static uint64_t phase_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  // never 0, 0 marks disabled timing
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec + 1;
+}
+
+void phase_timing_set_enabled(int enabled) {
+  __atomic_store_n(&phase_timing_on, enabled ? 1 : 0, __ATOMIC_RELEASE);
+}
+
+int phase_timing_enabled(void) {
+  return __atomic_load_n(&phase_timing_on, __ATOMIC_ACQUIRE);
+}
+
+void phase_timing_set_callback(Phase_timing_callback callback, void *context) {
+  __atomic_store_n(&phase_callback_context, context, __ATOMIC_RELAXED);
+  __atomic_store_n(&phase_callback, callback, __ATOMIC_RELEASE);
+}
+
+void phase_timing_get_stats(struct Phase_timing_stats *stats) {
+  for (int phase = 0; phase < Phase_count; phase++) {
+    stats[phase].count = __atomic_load_n(&phase_stats[phase].count, __ATOMIC_RELAXED);
+    stats[phase].total_ns = __atomic_load_n(&phase_stats[phase].total_ns, __ATOMIC_RELAXED);
+    stats[phase].max_ns = __atomic_load_n(&phase_stats[phase].max_ns, __ATOMIC_RELAXED);
+    stats[phase].bytes = __atomic_load_n(&phase_stats[phase].bytes, __ATOMIC_RELAXED);
+  }
+}
+
+void phase_timing_reset_stats(void) {
+  for (int phase = 0; phase < Phase_count; phase++) {
+    __atomic_store_n(&phase_stats[phase].count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&phase_stats[phase].total_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&phase_stats[phase].max_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&phase_stats[phase].bytes, 0, __ATOMIC_RELAXED);
+  }
+}
+
+const char *phase_name(enum Phase phase) {
+  return phase >= 0 && phase < Phase_count ? phase_names[phase] : "unknown";
+}
+
+uint64_t phase_begin(void) {
+  return __atomic_load_n(&phase_timing_on, __ATOMIC_RELAXED) ? phase_now() : 0;
+}
+
+int phase_record(enum Phase phase, uint64_t begin, uint64_t end, size_t bytes) {
+  if (begin == 0 || end < begin) {
+    return 0;
+  }
+  uint64_t duration = end - begin;
+  struct Phase_timing_stats *stats = &phase_stats[phase];
+  __atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stats->total_ns, duration, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stats->bytes, bytes, __ATOMIC_RELAXED);
+  unsigned long long max = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+  while (duration > max &&
+         !__atomic_compare_exchange_n(&stats->max_ns, &max, duration, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+
+  Phase_timing_callback callback = __atomic_load_n(&phase_callback, __ATOMIC_ACQUIRE);
+  if (!callback) {
+    return 0;
+  }
+  callback(phase, duration, bytes, __atomic_load_n(&phase_callback_context, __ATOMIC_RELAXED));
+  return 1;
+}
+
+uint64_t phase_end(enum Phase phase, uint64_t begin, size_t bytes) {
+  if (begin == 0) {
+    return 0;
+  }
+  uint64_t end = phase_now();
+  // the callback does not count towards the next phase
+  return phase_record(phase, begin, end, bytes) ? phase_now() : end;
+}
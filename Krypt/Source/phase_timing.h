@@ -0,0 +1,152 @@
+//
+//  phase_timing.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef phase_timing_h
+#define phase_timing_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ Phases of the C core operations. The byte count of a phase is the size of its input for parsing phases and of its
+ output otherwise.
+ */
+enum Phase {
+  /// smime_decrypt: private key PEM decoding
+  Phase_smime_decrypt_key = 0,
+  /// smime_decrypt: S/MIME parsing (get_pkcs7), bytes of the message
+  Phase_smime_decrypt_parse,
+  /// smime_decrypt: key unwrap and content decryption, bytes of the content
+  Phase_smime_decrypt_decrypt,
+  /// smime_decrypt: copy of the content to the returned string
+  Phase_smime_decrypt_output,
+  /// smime_verify: S/MIME parsing (get_pkcs7), bytes of the message
+  Phase_smime_verify_parse,
+  /// smime_verify: X509_STORE of the trusted certificates (store_with_trusted_certs)
+  Phase_smime_verify_store,
+  /// smime_verify: sender email check (pkcs7_signature_contains_email)
+  Phase_smime_verify_email,
+  /// smime_verify: chain building and verification of the signer certificate in PKCS7_verify
+  Phase_smime_verify_chain,
+  /// smime_verify: content digest and signature check in PKCS7_verify, bytes of the content
+  Phase_smime_verify_digest,
+  /// smime_verify: copy of the content to the returned string
+  Phase_smime_verify_output,
+  /// createCSR: version and subject of the request
+  Phase_csr_subject,
+  /// createCSR: private key PEM decoding
+  Phase_csr_key,
+  /// createCSR: signature of the request
+  Phase_csr_sign,
+  /// createCSR: PEM or DER encoding, bytes of the output
+  Phase_csr_encode,
+  /// pkcs8_encrypt: private key PEM decoding
+  Phase_pkcs8_encrypt_key,
+  /// pkcs8_encrypt: PBKDF2 and encryption
+  Phase_pkcs8_encrypt_encrypt,
+  /// pkcs8_encrypt: PEM or DER encoding, bytes of the output
+  Phase_pkcs8_encrypt_encode,
+  /// pkcs8_decrypt: PEM decoding, bytes of the input
+  Phase_pkcs8_decrypt_parse,
+  /// pkcs8_decrypt: PBKDF2 and decryption
+  Phase_pkcs8_decrypt_decrypt,
+  /// pkcs8_decrypt: PEM or DER encoding, bytes of the output
+  Phase_pkcs8_decrypt_encode,
+  /// x509_wrap_pubkey: PEM decoding of both keys
+  Phase_x509_wrap_keys,
+  /// x509_wrap_pubkey: certificate fields and signature
+  Phase_x509_wrap_sign,
+  /// x509_wrap_pubkey: PEM or DER encoding, bytes of the output
+  Phase_x509_wrap_encode,
+  Phase_count
+};
+
+struct Phase_timing_stats {
+  /// Completed phases
+  unsigned long count;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+  unsigned long long bytes;
+};
+
+/**
+ Called on the thread of the operation after every phase while timing is enabled, must be cheap
+
+ @param phase Completed phase
+ @param duration_ns Duration of the phase
+ @param bytes Bytes of the phase, see `Phase`
+ @param context Context passed to `phase_timing_set_callback`
+ */
+typedef void (*Phase_timing_callback)(enum Phase phase, uint64_t duration_ns, size_t bytes, void *context);
+
+/**
+ Switches the timing of all phases on or off. Disabled by default, a disabled phase costs one atomic load.
+
+ @param enabled 1 = on, 0 = off
+ */
+void phase_timing_set_enabled(int enabled);
+
+/**
+ @return 1 if timing is enabled, otherwise 0
+ */
+int phase_timing_enabled(void);
+
+/**
+ Sets the callback, in addition to the aggregate statistics. Set it while timing is disabled.
+
+ @param callback Callback, NULL for none
+ @param context Passed to the callback
+ */
+void phase_timing_set_callback(Phase_timing_callback callback, void *context);
+
+/**
+ Snapshot of the statistics of every phase since the last reset
+
+ @param stats Returns `Phase_count` statistics, indexed by `Phase`
+ */
+void phase_timing_get_stats(struct Phase_timing_stats *stats);
+
+/**
+ Clears the statistics of every phase
+ */
+void phase_timing_reset_stats(void);
+
+/**
+ @param phase Phase
+ @return Name of the phase, e.g. "smime_verify_chain"
+ */
+const char *phase_name(enum Phase phase);
+
+/**
+ Start of the first phase of an operation
+
+ @return Current time in ns, 0 if timing is disabled
+ */
+uint64_t phase_begin(void);
+
+/**
+ Records a phase that started at `begin`
+
+ @param phase Completed phase
+ @param begin Start of the phase from `phase_begin` or the previous `phase_end`, 0 records nothing
+ @param bytes Bytes of the phase
+ @return Current time in ns as start of the next phase, 0 if `begin` was 0
+ */
+uint64_t phase_end(enum Phase phase, uint64_t begin, size_t bytes);
+
+/**
+ Records a phase with known start and end, e.g. of a phase inside an OpenSSL call
+
+ @param phase Completed phase
+ @param begin Start of the phase, 0 records nothing
+ @param end End of the phase from `phase_begin`
+ @param bytes Bytes of the phase
+ @return 1 if the callback was called, otherwise 0
+ */
+int phase_record(enum Phase phase, uint64_t begin, uint64_t end, size_t bytes);
+
+#endif /* phase_timing_h */
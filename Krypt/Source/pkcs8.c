@@ -12,6 +12,7 @@
 #include <openssl/evp.h>
 #include <openssl/pkcs12.h>
 #include "helper.h"
+#include "phase_timing.h"
 
 void pkcs8_encrypt_free_all(BIO *out, EVP_PKEY *key, PKCS8_PRIV_KEY_INFO *p8inf, X509_ALGOR *pbe, X509_SIG *p8);
 void pkcs8_decrypt_free_all(BIO *in, BIO *out, EVP_PKEY *key, PKCS8_PRIV_KEY_INFO *p8inf, X509_SIG *p8);
@@ -28,6 +29,7 @@ char *convert_pkcs1_to_pkcs8(const char *pem) {
     // Write out PEM to bio
     if(!PEM_write_bio_RSA_PUBKEY(out, rsa)) {
       // Cannot write out public key, clean up and return
+      BIO_free(out);
       BIO_free(key);
       RSA_free(rsa);
       return NULL;
@@ -36,11 +38,34 @@ char *convert_pkcs1_to_pkcs8(const char *pem) {
     BIO_free(key);
     RSA_free(rsa);
     
-    return str_from_BIO(out);
+    char *str = str_from_BIO(out);
+    BIO_free(out);
+    return str;
 }
 
-char *pkcs8_encrypt(const char *pkcs1, const char *password) {
-  BIO *out = NULL;
+struct Der_buffer *convert_pkcs1_to_pkcs8_der(const char *pem) {
+  BIO *key = BIO_from_str(pem);
+  RSA *rsa = PEM_read_bio_RSAPublicKey(key, NULL, 0, NULL);
+  BIO_free(key);
+  if (rsa == NULL) {
+    return NULL;
+  }
+
+  int length = i2d_RSA_PUBKEY(rsa, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_RSA_PUBKEY(rsa, &p) != length) {
+    der_buffer_free(der);
+    der = NULL;
+  }
+  RSA_free(rsa);
+  return der;
+}
+
+/*
+ Encrypts the private key, shared by the PEM and DER outputs
+ */
+static X509_SIG *pkcs8_encrypt_sig(const char *pkcs1, const char *password, uint64_t *phase) {
   EVP_PKEY *pkey = NULL;
   PKCS8_PRIV_KEY_INFO *p8inf = NULL;
   X509_ALGOR *pbe = NULL;
@@ -58,39 +83,70 @@ char *pkcs8_encrypt(const char *pkcs1, const char *password) {
 
   pkey = get_key(pkcs1);
   if (pkey == NULL) {
-    pkcs8_encrypt_free_all(out, pkey, p8inf, pbe, p8);
+    pkcs8_encrypt_free_all(NULL, pkey, p8inf, pbe, p8);
     return NULL;
   }
 
   p8inf = EVP_PKEY2PKCS8(pkey);
+  *phase = phase_end(Phase_pkcs8_encrypt_key, *phase, 0);
   if (p8inf == NULL) {
-    pkcs8_encrypt_free_all(out, pkey, p8inf, pbe, p8);
+    pkcs8_encrypt_free_all(NULL, pkey, p8inf, pbe, p8);
     return NULL;
   }
 
   p8 = PKCS8_encrypt(pbe_nid, cipher, password, passlen, NULL, 0, iter, p8inf);
+  *phase = phase_end(Phase_pkcs8_encrypt_encrypt, *phase, 0);
+  pkcs8_encrypt_free_all(NULL, pkey, p8inf, pbe, NULL);
+  return p8;
+}
+
+char *pkcs8_encrypt(const char *pkcs1, const char *password) {
+  uint64_t phase = phase_begin();
+  X509_SIG *p8 = pkcs8_encrypt_sig(pkcs1, password, &phase);
   if (p8 == NULL) {
-    pkcs8_encrypt_free_all(out, pkey, p8inf, pbe, p8);
     return NULL;
   }
 
-  out = BIO_new(BIO_s_mem());
+  BIO *out = BIO_new(BIO_s_mem());
   BIO_set_mem_eof_return(out, 0);
   PEM_write_bio_PKCS8(out, p8);
   if (out == NULL) {
-    pkcs8_encrypt_free_all(out, pkey, p8inf, pbe, p8);
+    pkcs8_encrypt_free_all(out, NULL, NULL, NULL, p8);
     return NULL;
   }
 
+  size_t length = (size_t)BIO_pending(out);
   char *str = str_from_BIO(out);
 
-  pkcs8_encrypt_free_all(out, pkey, p8inf, pbe, p8);
+  pkcs8_encrypt_free_all(out, NULL, NULL, NULL, p8);
+  phase_end(Phase_pkcs8_encrypt_encode, phase, length);
   return str;
 }
 
-char *pkcs8_decrypt(const char *pem, const char *password) {
+struct Der_buffer *pkcs8_encrypt_der(const char *pkcs1, const char *password) {
+  uint64_t phase = phase_begin();
+  X509_SIG *p8 = pkcs8_encrypt_sig(pkcs1, password, &phase);
+  if (p8 == NULL) {
+    return NULL;
+  }
+
+  int length = i2d_X509_SIG(p8, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_X509_SIG(p8, &p) != length) {
+    der_buffer_free(der);
+    der = NULL;
+  }
+  X509_SIG_free(p8);
+  phase_end(Phase_pkcs8_encrypt_encode, phase, der ? der->length : 0);
+  return der;
+}
+
+/*
+ Decrypts the private key, shared by the PEM and DER outputs
+ */
+static EVP_PKEY *pkcs8_decrypt_key(const char *pem, const char *password, uint64_t *phase) {
   BIO *in = NULL;
-  BIO *out = NULL;
   EVP_PKEY *pkey = NULL;
   PKCS8_PRIV_KEY_INFO *p8inf = NULL;
   X509_SIG *p8 = NULL;
@@ -103,42 +159,72 @@ char *pkcs8_decrypt(const char *pem, const char *password) {
 
   in = BIO_from_str(pem);
   if (in == NULL) {
-    pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
+    pkcs8_decrypt_free_all(in, NULL, pkey, p8inf, p8);
     return NULL;
   }
 
   p8 = PEM_read_bio_PKCS8(in, NULL, NULL, NULL);
+  *phase = phase_end(Phase_pkcs8_decrypt_parse, *phase, *phase ? strlen(pem) : 0);
   if (p8 == NULL) {
-    pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
+    pkcs8_decrypt_free_all(in, NULL, pkey, p8inf, p8);
     return NULL;
   }
 
   p8inf = PKCS8_decrypt(p8, password, passlen);
+  *phase = phase_end(Phase_pkcs8_decrypt_decrypt, *phase, 0);
   if (p8inf == NULL) {
-    pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
+    pkcs8_decrypt_free_all(in, NULL, pkey, p8inf, p8);
     return NULL;
   }
 
   pkey = EVP_PKCS82PKEY(p8inf);
+  pkcs8_decrypt_free_all(in, NULL, NULL, p8inf, p8);
+  return pkey;
+}
+
+char *pkcs8_decrypt(const char *pem, const char *password) {
+  uint64_t phase = phase_begin();
+  EVP_PKEY *pkey = pkcs8_decrypt_key(pem, password, &phase);
   if (pkey == NULL) {
-    pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
     return NULL;
   }
 
-  out = BIO_new(BIO_s_mem());
+  BIO *out = BIO_new(BIO_s_mem());
   BIO_set_mem_eof_return(out, 0);
   PEM_write_bio_PrivateKey_traditional(out, pkey, NULL, NULL, 0, NULL, NULL);
   if (out == NULL) {
-    pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
+    pkcs8_decrypt_free_all(NULL, out, pkey, NULL, NULL);
     return NULL;
   }
 
+  size_t length = (size_t)BIO_pending(out);
   char *str = str_from_BIO(out);
 
-  pkcs8_decrypt_free_all(in, out, pkey, p8inf, p8);
+  pkcs8_decrypt_free_all(NULL, out, pkey, NULL, NULL);
+  phase_end(Phase_pkcs8_decrypt_encode, phase, length);
   return str;
 }
 
+struct Der_buffer *pkcs8_decrypt_der(const char *pem, const char *password) {
+  uint64_t phase = phase_begin();
+  EVP_PKEY *pkey = pkcs8_decrypt_key(pem, password, &phase);
+  if (pkey == NULL) {
+    return NULL;
+  }
+
+  // traditional format like PEM_write_bio_PrivateKey_traditional: PKCS#1 for RSA, SEC1 for EC
+  int length = i2d_PrivateKey(pkey, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_PrivateKey(pkey, &p) != length) {
+    der_buffer_free(der);
+    der = NULL;
+  }
+  EVP_PKEY_free(pkey);
+  phase_end(Phase_pkcs8_decrypt_encode, phase, der ? der->length : 0);
+  return der;
+}
+
 void pkcs8_encrypt_free_all(BIO *out, EVP_PKEY *key, PKCS8_PRIV_KEY_INFO *p8inf, X509_ALGOR *pbe, X509_SIG *p8) {
   BIO_free_all(out);
   EVP_PKEY_free(key);
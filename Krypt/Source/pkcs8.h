@@ -9,6 +9,7 @@
 #define pkcs8_h
 
 #include <stdio.h>
+#include "der_buffer.h"
 
 char *convert_pkcs1_to_pkcs8(const char *pem);
 
@@ -16,4 +17,30 @@ char *pkcs8_encrypt(const char *pkcs1, const char *password);
 
 char *pkcs8_decrypt(const char *pem, const char *password);
 
+/**
+ Converts a PKCS#1 RSA public key to a SubjectPublicKeyInfo
+
+ @param pem RSA public key in PKCS#1 PEM format
+ @return SubjectPublicKeyInfo in DER format, NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *convert_pkcs1_to_pkcs8_der(const char *pem);
+
+/**
+ Encrypts a private key to PKCS#8 with PBES2, AES 256 CBC and HMAC SHA256 like `pkcs8_encrypt`
+
+ @param pkcs1 Private key in PEM format
+ @param password Password
+ @return Encrypted PKCS#8 in DER format, NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *pkcs8_encrypt_der(const char *pkcs1, const char *password);
+
+/**
+ Decrypts an encrypted PKCS#8 private key like `pkcs8_decrypt`
+
+ @param pem Encrypted PKCS#8 in PEM format
+ @param password Password
+ @return Private key in the traditional DER format (PKCS#1 for RSA, SEC1 for EC), NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *pkcs8_decrypt_der(const char *pem, const char *password);
+
 #endif /* pkcs8_h */
@@ -0,0 +1,292 @@
+//
+//  rsa_engine.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "rsa_engine.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#define RSA_ENGINE_PADDINGS 2
+
+/*
+ Contexts used by one thread at a time, indexed by padding and direction (0 = encrypt, 1 = decrypt).
+ */
+struct rsa_engine_contexts {
+  EVP_PKEY_CTX *ctx[RSA_ENGINE_PADDINGS][2];
+  struct rsa_engine_contexts *next;
+};
+
+struct Rsa_engine_key {
+  EVP_PKEY *pkey;
+  int is_private;
+  size_t size;
+  pthread_mutex_t lock;
+  /// Context sets not in use, one per thread that called concurrently so far
+  struct rsa_engine_contexts *idle;
+};
+
+static int rsa_engine_fail(enum Rsa_engine_error *err, enum Rsa_engine_error error) {
+  if (err) {
+    *err = error;
+  }
+  return 0;
+}
+
+static void rsa_engine_contexts_free(struct rsa_engine_contexts *contexts) {
+  for (int padding = 0; padding < RSA_ENGINE_PADDINGS; padding++) {
+    EVP_PKEY_CTX_free(contexts->ctx[padding][0]);
+    EVP_PKEY_CTX_free(contexts->ctx[padding][1]);
+  }
+  free(contexts);
+}
+
+/*
+ Runs one raw operation so OpenSSL caches the Montgomery contexts (and for private keys creates the blinding)
+ while the key is loaded instead of during the first real operation.
+ Going through EVP warms the key the later contexts use, also when OpenSSL 3 keeps a provider copy of it.
+ A failure leaves nothing on the error queue of the thread.
+ */
+static int rsa_engine_warm_up(EVP_PKEY *pkey, int is_private) {
+  ERR_set_mark();
+  size_t size = (size_t)EVP_PKEY_size(pkey);
+  unsigned char *in = calloc(1, size);
+  unsigned char *out = malloc(size);
+  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+  size_t length = size;
+  int ok = in && out && ctx;
+  if (ok) {
+    in[size - 1] = 2;
+    if (is_private) {
+      ok = EVP_PKEY_decrypt_init(ctx) == 1 &&
+           EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_NO_PADDING) == 1 &&
+           EVP_PKEY_decrypt(ctx, out, &length, in, size) == 1;
+    } else {
+      ok = EVP_PKEY_encrypt_init(ctx) == 1 &&
+           EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_NO_PADDING) == 1 &&
+           EVP_PKEY_encrypt(ctx, out, &length, in, size) == 1;
+    }
+  }
+  if (out) {
+    OPENSSL_cleanse(out, size);
+  }
+  EVP_PKEY_CTX_free(ctx);
+  free(in);
+  free(out);
+  ERR_pop_to_mark();
+  return ok;
+}
+
+static struct Rsa_engine_key *rsa_engine_key_new(RSA *rsa, int is_private, enum Rsa_engine_error *err) {
+  if (!rsa || (is_private && !RSA_get0_d(rsa))) {
+    RSA_free(rsa);
+    rsa_engine_fail(err, Rsa_engine_error_invalid_key);
+    return NULL;
+  }
+
+  struct Rsa_engine_key *key = calloc(1, sizeof(struct Rsa_engine_key));
+  EVP_PKEY *pkey = EVP_PKEY_new();
+  if (!key || !pkey || EVP_PKEY_assign_RSA(pkey, rsa) != 1) {
+    RSA_free(rsa);
+    EVP_PKEY_free(pkey);
+    free(key);
+    rsa_engine_fail(err, Rsa_engine_error_out_of_memory);
+    return NULL;
+  }
+  if (!rsa_engine_warm_up(pkey, is_private)) {
+    EVP_PKEY_free(pkey);
+    free(key);
+    rsa_engine_fail(err, Rsa_engine_error_invalid_key);
+    return NULL;
+  }
+  key->pkey = pkey;
+  key->is_private = is_private;
+  key->size = (size_t)EVP_PKEY_size(pkey);
+  pthread_mutex_init(&key->lock, NULL);
+  return key;
+}
+
+struct Rsa_engine_key *rsa_engine_key_new_der(const unsigned char *der, size_t der_length, int is_private, enum Rsa_engine_error *err) {
+  if (!der || der_length == 0 || der_length > LONG_MAX) {
+    rsa_engine_fail(err, Rsa_engine_error_invalid_input);
+    return NULL;
+  }
+  const unsigned char *p = der;
+  ERR_set_mark();
+  RSA *rsa = is_private ? d2i_RSAPrivateKey(NULL, &p, (long)der_length) : d2i_RSAPublicKey(NULL, &p, (long)der_length);
+  ERR_pop_to_mark();
+  return rsa_engine_key_new(rsa, is_private, err);
+}
+
+struct Rsa_engine_key *rsa_engine_key_new_pem(const char *pem, int is_private, enum Rsa_engine_error *err) {
+  BIO *bio = pem ? BIO_new_mem_buf(pem, -1) : NULL;
+  if (!bio) {
+    rsa_engine_fail(err, Rsa_engine_error_invalid_input);
+    return NULL;
+  }
+
+  RSA *rsa = NULL;
+  // parse errors are reported as Rsa_engine_error_invalid_key, not left for later calls of this thread
+  ERR_set_mark();
+  if (is_private) {
+    EVP_PKEY *pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+    rsa = pkey ? EVP_PKEY_get1_RSA(pkey) : NULL;
+    EVP_PKEY_free(pkey);
+  } else {
+    rsa = PEM_read_bio_RSA_PUBKEY(bio, NULL, NULL, NULL);
+    if (!rsa) {
+      // PKCS#1 "RSA PUBLIC KEY" as used by the Vivy backend
+      BIO_reset(bio);
+      rsa = PEM_read_bio_RSAPublicKey(bio, NULL, NULL, NULL);
+    }
+  }
+  ERR_pop_to_mark();
+  BIO_free(bio);
+  return rsa_engine_key_new(rsa, is_private, err);
+}
+
+void rsa_engine_key_free(struct Rsa_engine_key *key) {
+  if (!key) {
+    return;
+  }
+  while (key->idle) {
+    struct rsa_engine_contexts *next = key->idle->next;
+    rsa_engine_contexts_free(key->idle);
+    key->idle = next;
+  }
+  pthread_mutex_destroy(&key->lock);
+  EVP_PKEY_free(key->pkey);
+  free(key);
+}
+
+size_t rsa_engine_key_size(const struct Rsa_engine_key *key) {
+  return key ? key->size : 0;
+}
+
+int rsa_engine_key_is_private(const struct Rsa_engine_key *key) {
+  return key ? key->is_private : 0;
+}
+
+static struct rsa_engine_contexts *rsa_engine_checkout(struct Rsa_engine_key *key) {
+  pthread_mutex_lock(&key->lock);
+  struct rsa_engine_contexts *contexts = key->idle;
+  if (contexts) {
+    key->idle = contexts->next;
+  }
+  pthread_mutex_unlock(&key->lock);
+  return contexts ? contexts : calloc(1, sizeof(struct rsa_engine_contexts));
+}
+
+static void rsa_engine_checkin(struct Rsa_engine_key *key, struct rsa_engine_contexts *contexts) {
+  pthread_mutex_lock(&key->lock);
+  contexts->next = key->idle;
+  key->idle = contexts;
+  pthread_mutex_unlock(&key->lock);
+}
+
+/*
+ Returns the prepared context of the set, creating and configuring it on first use.
+ */
+static EVP_PKEY_CTX *rsa_engine_ctx(struct Rsa_engine_key *key, struct rsa_engine_contexts *contexts, enum Rsa_engine_padding padding, int decrypt) {
+  int p = padding == Rsa_engine_padding_pkcs1 ? 1 : 0;
+  EVP_PKEY_CTX *ctx = contexts->ctx[p][decrypt];
+  if (ctx) {
+    return ctx;
+  }
+
+  ctx = EVP_PKEY_CTX_new(key->pkey, NULL);
+  int ok = ctx && (decrypt ? EVP_PKEY_decrypt_init(ctx) : EVP_PKEY_encrypt_init(ctx)) == 1;
+  if (ok && padding == Rsa_engine_padding_pkcs1) {
+    ok = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) == 1;
+  } else if (ok) {
+    ok = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) == 1 &&
+         EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) == 1 &&
+         EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) == 1;
+  }
+  if (!ok) {
+    EVP_PKEY_CTX_free(ctx);
+    return NULL;
+  }
+  contexts->ctx[p][decrypt] = ctx;
+  return ctx;
+}
+
+static int rsa_engine_crypt(struct Rsa_engine_key *key,
+                            enum Rsa_engine_padding padding,
+                            int decrypt,
+                            const unsigned char *in,
+                            size_t in_length,
+                            unsigned char *out,
+                            size_t out_capacity,
+                            size_t *out_length,
+                            enum Rsa_engine_error *err) {
+  if (!key || (decrypt && !key->is_private)) {
+    return rsa_engine_fail(err, Rsa_engine_error_invalid_key);
+  }
+  if (!in || !out || (decrypt && in_length != key->size)) {
+    return rsa_engine_fail(err, Rsa_engine_error_invalid_input);
+  }
+  if (out_capacity < key->size) {
+    // OpenSSL checks the capacity against the modulus length, also when the plaintext is shorter
+    return rsa_engine_fail(err, Rsa_engine_error_buffer_too_small);
+  }
+
+  struct rsa_engine_contexts *contexts = rsa_engine_checkout(key);
+  if (!contexts) {
+    return rsa_engine_fail(err, Rsa_engine_error_out_of_memory);
+  }
+  // a failed operation reports Rsa_engine_error_operation, its OpenSSL errors must not reach later calls of this
+  // thread, e.g. the Smime_error of an S/MIME call on the same executor thread
+  ERR_set_mark();
+  EVP_PKEY_CTX *ctx = rsa_engine_ctx(key, contexts, padding, decrypt);
+  size_t length = out_capacity;
+  int ok = ctx != NULL;
+  if (ok && decrypt) {
+    ok = EVP_PKEY_decrypt(ctx, out, &length, in, in_length) == 1;
+  } else if (ok) {
+    ok = EVP_PKEY_encrypt(ctx, out, &length, in, in_length) == 1;
+  }
+  rsa_engine_checkin(key, contexts);
+  ERR_pop_to_mark();
+
+  if (!ok) {
+    return rsa_engine_fail(err, Rsa_engine_error_operation);
+  }
+  if (out_length) {
+    *out_length = length;
+  }
+  return 1;
+}
+
+int rsa_engine_encrypt(struct Rsa_engine_key *key,
+                       enum Rsa_engine_padding padding,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Rsa_engine_error *err) {
+  return rsa_engine_crypt(key, padding, 0, in, in_length, out, out_capacity, out_length, err);
+}
+
+int rsa_engine_decrypt(struct Rsa_engine_key *key,
+                       enum Rsa_engine_padding padding,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Rsa_engine_error *err) {
+  return rsa_engine_crypt(key, padding, 1, in, in_length, out, out_capacity, out_length, err);
+}
@@ -0,0 +1,126 @@
+//
+//  rsa_engine.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef rsa_engine_h
+#define rsa_engine_h
+
+#include <stdio.h>
+
+enum Rsa_engine_padding {
+  Rsa_engine_padding_oaep_sha256,
+  Rsa_engine_padding_pkcs1
+};
+
+enum Rsa_engine_error {
+  Rsa_engine_error_none = 0,
+  Rsa_engine_error_invalid_key,
+  Rsa_engine_error_invalid_input,
+  Rsa_engine_error_buffer_too_small,
+  Rsa_engine_error_operation,
+  Rsa_engine_error_out_of_memory
+};
+
+/**
+ RSA key prepared for repeated encryption and decryption.
+
+ Loading the key sets up the Montgomery contexts of the modulus and primes and, for private keys,
+ the blinding, so the first operation does not pay for them. The `EVP_PKEY_CTX`s with the padding,
+ OAEP digest and MGF1 digest configured are created once and reused: every thread that calls into the key
+ at the same time gets its own set, sets are returned to the key after each operation.
+ The key is safe to use from multiple threads, it must not be freed while operations are running.
+ */
+struct Rsa_engine_key;
+
+/**
+ Loads a key in PKCS#1 DER, the format `SecKeyCopyExternalRepresentation` returns for RSA keys.
+
+ @param der PKCS#1 RSAPublicKey or RSAPrivateKey
+ @param der_length Length of der
+ @param is_private 1 for a private key, 0 for a public key
+ @param err Reason of the failure
+ @return Key, NULL on failure. Free with `rsa_engine_key_free`
+ */
+struct Rsa_engine_key *rsa_engine_key_new_der(const unsigned char *der, size_t der_length, int is_private, enum Rsa_engine_error *err);
+
+/**
+ Loads a key in PEM: PKCS#1 or PKCS#8 private keys, PKCS#1 or SubjectPublicKeyInfo public keys.
+
+ @param pem Null terminated PEM
+ @param is_private 1 for a private key, 0 for a public key
+ @param err Reason of the failure
+ @return Key, NULL on failure. Free with `rsa_engine_key_free`
+ */
+struct Rsa_engine_key *rsa_engine_key_new_pem(const char *pem, int is_private, enum Rsa_engine_error *err);
+
+/**
+ Frees the key and all its prepared contexts.
+
+ @param key Key to free, may be NULL
+ */
+void rsa_engine_key_free(struct Rsa_engine_key *key);
+
+/**
+ Returns the modulus length, which is the length of every ciphertext of the key.
+
+ @param key Key
+ @return Modulus length in bytes
+ */
+size_t rsa_engine_key_size(const struct Rsa_engine_key *key);
+
+/**
+ Returns whether the key can decrypt.
+
+ @param key Key
+ @return 1 for a private key, 0 for a public key
+ */
+int rsa_engine_key_is_private(const struct Rsa_engine_key *key);
+
+/**
+ Encrypts with the public part of the key.
+
+ @param key Public or private key
+ @param padding Padding
+ @param in Plaintext, at most modulus length - 66 bytes for OAEP SHA256, - 11 bytes for PKCS#1
+ @param in_length Length of the plaintext
+ @param out Buffer for the ciphertext, at least `rsa_engine_key_size` bytes
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int rsa_engine_encrypt(struct Rsa_engine_key *key,
+                       enum Rsa_engine_padding padding,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Rsa_engine_error *err);
+
+/**
+ Decrypts with a private key.
+
+ @param key Private key
+ @param padding Padding
+ @param in Ciphertext
+ @param in_length Length of the ciphertext
+ @param out Buffer for the plaintext, `rsa_engine_key_size` bytes are always enough
+ @param out_capacity Size of the output buffer
+ @param out_length Returns the number of bytes written to out
+ @param err Reason of the failure
+ @return Status: 1 = success, 0 = failure
+ */
+int rsa_engine_decrypt(struct Rsa_engine_key *key,
+                       enum Rsa_engine_padding padding,
+                       const unsigned char *in,
+                       size_t in_length,
+                       unsigned char *out,
+                       size_t out_capacity,
+                       size_t *out_length,
+                       enum Rsa_engine_error *err);
+
+#endif /* rsa_engine_h */
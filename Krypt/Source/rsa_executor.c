@@ -0,0 +1,258 @@
+//
+//  rsa_executor.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "rsa_executor.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct rsa_executor_job {
+  rsa_executor_work work;
+  rsa_executor_completion completion;
+  void *context;
+  double submitted_us;
+};
+
+struct Rsa_executor {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  /// Ring of waiting requests
+  struct rsa_executor_job *jobs;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  int stopping;
+  pthread_t *threads;
+  int thread_count;
+  struct Rsa_executor_stats stats;
+};
+
+static double rsa_executor_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void rsa_executor_record(struct Rsa_executor_histogram *histogram, double us) {
+  int bucket = 0;
+  // bucket = number of significant bits of the whole microseconds
+  for (unsigned long long whole = us >= 1 ? (unsigned long long)us : 0; whole > 0 && bucket < RSA_EXECUTOR_HISTOGRAM_BUCKETS - 1; whole >>= 1) {
+    bucket++;
+  }
+  histogram->counts[bucket]++;
+  histogram->count++;
+  histogram->total_us += us;
+  if (us > histogram->max_us) {
+    histogram->max_us = us;
+  }
+}
+
+static void *rsa_executor_thread(void *arg) {
+  struct Rsa_executor *executor = arg;
+  pthread_mutex_lock(&executor->lock);
+  for (;;) {
+    while (executor->count == 0 && !executor->stopping) {
+      pthread_cond_wait(&executor->not_empty, &executor->lock);
+    }
+    if (executor->count == 0) {
+      // stopping and drained
+      break;
+    }
+    struct rsa_executor_job job = executor->jobs[executor->head];
+    executor->head = (executor->head + 1) % executor->capacity;
+    executor->count--;
+    executor->stats.running++;
+    double started_us = rsa_executor_now_us();
+    double wait_us = started_us - job.submitted_us;
+    rsa_executor_record(&executor->stats.wait, wait_us);
+    pthread_cond_signal(&executor->not_full);
+    pthread_mutex_unlock(&executor->lock);
+
+    job.work(job.context);
+    double service_us = rsa_executor_now_us() - started_us;
+
+    pthread_mutex_lock(&executor->lock);
+    executor->stats.running--;
+    executor->stats.completed++;
+    rsa_executor_record(&executor->stats.service, service_us);
+    if (job.completion) {
+      // statistics already count the request when the caller learns it is done
+      pthread_mutex_unlock(&executor->lock);
+      job.completion(job.context, wait_us, service_us);
+      pthread_mutex_lock(&executor->lock);
+    }
+  }
+  pthread_mutex_unlock(&executor->lock);
+  return NULL;
+}
+
+struct Rsa_executor *rsa_executor_new(int threads, size_t queue_capacity) {
+  if (threads < 1 || queue_capacity < 1) {
+    return NULL;
+  }
+  struct Rsa_executor *executor = calloc(1, sizeof(struct Rsa_executor));
+  if (!executor) {
+    return NULL;
+  }
+  executor->jobs = calloc(queue_capacity, sizeof(struct rsa_executor_job));
+  executor->threads = calloc((size_t)threads, sizeof(pthread_t));
+  if (!executor->jobs || !executor->threads) {
+    free(executor->jobs);
+    free(executor->threads);
+    free(executor);
+    return NULL;
+  }
+  executor->capacity = queue_capacity;
+  executor->stats.queue_capacity = queue_capacity;
+  pthread_mutex_init(&executor->lock, NULL);
+  pthread_cond_init(&executor->not_empty, NULL);
+  pthread_cond_init(&executor->not_full, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&executor->threads[i], NULL, rsa_executor_thread, executor) != 0) {
+      break;
+    }
+    executor->thread_count++;
+  }
+  executor->stats.threads = executor->thread_count;
+  if (executor->thread_count == 0) {
+    rsa_executor_free(executor);
+    return NULL;
+  }
+  return executor;
+}
+
+void rsa_executor_free(struct Rsa_executor *executor) {
+  if (!executor) {
+    return;
+  }
+  pthread_mutex_lock(&executor->lock);
+  executor->stopping = 1;
+  pthread_cond_broadcast(&executor->not_empty);
+  pthread_cond_broadcast(&executor->not_full);
+  pthread_mutex_unlock(&executor->lock);
+  for (int i = 0; i < executor->thread_count; i++) {
+    pthread_join(executor->threads[i], NULL);
+  }
+  pthread_cond_destroy(&executor->not_full);
+  pthread_cond_destroy(&executor->not_empty);
+  pthread_mutex_destroy(&executor->lock);
+  free(executor->threads);
+  free(executor->jobs);
+  free(executor);
+}
+
+static int rsa_executor_fail(enum Rsa_executor_error *err, enum Rsa_executor_error error) {
+  if (err) {
+    *err = error;
+  }
+  return 0;
+}
+
+int rsa_executor_submit(struct Rsa_executor *executor,
+                        rsa_executor_work work,
+                        rsa_executor_completion completion,
+                        void *context,
+                        double timeout_seconds,
+                        enum Rsa_executor_error *err) {
+  if (!executor || !work) {
+    return rsa_executor_fail(err, Rsa_executor_error_invalid_input);
+  }
+
+  struct timespec deadline;
+  if (timeout_seconds > 0) {
+    // condition variables wait against the realtime clock
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    time_t seconds = (time_t)timeout_seconds;
+    deadline.tv_sec += seconds;
+    deadline.tv_nsec += (long)((timeout_seconds - (double)seconds) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  pthread_mutex_lock(&executor->lock);
+  while (executor->count == executor->capacity && !executor->stopping && timeout_seconds != 0) {
+    int status = 0;
+    if (timeout_seconds < 0) {
+      pthread_cond_wait(&executor->not_full, &executor->lock);
+    } else {
+      status = pthread_cond_timedwait(&executor->not_full, &executor->lock, &deadline);
+    }
+    if (status == ETIMEDOUT) {
+      break;
+    }
+  }
+  if (executor->stopping) {
+    pthread_mutex_unlock(&executor->lock);
+    return rsa_executor_fail(err, Rsa_executor_error_shutting_down);
+  }
+  if (executor->count == executor->capacity) {
+    executor->stats.rejected++;
+    pthread_mutex_unlock(&executor->lock);
+    return rsa_executor_fail(err, Rsa_executor_error_queue_full);
+  }
+
+  size_t tail = (executor->head + executor->count) % executor->capacity;
+  executor->jobs[tail] = (struct rsa_executor_job){ work, completion, context, rsa_executor_now_us() };
+  executor->count++;
+  executor->stats.submitted++;
+  if (executor->count > executor->stats.max_queue_depth) {
+    executor->stats.max_queue_depth = executor->count;
+  }
+  pthread_cond_signal(&executor->not_empty);
+  pthread_mutex_unlock(&executor->lock);
+  return 1;
+}
+
+void rsa_executor_get_stats(struct Rsa_executor *executor, struct Rsa_executor_stats *stats) {
+  if (!executor || !stats) {
+    return;
+  }
+  pthread_mutex_lock(&executor->lock);
+  *stats = executor->stats;
+  stats->queue_depth = executor->count;
+  pthread_mutex_unlock(&executor->lock);
+}
+
+void rsa_executor_reset_stats(struct Rsa_executor *executor) {
+  if (!executor) {
+    return;
+  }
+  pthread_mutex_lock(&executor->lock);
+  int running = executor->stats.running;
+  memset(&executor->stats, 0, sizeof(executor->stats));
+  executor->stats.queue_capacity = executor->capacity;
+  executor->stats.threads = executor->thread_count;
+  executor->stats.running = running;
+  executor->stats.max_queue_depth = executor->count;
+  pthread_mutex_unlock(&executor->lock);
+}
+
+double rsa_executor_histogram_percentile(const struct Rsa_executor_histogram *histogram, double percentile) {
+  if (!histogram || histogram->count == 0) {
+    return 0;
+  }
+  double rank = percentile / 100.0 * (double)histogram->count;
+  if (rank < 1) {
+    rank = 1;
+  }
+  unsigned long seen = 0;
+  for (int bucket = 0; bucket < RSA_EXECUTOR_HISTOGRAM_BUCKETS; bucket++) {
+    seen += histogram->counts[bucket];
+    if ((double)seen >= rank) {
+      double upper = (double)(1ULL << bucket);
+      // the last bucket is open ended
+      return bucket == RSA_EXECUTOR_HISTOGRAM_BUCKETS - 1 || upper > histogram->max_us ? histogram->max_us : upper;
+    }
+  }
+  return histogram->max_us;
+}
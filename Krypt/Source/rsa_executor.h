@@ -0,0 +1,138 @@
+//
+//  rsa_executor.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef rsa_executor_h
+#define rsa_executor_h
+
+#include <stdio.h>
+
+#define RSA_EXECUTOR_HISTOGRAM_BUCKETS 32
+
+enum Rsa_executor_error {
+  Rsa_executor_error_none = 0,
+  Rsa_executor_error_invalid_input,
+  Rsa_executor_error_queue_full,
+  Rsa_executor_error_shutting_down
+};
+
+/**
+ Fixed pool of threads for RSA private key operations (S/MIME decryption, CSR signing, cipher key unwrapping).
+
+ Running these operations on a few dedicated threads instead of inline on request threads bounds how many run
+ at the same time and keeps their latency out of unrelated work. Requests are queued up to a fixed capacity,
+ beyond that submitting fails or waits (backpressure). Wait and service times are recorded in histograms.
+ */
+struct Rsa_executor;
+
+/**
+ Latency histogram with power of two buckets: bucket 0 counts durations below 1 µs,
+ bucket i durations in [2^(i-1), 2^i) µs, the last bucket everything longer.
+ */
+struct Rsa_executor_histogram {
+  unsigned long counts[RSA_EXECUTOR_HISTOGRAM_BUCKETS];
+  /// Number of recorded durations
+  unsigned long count;
+  /// Sum of all durations in µs
+  double total_us;
+  /// Longest duration in µs
+  double max_us;
+};
+
+struct Rsa_executor_stats {
+  /// Requests waiting in the queue
+  size_t queue_depth;
+  /// Highest queue depth seen
+  size_t max_queue_depth;
+  /// Maximum number of waiting requests
+  size_t queue_capacity;
+  /// Requests being executed
+  int running;
+  /// Number of threads
+  int threads;
+  /// Requests accepted
+  unsigned long submitted;
+  /// Requests finished
+  unsigned long completed;
+  /// Requests refused because the queue was full
+  unsigned long rejected;
+  /// Time from submission until a thread picked the request up
+  struct Rsa_executor_histogram wait;
+  /// Time the work function ran
+  struct Rsa_executor_histogram service;
+};
+
+/**
+ Work of one request, runs on a thread of the executor.
+ */
+typedef void (*rsa_executor_work)(void *context);
+
+/**
+ Called on the executor thread after the work with the measured wait and service time,
+ the request is already counted in the statistics.
+ */
+typedef void (*rsa_executor_completion)(void *context, double wait_us, double service_us);
+
+/**
+ Creates an executor and starts its threads.
+
+ @param threads Number of threads, 1 or more
+ @param queue_capacity Maximum number of waiting requests, 1 or more
+ @return Executor, NULL on failure. Free with `rsa_executor_free`
+ */
+struct Rsa_executor *rsa_executor_new(int threads, size_t queue_capacity);
+
+/**
+ Stops accepting requests, runs the already queued ones, joins the threads and frees the executor.
+ Must not be called from a thread of the executor.
+
+ @param executor Executor to free, may be NULL
+ */
+void rsa_executor_free(struct Rsa_executor *executor);
+
+/**
+ Queues a request.
+
+ @param executor Executor
+ @param work Work to run on an executor thread
+ @param completion Called after the work, may be NULL
+ @param context Passed to work and completion
+ @param timeout_seconds How long to wait for space when the queue is full: 0 fails immediately, a negative value waits without limit
+ @param err Reason of the failure
+ @return Status: 1 = queued, 0 = failure (neither work nor completion will be called)
+ */
+int rsa_executor_submit(struct Rsa_executor *executor,
+                        rsa_executor_work work,
+                        rsa_executor_completion completion,
+                        void *context,
+                        double timeout_seconds,
+                        enum Rsa_executor_error *err);
+
+/**
+ Copies the statistics.
+
+ @param executor Executor
+ @param stats Returns the statistics
+ */
+void rsa_executor_get_stats(struct Rsa_executor *executor, struct Rsa_executor_stats *stats);
+
+/**
+ Clears the counters and histograms, the queue itself is not touched.
+
+ @param executor Executor
+ */
+void rsa_executor_reset_stats(struct Rsa_executor *executor);
+
+/**
+ Estimates a percentile from a histogram as the upper bound of the bucket it falls into.
+
+ @param histogram Histogram
+ @param percentile Percentile between 0 and 100
+ @return Duration in µs, 0 for an empty histogram
+ */
+double rsa_executor_histogram_percentile(const struct Rsa_executor_histogram *histogram, double percentile);
+
+#endif /* rsa_executor_h */
@@ -0,0 +1,236 @@
+//
+//  rsa_keygen.c
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "rsa_keygen.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <openssl/bn.h>
+#include <openssl/rsa.h>
+
+#define RSA_KEYGEN_PRIMES 2
+/// FIPS 186-4 B.3.1: |p - q| must exceed 2^(bits/2 - 100)
+#define RSA_KEYGEN_MIN_PRIME_DISTANCE_BITS 100
+
+struct rsa_keygen_search {
+  pthread_mutex_t lock;
+  int prime_bits;
+  const BIGNUM *e;
+  BIGNUM *primes[RSA_KEYGEN_PRIMES];
+  int found;
+  /// Set when both primes are found or a search failed, cancels the other searches
+  int done;
+  int failed;
+};
+
+static void *rsa_keygen_fail(enum Rsa_keygen_error *err, enum Rsa_keygen_error error) {
+  if (err) {
+    *err = error;
+  }
+  return NULL;
+}
+
+/// Called by `BN_generate_prime_ex` for every candidate and Miller-Rabin round, returning 0 cancels the search
+static int rsa_keygen_callback(int a, int b, BN_GENCB *cb) {
+  (void)a;
+  (void)b;
+  struct rsa_keygen_search *search = BN_GENCB_get_arg(cb);
+  pthread_mutex_lock(&search->lock);
+  int done = search->done;
+  pthread_mutex_unlock(&search->lock);
+  return !done;
+}
+
+/// 1 if prime - 1 is coprime to e
+static int rsa_keygen_coprime(const BIGNUM *prime, const BIGNUM *e, BN_CTX *ctx) {
+  BN_CTX_start(ctx);
+  BIGNUM *prime_1 = BN_CTX_get(ctx);
+  BIGNUM *gcd = BN_CTX_get(ctx);
+  int ok = gcd && BN_sub(prime_1, prime, BN_value_one()) && BN_gcd(gcd, prime_1, e, ctx) && BN_is_one(gcd);
+  BN_CTX_end(ctx);
+  return ok;
+}
+
+/// 1 if the primes are far enough apart
+static int rsa_keygen_distant(const BIGNUM *p, const BIGNUM *q, int prime_bits, BN_CTX *ctx) {
+  BN_CTX_start(ctx);
+  BIGNUM *difference = BN_CTX_get(ctx);
+  int ok = difference && BN_sub(difference, p, q) && BN_num_bits(difference) > prime_bits - RSA_KEYGEN_MIN_PRIME_DISTANCE_BITS;
+  BN_CTX_end(ctx);
+  return ok;
+}
+
+static void *rsa_keygen_thread(void *arg) {
+  struct rsa_keygen_search *search = arg;
+  BN_CTX *ctx = BN_CTX_new();
+  BN_GENCB *cb = BN_GENCB_new();
+  BIGNUM *prime = BN_secure_new();
+  if (!ctx || !cb || !prime) {
+    pthread_mutex_lock(&search->lock);
+    search->failed = search->done = 1;
+    pthread_mutex_unlock(&search->lock);
+  } else {
+    BN_GENCB_set(cb, rsa_keygen_callback, search);
+  }
+
+  while (prime) {
+    pthread_mutex_lock(&search->lock);
+    int done = search->done;
+    pthread_mutex_unlock(&search->lock);
+    if (done) {
+      break;
+    }
+    if (BN_generate_prime_ex(prime, search->prime_bits, 0, NULL, NULL, cb) != 1) {
+      // cancelled, or an actual failure that ends the whole search
+      pthread_mutex_lock(&search->lock);
+      if (!search->done) {
+        search->failed = search->done = 1;
+      }
+      pthread_mutex_unlock(&search->lock);
+      break;
+    }
+    if (!rsa_keygen_coprime(prime, search->e, ctx)) {
+      continue;
+    }
+
+    pthread_mutex_lock(&search->lock);
+    if (!search->done &&
+        (search->found == 0 || rsa_keygen_distant(prime, search->primes[0], search->prime_bits, ctx))) {
+      search->primes[search->found++] = prime;
+      prime = search->found < RSA_KEYGEN_PRIMES ? BN_secure_new() : NULL;
+      search->done = search->found == RSA_KEYGEN_PRIMES;
+      if (!search->done && !prime) {
+        search->failed = search->done = 1;
+      }
+    }
+    pthread_mutex_unlock(&search->lock);
+  }
+
+  BN_clear_free(prime);
+  BN_GENCB_free(cb);
+  BN_CTX_free(ctx);
+  return NULL;
+}
+
+/// Completes the key from the primes like `RSA_generate_key_ex`. Returns NULL with `rejected` set if the modulus
+/// has the wrong size or d is too small, so new primes are needed, and NULL with `rejected` cleared on other failures
+static RSA *rsa_keygen_assemble(BIGNUM *p, BIGNUM *q, const BIGNUM *e, int bits, BN_CTX *ctx, int *rejected) {
+  *rejected = 0;
+  if (BN_cmp(p, q) < 0) {
+    BIGNUM *swap = p;
+    p = q;
+    q = swap;
+  }
+  BN_set_flags(p, BN_FLG_CONSTTIME);
+  BN_set_flags(q, BN_FLG_CONSTTIME);
+  RSA *rsa = RSA_new();
+  BIGNUM *n = BN_new();
+  BIGNUM *public_e = BN_dup(e);
+  BIGNUM *d = BN_secure_new();
+  BIGNUM *dmp1 = BN_secure_new();
+  BIGNUM *dmq1 = BN_secure_new();
+  BIGNUM *iqmp = BN_secure_new();
+  BN_CTX_start(ctx);
+  BIGNUM *p_1 = BN_CTX_get(ctx);
+  BIGNUM *q_1 = BN_CTX_get(ctx);
+  BIGNUM *gcd = BN_CTX_get(ctx);
+  BIGNUM *lcm = BN_CTX_get(ctx);
+
+  int ok = rsa && n && public_e && d && dmp1 && dmq1 && iqmp && lcm && BN_mul(n, p, q, ctx);
+  if (ok && BN_num_bits(n) != bits) {
+    ok = 0;
+    *rejected = 1;
+  }
+  ok = ok && BN_sub(p_1, p, BN_value_one()) && BN_sub(q_1, q, BN_value_one()) &&
+       BN_gcd(gcd, p_1, q_1, ctx) && BN_mul(lcm, p_1, q_1, ctx) && BN_div(lcm, NULL, lcm, gcd, ctx);
+  if (ok) {
+    BN_set_flags(lcm, BN_FLG_CONSTTIME);
+    ok = BN_mod_inverse(d, e, lcm, ctx) != NULL;
+  }
+  if (ok && BN_num_bits(d) <= bits / 2) {
+    ok = 0;
+    *rejected = 1;
+  }
+  ok = ok && BN_mod(dmp1, d, p_1, ctx) && BN_mod(dmq1, d, q_1, ctx) && BN_mod_inverse(iqmp, q, p, ctx) != NULL;
+  BN_CTX_end(ctx);
+  if (ok && RSA_set0_key(rsa, n, public_e, d) == 1) {
+    n = public_e = d = NULL;
+    if (RSA_set0_factors(rsa, p, q) == 1) {
+      p = q = NULL;
+      if (RSA_set0_crt_params(rsa, dmp1, dmq1, iqmp) == 1) {
+        return rsa;
+      }
+    }
+  }
+  BN_free(n);
+  BN_free(public_e);
+  BN_clear_free(d);
+  BN_clear_free(dmp1);
+  BN_clear_free(dmq1);
+  BN_clear_free(iqmp);
+  BN_clear_free(p);
+  BN_clear_free(q);
+  RSA_free(rsa);
+  return NULL;
+}
+
+EVP_PKEY *rsa_keygen_parallel(int bits, int threads, enum Rsa_keygen_error *err) {
+  if (bits < 1024 || bits % 2 != 0 || threads < 1) {
+    return rsa_keygen_fail(err, Rsa_keygen_error_invalid_input);
+  }
+  BIGNUM *e = BN_new();
+  BN_CTX *ctx = BN_CTX_new();
+  pthread_t *workers = calloc((size_t)threads, sizeof(pthread_t));
+  if (!e || !ctx || !workers || BN_set_word(e, RSA_F4) != 1) {
+    BN_free(e);
+    BN_CTX_free(ctx);
+    free(workers);
+    return rsa_keygen_fail(err, Rsa_keygen_error_generation);
+  }
+
+  RSA *rsa = NULL;
+  int failed = 0;
+  while (!rsa && !failed) {
+    struct rsa_keygen_search search = { .prime_bits = bits / 2, .e = e };
+    pthread_mutex_init(&search.lock, NULL);
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+      if (pthread_create(&workers[i], NULL, rsa_keygen_thread, &search) != 0) {
+        break;
+      }
+      started++;
+    }
+    // the calling thread searches as well
+    rsa_keygen_thread(&search);
+    for (int i = 1; i <= started; i++) {
+      pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&search.lock);
+
+    failed = search.failed;
+    if (!failed) {
+      // takes ownership of the primes, only a rejected key repeats the search, other failures end it
+      int rejected = 0;
+      rsa = rsa_keygen_assemble(search.primes[0], search.primes[1], e, bits, ctx, &rejected);
+      failed = !rsa && !rejected;
+    } else {
+      for (int i = 0; i < search.found; i++) {
+        BN_clear_free(search.primes[i]);
+      }
+    }
+  }
+  free(workers);
+  BN_CTX_free(ctx);
+  BN_free(e);
+
+  EVP_PKEY *pkey = rsa ? EVP_PKEY_new() : NULL;
+  if (!pkey || EVP_PKEY_assign_RSA(pkey, rsa) != 1) {
+    RSA_free(rsa);
+    EVP_PKEY_free(pkey);
+    return rsa_keygen_fail(err, Rsa_keygen_error_generation);
+  }
+  return pkey;
+}
@@ -0,0 +1,36 @@
+//
+//  rsa_keygen.h
+//  Krypt
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef rsa_keygen_h
+#define rsa_keygen_h
+
+#include <stdio.h>
+#include <openssl/evp.h>
+
+enum Rsa_keygen_error {
+  Rsa_keygen_error_none = 0,
+  Rsa_keygen_error_invalid_input,
+  Rsa_keygen_error_generation
+};
+
+/**
+ Generates an RSA private key with public exponent 65537, searching for the primes on several threads.
+
+ Every thread runs its own prime search with `BN_generate_prime_ex`, the same sieve and Miller-Rabin rounds
+ `RSA_generate_key_ex` uses. The first two suitable primes win and the other searches are cancelled, so the
+ latency is that of the fastest searches instead of two sequential ones. Like `RSA_generate_key_ex` the primes
+ have gcd(p - 1, e) = 1, their two top bits set and p > q. In addition |p - q| > 2^(bits/2 - 100) and
+ d > 2^(bits/2) as required by FIPS 186-4, d is computed modulo lcm(p - 1, q - 1).
+
+ @param bits Size of the modulus, even and at least 1024
+ @param threads Number of searching threads, 1 searches on the calling thread
+ @param err Error code of the failure, may be NULL
+ @return Private key, NULL on failure. Free with EVP_PKEY_free
+ */
+EVP_PKEY *rsa_keygen_parallel(int bits, int threads, enum Rsa_keygen_error *err);
+
+#endif /* rsa_keygen_h */
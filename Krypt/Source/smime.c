@@ -14,6 +14,10 @@
 #include <openssl/crypto.h>
 #include <openssl/rand.h>
 #include "helper.h"
+#include "phase_timing.h"
+
+/// Time of the last certificate checked by PKCS7_verify on this thread, the end of the chain phase
+static __thread uint64_t verify_chain_end = 0;
 
 /*
  converts PEM encoded certificate to X509
@@ -46,6 +50,7 @@ PKCS7 *get_pkcs7(const char *smime_string, BIO **bcont) {
   BIO_set_mem_eof_return(smime_membuf, 0);
   BIO_puts(smime_membuf, smime_string);
   PKCS7* pkcs7 = SMIME_read_PKCS7(smime_membuf, bcont);
+  BIO_free(smime_membuf);
   return pkcs7;
 }
 
@@ -54,16 +59,22 @@ PKCS7 *get_pkcs7(const char *smime_string, BIO **bcont) {
 /*
  decrypts the SMIME container
  */
-char *decrypt_pkcs7(PKCS7 *pkcs7, EVP_PKEY *pkey) {
+char *decrypt_pkcs7(PKCS7 *pkcs7, EVP_PKEY *pkey, uint64_t phase) {
   BIO *out = BIO_new(BIO_s_mem());
   
   if (PKCS7_decrypt(pkcs7, pkey, NULL, out, 0) != 1) {
+    phase_end(Phase_smime_decrypt_decrypt, phase, 0);
     EVP_PKEY_free(pkey);
     PKCS7_free(pkcs7);
+    BIO_free(out);
     return NULL;
   }
+  size_t length = (size_t)BIO_pending(out);
+  phase = phase_end(Phase_smime_decrypt_decrypt, phase, length);
   
   char *data = str_from_BIO(out);
+  BIO_free(out);
+  phase_end(Phase_smime_decrypt_output, phase, length);
 
   return data;
 }
@@ -76,18 +87,21 @@ char *decrypt_pkcs7(PKCS7 *pkcs7, EVP_PKEY *pkey) {
  @return Decrypted SMIME content
  */
 char *smime_decrypt(const char *encrypted, const char *privateKey) {
+  uint64_t phase = phase_begin();
   EVP_PKEY *pkey = get_key(privateKey);
+  phase = phase_end(Phase_smime_decrypt_key, phase, 0);
   if (!pkey) {
     return NULL;
   }
 
   PKCS7 *pkcs7 = get_pkcs7(encrypted, NULL);
+  phase = phase_end(Phase_smime_decrypt_parse, phase, phase ? strlen(encrypted) : 0);
   if (!pkcs7) {
     EVP_PKEY_free(pkey);
     return NULL;
   }
 
-  char *data = decrypt_pkcs7(pkcs7, pkey);
+  char *data = decrypt_pkcs7(pkcs7, pkey, phase);
   if (data != NULL) {
     EVP_PKEY_free(pkey);
     PKCS7_free(pkcs7);
@@ -133,6 +147,16 @@ X509_STORE *store_with_trusted_certs(const char** certs, int certCount) {
   return NULL;
 }
 
+/**
+ Marks the end of the chain phase, installed while phase timing is enabled. The last call is for the signer certificate
+ at depth 0, after it PKCS7_verify digests the content and checks the signature.
+ */
+static int verify_chain_callback(int ok, X509_STORE_CTX *ctx) {
+  (void)ctx;
+  verify_chain_end = phase_begin();
+  return ok;
+}
+
 /**
  Checks whether the certificate in the PKCS7 signature belongs to the signer with specific email address.
 
@@ -147,15 +171,17 @@ int pkcs7_signature_contains_email(PKCS7 *pkcs7, const char *email) {
   STACK_OF(X509) *cert_stack = PKCS7_get0_signers(pkcs7, NULL, 0);
   X509 *cert = sk_X509_num(cert_stack) ? sk_X509_value(cert_stack, 0) : NULL;
   if (!cert) {
+    sk_X509_free(cert_stack);
     return 0;
   }
   STACK_OF(OPENSSL_STRING) *emails = X509_get1_email(cert);
   const char *cert_email = sk_OPENSSL_STRING_num(emails) ? sk_OPENSSL_STRING_value(emails, 0) : NULL;
+  int contains = email && cert_email ? str_equal(email, cert_email) : 0;
 
   sk_X509_free(cert_stack);
-  sk_OPENSSL_STRING_free(emails);
+  X509_email_free(emails);
 
-  return str_equal(email, cert_email);
+  return contains;
 }
 
 /**
@@ -169,8 +195,10 @@ int pkcs7_signature_contains_email(PKCS7 *pkcs7, const char *email) {
  */
 int smime_verify(const char *decrypted, const char *sender_email, const char** certs, int certCount, char **content, enum Smime_error *err) {
   BIO *bcont = NULL;
+  uint64_t phase = phase_begin();
   
   PKCS7 *pkcs7 = get_pkcs7(decrypted, &bcont);
+  phase = phase_end(Phase_smime_verify_parse, phase, phase ? strlen(decrypted) : 0);
   if (!pkcs7) {
     unsigned long error = ERR_get_error();
     *err = (enum Smime_error) error;
@@ -178,10 +206,15 @@ int smime_verify(const char *decrypted, const char *sender_email, const char** c
   }
   
   X509_STORE *store = store_with_trusted_certs(certs, certCount);
+  phase = phase_end(Phase_smime_verify_store, phase, 0);
   if (!store) {
     PKCS7_free(pkcs7);
+    BIO_free(bcont);
     return 0;
   }
+  if (phase) {
+    X509_STORE_set_verify_cb(store, verify_chain_callback);
+  }
   
   BIO *out = BIO_new(BIO_s_mem());
 
@@ -196,12 +229,25 @@ int smime_verify(const char *decrypted, const char *sender_email, const char** c
   //  "If PKCS7_NOCHAIN is set then the certificates contained in the message are not used as untrusted CAs. This means that the whole verify chain (apart from the signer's certificate) must be contained in the trusted store." (https://www.openssl.org/docs/man1.0.2/man3/PKCS7_verify.html)
   flags |= PKCS7_NOCHAIN;
 
-  if (!pkcs7_signature_contains_email(pkcs7, sender_email)) {
+  int contains_email = pkcs7_signature_contains_email(pkcs7, sender_email);
+  phase = phase_end(Phase_smime_verify_email, phase, 0);
+  if (!contains_email) {
     *err = Smime_error_signature_doesnt_belong_to_sender;
+    PKCS7_free(pkcs7);
+    X509_STORE_free(store);
+    BIO_free(bcont);
+    BIO_free(out);
     return 0;
   }
 
+  verify_chain_end = 0;
   int ret = PKCS7_verify(pkcs7, NULL, store, bcont, out, flags);
+  if (phase) {
+    // the chain is checked first, without a callback call the verification failed before it
+    uint64_t chain_end = verify_chain_end ? verify_chain_end : phase_begin();
+    phase_record(Phase_smime_verify_chain, phase, chain_end, 0);
+    phase = phase_end(Phase_smime_verify_digest, chain_end, (size_t)BIO_pending(out));
+  }
   if (ret == 0) {
     unsigned long error = ERR_get_error();
     *err = (enum Smime_error) error;
@@ -211,7 +257,9 @@ int smime_verify(const char *decrypted, const char *sender_email, const char** c
   BIO_free(bcont);
   
   if (ret && content) {
+    size_t length = (size_t)BIO_pending(out);
     *content = str_from_BIO(out);
+    phase_end(Phase_smime_verify_output, phase, length);
   }
   
   BIO_free(out);
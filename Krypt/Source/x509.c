@@ -11,22 +11,18 @@
 #include <openssl/pem.h>
 #include <openssl/x509.h>
 #include "helper.h"
+#include "phase_timing.h"
 
 #include <openssl/err.h>
 
-/*
- * IETF RFC 5280 says serial number must be <= 20 bytes. Use 159 bits
- * so that the first bit will never be one, so that the DER encoding
- * rules won't force a leading octet.
- */
-# define SERIAL_RAND_BITS 159
-
 void x509_wrap_pubkey_free_all(BIO *prikeyin, BIO *pubkeyin, BIO *out, EVP_PKEY *prikey, EVP_PKEY *pubkey, X509 *x);
 
-char *x509_wrap_pubkey(const char *prikeypem, const char *pubkeypem) {
+/*
+ Creates the signed certificate shared by the PEM and DER outputs
+ */
+static X509 *x509_wrap_pubkey_cert(const char *prikeypem, const char *pubkeypem, uint64_t *phase) {
   BIO *prikeyin = NULL;
   BIO *pubkeyin = NULL;
-  BIO *out = NULL;
   EVP_PKEY *prikey = NULL;
   EVP_PKEY *pubkey = NULL;
   X509 *x = NULL;
@@ -37,9 +33,10 @@ char *x509_wrap_pubkey(const char *prikeypem, const char *pubkeypem) {
 
   pubkeyin = BIO_from_str(pubkeypem);
   pubkey = PEM_read_bio_PUBKEY(pubkeyin, NULL, NULL, NULL);
+  *phase = phase_end(Phase_x509_wrap_keys, *phase, 0);
 
   if (prikey == NULL || pubkey == NULL) {
-    x509_wrap_pubkey_free_all(prikeyin, pubkeyin, out, prikey, pubkey, x);
+    x509_wrap_pubkey_free_all(prikeyin, pubkeyin, NULL, prikey, pubkey, x);
     return NULL;
   }
 
@@ -61,22 +58,56 @@ char *x509_wrap_pubkey(const char *prikeypem, const char *pubkeypem) {
   X509_set_issuer_name(x, n);
 
   X509_sign(x, prikey, EVP_sha1());
+  *phase = phase_end(Phase_x509_wrap_sign, *phase, 0);
+
+  x509_wrap_pubkey_free_all(prikeyin, pubkeyin, NULL, prikey, pubkey, NULL);
+  return x;
+}
+
+char *x509_wrap_pubkey(const char *prikeypem, const char *pubkeypem) {
+  uint64_t phase = phase_begin();
+  X509 *x = x509_wrap_pubkey_cert(prikeypem, pubkeypem, &phase);
+  if (x == NULL) {
+    return NULL;
+  }
 
-  out = BIO_new(BIO_s_mem());
+  BIO *out = BIO_new(BIO_s_mem());
   BIO_set_mem_eof_return(out, 0);
   PEM_write_bio_X509(out, x);
 
   if (out == NULL) {
-    x509_wrap_pubkey_free_all(prikeyin, pubkeyin, out, prikey, pubkey, x);
+    x509_wrap_pubkey_free_all(NULL, NULL, out, NULL, NULL, x);
     return NULL;
   }
 
+  size_t length = (size_t)BIO_pending(out);
   char *str = str_from_BIO(out);
-  x509_wrap_pubkey_free_all(prikeyin, pubkeyin, out, prikey, pubkey, x);
+  x509_wrap_pubkey_free_all(NULL, NULL, out, NULL, NULL, x);
+  phase_end(Phase_x509_wrap_encode, phase, length);
 
   return str;
 }
 
+struct Der_buffer *x509_wrap_pubkey_der(const char *prikeypem, const char *pubkeypem) {
+  uint64_t phase = phase_begin();
+  X509 *x = x509_wrap_pubkey_cert(prikeypem, pubkeypem, &phase);
+  if (x == NULL) {
+    return NULL;
+  }
+
+  int length = i2d_X509(x, NULL);
+  struct Der_buffer *der = length > 0 ? der_buffer_new((size_t)length) : NULL;
+  unsigned char *p = der ? der->data : NULL;
+  if (der == NULL || i2d_X509(x, &p) != length) {
+    der_buffer_free(der);
+    der = NULL;
+  }
+  X509_free(x);
+  phase_end(Phase_x509_wrap_encode, phase, der ? der->length : 0);
+
+  return der;
+}
+
 void x509_wrap_pubkey_free_all(BIO *prikeyin, BIO *pubkeyin, BIO *out, EVP_PKEY *prikey, EVP_PKEY *pubkey, X509 *x) {
   BIO_free_all(prikeyin);
   BIO_free_all(pubkeyin);
@@ -9,7 +9,17 @@
 #define x509_h
 
 #include <stdio.h>
+#include "der_buffer.h"
 
 char *x509_wrap_pubkey(const char *prikeypem, const char *pubkeypem);
 
+/**
+ Wraps a public key in a self signed certificate, DER encoded for `SecCertificateCreateWithData`
+
+ @param prikeypem Private key signing the certificate in PEM format
+ @param pubkeypem Public key in PKCS#8 PEM format
+ @return Certificate in DER format, NULL on failure. Free with `der_buffer_free`
+ */
+struct Der_buffer *x509_wrap_pubkey_der(const char *prikeypem, const char *pubkeypem);
+
 #endif /* x509_h */